@@ -5,6 +5,7 @@
  * friend function.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 
@@ -25,13 +26,14 @@ public:
   Oxs_ChunkEnergy* energy;
   Oxs_ComputeEnergyDataThreaded ocedt;
   Oc_AlignedVector<Oxs_ComputeEnergyDataThreadedAux> thread_ocedtaux;
+  OC_BOOL fused; // If true, run via ComputeEnergyTile
 
   Oxs_ComputeEnergies_ChunkStruct
   (Oxs_ChunkEnergy* import_energy,
    const Oxs_ComputeEnergyDataThreaded& import_ocedt,
    int thread_count)
     : energy(import_energy), ocedt(import_ocedt),
-      thread_ocedtaux(thread_count) {}
+      thread_ocedtaux(thread_count), fused(0) {}
 
   Oxs_ComputeEnergies_ChunkStruct(const Oxs_ComputeEnergies_ChunkStruct&)
      = default;
@@ -66,11 +68,17 @@ public:
 
   OC_BOOL accums_initialized;
 
+  // Output arrays for fused tile terms.  Each may be null.
+  Oxs_MeshValue<OC_REAL8m>* energy_accum;
+  Oxs_MeshValue<ThreeVector>* H_accum;
+  OC_BOOL have_fused_terms;
+
   Oxs_ComputeEnergiesChunkThread()
     : state(0),
       mxH(0),mxH_accum(0),
       mxHxm(0), fixed_spins(0),
-      cache_blocksize(0), accums_initialized(0) {}
+      cache_blocksize(0), accums_initialized(0),
+      energy_accum(0), H_accum(0), have_fused_terms(0) {}
 
   void Cmd(int threadnumber, void* data);
 
@@ -102,6 +110,7 @@ Oxs_ComputeEnergiesChunkThread::Cmd
   // position in the fixed_spins array between chunks.
   OC_INDEX i_fixed = 0;
   OC_INDEX i_fixed_total = 0;
+  OC_INDEX last_chunk_stop = 0;
   if(fixed_spins) i_fixed_total = fixed_spins->size();
 
   // Local vector to hold Oxs_ComputeEnergyDataThreadedAux results.
@@ -109,6 +118,9 @@ Oxs_ComputeEnergiesChunkThread::Cmd
   Oc_AlignedVector<Oxs_ComputeEnergyDataThreadedAux>
     eit_ocedtaux(energy_terms->size());
 
+  // Accumulation buffer for fused tile terms.
+  Oxs_ChunkEnergyTile tile;
+
   while(1) {
     // Claim a chunk
     OC_INDEX index_start,index_stop;
@@ -127,17 +139,23 @@ Oxs_ComputeEnergiesChunkThread::Cmd
       OC_INDEX icache_stop = icache_start + cache_blocksize;
       if(icache_stop>index_stop) icache_stop = index_stop;
 
-      // Process chunk
+      // Process chunk.  Terms not using the fused tile interface are
+      // run first, one after another across the whole cache block.
+      // The first of these fills rather than accumulates, unless
+      // the accums were initialized by non-chunk energies.
+      OC_BOOL block_initialized = accums_initialized;
       OC_INDEX energy_item = 0;
       for(std::vector<Oxs_ComputeEnergies_ChunkStruct>::iterator eit
             = energy_terms->begin();
           eit != energy_terms->end() ; ++eit, ++energy_item) {
+        if(eit->fused) continue;
 
         // Set up some refs for convenience
         Oxs_ChunkEnergy& eterm = *(eit->energy);
         Oxs_ComputeEnergyDataThreaded ocedt = eit->ocedt; // Local copy
         Oxs_ComputeEnergyDataThreadedAux& ocedtaux = eit_ocedtaux[energy_item];
-        if(!accums_initialized && energy_item==0) {
+        if(!block_initialized) {
+          block_initialized = 1;
           // Note: Each thread has its own copy of the ocedt and
           // ocedtaux data, so we can tweak these as desired without
           // stepping on other threads
@@ -204,14 +222,79 @@ Oxs_ComputeEnergiesChunkThread::Cmd
         }
       }
 
+      // Fused tile terms.  Each tile is seeded from the accum arrays
+      // (or zero if those are not yet initialized), all fused terms add
+      // into the tile, and the tile is written back once.  Seeding from
+      // the accum arrays keeps the summation order the same as running
+      // the fused terms through ComputeEnergyChunk after the others.
+      if(have_fused_terms) {
+        for(OC_INDEX itile=icache_start;itile<icache_stop;
+            itile+=Oxs_ChunkEnergyTile::MAXSIZE) {
+          tile.node_start = itile;
+          tile.node_stop = itile + Oxs_ChunkEnergyTile::MAXSIZE;
+          if(tile.node_stop>icache_stop) tile.node_stop = icache_stop;
+          const OC_INDEX tsize = tile.node_stop - tile.node_start;
+          const ThreeVector zerovec(0.,0.,0.);
+          if(block_initialized && energy_accum) {
+            for(OC_INDEX k=0;k<tsize;++k) {
+              tile.energy[k] = (*energy_accum)[itile+k];
+            }
+          } else {
+            for(OC_INDEX k=0;k<tsize;++k) tile.energy[k] = 0.0;
+          }
+          if(block_initialized && H_accum) {
+            for(OC_INDEX k=0;k<tsize;++k) tile.H[k] = (*H_accum)[itile+k];
+          } else {
+            for(OC_INDEX k=0;k<tsize;++k) tile.H[k] = zerovec;
+          }
+          if(block_initialized && mxH_accum) {
+            for(OC_INDEX k=0;k<tsize;++k) {
+              tile.mxH[k] = (*mxH_accum)[itile+k];
+            }
+          } else {
+            for(OC_INDEX k=0;k<tsize;++k) tile.mxH[k] = zerovec;
+          }
+
+          energy_item = 0;
+          for(std::vector<Oxs_ComputeEnergies_ChunkStruct>::iterator eit
+                = energy_terms->begin();
+              eit != energy_terms->end() ; ++eit, ++energy_item) {
+            if(!eit->fused) continue;
+            eit->energy->ComputeEnergyTile(*state,
+                                           eit_ocedtaux[energy_item],
+                                           tile,threadnumber);
+          }
+
+          if(energy_accum) {
+            for(OC_INDEX k=0;k<tsize;++k) {
+              (*energy_accum)[itile+k] = tile.energy[k];
+            }
+          }
+          if(H_accum) {
+            for(OC_INDEX k=0;k<tsize;++k) (*H_accum)[itile+k] = tile.H[k];
+          }
+          if(mxH_accum) {
+            for(OC_INDEX k=0;k<tsize;++k) {
+              (*mxH_accum)[itile+k] = tile.mxH[k];
+            }
+          }
+        }
+      }
+
       // Post-processing, for this energy term and chunk.
 
-      // Zero torque on fixed spins.  This code assumes that, 1) the
-      // fixed_spins list is sorted in increasing order, and 2) the
-      // chunk indices come in strictly monotonically increasing
-      // order.
+      // Zero torque on fixed spins.  This code assumes that the
+      // fixed_spins list is sorted in increasing order.  Chunks
+      // usually come in increasing order, but not always (a stolen
+      // job may lie below the previous chunk), in which case the
+      // search position is reset with a binary search.
       // NB: Outside this loop, "i_fixed" stores the search start
       // location for the next chunk.
+      if(icache_start < last_chunk_stop && i_fixed_total>0) {
+        i_fixed = std::lower_bound(fixed_spins->begin(),fixed_spins->end(),
+                                   icache_start) - fixed_spins->begin();
+      }
+      last_chunk_stop = icache_stop;
       while(i_fixed < i_fixed_total) {
         OC_INDEX index = (*fixed_spins)[i_fixed];
         if(index <  icache_start) { ++i_fixed; continue; }
@@ -341,6 +424,18 @@ Oxs_ComputeEnergiesChunkThread::Cmd
   }
 }
 
+void
+Oxs_ChunkEnergy::ComputeEnergyTile
+(const Oxs_SimState& /* state */,
+ Oxs_ComputeEnergyDataThreadedAux& /* ocedtaux */,
+ Oxs_ChunkEnergyTile& /* tile */,
+ int /* threadnumber */) const
+{ // Only called if FusedTileSupport() returns true, in which case
+  // the child class must override this member.
+  throw Oxs_ExtError(this,"Programming error: ComputeEnergyTile"
+                     " called on term without fused tile support.");
+}
+
 #if REPORT_TIME
 Nb_StopWatch Oxs_ChunkEnergy::chunktime;
 
@@ -494,17 +589,17 @@ void Oxs_ComputeEnergies
 
   const int thread_count = Oc_GetMaxThreadCount();
 
-  // Export names for attach support. These should become const member
+  // Export keys for attach support. These should become const member
   // variables if this routine is moved into a class.
   using wkq = Oxs_Director::WellKnownQuantity; // shortcut
-  const String energy_density_name
-    = director.GetWellKnownQuantityLabel(wkq::total_energy_density);
-  const String total_H_name
-    = director.GetWellKnownQuantityLabel(wkq::total_H);
-  const String total_mxH_name
-    = director.GetWellKnownQuantityLabel(wkq::total_mxH);
-  const String total_mxHxm_name
-    = director.GetWellKnownQuantityLabel(wkq::total_mxHxm);
+  const Oxs_DerivedDataKey energy_density_key
+    = director.GetWellKnownQuantityKey(wkq::total_energy_density);
+  const Oxs_DerivedDataKey total_H_key
+    = director.GetWellKnownQuantityKey(wkq::total_H);
+  const Oxs_DerivedDataKey total_mxH_key
+    = director.GetWellKnownQuantityKey(wkq::total_mxH);
+  const Oxs_DerivedDataKey total_mxHxm_key
+    = director.GetWellKnownQuantityKey(wkq::total_mxHxm);
 #ifndef NODEBUG
   for(auto q : Oxs_Director::WellKnownQuantity_List) {
     assert(!director.WellKnownQuantityRequestStatus(q)
@@ -529,7 +624,7 @@ void Oxs_ComputeEnergies
     // Don't re-set if value already in state DerivedData (which is
     // anyway improper since DerivedData are supposed to be const).
     const Oxs_MeshValue<OC_REAL8m>* value = nullptr;
-    if(!state.GetDerivedData(energy_density_name,value)) {
+    if(!state.GetDerivedData(energy_density_key,value)) {
       energy = &energy_storage;
   }
   }
@@ -540,7 +635,7 @@ void Oxs_ComputeEnergies
      director.WellKnownQuantityRequestStatus(wkq::total_H)) {
     // Don't re-set if value already in state DerivedData
     const Oxs_MeshValue<ThreeVector>* value = nullptr;
-    if(!state.GetDerivedData(total_H_name,value)) {
+    if(!state.GetDerivedData(total_H_key,value)) {
       H = &H_storage;
   }
   }
@@ -551,7 +646,7 @@ void Oxs_ComputeEnergies
      director.WellKnownQuantityRequestStatus(wkq::total_mxH)) {
     // Don't re-set if value already in state DerivedData
     const Oxs_MeshValue<ThreeVector>* value = nullptr;
-    if(!state.GetDerivedData(total_mxH_name,value)) {
+    if(!state.GetDerivedData(total_mxH_key,value)) {
       mxH = &mxH_storage;
     }
   }
@@ -562,7 +657,7 @@ void Oxs_ComputeEnergies
      director.WellKnownQuantityRequestStatus(wkq::total_mxHxm)) {
     // Don't re-set if value already in state DerivedData
     const Oxs_MeshValue<ThreeVector>* value = nullptr;
-    if(!state.GetDerivedData(total_mxHxm_name,value)) {
+    if(!state.GetDerivedData(total_mxHxm_key,value)) {
       mxHxm = &mxHxm_storage;
     }
   }
@@ -583,16 +678,16 @@ void Oxs_ComputeEnergies
     if(mxH)    *(ocee.mxH)   = zerovec;
     if(mxHxm)  *(ocee.mxHxm) = zerovec;
     if(director.WellKnownQuantityRequestStatus(wkq::total_energy_density)) {
-      state.AddDerivedData(energy_density_name,std::move(energy->SharedCopy()));
+      state.AddDerivedData(energy_density_key,std::move(energy->SharedCopy()));
       }
     if(director.WellKnownQuantityRequestStatus(wkq::total_H)) {
-      state.AddDerivedData(total_H_name,std::move(H->SharedCopy()));
+      state.AddDerivedData(total_H_key,std::move(H->SharedCopy()));
     }
     if(director.WellKnownQuantityRequestStatus(wkq::total_mxH)) {
-      state.AddDerivedData(total_mxH_name,std::move(mxH->SharedCopy()));
+      state.AddDerivedData(total_mxH_key,std::move(mxH->SharedCopy()));
       }
     if(director.WellKnownQuantityRequestStatus(wkq::total_mxHxm)) {
-      state.AddDerivedData(total_mxHxm_name,std::move(mxHxm->SharedCopy()));
+      state.AddDerivedData(total_mxHxm_key,std::move(mxHxm->SharedCopy()));
     }
     return;
   }
@@ -636,14 +731,14 @@ void Oxs_ComputeEnergies
       dynamic_cast<Oxs_ChunkEnergy*>(*it);
     if(ceptr != NULL) {
       // Set up and initialize chunk energy structures
-      if(ceptr->energy_density_output.GetCacheRequestCount()>0) {
+      if(ceptr->energy_density_output.IsDemanded(state)) {
         ceptr->energy_density_output.cache.state_id=0;
         ocedt_base.energy = &(ceptr->energy_density_output.cache.value);
         ocedt_base.energy->AdjustSize(state.mesh);
       } else {
         ocedt_base.energy = 0;
       }
-      if(ceptr->field_output.GetCacheRequestCount()>0) {
+      if(ceptr->field_output.IsDemanded(state)) {
         ceptr->field_output.cache.state_id=0;
         ocedt_base.H = &(ceptr->field_output.cache.value);
         ocedt_base.H->AdjustSize(state.mesh);
@@ -652,6 +747,14 @@ void Oxs_ComputeEnergies
       }
       chunk.push_back(Oxs_ComputeEnergies_ChunkStruct(ceptr,
                                            ocedt_base,thread_count));
+#if OXS_CHUNK_FUSED_TILES
+      // Term outputs are filled by ComputeEnergyChunk, so terms with
+      // active term outputs are not fused.
+      if(ocedt_base.energy == 0 && ocedt_base.H == 0
+         && ceptr->FusedTileSupport(state)) {
+        chunk.back().fused = 1;
+      }
+#endif // OXS_CHUNK_FUSED_TILES
     } else {
       nonchunk.push_back(*it);
     }
@@ -688,13 +791,13 @@ void Oxs_ComputeEnergies
 
     // TODO: Rework output classes to use state DerivedData space.  As
     //       an interim step, make use of Oxs_MeshValue<T>.SharedCopy().
-    if(eterm.energy_density_output.GetCacheRequestCount()>0) {
+    if(eterm.energy_density_output.IsDemanded(state)) {
       eterm.energy_density_output.cache.state_id=0;
       term_oced.energy = &(eterm.energy_density_output.cache.value);
       term_oced.energy->AdjustSize(state.mesh);
     }
 
-    if(eterm.field_output.GetCacheRequestCount()>0) {
+    if(eterm.field_output.IsDemanded(state)) {
       eterm.field_output.cache.state_id=0;
       term_oced.H = &(eterm.field_output.cache.value);
       term_oced.H->AdjustSize(state.mesh);
@@ -713,10 +816,10 @@ void Oxs_ComputeEnergies
     ++(eterm.calc_count);
     eterm.ComputeEnergy(state,term_oced);
 
-    if(eterm.field_output.GetCacheRequestCount()>0) {
+    if(eterm.field_output.IsDemanded(state)) {
       eterm.field_output.cache.state_id=state.Id();
     }
-    if(eterm.energy_density_output.GetCacheRequestCount()>0) {
+    if(eterm.energy_density_output.IsDemanded(state)) {
       eterm.energy_density_output.cache.state_id=state.Id();
     }
     if(eterm.energy_sum_output.GetCacheRequestCount()>0) {
@@ -801,6 +904,11 @@ void Oxs_ComputeEnergies
   chunk_thread.max_mxH.resize(thread_count);
   chunk_thread.cache_blocksize = cache_blocksize;
   chunk_thread.accums_initialized = accums_initialized;
+  chunk_thread.energy_accum = energy;
+  chunk_thread.H_accum = H;
+  for(size_t ic=0;ic<chunk.size();++ic) {
+    if(chunk[ic].fused) chunk_thread.have_fused_terms = 1;
+  }
 
   // Initialize chunk energy computations
   for(std::vector<Oxs_ComputeEnergies_ChunkStruct>::iterator itc
@@ -859,11 +967,11 @@ void Oxs_ComputeEnergies
       eterm.energy_sum_output.cache.state_id=state.Id();
     }
 
-    if(eterm.field_output.GetCacheRequestCount()>0) {
+    if(eterm.field_output.IsDemanded(state)) {
       eterm.field_output.cache.state_id=state.Id();
     }
 
-    if(eterm.energy_density_output.GetCacheRequestCount()>0) {
+    if(eterm.energy_density_output.IsDemanded(state)) {
       eterm.energy_density_output.cache.state_id=state.Id();
     }
 
@@ -885,16 +993,16 @@ void Oxs_ComputeEnergies
   // Honor attachment requests
   // NB: SharedCopy() marks *H as read-only.
   if(director.WellKnownQuantityRequestStatus(wkq::total_energy_density)) {
-    state.AddDerivedData(energy_density_name,std::move(energy->SharedCopy()));
+    state.AddDerivedData(energy_density_key,std::move(energy->SharedCopy()));
   }
   if(director.WellKnownQuantityRequestStatus(wkq::total_H)) {
-    state.AddDerivedData(total_H_name,std::move(H->SharedCopy()));
+    state.AddDerivedData(total_H_key,std::move(H->SharedCopy()));
   }
   if(director.WellKnownQuantityRequestStatus(wkq::total_mxH)) {
-    state.AddDerivedData(total_mxH_name,std::move(mxH->SharedCopy()));
+    state.AddDerivedData(total_mxH_key,std::move(mxH->SharedCopy()));
   }
   if(director.WellKnownQuantityRequestStatus(wkq::total_mxHxm)) {
-    state.AddDerivedData(total_mxHxm_name,std::move(mxHxm->SharedCopy()));
+    state.AddDerivedData(total_mxHxm_key,std::move(mxHxm->SharedCopy()));
   }
 
 #if REPORT_TIME
@@ -116,6 +116,38 @@ public:
   // Note implicit copy constructor and assignment operator.
 };
 
+////////////////////////////////////////////////////////////////////////
+// Fused tile support.  Energy terms that can compute their energy
+// density, field, and torque cell-by-cell from local data can
+// optionally implement the Oxs_ChunkEnergy::ComputeEnergyTile
+// interface.  Oxs_ComputeEnergies then runs all such terms together,
+// one small tile of cells at a time, with the energy, H, and mxH sums
+// held in an Oxs_ChunkEnergyTile buffer that stays in L1 cache.  The
+// totals are written to the output arrays once per tile, rather than
+// once per term.  Set OXS_CHUNK_FUSED_TILES to 0 to disable the fused
+// path; all terms are then run through ComputeEnergyChunk.
+#ifndef OXS_CHUNK_FUSED_TILES
+# define OXS_CHUNK_FUSED_TILES 1
+#endif
+
+struct Oxs_ChunkEnergyTile {
+public:
+  enum { MAXSIZE = 128 }; // Sized to fit L1 cache with spin and Ms.
+
+  // Cells node_start through node_stop-1.  Element k of the buffers
+  // below corresponds to mesh index node_start+k.
+  OC_INDEX node_start;
+  OC_INDEX node_stop;
+
+  // Running sums.  ComputeEnergyTile implementations add their
+  // contributions into these; they never fill.
+  OC_REAL8m   energy[MAXSIZE];
+  ThreeVector H[MAXSIZE];
+  ThreeVector mxH[MAXSIZE];
+
+  Oxs_ChunkEnergyTile() : node_start(0), node_stop(0) {}
+};
+
 
 ////////////////////////////////////////////////////////////////////////
 // Oxs_ChunkEnergy class: child class of Oxs_Energy that supports an
@@ -230,6 +262,28 @@ protected:
   // ComputeEnergyChunkInitialize is run on thread 0 so the main
   // Tcl interpreter is accessible.)
 
+  // Optional fused tile interface.  If FusedTileSupport returns true
+  // for a given state, then Oxs_ComputeEnergies may call
+  // ComputeEnergyTile in place of ComputeEnergyChunk.  (It does so
+  // only when the term-specific energy density and field outputs are
+  // not requested.)  ComputeEnergyTile adds the energy density, field,
+  // and m x H for cells tile.node_start through tile.node_stop-1 into
+  // the tile buffers, and adds the energy and pE_pt sums into
+  // ocedtaux, just as ComputeEnergyChunk does for the *_accum arrays.
+  // Cells with Ms == 0 should contribute zero energy and torque.
+  // ComputeEnergyChunkInitialize and ComputeEnergyChunkFinalize are
+  // called as usual, and the thread safety requirements are the same
+  // as for ComputeEnergyChunk.  The default implementations report no
+  // support.
+  virtual OC_BOOL FusedTileSupport(const Oxs_SimState& /* state */) const {
+    return 0;
+  }
+  virtual void
+  ComputeEnergyTile(const Oxs_SimState& state,
+                    Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
+                    Oxs_ChunkEnergyTile& tile,
+                    int threadnumber) const;
+
   // ComputeEnergyAlt is an adapter that can (optionally) be used to
   // allow ComputeEnergyChunk code to provide the parent
   // Oxs_Energy::ComputeEnergy interface.
@@ -19,6 +19,7 @@
 #include "driver.h"
 #include "energy.h"
 #include "ext.h"
+#include "fieldwriter.h"
 #include "key.h"
 #include "mesh.h"
 #include "meshvalue.h"
@@ -53,7 +54,8 @@ void Oxs_Director::ExitProc(ClientData clientData)
 Oxs_Director::Oxs_Director(Tcl_Interp *i)
   : interp(i),
     problem_count(0),problem_id(0),
-    restart_flag(0),restart_crc_check_flag(1),mif_crc(0),
+    restart_flag(0),restart_crc_check_flag(1),tensor_cache_memory(0),
+    mif_crc(0),
     error_status(0),driver(NULL),
     simulation_state_reserve_count(0)
 {
@@ -795,6 +797,10 @@ void Oxs_Director::ForceRelease()
 
 void Oxs_Director::Release()
 {
+  // Queued background field writes refer to meshes owned by the
+  // Oxs_Ext objects deleted below, so wait for them to finish.
+  Oxs_FieldWriter::Flush();
+
   if(problem_id==0) {
     // problem_id==0 indicates that no problem is loaded.
     // Normally we should be able to just return here, but
@@ -1555,6 +1561,15 @@ Oxs_Director::OutputCacheRequestIncrement(const char* output_token,
   return TCL_OK;
 }
 
+int
+Oxs_Director::OutputDemandPeriod(const char* output_token,
+                                 OC_UINT4m period) const
+{
+  Oxs_Output* obj = InterpretOutputToken(output_token);
+  obj->SetDemandPeriod(period);
+  return TCL_OK;
+}
+
 void Oxs_Director::OutputNames(const char* output_token,
                                vector<String>& label_value_names) const
 { // Fills export label_value_names with label-value pairs for the
@@ -1987,35 +2002,35 @@ Oxs_Director::SetWellKnownQuantityLabel
                 "Well known quantity label \"total_energy_density\""
                 " set multiple times.");
     }
-    well_known_quantity_store.E_density.derived_label=label; break;
+    well_known_quantity_store.E_density.SetLabel(label);    break;
   case WellKnownQuantity::total_H:
     if(!well_known_quantity_store.H.derived_label.empty()) {
       OXS_THROW(Oxs_ProgramLogicError,
                 "Well known quantity label \"total_H\""
                 " set multiple times.");
     }
-    well_known_quantity_store.H.derived_label=label;         break;
+    well_known_quantity_store.H.SetLabel(label);            break;
   case WellKnownQuantity::total_mxH:
     if(!well_known_quantity_store.mxH.derived_label.empty()) {
       OXS_THROW(Oxs_ProgramLogicError,
                 "Well known quantity label \"total_mxH\""
                 " set multiple times.");
     }
-    well_known_quantity_store.mxH.derived_label=label;       break;
+    well_known_quantity_store.mxH.SetLabel(label);          break;
   case WellKnownQuantity::total_mxHxm:
     if(!well_known_quantity_store.mxHxm.derived_label.empty()) {
       OXS_THROW(Oxs_ProgramLogicError,
                 "Well known quantity label \"total_mxHxm\""
                 " set multiple times.");
     }
-    well_known_quantity_store.mxHxm.derived_label=label;     break;
+    well_known_quantity_store.mxHxm.SetLabel(label);        break;
   case WellKnownQuantity::dm_dt:
     if(!well_known_quantity_store.dm_dt.derived_label.empty()) {
       OXS_THROW(Oxs_ProgramLogicError,
                 "Well known quantity label \"dm_dt\""
                 " set multiple times.");
     }
-    well_known_quantity_store.dm_dt.derived_label=label;     break;
+    well_known_quantity_store.dm_dt.SetLabel(label);        break;
 
   default:
     OXS_THROW(Oxs_BadParameter,
@@ -2045,6 +2060,28 @@ Oxs_Director::GetWellKnownQuantityLabel
   return label;
 }
 
+Oxs_DerivedDataKey
+Oxs_Director::GetWellKnownQuantityKey
+(WellKnownQuantity quantity)
+  const
+{
+  Oxs_DerivedDataKey key;
+  switch(quantity) {
+  case WellKnownQuantity::total_energy_density:
+    key=well_known_quantity_store.E_density.derived_key; break;
+  case WellKnownQuantity::total_H:
+    key=well_known_quantity_store.H.derived_key;         break;
+  case WellKnownQuantity::total_mxH:
+    key=well_known_quantity_store.mxH.derived_key;       break;
+  case WellKnownQuantity::total_mxHxm:
+    key=well_known_quantity_store.mxHxm.derived_key;     break;
+  default:
+    OXS_THROW(Oxs_BadParameter,
+              "Invalid \"well known quantity\" request.");
+  }
+  return key;
+}
+
 bool
 Oxs_Director::WellKnownQuantityRequestStatus
 (WellKnownQuantity quantity)
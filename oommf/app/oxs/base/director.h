@@ -114,6 +114,12 @@ private:
   /// string is equivalent to ".", which uses the directory holding
   /// the problem MIF file.
 
+  OC_UINDEX tensor_cache_memory; // Memory budget, in bytes, for
+  /// process-wide caches of computed interaction tensors, such as the
+  /// Oxs_Demag tensor registry.  Set from the Oxs
+  /// demag_tensor_cache_memory_MB option in config/options.tcl.  The
+  /// default is zero, which disables such caches.
+
   // MIF object, which holds mif_interp, a slave of interp.  This is
   // created inside ProbInit(), and is held until Release().  The
   // MIF CRC and Parameters string are also determined at this time,
@@ -201,10 +207,17 @@ private:
   struct WellKnownQuantityInfo {
     bool attach_request;
     String derived_label;
+    Oxs_DerivedDataKey derived_key; // Interned derived_label
     WellKnownQuantityInfo() : attach_request(false) {}
+    void SetLabel(const String& label) {
+      derived_label = label;
+      if(label.empty()) derived_key = Oxs_DerivedDataKey();
+      else              derived_key = Oxs_DerivedDataKey(label);
+    }
     void Reset() {
       attach_request = false;
       derived_label.clear();
+      derived_key = Oxs_DerivedDataKey();
     }
   };
   struct {
@@ -325,6 +338,11 @@ public:
   }
   OC_BOOL CheckRestartCrc() const { return restart_crc_check_flag; }
 
+  void SetTensorCacheMemory(OC_UINDEX bytes) {
+    tensor_cache_memory = bytes;
+  }
+  OC_UINDEX GetTensorCacheMemory() const { return tensor_cache_memory; }
+
   String GetMifParameters() const;
   /// Returns parameters string as stored in current MIF
   /// object.  Throws an error if no problem is loaded.
@@ -426,6 +444,9 @@ public:
              int argc,const char** argv);
   int OutputCacheRequestIncrement(const char* output_token,
                                   OC_INT4m incr) const;
+  int OutputDemandPeriod(const char* output_token,
+                         OC_UINT4m period) const;
+  /// Sets scheduled demand period on output; see Oxs_Output.
   void OutputNames(const char* output_token,
                    std::vector<String>& label_value_names) const;
   /// Fills export label_value_names with label-value pairs for the
@@ -600,6 +621,9 @@ public:
   void SetWellKnownQuantityLabel(WellKnownQuantity quantity,
                                  const String& label);
   String GetWellKnownQuantityLabel(WellKnownQuantity quantity) const;
+  Oxs_DerivedDataKey GetWellKnownQuantityKey(WellKnownQuantity quantity) const;
+  /// Interned form of GetWellKnownQuantityLabel(), for use with the
+  /// Oxs_SimState derived data calls.
   bool WellKnownQuantityRequestStatus(WellKnownQuantity quantity) const;
   bool WellKnownQuantityRequestStatus() const {
      // Returns true if any attach requests have been made.
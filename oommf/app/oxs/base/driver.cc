@@ -553,6 +553,11 @@ Oxs_Driver::Oxs_Driver
 
   // Report max spin angle?  This value is preferably reported by
   // the exchange term, but can be computed by the driver if desired.
+  maxang_key = DataKey("Max Spin Ang");
+  stage_maxang_key = DataKey("Stage Max Spin Ang");
+  run_maxang_key = DataKey("Run Max Spin Ang");
+  prevstate_stage_maxang_key = DataKey("PrevState Stage Max Spin Ang");
+  prevstate_run_maxang_key = DataKey("PrevState Run Max Spin Ang");
   if(GetIntInitValue("report_max_spin_angle",0)) {
     report_max_spin_angle = 1;
     SimstateHoldRequest(2); // Run and stage max angle computation
@@ -1277,7 +1282,7 @@ void Oxs_Driver::FillStateDerivedData
   if(report_max_spin_angle) {
     // Carry across old stage and run maxang data
     OC_REAL8m run_maxang = -1.;
-    if(!old_state.GetDerivedData(DataName("Run Max Spin Ang"),run_maxang)) {
+    if(!old_state.GetDerivedData(run_maxang_key,run_maxang)) {
       // Spin angle data not filled.  Insure that maxang is
       // computed every step.  This is a little extra work; if we
       // wanted, we could coordinate this with the solver so that
@@ -1287,17 +1292,17 @@ void Oxs_Driver::FillStateDerivedData
       // adding a maxang_guess value to the state, but it is
       // probably not worth the trouble.
       UpdateSpinAngleData(old_state);
-      old_state.GetDerivedData(DataName("Run Max Spin Ang"),run_maxang);
+      old_state.GetDerivedData(run_maxang_key,run_maxang);
     }
-    new_state.AddDerivedData(DataName("PrevState Run Max Spin Ang"),
+    new_state.AddDerivedData(prevstate_run_maxang_key,
                              run_maxang);
     OC_REAL8m stage_maxang = -1.;
-    if(!old_state.GetDerivedData(DataName("Stage Max Spin Ang"),
+    if(!old_state.GetDerivedData(stage_maxang_key,
                                  stage_maxang)) {
       UpdateSpinAngleData(old_state);
-      old_state.GetDerivedData(DataName("Stage Max Spin Ang"),stage_maxang);
+      old_state.GetDerivedData(stage_maxang_key,stage_maxang);
     }
-    new_state.AddDerivedData(DataName("PrevState Stage Max Spin Ang"),
+    new_state.AddDerivedData(prevstate_stage_maxang_key,
                              stage_maxang);
   }
 }
@@ -1381,14 +1386,14 @@ void Oxs_Driver::FillNewStageStateDerivedData
     // Carry across run maxang data, and
     // initialize prevstate stage maxang to 0.
     OC_REAL8m run_maxang = -1.0;
-    if(!old_state.GetDerivedData(DataName("Run Max Spin Ang"),run_maxang)) {
+    if(!old_state.GetDerivedData(run_maxang_key,run_maxang)) {
       // Spin angle data not filled in current state
       UpdateSpinAngleData(old_state); // Update
-      old_state.GetDerivedData(DataName("Run Max Spin Ang"),run_maxang);
+      old_state.GetDerivedData(run_maxang_key,run_maxang);
     }
-    new_state.AddDerivedData(DataName("PrevState Run Max Spin Ang"),
+    new_state.AddDerivedData(prevstate_run_maxang_key,
                              run_maxang);
-    new_state.AddDerivedData(DataName("PrevState Stage Max Spin Ang"),
+    new_state.AddDerivedData(prevstate_stage_maxang_key,
                              0.0);
   }
 }
@@ -1603,18 +1608,18 @@ void Oxs_Driver::Run(vector<OxsRunEvent>& results,
         // Update max spin angle data, as necessary
         OC_REAL8m angle_data = 0.0; // Dummy init to pacify compilers
         if(maxSpinAng_output.cache.state_id != cstate.Id()
-           && cstate.GetDerivedData(DataName("Max Spin Ang"),angle_data)) {
+           && cstate.GetDerivedData(maxang_key,angle_data)) {
           maxSpinAng_output.cache.value = angle_data;
           maxSpinAng_output.cache.state_id = cstate.Id();
         }
         if(stage_maxSpinAng_output.cache.state_id != cstate.Id()
-           && cstate.GetDerivedData(DataName("Stage Max Spin Ang"),
+           && cstate.GetDerivedData(stage_maxang_key,
                                     angle_data)) {
           stage_maxSpinAng_output.cache.value = angle_data;
           stage_maxSpinAng_output.cache.state_id = cstate.Id();
         }
         if(run_maxSpinAng_output.cache.state_id != cstate.Id()
-           && cstate.GetDerivedData(DataName("Run Max Spin Ang"),angle_data)) {
+           && cstate.GetDerivedData(run_maxang_key,angle_data)) {
           run_maxSpinAng_output.cache.value = angle_data;
           run_maxSpinAng_output.cache.state_id = cstate.Id();
         }
@@ -1778,9 +1783,9 @@ void Oxs_Driver::UpdateSpinAngleData(const Oxs_SimState& state) const
                 " but Oxs_Driver::UpdateSpinAngleData is called.");
   }
   OC_REAL8m maxangle,stage_maxangle,run_maxangle;
-  if(state.GetDerivedData(DataName("Max Spin Ang"),maxangle)
-     && state.GetDerivedData(DataName("Stage Max Spin Ang"),stage_maxangle)
-     && state.GetDerivedData(DataName("Run Max Spin Ang"),run_maxangle)) {
+  if(state.GetDerivedData(maxang_key,maxangle)
+     && state.GetDerivedData(stage_maxang_key,stage_maxangle)
+     && state.GetDerivedData(run_maxang_key,run_maxangle)) {
     return; // Nothing to do
   }
   if(maxSpinAng_output.cache.state_id == state.Id()
@@ -1790,9 +1795,9 @@ void Oxs_Driver::UpdateSpinAngleData(const Oxs_SimState& state) const
     maxangle = maxSpinAng_output.cache.value;
     stage_maxangle = stage_maxSpinAng_output.cache.value;
     run_maxangle = run_maxSpinAng_output.cache.value;
-    state.AddDerivedData(DataName("Max Spin Ang"),maxangle);
-    state.AddDerivedData(DataName("Stage Max Spin Ang"),stage_maxangle);
-    state.AddDerivedData(DataName("Run Max Spin Ang"),run_maxangle);
+    state.AddDerivedData(maxang_key,maxangle);
+    state.AddDerivedData(stage_maxang_key,stage_maxangle);
+    state.AddDerivedData(run_maxang_key,run_maxangle);
     return;
   }
 
@@ -1810,14 +1815,14 @@ void Oxs_Driver::UpdateSpinAngleData(const Oxs_SimState& state) const
     }
   }
   maxangle *= (180./PI);
-  state.GetDerivedData(DataName("PrevState Stage Max Spin Ang"),
+  state.GetDerivedData(prevstate_stage_maxang_key,
                        stage_maxangle);
-  state.GetDerivedData(DataName("PrevState Run Max Spin Ang"),run_maxangle);
+  state.GetDerivedData(prevstate_run_maxang_key,run_maxangle);
   if(maxangle>stage_maxangle) stage_maxangle = maxangle;
   if(maxangle>run_maxangle)   run_maxangle = maxangle;
-  state.AddDerivedData(DataName("Max Spin Ang"),maxangle);
-  state.AddDerivedData(DataName("Stage Max Spin Ang"),stage_maxangle);
-  state.AddDerivedData(DataName("Run Max Spin Ang"),run_maxangle);
+  state.AddDerivedData(maxang_key,maxangle);
+  state.AddDerivedData(stage_maxang_key,stage_maxangle);
+  state.AddDerivedData(run_maxang_key,run_maxangle);
 }
 
 /// UpdateSpinAngleData
@@ -1871,10 +1876,10 @@ Oxs_Driver::Fill__maxSpinAng_output_fini
   maxangle *= (180./PI);
 
   OC_REAL8m stage_maxangle=0.0,run_maxangle=0.0;
-  state.GetDerivedData(DataName("PrevState Stage Max Spin Ang"),
+  state.GetDerivedData(prevstate_stage_maxang_key,
                        stage_maxangle);
   if(maxangle>stage_maxangle) stage_maxangle=maxangle;
-  state.GetDerivedData(DataName("PrevState Run Max Spin Ang"),run_maxangle);
+  state.GetDerivedData(prevstate_run_maxang_key,run_maxangle);
   if(maxangle>run_maxangle)   run_maxangle=maxangle;
   maxSpinAng_output.cache.value=maxangle;
   stage_maxSpinAng_output.cache.value=stage_maxangle;
@@ -1883,9 +1888,9 @@ Oxs_Driver::Fill__maxSpinAng_output_fini
   stage_maxSpinAng_output.cache.state_id =
   run_maxSpinAng_output.cache.state_id = state.Id();
 
-  if(!state.AddDerivedData(DataName("Max Spin Ang"),maxangle)
-     || !state.AddDerivedData(DataName("Stage Max Spin Ang"),stage_maxangle)
-     || !state.AddDerivedData(DataName("Run Max Spin Ang"),run_maxangle)) {
+  if(!state.AddDerivedData(maxang_key,maxangle)
+     || !state.AddDerivedData(stage_maxang_key,stage_maxangle)
+     || !state.AddDerivedData(run_maxang_key,run_maxangle)) {
     static Oxs_WarningMessage multangle(3);
     multangle.Send(revision_info,OC_STRINGIFY(__LINE__),
                    "Programming error? Max spin angle computed"
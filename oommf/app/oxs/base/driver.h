@@ -175,6 +175,11 @@ Oxs_ScalarOutput<Oxs_Driver> name##_output
   // are not set, in keeping with UpdateSpinAngleData() being a const
   // member function.
   OC_BOOL report_max_spin_angle;
+  Oxs_DerivedDataKey maxang_key;       // State derived data keys
+  Oxs_DerivedDataKey stage_maxang_key; // for the max spin angle
+  Oxs_DerivedDataKey run_maxang_key;   // values; set by constructor.
+  Oxs_DerivedDataKey prevstate_stage_maxang_key;
+  Oxs_DerivedDataKey prevstate_run_maxang_key;
   void UpdateSpinAngleData(const Oxs_SimState& state) const;
   Oxs_ChunkScalarOutput<Oxs_Driver> maxSpinAng_output;
   Oxs_ChunkScalarOutput<Oxs_Driver> stage_maxSpinAng_output;
@@ -124,13 +124,13 @@ void Oxs_Energy::UpdateStandardOutputs(const Oxs_SimState& state)
   oced.scratch_energy = &dummy_energy;
   oced.scratch_H      = &dummy_field;
 
-  if(energy_density_output.GetCacheRequestCount()>0) {
+  if(energy_density_output.IsDemanded(state)) {
     energy_density_output.cache.state_id=0;
     oced.scratch_energy = oced.energy = &energy_density_output.cache.value;
     oced.energy->AdjustSize(state.mesh);
   }
 
-  if(field_output.GetCacheRequestCount()>0) {
+  if(field_output.IsDemanded(state)) {
     field_output.cache.state_id=0;
     oced.scratch_H = oced.H = &field_output.cache.value;
     oced.H->AdjustSize(state.mesh);
@@ -139,10 +139,10 @@ void Oxs_Energy::UpdateStandardOutputs(const Oxs_SimState& state)
   ++calc_count;
   ComputeEnergy(state,oced);
 
-  if(energy_density_output.GetCacheRequestCount()>0) {
+  if(energy_density_output.IsDemanded(state)) {
     energy_density_output.cache.state_id=state.Id();
   }
-  if(field_output.GetCacheRequestCount()>0) {
+  if(field_output.IsDemanded(state)) {
     field_output.cache.state_id=state.Id();
   }
   if(energy_sum_output.GetCacheRequestCount()>0) {
@@ -200,12 +200,12 @@ void Oxs_Energy::GetEnergyData
   energytime.Start();
 #endif // REPORT_TIME
 
-  if(field_output.GetCacheRequestCount()>0) {
+  if(field_output.IsDemanded(state)) {
     field_output.cache.state_id=0;
     oed.field_buffer = &field_output.cache.value;
   }
 
-  if(energy_density_output.GetCacheRequestCount()>0) {
+  if(energy_density_output.IsDemanded(state)) {
     energy_density_output.cache.state_id=0;
     oed.energy_buffer = &energy_density_output.cache.value;
   }
@@ -216,10 +216,10 @@ void Oxs_Energy::GetEnergyData
   ++calc_count;
   GetEnergy(state,oed);
 
-  if(field_output.GetCacheRequestCount()>0) {
+  if(field_output.IsDemanded(state)) {
     field_output.cache.state_id=state.Id();
   }
-  if(energy_density_output.GetCacheRequestCount()>0) {
+  if(energy_density_output.IsDemanded(state)) {
     energy_density_output.cache.state_id=state.Id();
   }
   if(energy_sum_output.GetCacheRequestCount()>0) {
@@ -569,12 +569,12 @@ void Oxs_Energy::AccumEnergyAndTorque
   energytime.Start();
 #endif // REPORT_TIME
 
-  if(energy_density_output.GetCacheRequestCount()>0) {
+  if(energy_density_output.IsDemanded(state)) {
     energy_density_output.cache.state_id=0;
     oced.energy = &energy_density_output.cache.value;
   }
 
-  if(field_output.GetCacheRequestCount()>0) {
+  if(field_output.IsDemanded(state)) {
     field_output.cache.state_id=0;
     oced.H = &field_output.cache.value;
   }
@@ -586,10 +586,10 @@ void Oxs_Energy::AccumEnergyAndTorque
   ++calc_count;
   ComputeEnergy(state,oced);
 
-  if(field_output.GetCacheRequestCount()>0) {
+  if(field_output.IsDemanded(state)) {
     field_output.cache.state_id=state.Id();
   }
-  if(energy_density_output.GetCacheRequestCount()>0) {
+  if(energy_density_output.IsDemanded(state)) {
     energy_density_output.cache.state_id=state.Id();
   }
   if(energy_sum_output.GetCacheRequestCount()>0) {
@@ -305,6 +305,36 @@ protected:
   virtual ~Oxs_EnergyPreconditionerSupport() {}
 };
 
+////////////////////////////////////////////////////////////////////////
+// Optional interface for energy terms.  Energy terms whose field has
+// the linear nearest-neighbour form
+//
+//   H[i] = 1/(MU0*Ms[i]) * \sum_j wgt_ij * (m[j]-m[i])
+//
+// on a rectangular mesh, where j runs over the (up to six) face
+// neighbours of cell i having Ms[j] != 0, wrapping across periodic
+// boundaries, and wgt_ij is one of wgtx, wgty, wgtz according to the
+// axis joining cells i and j, may report the weights through this
+// interface.  Evolvers can use this to treat the term implicitly.
+class Oxs_EnergyLinearExchangeSupport {
+public:
+  struct LinearExchangeData {
+    // Import to GetLinearExchange
+    const Oxs_SimState* state;
+
+    // Exports from GetLinearExchange, in J/m^3.  For uniform exchange
+    // coefficient A these are 2*A/(cellsize*cellsize).
+    OC_REAL8m wgtx, wgty, wgtz;
+  };
+  virtual OC_INT4m GetLinearExchange(LinearExchangeData& led) const =0;
+  /// Returns 1 and fills the weights in led if the field of *this for
+  /// led.state has the form above, 0 otherwise.
+
+protected:
+  Oxs_EnergyLinearExchangeSupport() {}
+  virtual ~Oxs_EnergyLinearExchangeSupport() {}
+};
+
 
 ////////////////////////////////////////////////////////////////////////
 // Oxs_ComputeEnergies compute sums of energies, fields, and/or
@@ -63,11 +63,13 @@ OxsExtUserOutput::LookupSource
       throw msg;
     }
 
-    // Request caching on source field.  This request is
-    // decremented when uo is destroyed, provided that
-    // source_field is still registered with the director
-    // at that time.
-    source_field->CacheRequestIncrement(1);
+    // Register as a dependent of the source field, so that scheduled
+    // demand on this output carries over to the source.  The source
+    // is otherwise filled on demand by Fill__user_outputs_init.  The
+    // dependency is removed when uo is destroyed, provided that
+    // source_field is still registered with the director at that
+    // time.
+    source_field->AddDependent(&output);
 
     // If output units were not specified by user, copy value
     // from source.
@@ -86,10 +88,9 @@ OxsExtUserOutput::~OxsExtUserOutput()
     // source_field pointer is apparently still valid,
     // since Oxs_Output objects are contractually obligated
     // to de-register on destruction.  Therefore, we can
-    // decrement the cache request, to pair with the increment
-    // that is performed when uo is linked to source_field
-    // (cf. Oxs_Ext::Init()).
-      source_field->CacheRequestIncrement(-1);
+    // remove the dependency that is set when uo is linked
+    // to source_field (cf. LookupSource()).
+      source_field->RemoveDependent(&output);
     }
 }
 
@@ -1373,7 +1374,11 @@ Oxs_Ext::Fill__user_outputs_init
     }
 
     // Initialize source field.  When chunk vector fields
-    // are coded, call their initializer instead.
+    // are coded, call their initializer instead.  The cache
+    // request is held until Fill__user_outputs_fini, and is
+    // a no-op if the source was filled on the main path
+    // because of scheduled demand.
+    uo.source_field->CacheRequestIncrement(1);
     uo.source_field->UpdateCache(&state);
 
     // Initialize selector and selector scaling
@@ -1471,6 +1476,7 @@ Oxs_Ext::Fill__user_outputs_fini
     }
     output.cache.value=sum*uo.scaling;
     output.cache.state_id=state.Id();
+    uo.source_field->CacheRequestIncrement(-1); // Pairs with _init
   } // index<user_output.GetSize()
 }
 
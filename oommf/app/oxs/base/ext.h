@@ -448,6 +448,11 @@ public:
     // and Oxs_SimState::Add/GetAuxData().
     return instanceId + String(":") + String(item);
   }
+  Oxs_DerivedDataKey DataKey(const char* item) const {
+    // Interned form of DataName(), for Oxs_SimState derived data
+    // accessed every step.  Build once, in Init() or the constructor.
+    return Oxs_DerivedDataKey(DataName(item));
+  }
 
   // Read access to mif_options member (above). If import label is a key
   // in mif_options, then fills export value and returns true. Otherwise
@@ -0,0 +1,239 @@
+/* FILE: fieldwriter.cc                 -*-Mode: c++-*-
+ *
+ * Background writer for Oxs field output files.  See fieldwriter.h.
+ *
+ */
+
+#include "fieldwriter.h"
+#include "oxsexcept.h"
+
+OC_USE_STD_NAMESPACE;  // Specify std namespace, if supported
+OC_USE_STRING;
+
+/* End includes */
+
+#if OOMMF_THREADS
+// Tcl event used to notify the main thread that one or more writes
+// have finished.  The event carries no data; the event proc simply
+// dispatches everything on the completed list.  Flush() followed by
+// DispatchCompleted() may empty the list before the event is serviced,
+// in which case the event is a NOP.
+struct OxsFieldWriterEvent {
+  Tcl_Event header;
+};
+
+static int OxsFieldWriterEventProc(Tcl_Event*,int /* flags */)
+{
+  Tcl_Interp* interp = Oc_GlobalInterpreter();
+  if(interp != nullptr) {
+    Oxs_FieldWriter::DispatchCompleted(interp);
+  }
+  return 1; // Tcl frees the event
+}
+#endif // OOMMF_THREADS
+
+Oxs_FieldWriter::Oxs_FieldWriter()
+  : Oxs_ThreadThrowaway("Oxs_FieldWriter"),
+    queue_depth(2), in_progress(0), task_running(0)
+#if OOMMF_THREADS
+  , main_thread(Tcl_GetCurrentThread())
+#endif
+{}
+
+Oxs_FieldWriter::~Oxs_FieldWriter()
+{
+  // The Oxs_ThreadThrowaway destructor waits (with timeout) for the
+  // writer thread to exit.  Callbacks for any writes still in the
+  // queue are dropped, as the interpreter may already be gone.
+  try {
+    Flush();
+  } catch(...) {}
+}
+
+Oxs_FieldWriter& Oxs_FieldWriter::Instance()
+{
+  static Oxs_FieldWriter writer;
+  return writer;
+}
+
+void Oxs_FieldWriter::SetQueueDepth(OC_INDEX depth)
+{
+  if(depth<0) depth = 0;
+  Oxs_FieldWriter& fw = Instance();
+  if(depth < fw.queue_depth) {
+    fw.Flush(); // Don't leave more jobs in the queue than allowed
+  }
+#if OOMMF_THREADS
+  std::lock_guard<std::mutex> lck(fw.mutex);
+#endif
+  fw.queue_depth = depth;
+}
+
+OC_INDEX Oxs_FieldWriter::GetQueueDepth()
+{
+  return Instance().queue_depth;
+}
+
+OC_BOOL Oxs_FieldWriter::IsAsync()
+{
+#if OOMMF_THREADS
+  return (Instance().queue_depth>0);
+#else
+  return 0;
+#endif
+}
+
+void Oxs_FieldWriter::Submit(std::unique_ptr<Oxs_FieldWriteJob> job)
+{
+  if(!job) return;
+  Oxs_FieldWriter& fw = Instance();
+#if OOMMF_THREADS
+  if(fw.queue_depth>0) {
+    OC_BOOL dolaunch = 0;
+    {
+      std::unique_lock<std::mutex> lck(fw.mutex);
+      fw.main_thread = Tcl_GetCurrentThread();
+      // Backpressure: wait for the writer to catch up.
+      fw.space_available.wait(lck,[&fw] {
+          return (static_cast<OC_INDEX>(fw.queue.size())+fw.in_progress
+                  < fw.queue_depth); });
+      fw.queue.push_back(std::move(job));
+      if(!fw.task_running) {
+        // Launch new thread.  Otherwise the running thread will pick
+        // up the new job when it finishes the current one.
+        fw.task_running = 1;
+        dolaunch = 1;
+      }
+    }
+    if(dolaunch) {
+      try {
+        fw.Launch();
+      } catch(...) {
+        std::lock_guard<std::mutex> lck(fw.mutex);
+        fw.task_running = 0;
+        fw.queue.clear();
+        throw;
+      }
+    }
+    return;
+  }
+#endif // OOMMF_THREADS
+  // Synchronous fallback, for clients that don't check IsAsync().
+  // Errors propagate to the caller; on success the callback is left
+  // for the next DispatchCompleted() call.
+  job->Write();
+  Completion done;
+  done.callback = job->callback;
+  done.filename = job->filename;
+  fw.completed.push_back(done);
+}
+
+void Oxs_FieldWriter::Flush()
+{
+#if OOMMF_THREADS
+  Oxs_FieldWriter& fw = Instance();
+  std::unique_lock<std::mutex> lck(fw.mutex);
+  fw.idle.wait(lck,[&fw] { return !fw.task_running; });
+#endif
+}
+
+void Oxs_FieldWriter::Task()
+{ // Runs on writer thread.
+#if OOMMF_THREADS
+  while(1) {
+    std::unique_ptr<Oxs_FieldWriteJob> job;
+    {
+      std::lock_guard<std::mutex> lck(mutex);
+      if(queue.empty()) {
+        task_running = 0;
+        idle.notify_all();
+        break;
+      }
+      job = std::move(queue.front());
+      queue.pop_front();
+      ++in_progress;
+    }
+
+    Completion done;
+    done.callback = job->callback;
+    done.filename = job->filename;
+    try {
+      job->Write();
+    } catch(Oxs_Exception& oxserr) {
+      done.errmsg = oxserr.MessageText();
+    } catch(Oc_Exception& ocerr) {
+      Oc_AutoBuf msg;
+      ocerr.ConstructMessage(msg);
+      done.errmsg = msg.GetStr();
+    } catch(const String& smsg) {
+      done.errmsg = smsg;
+    } catch(const char* cmsg) {
+      done.errmsg = cmsg;
+    } catch(...) {
+      done.errmsg = "Unrecognized exception";
+    }
+    if(!done.errmsg.empty()) {
+      done.errmsg = String("Error writing Ovf file \"") + done.filename
+        + String("\": ") + done.errmsg;
+    }
+    job.reset(); // Release snapshot before making room in the queue
+
+    Tcl_ThreadId notify_thread;
+    {
+      std::lock_guard<std::mutex> lck(mutex);
+      completed.push_back(done);
+      --in_progress;
+      notify_thread = main_thread;
+      space_available.notify_all();
+    }
+
+    OxsFieldWriterEvent* ev
+      = reinterpret_cast<OxsFieldWriterEvent*>
+         (ckalloc(sizeof(OxsFieldWriterEvent)));
+    ev->header.proc = OxsFieldWriterEventProc;
+    ev->header.nextPtr = nullptr;
+    Tcl_ThreadQueueEvent(notify_thread,&(ev->header),TCL_QUEUE_TAIL);
+    Tcl_ThreadAlert(notify_thread);
+  }
+#endif // OOMMF_THREADS
+}
+
+void Oxs_FieldWriter::DispatchCompleted(Tcl_Interp* interp)
+{
+  Oxs_FieldWriter& fw = Instance();
+  std::vector<Completion> work;
+  {
+#if OOMMF_THREADS
+    std::lock_guard<std::mutex> lck(fw.mutex);
+#endif
+    work.swap(fw.completed);
+  }
+  for(const Completion& done : work) {
+    if(RunCallback(interp,done.callback,done.filename,done.errmsg)
+       != TCL_OK) {
+      Tcl_BackgroundError(interp);
+    }
+  }
+}
+
+int Oxs_FieldWriter::RunCallback
+(Tcl_Interp* interp,
+ const String& callback,
+ const String& filename,
+ const String& errmsg)
+{
+  if(callback.empty()) return TCL_OK;
+  Tcl_Obj* cmd = Tcl_NewStringObj(callback.c_str(),-1);
+  Tcl_IncrRefCount(cmd);
+  int result = Tcl_ListObjAppendElement(interp,cmd,
+                     Tcl_NewStringObj(filename.c_str(),-1));
+  if(result == TCL_OK) {
+    result = Tcl_ListObjAppendElement(interp,cmd,
+                     Tcl_NewStringObj(errmsg.c_str(),-1));
+  }
+  if(result == TCL_OK) {
+    result = Tcl_EvalObjEx(interp,cmd,TCL_EVAL_GLOBAL);
+  }
+  Tcl_DecrRefCount(cmd);
+  return result;
+}
@@ -0,0 +1,164 @@
+/* FILE: fieldwriter.h                 -*-Mode: c++-*-
+ *
+ * Background writer for Oxs field output files.  Oxs_FieldOutput<T>
+ * hands a snapshot of its cache to the writer, which formats the data
+ * and writes the OVF file on a separate thread so that the solver can
+ * continue with the next step.  The writer keeps a bounded queue of
+ * pending writes; the solver only blocks when the queue is full.
+ *
+ * Completion is reported back to the main thread through the Tcl event
+ * loop.  Each write request carries a Tcl command prefix that is run in
+ * the global interpreter once the file is closed, with the filename and
+ * an error message (empty on success) appended.  Oxs_Output uses this
+ * to defer sending the file to mmArchive/mmDisp until the file is
+ * complete.
+ *
+ */
+
+#ifndef _OXS_FIELDWRITER
+#define _OXS_FIELDWRITER
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "oc.h"
+#include "vf.h"
+
+#include "meshvalue.h"
+#include "oxsthread.h"
+
+OC_USE_STD_NAMESPACE;  // Specify std namespace, if supported
+OC_USE_STRING;
+
+/* End includes */
+
+////////////////////////////////////////////////////////////////////////
+// Base class for a single queued write.  Write() is called on the
+// writer thread, and throws on error.  The job owns everything Write()
+// needs except the mesh, which must remain valid until the job is
+// done; Oxs_Director::Release() calls Oxs_FieldWriter::Flush() before
+// deleting any meshes.
+class Oxs_FieldWriteJob {
+public:
+  const String filename;
+  const String callback;
+  Oxs_FieldWriteJob(const char* filename_,const char* callback_)
+    : filename(filename_), callback(callback_) {}
+  virtual ~Oxs_FieldWriteJob() {}
+  virtual void Write() = 0;
+};
+
+template<class T>
+class Oxs_MeshValueWriteJob : public Oxs_FieldWriteJob {
+public:
+  // Data snapshot.  Filled by the requester before submission, either
+  // with a shared copy of a read-only cache (copy-on-write; see
+  // Oxs_MeshValue<T>::SharedCopy()) or with a deep copy of a mutable
+  // cache.
+  Oxs_MeshValue<T> value;
+
+  Oxs_MeshValueWriteJob(const char* filename_,const char* callback_,
+                        OC_BOOL do_headers_,const char* title_,
+                        const char* desc_,
+                        const vector<String>& valuelabels_,
+                        const vector<String>& valueunits_,
+                        Vf_Ovf20_MeshType meshtype_,
+                        Vf_OvfDataStyle datastyle_,
+                        const char* textfmt_,
+                        const Vf_Ovf20_MeshNodes* mesh_,
+                        Vf_OvfFileVersion ovf_version_)
+    : Oxs_FieldWriteJob(filename_,callback_),
+      do_headers(do_headers_), title(title_), desc(desc_),
+      valuelabels(valuelabels_), valueunits(valueunits_),
+      meshtype(meshtype_), datastyle(datastyle_), textfmt(textfmt_),
+      mesh(mesh_), ovf_version(ovf_version_) {}
+
+  void Write() override {
+    Oxs_MeshValueOutputField<T>(filename.c_str(),do_headers,title.c_str(),
+                                desc.c_str(),valuelabels,valueunits,
+                                meshtype,datastyle,textfmt.c_str(),
+                                mesh,&value,ovf_version);
+  }
+
+private:
+  const OC_BOOL do_headers;
+  const String title;
+  const String desc;
+  vector<String> valuelabels;
+  vector<String> valueunits;
+  const Vf_Ovf20_MeshType meshtype;
+  const Vf_OvfDataStyle datastyle;
+  const String textfmt;
+  const Vf_Ovf20_MeshNodes* const mesh;
+  const Vf_OvfFileVersion ovf_version;
+};
+
+////////////////////////////////////////////////////////////////////////
+// Process-wide writer.  All public members are static, and except as
+// noted are for use from the main thread only.
+class Oxs_FieldWriter : public Oxs_ThreadThrowaway {
+public:
+  // Maximum number of writes outstanding (queued plus in progress).
+  // The default is 2, i.e., one file being written while the next is
+  // waiting.  A depth of 0 disables the writer thread; in that case,
+  // and in non-threaded builds, IsAsync() returns false and clients
+  // should write synchronously.
+  static void SetQueueDepth(OC_INDEX depth);
+  static OC_INDEX GetQueueDepth();
+  static OC_BOOL IsAsync();
+
+  // Queue job for writing.  Blocks if the queue is full.
+  static void Submit(std::unique_ptr<Oxs_FieldWriteJob> job);
+
+  // Wait for all queued writes to finish.  Callbacks for the finished
+  // writes are left pending; see DispatchCompleted().
+  static void Flush();
+
+  // Runs callbacks for all finished writes, in completion order.  Errors
+  // raised by callbacks are passed to Tcl_BackgroundError.  This is
+  // also called from the Tcl event loop as writes finish.
+  static void DispatchCompleted(Tcl_Interp* interp);
+
+  // Runs "callback filename errmsg" in the global namespace of interp.
+  // Used for both asynchronous and synchronous completions.
+  static int RunCallback(Tcl_Interp* interp,const String& callback,
+                         const String& filename,const String& errmsg);
+
+  ~Oxs_FieldWriter();
+
+protected:
+  void Task() override;
+
+private:
+  Oxs_FieldWriter();
+  static Oxs_FieldWriter& Instance();
+
+  struct Completion {
+    String callback;
+    String filename;
+    String errmsg;
+  };
+
+  OC_INDEX queue_depth;
+  std::deque< std::unique_ptr<Oxs_FieldWriteJob> > queue;
+  OC_INDEX in_progress;   // Jobs removed from queue but not finished
+  OC_BOOL task_running;   // True if writer thread is active
+  std::vector<Completion> completed;
+#if OOMMF_THREADS
+  Tcl_ThreadId main_thread;
+  std::mutex mutex;
+  std::condition_variable space_available;
+  std::condition_variable idle;
+#endif
+  /// NB: queue, in_progress, task_running and completed are accessed
+  /// from both the main thread and the writer thread, and must only be
+  /// accessed with mutex held.
+
+  // Disable copy constructor and assignment operator.
+  Oxs_FieldWriter(const Oxs_FieldWriter&) = delete;
+  Oxs_FieldWriter& operator=(const Oxs_FieldWriter&) = delete;
+};
+
+#endif // _OXS_FIELDWRITER
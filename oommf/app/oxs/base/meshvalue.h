@@ -248,8 +248,10 @@ public:
   Oxs_MeshValue(const Oxs_MeshValue<T> &other);  // Copy constructor
   Oxs_MeshValue<T>& operator=(const Oxs_MeshValue<T> &other);
 
-  // Move constructor and assignment operator.
-  Oxs_MeshValue(Oxs_MeshValue<T>&& other);
+  // Move constructor and assignment operator.  The move constructor
+  // is noexcept so that std::vector reallocation moves rather than
+  // copies.
+  Oxs_MeshValue(Oxs_MeshValue<T>&& other) noexcept;
   Oxs_MeshValue<T>& operator=(Oxs_MeshValue<T>&& other);
 
   // Mark as read-only. Once set, cannot be unset.
@@ -556,7 +558,7 @@ Oxs_MeshValue<T>::operator=(Oxs_MeshValue<T>&& other)
 
 // Move constructor
 template<class T>
-Oxs_MeshValue<T>::Oxs_MeshValue(Oxs_MeshValue<T>&& other)
+Oxs_MeshValue<T>::Oxs_MeshValue(Oxs_MeshValue<T>&& other) noexcept
   : arr(other.arr), size(other.size),
     arrblock(std::move(other.arrblock)),
     read_only_lock(other.read_only_lock)
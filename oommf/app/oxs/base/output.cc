@@ -12,7 +12,7 @@
 /* End includes */
 
 Oxs_Output::Oxs_Output()
-  : director(NULL), cache_request_count(0),
+  : director(NULL), cache_request_count(0), demand_period(0),
     priority(0)
 {}
 
@@ -31,7 +31,52 @@ void Oxs_Output::Setup
   output_name = output_name_;
   output_type = output_type_;
   output_units = output_units_;
+  long_name_key = Oxs_DerivedDataKey(LongName());
   cache_request_count = 0;  // Reset to 0.
+  demand_period = 0;
+}
+
+void Oxs_Output::AddDependent(const Oxs_Output* dependent)
+{
+  if(dependent == this) {
+    OXS_THROW(Oxs_ProgramLogicError,
+              "Output object can't depend on itself.");
+  }
+  for(auto dep : dependents) {
+    if(dep == dependent) return; // Already registered
+  }
+  dependents.push_back(dependent);
+}
+
+void Oxs_Output::RemoveDependent(const Oxs_Output* dependent)
+{
+  for(auto it = dependents.begin(); it != dependents.end(); ++it) {
+    if(*it == dependent) {
+      dependents.erase(it);
+      return;
+    }
+  }
+}
+
+OC_BOOL Oxs_Output::HasScheduledDemand() const
+{
+  if(demand_period>0) return 1;
+  for(auto dep : dependents) {
+    if(dep->HasScheduledDemand()) return 1;
+  }
+  return 0;
+}
+
+OC_BOOL Oxs_Output::IsScheduled(const Oxs_SimState& state) const
+{ // NB: Dependency chains are short (typically a single user output
+  // per source), so the recursion here is cheap.
+  if(demand_period>0 && state.iteration_count%demand_period == 0) {
+    return 1;
+  }
+  for(auto dep : dependents) {
+    if(dep->IsScheduled(state)) return 1;
+  }
+  return 0;
 }
 
 void Oxs_Output::Register
@@ -13,6 +13,7 @@
 #define _OXS_OUTPUT
 
 #include <string>
+#include <vector>
 
 #include "oc.h"
 
@@ -35,6 +36,7 @@ private:
   String output_name;
   String output_type;  // "scalar", "vector field", or "scalar field"
   String output_units;
+  Oxs_DerivedDataKey long_name_key; // Interned LongName(), set by Setup
 
   // The CacheRequestIncrement routine puts requests in (positive
   // argument) or out (negative argument) to have the cache updated with
@@ -50,6 +52,17 @@ private:
   // goes to zero.
   OC_UINT4m cache_request_count;
 
+  // Demand-driven evaluation.  Cache requests (above) are persistent
+  // and mark the output as needed for every state.  Output schedules
+  // declare a finer grained demand through demand_period: if non-zero,
+  // the output will be read for states with iteration_count a multiple
+  // of demand_period.  Outputs computed from other outputs (such as
+  // Oxs_Ext user outputs) are registered as dependents of their
+  // sources, so that scheduled demand on a dependent carries over to
+  // the source.  See IsDemanded() below.
+  OC_UINT4m demand_period;
+  std::vector<const Oxs_Output*> dependents;
+
   OC_INT4m priority; // Output evaluation priority.  Smaller
   /// is higher priority.  Default priority is 0.  This
   /// can only be set from Oxs_Output::Register function,
@@ -84,7 +97,8 @@ protected:
              const char* output_type_,
              const char* output_units_);
   // Called from public child Setup members, to initialize private
-  // data.  Also resets cache_request_count to 0.  A previous fifth
+  // data.  Also resets cache_request_count and demand_period to 0.
+  // A previous fifth
   // optional parameter "cache_support" has been deprecated since
   // 2021-03-18 (commit 110419aca0d2).
 
@@ -104,6 +118,7 @@ public:
   String OwnerName()  const { return owner_name;  }
   String OutputName() const { return output_name; }
   String LongName() const;
+  const Oxs_DerivedDataKey& LongNameKey() const { return long_name_key; }
   String OutputType() const { return output_type; }
   String OutputUnits() const { return output_units; }
   virtual int SetOutputFormat(const String& format) =0;
@@ -125,6 +140,29 @@ public:
   }
   OC_UINT4m GetCacheRequestCount() const { return cache_request_count; }
 
+  // Demand control.  Producers that can fill an output as a side
+  // effect of a main-path computation (e.g., energy terms filling
+  // term field outputs inside Oxs_ComputeEnergies) should do so only
+  // if IsDemanded(state) is true.  Outputs not demanded for a given
+  // state are instead filled on request by the output's own update
+  // routine, if and when the output is actually read.
+  //   SetDemandPeriod() is called from the output scheduler
+  // (schedule.tcl, via Oxs_Director::OutputDemandPeriod).  A period
+  // of 0 removes any scheduled demand.  AddDependent() and
+  // RemoveDependent() manage the dependency graph; the dependent
+  // must be removed before it is destroyed.
+  void SetDemandPeriod(OC_UINT4m period) { demand_period = period; }
+  OC_UINT4m GetDemandPeriod() const { return demand_period; }
+  void AddDependent(const Oxs_Output* dependent);
+  void RemoveDependent(const Oxs_Output* dependent);
+  OC_BOOL HasScheduledDemand() const; // True if this output or any
+  /// dependent has a non-zero demand period.
+  OC_BOOL IsScheduled(const Oxs_SimState& state) const; // True if
+  /// this output or any dependent is scheduled for state.
+  OC_BOOL IsDemanded(const Oxs_SimState& state) const {
+    return (cache_request_count>0 || IsScheduled(state));
+  }
+
   OC_INT4m Priority() const { return priority; }
 
   // Output unit kludge added to support "user output" initialization
@@ -86,6 +86,12 @@ Oc_Class Oxs_Output {
       # When the problem is released, output handles become invalid,
       # so Oxs_Output instances must be destroyed.
       Oc_EventHandler New _ Oxs Release [list $class DeleteAll]
+
+      # Background field output queue depth; 0 writes field output
+      # files synchronously. See config/options.tcl.
+      if {![Oc_Option Get Oxs field_output_queue_depth _]} {
+         Oxs_FieldWriterQueueDepth $_
+      }
    }
    proc ThreadExitCleanup { thread } {
       # This should be triggered on thread Delete, not thread
@@ -190,6 +196,22 @@ Oc_Class Oxs_Output {
       catch {unset directory($name)}
    }
 
+   proc SetDemandPeriod {outputname period} {
+      # Passes the scheduled demand period for outputname (see
+      # Oxs_Schedule UpdateDemand) to the underlying output object.
+      # DataTable demand applies to all scalar outputs.
+      if {[string compare DataTable $outputname]==0} {
+         set names $scalars
+      } else {
+         set names [list $outputname]
+      }
+      foreach n $names {
+         if {[info exists directory($n)]} {
+            Oxs_OutputDemandPeriod [$directory($n) Cget -handle] $period
+         }
+      }
+   }
+
    proc GetOutputNames {} {
       return [array names directory]
    }
@@ -369,24 +391,41 @@ Oc_Class Oxs_Output {
             lappend check_exports $export_id
          } elseif {[string compare "Interactive" $event] != 0} {
             return -1  ;# Data already sent, so ignore repeats.
-            ## (The non-error return value is the Net_Thread message
-            ## id.) A special case is interactive requests, which are
-            ## always honored.
+            ## (The non-error return value is otherwise the temporary
+            ## file name.) A special case is interactive requests,
+            ## which are always honored.
          }
       }
 
       # Piece together a temporary file name
       set temp [Oc_TempName [file tail [dict get $params basename]] \
                    [file extension $filename]]
-      Oxs_OutputGet $handle $temp
 
-      # Send data
-      set msgid [$thread Send datafile [list $temp $filename]]
+      # The file may be written in the background (see Oxs_FieldWriter
+      # in fieldwriter.h), in which case Oxs_OutputGet returns before
+      # the file is complete. The data are sent from the SendDataFile
+      # callback, which runs once the file is closed.
+      Oxs_OutputGet $handle $temp [list $class SendDataFile $thread $filename]
+   }
+
+   proc SendDataFile { thread filename temp errmsg } {
+      # Completion callback for field output writes. Imports are
+      # Net_Thread object, destination filename, temporary file name,
+      # and an error message, which is empty if the write succeeded.
+      if {![string match {} $errmsg]} {
+         catch {file delete $temp}
+         Oc_Log Log $errmsg error
+         return
+      }
+      if {[catch {$thread Send datafile [list $temp $filename]} msgid]} {
+         # Destination went away while the file was being written.
+         catch {file delete $temp}
+         return
+      }
       dict set tmpfiles $thread $msgid $temp
       Oc_EventHandler New _ $thread Reply${msgid} \
          [list dict unset [$class GlobalName tmpfiles] $thread $msgid] \
          -groups [list $thread]
-      return $msgid
    }
 
    proc Send {outputname destname event} {
@@ -23,6 +23,7 @@
 #include "output.h"
 
 #include "exterror.h"
+#include "fieldwriter.h"
 #include "meshvalue.h"
 #include "simstate.h"
 #include "oxsexcept.h"
@@ -475,6 +476,16 @@ protected:
   virtual const Oxs_MeshValue<T>*
      GetCacheBuffer(const Oxs_SimState* state) const=0;
 
+  // Fills snapshot with the current cache contents, for background
+  // writing by Oxs_FieldWriter.  The snapshot must not change if the
+  // cache is later refilled.  The default implementation makes a deep
+  // copy; cache classes holding immutable data override this with a
+  // shared (copy-on-write) copy.
+  virtual void SnapshotCache(const Oxs_SimState* state,
+                             Oxs_MeshValue<T>& snapshot) const {
+    snapshot = *GetCacheBuffer(state);
+  }
+
   String output_filename_script; // Empty string to use default
   /// file naming method, otherwise script taking a "params"
   /// dictionary that is run inside the MIF interp.
@@ -604,10 +615,16 @@ int Oxs_FieldOutput<T>::Output
  Tcl_Interp* interp,        // Tcl interpreter
  int argc,const char** argv)      // Args
 {
+  // Args are filename and an optional Tcl callback.  If a callback is
+  // provided, then the file may be written in the background by
+  // Oxs_FieldWriter.  In either case the callback is run with the
+  // filename and an error message (empty on success) appended, after
+  // the file is closed.  (If this routine returns an error, then the
+  // callback is not run.)
   Tcl_ResetResult(interp);
-  if(argc!=1) {
-    Tcl_AppendResult(interp, "wrong # of args: should be 1: filename",
-                     (char *) NULL);
+  if(argc!=1 && argc!=2) {
+    Tcl_AppendResult(interp, "wrong # of args: should be filename"
+                     " ?callback?", (char *) NULL);
     return TCL_ERROR;
   }
   if(state==NULL || state->Id()==0) {
@@ -617,6 +634,8 @@ int Oxs_FieldOutput<T>::Output
   }
 
   const char* filename = argv[0];
+  const char* callback = (argc>1 ? argv[1] : nullptr);
+  OC_BOOL queued = 0;
   CacheRequestIncrement(1);
   UpdateCache(state);
 
@@ -684,14 +703,29 @@ int Oxs_FieldOutput<T>::Output
 
     Vf_OvfFileVersion ovf_version = vf_ovf_20; // Default
 
-    Oxs_MeshValueOutputField<T>
-      (filename,GetOutputWriteheaders(),Oxs_Output::LongName().c_str(),
-       description,valuelabels,valueunits,
-       meshtype,   // Either rectangular or irregular
-       datastyle,   // vf_oascii, vf_obin4, or vf_obin8
-       textfmt.c_str(),state->GetMeshNodesPtr(),
-       GetCacheBuffer(state),
-       ovf_version);
+    if(callback != nullptr && Oxs_FieldWriter::IsAsync()) {
+      // Snapshot the cache and hand off to the writer thread.  Data
+      // formatting (including binary4 conversion) and file I/O happen
+      // off the solver thread.
+      std::unique_ptr< Oxs_MeshValueWriteJob<T> > job
+        (new Oxs_MeshValueWriteJob<T>
+         (filename,callback,GetOutputWriteheaders(),
+          Oxs_Output::LongName().c_str(),description,
+          valuelabels,valueunits,meshtype,datastyle,textfmt.c_str(),
+          state->GetMeshNodesPtr(),ovf_version));
+      SnapshotCache(state,job->value);
+      Oxs_FieldWriter::Submit(std::move(job));
+      queued = 1;
+    } else {
+      Oxs_MeshValueOutputField<T>
+        (filename,GetOutputWriteheaders(),Oxs_Output::LongName().c_str(),
+         description,valuelabels,valueunits,
+         meshtype,   // Either rectangular or irregular
+         datastyle,   // vf_oascii, vf_obin4, or vf_obin8
+         textfmt.c_str(),state->GetMeshNodesPtr(),
+         GetCacheBuffer(state),
+         ovf_version);
+    }
   } catch (Oxs_ExtError& err) {
     // Include filename in error message
     char buf[1500];
@@ -726,6 +760,10 @@ int Oxs_FieldOutput<T>::Output
 
   CacheRequestIncrement(-1); // We're done with the cache
 
+  if(errorcode==TCL_OK && callback!=nullptr && !queued) {
+    errorcode = Oxs_FieldWriter::RunCallback(interp,callback,filename,"");
+  }
+
   // On success, return value is the filename.
   if(errorcode==TCL_OK) {
     Tcl_ResetResult(interp); // Protection against badly behaved Oxs_Ext's.
@@ -782,10 +820,13 @@ public:
     OC_UINT4m state_id;
   } cache;
 
-  // Augment default CacheRequestIncrement() base member
+  // Augment default CacheRequestIncrement() base member.  The cache
+  // buffer is kept if the output has scheduled demand, since then it
+  // will be refilled on a later step anyway.
   virtual void CacheRequestIncrement(OC_INT4m incr) override {
     Oxs_Output::CacheRequestIncrement(incr);
-    if(Oxs_Output::GetCacheRequestCount()<1) {
+    if(Oxs_Output::GetCacheRequestCount()<1
+       && !Oxs_Output::HasScheduledDemand()) {
       cache.state_id=0;
       cache.value.Release();
     }
@@ -883,7 +924,7 @@ public:
 
   OC_BOOL IsCacheValid(const Oxs_SimState* state) {
     const Oxs_MeshValue<T>* valueptr;
-    return state->GetDerivedData(Oxs_Output::LongName(),valueptr);
+    return state->GetDerivedData(Oxs_Output::LongNameKey(),valueptr);
   }
 
   // GetCacheBuffer is functionally the same as IsCacheValid, except that
@@ -892,12 +933,26 @@ public:
   virtual const Oxs_MeshValue<T>*
   GetCacheBuffer(const Oxs_SimState* state) const override {
     const Oxs_MeshValue<T>* valueptr;
-    if(state->GetDerivedData(Oxs_Output::LongName(),valueptr)) {
+    if(state->GetDerivedData(Oxs_Output::LongNameKey(),valueptr)) {
       return valueptr;
     }
     return nullptr;
   }
 
+  // State derived data are never changed once set, so a shared copy
+  // is safe.  Values moved into the DerivedData area may not have the
+  // read_only_lock set yet; set it here.  (The DerivedData store is
+  // mutable, so the const_cast is benign.)
+  virtual void SnapshotCache(const Oxs_SimState* state,
+                             Oxs_MeshValue<T>& snapshot) const override {
+    const Oxs_MeshValue<T>* valueptr = GetCacheBuffer(state);
+    if(valueptr->IsReadOnly()) {
+      snapshot = valueptr->SharedCopy();
+    } else {
+      snapshot = const_cast<Oxs_MeshValue<T>*>(valueptr)->SharedCopy();
+    }
+  }
+
   // To fill the cache a client should create an Oxs_MeshValue sized to
   // match state->mesh, and fill it as appropriate for the state. Then
   // call MoveToCache to *move* the Oxs_MeshValue into the state's
@@ -919,16 +974,16 @@ public:
   // call returns false.
   OC_BOOL MoveToCache(const Oxs_SimState* state,
                       Oxs_MeshValue<T>& value) {
-    return state->AddDerivedData(Oxs_Output::LongName(),std::move(value));
+    return state->AddDerivedData(Oxs_Output::LongNameKey(),std::move(value));
   }
   OC_BOOL ShareToCache(const Oxs_SimState* state,
                       Oxs_MeshValue<T>& value) {
     // If value is already attached to state, do nothing
-    if(state->HaveDerivedData(Oxs_Output::LongName(),&value)) {
+    if(state->HaveDerivedData(Oxs_Output::LongNameKey(),&value)) {
       return 0;
     }
     // Otherwise, move a shared copy into state
-    return state->AddDerivedData(Oxs_Output::LongName(),
+    return state->AddDerivedData(Oxs_Output::LongNameKey(),
                                  std::move(value.SharedCopy()));
   }
 
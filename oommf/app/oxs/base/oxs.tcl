@@ -19,6 +19,11 @@ if { [lsearch -exact $auto_path $oxs(library)] == -1 } {
     lappend auto_path $oxs(library)
 }
 
+# Memory budget for process-wide tensor caches.  See config/options.tcl.
+if {![Oc_Option Get Oxs demag_tensor_cache_memory_MB _]} {
+    Oxs_SetTensorCacheMemory $_
+}
+
 # Load in any local modifications
 set local [file join [file dirname [info script]] local oxs.tcl]
 if {[file isfile $local] && [file readable $local]} {
@@ -19,6 +19,7 @@
 #include "director.h"
 #include "driver.h"  // For Oxs_Driver::RunEvent structure
 #include "ext.h"
+#include "fieldwriter.h"
 #include "oc.h"
 #include "outputderiv.h"
 #include "oxsthread.h"
@@ -53,6 +54,7 @@ typedef String Oxs_CmdProc(Oxs_Director* director,Tcl_Interp *interp,
 			   int argc,const char** argv);
 Oxs_CmdProc Oxs_SetRestartFlag;
 Oxs_CmdProc Oxs_SetRestartCrcCheck;
+Oxs_CmdProc Oxs_SetTensorCacheMemory;
 Oxs_CmdProc Oxs_SetRestartFileDir;
 Oxs_CmdProc Oxs_GetRestartFileDir;
 Oxs_CmdProc Oxs_GetMifCrc;
@@ -75,6 +77,9 @@ Oxs_CmdProc Oxs_ListExtObjects;
 Oxs_CmdProc Oxs_ListEnergyObjects;
 Oxs_CmdProc Oxs_ListOutputObjects;
 Oxs_CmdProc Oxs_OutputGet;
+Oxs_CmdProc Oxs_OutputDemandPeriod;
+Oxs_CmdProc Oxs_FieldWriterQueueDepth;
+Oxs_CmdProc Oxs_FieldWriterFlush;
 Oxs_CmdProc Oxs_GetAllScalarOutputs;
 Oxs_CmdProc Oxs_OutputNames;
 Oxs_CmdProc Oxs_QueryState;
@@ -558,6 +563,52 @@ String Oxs_SetRestartCrcCheck(Oxs_Director* director,Tcl_Interp *interp,
   return String(buf);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Oxs_SetTensorCacheMemory --
+ *      Set the memory budget, in MB, for process-wide interaction
+ *      tensor caches.  The new budget is applied when the next
+ *      problem is loaded.
+ *
+ * Results:
+ *      Returns the previous value, in MB.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+String Oxs_SetTensorCacheMemory(Oxs_Director* director,Tcl_Interp *interp,
+                                int argc,const char** argv)
+{
+  if (argc != 2) {
+    Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		     " budget_MB\"", (char *) NULL);
+    throw OxsCmdsProcTclException(TCL_ERROR);
+  }
+
+  double newbudget;
+  if (Tcl_GetDouble(interp, argv[1], &newbudget) != TCL_OK) {
+    throw OxsCmdsProcTclException(TCL_ERROR);
+  }
+  if (newbudget<0.0) {
+    Tcl_AppendResult(interp, "Invalid budget \"", argv[1],
+		     "\"; must be non-negative", (char *) NULL);
+    throw OxsCmdsProcTclException(TCL_ERROR);
+  }
+
+  double oldbudget
+    = static_cast<double>(director->GetTensorCacheMemory())/(1024.*1024.);
+  director->SetTensorCacheMemory
+    (static_cast<OC_UINDEX>(newbudget*1024.*1024.));
+
+  char buf[64];
+  Oc_Snprintf(buf,sizeof(buf),"%g",oldbudget);
+  return String(buf);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1336,6 +1387,106 @@ String Oxs_OutputGet(Oxs_Director* director,Tcl_Interp *interp,
     return String("");
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Oxs_OutputDemandPeriod --
+ *      Sets the scheduled demand period for an output.  Called by
+ *      the Oxs_Schedule class whenever the Step schedules for an
+ *      output change.  A period of 0 removes scheduled demand.
+ *
+ * Results:
+ *      Empty string.
+ *
+ * Side effects:
+ *      Energy terms and evolvers may store the output as a side effect
+ *      of main-path computations on states where it is demanded.
+ *
+ *----------------------------------------------------------------------
+ */
+String Oxs_OutputDemandPeriod(Oxs_Director* director,Tcl_Interp *interp,
+                              int argc,const char** argv)
+{
+    if (argc != 3) {
+        Tcl_AppendResult(interp, "wrong # args: should be \"",
+		     argv[0], " output period\"", (char *) NULL);
+	throw OxsCmdsProcTclException(TCL_ERROR);
+    }
+    int period;
+    if (Tcl_GetInt(interp, argv[2], &period) != TCL_OK) {
+	throw OxsCmdsProcTclException(TCL_ERROR);
+    }
+    if (period < 0) period = 0;
+    director->OutputDemandPeriod(argv[1],static_cast<OC_UINT4m>(period));
+    return String("");
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Oxs_FieldWriterQueueDepth --
+ *      Gets or sets the maximum number of outstanding background
+ *      field output writes.  A depth of 0 disables background
+ *      writing.
+ *
+ * Results:
+ *      Current (new) queue depth.
+ *
+ * Side effects:
+ *      Reducing the depth waits for queued writes to finish.
+ *
+ *----------------------------------------------------------------------
+ */
+String Oxs_FieldWriterQueueDepth(Oxs_Director*,Tcl_Interp *interp,
+                                 int argc,const char** argv)
+{
+    if (argc != 1 && argc != 2) {
+        Tcl_AppendResult(interp, "wrong # args: should be \"",
+		     argv[0], " ?depth?\"", (char *) NULL);
+	throw OxsCmdsProcTclException(TCL_ERROR);
+    }
+    if (argc == 2) {
+        int depth;
+        if (Tcl_GetInt(interp, argv[1], &depth) != TCL_OK) {
+	    throw OxsCmdsProcTclException(TCL_ERROR);
+        }
+        Oxs_FieldWriter::SetQueueDepth(depth);
+    }
+    char buf[64];
+    Oc_Snprintf(buf,sizeof(buf),"%ld",
+                static_cast<long>(Oxs_FieldWriter::GetQueueDepth()));
+    return String(buf);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Oxs_FieldWriterFlush --
+ *      Waits for all background field output writes to finish, and
+ *      runs their completion callbacks.
+ *
+ * Results:
+ *      Empty string.
+ *
+ * Side effects:
+ *      Completion callbacks typically send the written files to
+ *      their data destinations.
+ *
+ *----------------------------------------------------------------------
+ */
+String Oxs_FieldWriterFlush(Oxs_Director*,Tcl_Interp *interp,
+                            int argc,const char** argv)
+{
+    if (argc != 1) {
+        Tcl_AppendResult(interp, "wrong # args: should be \"",
+		     argv[0], "\"", (char *) NULL);
+	throw OxsCmdsProcTclException(TCL_ERROR);
+    }
+    Oxs_FieldWriter::Flush();
+    Oxs_FieldWriter::DispatchCompleted(interp);
+    return String("");
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2275,6 +2426,7 @@ void OxsRegisterInterfaceCommands(Oxs_Director* director,
   // Tcl command names.
   REGCMD(Oxs_SetRestartFlag,"Oxs_Director::SetRestartFlag");
   REGCMD(Oxs_SetRestartCrcCheck,"Oxs_Director::SetRestartCrcCheck");
+  REGCMD(Oxs_SetTensorCacheMemory,"Oxs_Director::SetTensorCacheMemory");
   REGCMD(Oxs_SetRestartFileDir,"Oxs_Director::SetRestartFileDir");
   REGCMD(Oxs_GetRestartFileDir,"Oxs_Director::GetRestartFileDir");
   REGCMD(Oxs_GetMifCrc,"Oxs_Director::GetMifCrc");
@@ -2298,6 +2450,9 @@ void OxsRegisterInterfaceCommands(Oxs_Director* director,
   REGCMD(Oxs_ListEnergyObjects,"Oxs_Director::ListEnergyObjects");
   REGCMD(Oxs_ListOutputObjects,"Oxs_Director::ListOutputObjects");
   REGCMD(Oxs_OutputGet,"Oxs_Director::Output");
+  REGCMD(Oxs_OutputDemandPeriod,"Oxs_Director::OutputDemandPeriod");
+  REGCMD(Oxs_FieldWriterQueueDepth,"Oxs_FieldWriter::SetQueueDepth");
+  REGCMD(Oxs_FieldWriterFlush,"Oxs_FieldWriter::Flush");
   REGCMD(Oxs_GetAllScalarOutputs,"Oxs_Director::GetAllScalarOutputs");
   REGCMD(Oxs_OutputNames,"Oxs_Director::OutputNames");
   REGCMD(Oxs_QueryState,"Oxs_QueryState");
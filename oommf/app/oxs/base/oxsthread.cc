@@ -331,7 +331,25 @@ void _Oxs_Thread_threadmain(Oxs_Thread* othread)
   // Action loop
   while(1) {
     assert(startlck.owns_lock());
+#if OXS_THREAD_SPIN_COUNT > 0
+    if(start.count != 0) {
+      // Spin briefly before sleeping on the condition variable.  The
+      // start mutex is released during the spin so that RunCmd can
+      // post a new command.
+      startlck.unlock();
+      for(int spin=0;spin<OXS_THREAD_SPIN_COUNT;++spin) {
+        if(othread->run_signal.load(std::memory_order_acquire)) break;
+#if OC_USE_SSE
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+      }
+      startlck.lock();
+    }
+#endif // OXS_THREAD_SPIN_COUNT
     while(start.count != 0) start.cond.wait(startlck);
+    othread->run_signal.store(0,std::memory_order_relaxed);
     if(nullptr==runobj) break; // Private signal to exit thread
 
     // At this point *stop should be a valid pointer.  We can check and
@@ -465,7 +483,7 @@ public:
 
 Oxs_Thread::Oxs_Thread
 (int thread_number_x)
-  : thread_number(thread_number_x),
+  : thread_number(thread_number_x), run_signal(0),
     stop(nullptr), runobj(nullptr), data(nullptr)
 {
   // Note: We may want to wrap start and stop controls into
@@ -498,6 +516,7 @@ Oxs_Thread::~Oxs_Thread()
   runobj = nullptr;
   data = nullptr;
   start.count = 0;
+  run_signal.store(1,std::memory_order_release);
   start.cond.notify_all();
   while(start.count == 0) start.cond.wait(startlck);
   startlck.unlock();
@@ -519,6 +538,7 @@ void Oxs_Thread::RunCmd
   runobj = runobj_x;
   data = data_x;
   start.count = 0; // Run signal
+  run_signal.store(1,std::memory_order_release);
   startlck.unlock();
   start.cond.notify_one(); // Tell child to start
 }
@@ -54,6 +54,7 @@
 /// is helpful for using lambda expression as template parameters.
 
 #if OOMMF_THREADS
+# include <atomic>    // std::atomic
 # include <thread>    // std::thread
 # include <mutex>     // std::mutex, std::lock
 # include <condition_variable> // std::condition_variable
@@ -71,6 +72,16 @@
 //#define OXS_THREAD_TIMER_COUNT 15
 #define OXS_THREAD_TIMER_COUNT 0
 
+// Idle child threads spin for up to OXS_THREAD_SPIN_COUNT pause
+// instructions waiting for the next command before sleeping on the
+// start condition variable.  Commands that arrive during the spin
+// phase start without the cost of a kernel wakeup, which matters when
+// many small jobs are launched in quick succession.  Set to 0 to
+// disable spinning.
+#ifndef OXS_THREAD_SPIN_COUNT
+# define OXS_THREAD_SPIN_COUNT 2000
+#endif
+
 // Write to stderr each time memory for a Oxs_StripedArray object is
 // allocated or released.
 #ifndef _OXS_THREAD_TRACK_MEMORY
@@ -310,6 +321,9 @@ class Oxs_Thread {
 #endif
 
   Oxs_ThreadControl start; // Unique to thread object
+  std::atomic<int> run_signal; // Set with start.count = 0, so that
+  /// threads in the spin phase of a wait see new commands without
+  /// holding start.mutex.
   Oxs_ThreadControl* stop; // Assigned by and unique to tree object.
   // The stop ptr is set in RunCmd call before child thread is notified.
   // stop should only be accessed while holding the start mutex.
@@ -1055,6 +1069,17 @@ template<class T> void Oxs_StripedArray<T>::SetSize
 // n*sizeof(B), with n an integer, and chunk_size*sizeof(B) is a
 // multiple of the cache line or page size then chunk_size*sizeof(A) =
 // chunk_size*n*sizeof(B) will be too.
+// Work stealing: Each thread owns one contiguous range of the array,
+// initially matched to the Oxs_StripedArray strip for that thread (so
+// on NUMA machines the memory is local).  The owner claims work from
+// the front of its range in pieces of size piece_size.  When a thread
+// runs dry it steals the back half of another thread's remaining
+// range, moves it into its own bucket, and carries on; so stolen work
+// can itself be stolen.  A thief never takes the last piece of a
+// range, which insures that every thread with a non-empty initial
+// assignment runs at least once.  (Some older Oxs_ChunkEnergy code
+// relies on thread 0 running.)  Note that the pieces a thread receives
+// are not in general in increasing index order.
 template<class T> class Oxs_JobControl
 {
 private:
@@ -1070,9 +1095,15 @@ private:
 
   void ReassignJobs(OC_INT4m thread_id, OC_INDEX& start, OC_INDEX& stop);
 
+  void FinishInit(OC_INDEX arrsize,OC_INDEX record_size);
+
   OC_INT4m thread_count;
+  OC_INDEX piece_size;
 
-  enum { BASE_PIECE_COUNT=32 };
+  // Each initial assignment is broken into about BASE_PIECE_COUNT
+  // pieces, but pieces are not made smaller than MIN_PIECE_SIZE
+  // elements, to keep the per-claim mutex overhead small.
+  enum { BASE_PIECE_COUNT=32, MIN_PIECE_SIZE=1024 };
 
 public:
   void Free() {
@@ -1081,7 +1112,7 @@ public:
     thread_count = -1;
   }
 
-  Oxs_JobControl() : threadjob(0), thread_count(-1) {}
+  Oxs_JobControl() : threadjob(0), thread_count(-1), piece_size(1) {}
 
   ~Oxs_JobControl() { Free(); }
 
@@ -1091,6 +1122,13 @@ public:
   // record_size is the number of T objects per work unit.  Each job
   // assignment will be an integral multiple of record_size.
 
+  void InitRange(OC_INT4m number_of_threads,
+                 OC_INDEX range_size,
+                 OC_INDEX record_size = 1);
+  // Same as Init, but for a plain index range [0,range_size) not
+  // tied to an Oxs_StripedArray.  The range is divided evenly across
+  // the threads.
+
   void GetJob(OC_INT4m thread_id,
               OC_INDEX &start, OC_INDEX& stop);
 
@@ -1106,8 +1144,6 @@ template<class T> void Oxs_JobControl<T>::Init
  const Oxs_StripedArray<T>* arrblock,
  OC_INDEX record_size)
 {
-  if(record_size < 1) record_size = 1;
-
   if(thread_count != number_of_threads ||
      threadjob==0) {
     // (re)Alloc.  Otherwise, reuse old space.
@@ -1149,6 +1185,38 @@ template<class T> void Oxs_JobControl<T>::Init
       threadjob[i].start = threadjob[i].stop = arrsize;
     }
   }
+  FinishInit(arrsize,record_size);
+}
+
+template<class T> void Oxs_JobControl<T>::InitRange
+(OC_INT4m number_of_threads,
+ OC_INDEX range_size,
+ OC_INDEX record_size)
+{
+  if(thread_count != number_of_threads ||
+     threadjob==0) {
+    Free();
+    thread_count = number_of_threads;
+    threadjob = new JobData[thread_count];
+  }
+  assert(thread_count>0 && range_size>=0);
+  const OC_INDEX blocksize = range_size/thread_count;
+  const OC_INDEX fudgesize = range_size - blocksize*thread_count;
+  OC_INDEX fencepole = 0;
+  for(OC_INT4m i=0;i<thread_count;++i) {
+    OC_INDEX adj = blocksize + (i<fudgesize ? 1 : 0);
+    threadjob[i].start = fencepole;
+    threadjob[i].stop = (fencepole += adj) ;
+  }
+  FinishInit(range_size,record_size);
+}
+
+template<class T> void Oxs_JobControl<T>::FinishInit
+(OC_INDEX arrsize,
+ OC_INDEX record_size)
+{ // Common back end for Init and InitRange.  On entry the threadjob
+  // start/stop pairs cover [0,arrsize) in order.
+  if(record_size < 1) record_size = 1;
   assert(threadjob[0].start == 0 && threadjob[thread_count-1].stop == arrsize);
 
   if(record_size>1) {
@@ -1178,6 +1246,14 @@ template<class T> void Oxs_JobControl<T>::Init
     }
   }
 
+  // Piece size for claims, an integral multiple of record_size.  Since
+  // all job start points are multiples of record_size, so are all
+  // piece boundaries.
+  piece_size = (arrsize/thread_count + BASE_PIECE_COUNT - 1)
+    /BASE_PIECE_COUNT;
+  if(piece_size<MIN_PIECE_SIZE) piece_size = MIN_PIECE_SIZE;
+  piece_size = ((piece_size + record_size - 1)/record_size)*record_size;
+
   // Empty jobs are marked by setting .start = .stop = -1 and
   // .all_done=1
   for(OC_INT4m i=0;i<thread_count;++i) {
@@ -1197,50 +1273,56 @@ template<class T> inline void Oxs_JobControl<T>::GetJob
 {
   JobData& job = threadjob[thread_id];
 
-  OC_INDEX test_start,test_stop;
-
-  int fini = 0;
   {
     std::lock_guard<std::mutex> lck(job.mutex);
-    test_start = job.start;
-    job.start = test_stop  = job.stop;
-    fini = job.all_done;
-  }
-
-  if(test_start<test_stop) {
-    // Job found in bucket for thread_id
-    start = test_start;
-    stop  = test_stop;
-    return;
+    if(job.start<job.stop) {
+      // Claim next piece from front of own bucket
+      start = job.start;
+      stop = job.start + piece_size;
+      if(stop>job.stop) stop = job.stop;
+      job.start = stop;
+      return;
+    }
+    job.all_done = 1;
   }
 
   // Otherwise, all jobs for thread_id have been completed.
   // See if we can find some jobs in a different thread bucket.
-  if(fini) {
-    // No; all jobs assigned
-    start = stop = -1;
-  } else {
-    ReassignJobs(thread_id,start,stop);
-  }
-
-  return;
+  ReassignJobs(thread_id,start,stop);
 }
 
 template<class T> void Oxs_JobControl<T>::ReassignJobs
 (OC_INT4m thread_id,
  OC_INDEX &start,
  OC_INDEX& stop)
-{
-  // Reassignments not currently supported
+{ // Steal the back half of the first other bucket, in round-robin
+  // order starting from thread_id+1, holding at least two pieces.
   start = stop = -1;
-
-  JobData& job = threadjob[thread_id];
-  {
-    std::lock_guard<std::mutex> lck(job.mutex);
-    job.all_done = 1;
+  OC_INDEX steal_start = -1, steal_stop = -1;
+  for(OC_INT4m offset=1;offset<thread_count;++offset) {
+    JobData& victim = threadjob[(thread_id+offset)%thread_count];
+    std::lock_guard<std::mutex> lck(victim.mutex);
+    const OC_INDEX remaining = victim.stop - victim.start;
+    if(victim.all_done || remaining < 2*piece_size) continue;
+    // Owner keeps the front half, rounded up to whole pieces.
+    const OC_INDEX keep_pieces = (remaining/piece_size + 1)/2;
+    steal_start = victim.start + keep_pieces*piece_size;
+    steal_stop  = victim.stop;
+    victim.stop = steal_start;
+    break;
   }
+  if(steal_start >= steal_stop) return; // Nothing left to steal
 
-  return;
+  // Move the stolen range into our own bucket, where it is open to
+  // further stealing, and claim the first piece.
+  JobData& job = threadjob[thread_id];
+  std::lock_guard<std::mutex> lck(job.mutex);
+  start = steal_start;
+  stop = steal_start + piece_size;
+  if(stop>steal_stop) stop = steal_stop;
+  job.start = stop;
+  job.stop = steal_stop;
+  job.all_done = 0;
 }
 
 #else  // !OOMMF_THREADS ///////////////////////////////////////////////
@@ -1272,6 +1354,17 @@ public:
     arrblock->GetStripPosition(0,threadjobs.start,threadjobs.stop);
   }
 
+  void InitRange(OC_INT4m
+#ifndef NDEBUG
+                 number_of_threads
+#endif
+                 , OC_INDEX range_size,
+                 OC_INDEX /* record_size */ =1) {
+    assert(number_of_threads == 1);
+    threadjobs.start = 0;
+    threadjobs.stop = range_size;
+  }
+
   void GetJob(OC_INT4m /* thread_id */,
               OC_INDEX &start, OC_INDEX& stop) {
     start = threadjobs.start;
@@ -1401,6 +1494,24 @@ public:
 //       Oc_AlignedVector template.  Oc_AlignedVector is a typedef for
 //       std::vector with the Oc_AlignedAlloc allocator.  See
 //       oommf/pkg/oc/ocalloc.h for details.
+//
+//    4) Work is handed out in pieces through Oxs_JobControl, with idle
+//       threads stealing from busy ones, so each thread will usually
+//       see several calls, and the [jstart,jstop) ranges seen by one
+//       thread are not necessarily in increasing order.
+//
+// For index ranges that are not tied to an Oxs_MeshValue (for example,
+// FFT slabs or planes), use Oxs_ParallelFor:
+//
+//   Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+//                  (slab_count,
+//                   [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
+//                    for(OC_INDEX j=jstart;j<jstop;++j) {
+//                      ...
+//                    }});
+//
+// An optional third argument, record_size, makes every range boundary
+// (other than the final stop) a multiple of record_size.
 
 #if !OOMMF_THREADS
 template <typename T> class Oxs_MeshValue; // Forward declaration
@@ -1430,6 +1541,19 @@ private:
   Oxs_RunThreaded& operator=(Oxs_RunThreaded const&);
 };
 
+// Version for plain index ranges:
+template<typename FUNC>
+class Oxs_ParallelFor {
+public:
+  Oxs_ParallelFor(OC_INDEX range_size,FUNC eval_chunk,
+                  OC_INDEX /* record_size */ = 1) {
+    if(range_size>0) eval_chunk(0,0,range_size);
+  }
+private:
+  Oxs_ParallelFor(Oxs_ParallelFor const&);
+  Oxs_ParallelFor& operator=(Oxs_ParallelFor const&);
+};
+
 
 #else // OOMMF_THREADS /////////////////////////////////////////////////
 template <typename T> class Oxs_MeshValue; // Forward declaration
@@ -1545,6 +1669,58 @@ private:
   Oxs_RunThreaded& operator=(Oxs_RunThreaded const&); // Disable
 };
 
+// Version for plain index ranges:
+template<typename FUNC>
+class _Oxs_ParallelFor_Support : public Oxs_ThreadRunObj {
+public:
+  Oxs_JobControl<char> job_basket; // Template type unused by InitRange
+
+  _Oxs_ParallelFor_Support
+  (int number_of_threads,OC_INDEX range_size,OC_INDEX record_size,
+   FUNC import_eval_chunk)
+    : eval_chunk(import_eval_chunk)
+  {
+    job_basket.InitRange(number_of_threads,range_size,record_size);
+  }
+
+  void Cmd(int threadnumber, void* /* data */) {
+    while(1) {
+      OC_INDEX jstart,jstop;
+      job_basket.GetJob(threadnumber,jstart,jstop);
+      if(jstart>=jstop) break; // No more jobs
+      eval_chunk(threadnumber,jstart,jstop);
+    }
+  }
+
+private:
+  FUNC eval_chunk;
+
+  // Disable default copy and assignment members
+  _Oxs_ParallelFor_Support(_Oxs_ParallelFor_Support const&);
+  _Oxs_ParallelFor_Support& operator=(_Oxs_ParallelFor_Support const&);
+};
+
+template<typename FUNC>
+class Oxs_ParallelFor {
+public:
+  Oxs_ParallelFor(OC_INDEX range_size,FUNC eval_chunk,
+                  OC_INDEX record_size = 1) {
+    if(range_size<1) return;
+    const int number_of_threads = Oc_GetMaxThreadCount();
+    if(number_of_threads <= 1) { // Bypass thread initialization overhead
+      eval_chunk(0,0,range_size);
+    } else {
+      Oxs_ThreadTree threadtree;
+      _Oxs_ParallelFor_Support<FUNC>
+        thread_data(number_of_threads,range_size,record_size,eval_chunk);
+      threadtree.LaunchTree(thread_data,0);
+    }
+  }
+private:
+  Oxs_ParallelFor(Oxs_ParallelFor const&); // Disable
+  Oxs_ParallelFor& operator=(Oxs_ParallelFor const&); // Disable
+};
+
 
 #endif // OOMMF_THREADS
 ////////////////////////////////////////////////////////////////////////
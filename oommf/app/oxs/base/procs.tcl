@@ -174,6 +174,9 @@ proc Oxs_FlushLog {} {
 # Routine to flush pending data messages. Used for cleanup on problem exit.
 proc Oxs_FlushData {} {
    global OxsFlushData_open_connections
+   # Finish background field output writes first, so that the files
+   # are sent before the connections are closed.
+   Oxs_FieldWriterFlush
    set OxsFlushData_open_connections [dict create]
    # Explicitly close each data destination.  Note that at the very
    # bottom a socket close occurs, which is a blocking operation.
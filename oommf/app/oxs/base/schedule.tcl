@@ -59,6 +59,7 @@ Oc_Class Oxs_Schedule {
         Oc_EventHandler Generate $this Delete
         Oc_EventHandler DeleteGroup $this
         catch {unset index($output,$destination)}
+        Oxs_Schedule UpdateDemand $output $this
     }
     proc ProblemInit { new_mif_interp } {
        if {[string compare $mif_interp $new_mif_interp]!=0} {
@@ -92,6 +93,41 @@ Oc_Class Oxs_Schedule {
              $elt Delete
           }
        }
+       # Output objects are new, so push demand for the surviving
+       # schedules.
+       set outputs {}
+       foreach elt [Oxs_Schedule Instances] {
+          set output [$elt Cget -output]
+          if {[lsearch -exact $outputs $output]<0} {
+             lappend outputs $output
+             Oxs_Schedule UpdateDemand $output
+          }
+       }
+    }
+    proc UpdateDemand { o {exclude {}} } {
+       # Computes the step period at which output o is demanded across
+       # all destinations, and passes that to the output object.  The
+       # period is the gcd of the active Step frequencies, or 0 if o
+       # has no active Step schedule.  Filter scripts can only remove
+       # events, so the period is an upper bound on demand; Stage and
+       # Done events can't be predicted and are filled on request.
+       # The exclude import is used by the destructor.
+       set period 0
+       foreach elt [Oxs_Schedule Instances] {
+          if {[string compare $elt $exclude]==0 \
+                 || [string compare [$elt Cget -output] $o]!=0} {
+             continue
+          }
+          upvar #0 [$elt GlobalName active] a [$elt GlobalName frequency] f
+          if {!$a(Step) || $f(Step)<1} { continue }
+          set x $f(Step)
+          while {$x>0} {
+             set t [expr {$period % $x}]
+             set period $x
+             set x $t
+          }
+       }
+       catch {Oxs_Output SetDemandPeriod $o $period}
     }
     method Send {e} {
        upvar #0 [string tolower $e] count
@@ -134,6 +170,9 @@ Oc_Class Oxs_Schedule {
     }
     method SetActive {event value} {
         set active($event) $value
+        if {[string compare Step $event]==0} {
+           Oxs_Schedule UpdateDemand $output
+        }
         Oc_EventHandler DeleteGroup $this-$event
         if {$value} {
             Oc_EventHandler New _ Oxs $event [list $this Send $event] \
@@ -147,11 +186,17 @@ Oc_Class Oxs_Schedule {
     method SetFilter {event value} {
        set frequency($event) [lindex $value 0]
        set filter_script($event) [lindex $value 1]
+       if {[string compare Step $event]==0} {
+          Oxs_Schedule UpdateDemand $output
+       }
     }
     method SetFrequency {event freqvalue} {
        # Used by the interactive interface; changes frequency
        # without affecting the filter_script.
        set frequency($event) $freqvalue
+       if {[string compare Step $event]==0} {
+          Oxs_Schedule UpdateDemand $output
+       }
     }
 
 }
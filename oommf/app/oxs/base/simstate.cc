@@ -5,7 +5,9 @@
  */
 
 #include <algorithm>   // std::sort
+#include <unordered_map>
 #include <utility>     // std::move
+#include <vector>
 
 #include "nb.h"
 #include "vf.h"
@@ -16,8 +18,97 @@
 #include "simstate.h"
 #include "util.h"
 
+#if OOMMF_THREADS
+# include <mutex>
+#endif
+
 /* End includes */
 
+// Process-wide table of interned derived data names.  Names are never
+// removed, so an index remains valid for the life of the process.
+class _Oxs_DerivedDataKeyTable {
+public:
+  static OC_INDEX Intern(const String& name);
+  static OC_INDEX Find(const String& name);
+  static String Name(OC_INDEX index);
+  static OC_INDEX Count();
+private:
+  static std::unordered_map<String,OC_INDEX> index_map;
+  static std::vector<String> names;
+#if OOMMF_THREADS
+  static std::mutex mutex;
+#endif
+};
+
+std::unordered_map<String,OC_INDEX> _Oxs_DerivedDataKeyTable::index_map;
+std::vector<String> _Oxs_DerivedDataKeyTable::names;
+#if OOMMF_THREADS
+std::mutex _Oxs_DerivedDataKeyTable::mutex;
+# define OXS_DERIVED_KEY_TABLE_LOCK std::lock_guard<std::mutex> lck(mutex)
+#else
+# define OXS_DERIVED_KEY_TABLE_LOCK
+#endif
+
+OC_INDEX _Oxs_DerivedDataKeyTable::Intern(const String& name)
+{
+  OXS_DERIVED_KEY_TABLE_LOCK;
+  std::pair<std::unordered_map<String,OC_INDEX>::iterator,bool> p
+    = index_map.insert(std::make_pair(name,
+                                      static_cast<OC_INDEX>(names.size())));
+  if(p.second) {
+    names.push_back(name);
+  }
+  return p.first->second;
+}
+
+OC_INDEX _Oxs_DerivedDataKeyTable::Find(const String& name)
+{
+  OXS_DERIVED_KEY_TABLE_LOCK;
+  std::unordered_map<String,OC_INDEX>::const_iterator it
+    = index_map.find(name);
+  if(it == index_map.end()) {
+    return -1;
+  }
+  return it->second;
+}
+
+String _Oxs_DerivedDataKeyTable::Name(OC_INDEX index)
+{
+  OXS_DERIVED_KEY_TABLE_LOCK;
+  if(index<0 || index>=static_cast<OC_INDEX>(names.size())) {
+    return String();
+  }
+  return names[index];
+}
+
+OC_INDEX _Oxs_DerivedDataKeyTable::Count()
+{
+  OXS_DERIVED_KEY_TABLE_LOCK;
+  return static_cast<OC_INDEX>(names.size());
+}
+
+#undef OXS_DERIVED_KEY_TABLE_LOCK
+
+OC_INDEX Oxs_DerivedDataKey::Intern(const String& name)
+{
+  return _Oxs_DerivedDataKeyTable::Intern(name);
+}
+
+OC_INDEX Oxs_DerivedDataKey::Find(const String& name)
+{
+  return _Oxs_DerivedDataKeyTable::Find(name);
+}
+
+String Oxs_DerivedDataKey::Name(OC_INDEX index)
+{
+  return _Oxs_DerivedDataKeyTable::Name(index);
+}
+
+OC_INDEX Oxs_DerivedDataKey::Count()
+{
+  return _Oxs_DerivedDataKeyTable::Count();
+}
+
 // Constructor
 Oxs_SimState::Oxs_SimState()
   : previous_state_id(0),iteration_count(0),
@@ -78,36 +169,26 @@ void Oxs_SimState::Reset()
 OC_BOOL Oxs_SimState::AddDerivedData
 (const String& name,
  OC_REAL8m value) const
-{ // Note: The derived_data map object is mutable.
-  pair<const String,OC_REAL8m> newdata(name,value);
-  // According to the C++ spec, the first member of pair<>, given as
-  // input to map.insert(), is const.  Compilers should promote
-  // non-const to const, but some compilers are broken.  It doesn't
-  // hurt us here to be precise, so we specify const String for
-  // portability.
-  pair<std::unordered_map<DerivedDataKey,OC_REAL8m>::iterator,bool> p
-    = derived_data.insert(newdata);
-  return p.second;
+{ // Note: The derived_data store is mutable.
+  return derived_data.Add(Oxs_DerivedDataKey::Intern(name),std::move(value));
 }
 
 OC_BOOL Oxs_SimState::GetDerivedData
 (const String& name,
  OC_REAL8m& value) const
 {
-  std::unordered_map<DerivedDataKey,OC_REAL8m>::const_iterator it
-    = derived_data.find(name);
-  if(it == derived_data.end()) {
+  const OC_REAL8m* ptr = derived_data.Get(Oxs_DerivedDataKey::Find(name));
+  if(ptr == nullptr) {
     return 0;
   }
-  value = it->second;
+  value = *ptr;
   return 1;
 }
 
 void Oxs_SimState::AppendListDerivedData(vector<String>& names) const
 { // Class internal routine
-  for(std::unordered_map<DerivedDataKey,OC_REAL8m>::const_iterator
-        cit = derived_data.begin(); cit!=derived_data.end(); ++cit) {
-    names.push_back(cit->first);
+  for(OC_INDEX i : derived_data.Keys()) {
+    names.push_back(Oxs_DerivedDataKey::Name(i));
   }
 }
 void Oxs_SimState::ListDerivedData(vector<String>& names) const
@@ -117,26 +198,10 @@ void Oxs_SimState::ListDerivedData(vector<String>& names) const
 }
 
 // Derived data of Oxs_MeshValue array of scalars type:
-#if 0 // Copy version is expensive; disable
-OC_BOOL Oxs_SimState::AddDerivedData // Expensive copy version
-(const String& name,
- const Oxs_MeshValue<OC_REAL8m>& value) const
-{ // Note: The derived_scalar_meshvalue_data map object is mutable.
-  pair<const String,Oxs_MeshValue<OC_REAL8m> > newdata(name,value);
-  pair<std::unordered_map<DerivedDataKey,
-                          Oxs_MeshValue<OC_REAL8m> >
-       ::iterator,bool> p
-    = derived_scalar_meshvalue_data.insert(std::move(newdata));
-  // NB: Creation of newdata uses the expensive Oxs_MeshValue<>
-  //     copy constructor. Using std::move to .insert ensures
-  //     that a second copy isn't made for the map insertion.
-  return p.second;
-}
-#endif // Expensive copy
 OC_BOOL Oxs_SimState::AddDerivedData // Move assignment version
 (const String& name,
  Oxs_MeshValue<OC_REAL8m>&& value) const
-{ // Note 1: The derived_scalar_meshvalue_data map object is mutable.
+{ // Note 1: The derived_scalar_meshvalue_data store is mutable.
   // Note 2: Import "value" should generally be made using std::move().
   //         If this call is successful, then on the client side "value"
   //         be empty on return.  If you want to retain access to value,
@@ -147,7 +212,7 @@ OC_BOOL Oxs_SimState::AddDerivedData // Move assignment version
   //
   // Note 2.5: bar.SharedCopy() above will mark both bar and the image
   //         in foo as read-only. You may want to check if "bar-name" is
-  //         already in the map first, so you don't have to make the
+  //         already in the store first, so you don't have to make the
   //         shared copy if it's not going to be used. (BTW, in addition
   //         to marking the value as read-only, the shared copy
   //         operation copies the std::shared_ptr<T> arrblock, which
@@ -155,39 +220,23 @@ OC_BOOL Oxs_SimState::AddDerivedData // Move assignment version
   //         once you make the SharedCopy the read-only-lock is set,
   //         even if the AddDerivedData() call fails, for whatever
   //         reason.
-
-  // If name is already in map, do nothing and return false.
-  if(derived_scalar_meshvalue_data.count(name)>0) {
-    return 0;
-  }
-
-  // Otherwise, move value into map
-  pair<const String,Oxs_MeshValue<OC_REAL8m> >
-    newdata(name,std::move(value));
-  pair<std::unordered_map<DerivedDataKey,
-                          Oxs_MeshValue<OC_REAL8m> >
-       ::iterator,bool> p
-    = derived_scalar_meshvalue_data.insert(std::move(newdata));
-
-  if(!p.second) {
-    // For some reason insertion failed. Move data back from newdata
-    // into value.
-    value = std::move(newdata.second);
-  }
-  return p.second;
+  //
+  // If name is already in the store, then value is left unchanged and
+  // the return value is false.
+  return derived_scalar_meshvalue_data.Add(Oxs_DerivedDataKey::Intern(name),
+                                           std::move(value));
 }
 
 OC_BOOL Oxs_SimState::GetDerivedData
 (const String& name,
  const Oxs_MeshValue<OC_REAL8m>* &value) const
 {
-  std::unordered_map<DerivedDataKey,
-                     Oxs_MeshValue<OC_REAL8m> >
-    ::const_iterator it = derived_scalar_meshvalue_data.find(name);
-  if(it == derived_scalar_meshvalue_data.end()) {
+  const Oxs_MeshValue<OC_REAL8m>* ptr
+    = derived_scalar_meshvalue_data.Get(Oxs_DerivedDataKey::Find(name));
+  if(ptr == nullptr) {
     return 0;
   }
-  value = &(it->second);
+  value = ptr;
   return 1;
 }
 
@@ -195,87 +244,30 @@ void
 Oxs_SimState::ListDerivedScalarMeshValueData(vector<String>& names) const
 {
   names.clear();
-  std::unordered_map<DerivedDataKey,
-                     Oxs_MeshValue<OC_REAL8m> >
-    ::const_iterator it = derived_scalar_meshvalue_data.begin();
-  while(it!=derived_scalar_meshvalue_data.end()) {
-    names.push_back(it->first);
-    ++it;
+  for(OC_INDEX i : derived_scalar_meshvalue_data.Keys()) {
+    names.push_back(Oxs_DerivedDataKey::Name(i));
   }
 }
 
 // Derived data of Oxs_MeshValue array of threevectors type:
-#if 0 // Copy version is expensive; disable
-OC_BOOL Oxs_SimState::AddDerivedData // Expensive copy version
-(const String& name,
- const Oxs_MeshValue<ThreeVector>& value) const
-{ // Note: The derived_threevector_meshvalue_data map object is
-  //       mutable.
-  pair<const String,Oxs_MeshValue<ThreeVector> > newdata(name,value);
-  pair<std::unordered_map<DerivedDataKey,Oxs_MeshValue<ThreeVector> >
-       ::iterator,bool> p
-    = derived_threevector_meshvalue_data.insert(std::move(newdata));
-  // NB: Creation of newdata uses the expensive Oxs_MeshValue<>
-  //     copy constructor. Using std::move to .insert ensures
-  //     that a second copy isn't made for the map insertion.
-  return p.second;
-}
-#endif // Expensive copy
-
 OC_BOOL Oxs_SimState::AddDerivedData // Move assignment version
 (const String& name,
  Oxs_MeshValue<ThreeVector>&& value) const
-{ // Note 1: The derived_threevector_meshvalue_data map object is mutable.
-  // Note 2: Import "value" should generally be made using std::move().
-  //         If this call is successful, then on the client side "value"
-  //         be empty on return.  If you want to retain access to value,
-  //         then use Oxs_MeshValue<T>::SharedCopy() to make a shared
-  //         copy and move the copy, e.g.,
-  //
-  //    foo.AddDerivedData("bar-name",std::move(bar.SharedCopy()));
-  //
-  // Note 2.5: bar.SharedCopy() above will mark both bar and the image
-  //         in foo as read-only. You may want to check if "bar-name" is
-  //         already in the map first, so you don't have to make the
-  //         shared copy if it's not going to be used. (BTW, in addition
-  //         to marking the value as read-only, the shared copy
-  //         operation copies the std::shared_ptr<T> arrblock, which
-  //         goes through a mutex to ensure thread safety.) Of course,
-  //         once you make the SharedCopy the read-only-lock is set,
-  //         even if the AddDerivedData() call fails, for whatever
-  //         reason.
-
-  // If name is already in map, do nothing and return false.
-  if(derived_threevector_meshvalue_data.count(name)>0) {
-    return 0;
-  }
-
-  // Otherwise, move value into map
-  pair<const String,Oxs_MeshValue<ThreeVector> >
-    newdata(name,std::move(value));
-  pair<std::unordered_map<DerivedDataKey,
-                          Oxs_MeshValue<ThreeVector> >
-       ::iterator,bool> p
-    = derived_threevector_meshvalue_data.insert(std::move(newdata));
-
-  if(!p.second) {
-    // For some reason insertion failed. Move data back from newdata
-    // into value.
-    value = std::move(newdata.second);
-  }
-  return p.second;
+{ // See notes in the Oxs_MeshValue<OC_REAL8m> version above.
+  return derived_threevector_meshvalue_data.Add(
+                Oxs_DerivedDataKey::Intern(name),std::move(value));
 }
 
 OC_BOOL Oxs_SimState::GetDerivedData
 (const String& name,
  const Oxs_MeshValue<ThreeVector>* &value) const
 {
-  std::unordered_map<DerivedDataKey,Oxs_MeshValue<ThreeVector> >
-    ::const_iterator it = derived_threevector_meshvalue_data.find(name);
-  if(it == derived_threevector_meshvalue_data.end()) {
+  const Oxs_MeshValue<ThreeVector>* ptr
+    = derived_threevector_meshvalue_data.Get(Oxs_DerivedDataKey::Find(name));
+  if(ptr == nullptr) {
     return 0;
   }
-  value = &(it->second);
+  value = ptr;
   return 1;
 }
 
@@ -283,19 +275,16 @@ void
 Oxs_SimState::ListDerivedThreeVectorMeshValueData(vector<String>& names) const
 {
   names.clear();
-  std::unordered_map<DerivedDataKey,Oxs_MeshValue<ThreeVector> >
-    ::const_iterator it = derived_threevector_meshvalue_data.begin();
-  while(it!=derived_threevector_meshvalue_data.end()) {
-    names.push_back(it->first);
-    ++it;
+  for(OC_INDEX i : derived_threevector_meshvalue_data.Keys()) {
+    names.push_back(Oxs_DerivedDataKey::Name(i));
   }
 }
 
 void Oxs_SimState::ClearDerivedData()
 {
-  derived_data.clear();
-  derived_scalar_meshvalue_data.clear();
-  derived_threevector_meshvalue_data.clear();
+  derived_data.Clear();
+  derived_scalar_meshvalue_data.Clear();
+  derived_threevector_meshvalue_data.Clear();
 }
 
 void Oxs_SimState::AddAuxData
@@ -545,18 +534,18 @@ void Oxs_SimState::SaveState(const char* filename,
 
   { // Scalar derived data.
     // For consistency, save data in order sorted by key
-    std::vector<DerivedDataKey> keys;
-    keys.reserve (derived_data.size());
-    for (auto& it : derived_data) {
-      keys.push_back(it.first);
+    std::vector< std::pair<String,OC_REAL8m> > items;
+    items.reserve(derived_data.Keys().size());
+    for(OC_INDEX i : derived_data.Keys()) {
+      items.emplace_back(Oxs_DerivedDataKey::Name(i),*derived_data.Get(i));
     }
-    std::sort(keys.begin(), keys.end());
-    for (auto& it : keys) {
+    std::sort(items.begin(), items.end());
+    for (auto& it : items) {
       string_array.clear();
       string_array.push_back("DRV");
-      string_array.push_back(it);
+      string_array.push_back(it.first);
       Oc_Snprintf(buf,sizeof(buf),"%.17g",
-                  static_cast<double>(derived_data[it]));
+                  static_cast<double>(it.second));
       string_array.push_back(String(buf));
       desc += String("\n");
       desc += Nb_MergeList(string_array);
@@ -565,18 +554,19 @@ void Oxs_SimState::SaveState(const char* filename,
 
   { // Oxs_MeshValue scalar array data: This is not saved,
     // but the label and array size is recorded.
-    std::vector<DerivedDataKey> keys;
-    keys.reserve (derived_scalar_meshvalue_data.size());
-    for (auto& it : derived_scalar_meshvalue_data) {
-      keys.push_back(it.first);
+    std::vector< std::pair<String,OC_INDEX> > items;
+    items.reserve(derived_scalar_meshvalue_data.Keys().size());
+    for(OC_INDEX i : derived_scalar_meshvalue_data.Keys()) {
+      items.emplace_back(Oxs_DerivedDataKey::Name(i),
+                         derived_scalar_meshvalue_data.Get(i)->Size());
     }
-    std::sort(keys.begin(), keys.end());
-    for (auto& it : keys) {
+    std::sort(items.begin(), items.end());
+    for (auto& it : items) {
       string_array.clear();
       string_array.push_back("DRV_SMV");
-      string_array.push_back(it);
+      string_array.push_back(it.first);
       Oc_Snprintf(buf,sizeof(buf),"%ld",
-        static_cast<long int>(derived_scalar_meshvalue_data[it].Size()));
+                  static_cast<long int>(it.second));
       string_array.push_back(String(buf));
       desc += String("\n");
       desc += Nb_MergeList(string_array);
@@ -585,18 +575,19 @@ void Oxs_SimState::SaveState(const char* filename,
 
   { // Oxs_MeshValue threevector array data: This is not saved,
     // but the label and array size is recorded.
-    std::vector<DerivedDataKey> keys;
-    keys.reserve (derived_threevector_meshvalue_data.size());
-    for (auto& it : derived_threevector_meshvalue_data) {
-      keys.push_back(it.first);
+    std::vector< std::pair<String,OC_INDEX> > items;
+    items.reserve(derived_threevector_meshvalue_data.Keys().size());
+    for(OC_INDEX i : derived_threevector_meshvalue_data.Keys()) {
+      items.emplace_back(Oxs_DerivedDataKey::Name(i),
+                         derived_threevector_meshvalue_data.Get(i)->Size());
     }
-    std::sort(keys.begin(), keys.end());
-    for (auto& it : keys) {
+    std::sort(items.begin(), items.end());
+    for (auto& it : items) {
       string_array.clear();
       string_array.push_back("DRV_TVMV");
-      string_array.push_back(it);
+      string_array.push_back(it.first);
       Oc_Snprintf(buf,sizeof(buf),"%ld",
-        static_cast<long int>(derived_threevector_meshvalue_data[it].Size()));
+                  static_cast<long int>(it.second));
       string_array.push_back(String(buf));
       desc += String("\n");
       desc += Nb_MergeList(string_array);
@@ -604,7 +595,7 @@ void Oxs_SimState::SaveState(const char* filename,
   }
 
   { // Auxiliary data
-    std::vector<DerivedDataKey> keys;
+    std::vector<AuxDataKey> keys;
     keys.reserve (auxiliary_data.size());
     for (auto& it : auxiliary_data) {
       keys.push_back(it.first);
@@ -848,19 +839,20 @@ Oxs_SimState::DumpStateOverview() const
            String(", stage: ") + StatusToString(step_done) +
            String(", run: ") + StatusToString(run_done);
     buf += String("\n Scalar derived values---");
-    for(const auto& cit : derived_data) {
-      buf += String("\n  ") + cit.first
-        + String(" : ") + Oc_MakeString(cit.second);
+    for(OC_INDEX i : derived_data.Keys()) {
+      buf += String("\n  ") + Oxs_DerivedDataKey::Name(i)
+        + String(" : ") + Oc_MakeString(*derived_data.Get(i));
     }
     buf += String("\n Scalar field derived values---");
-    for(const auto& cit : derived_scalar_meshvalue_data) {
-      buf += String("\n  ") + cit.first
-        + String(" : @") + Oc_MakeString(cit.second.GetArrayBlock());
+    for(OC_INDEX i : derived_scalar_meshvalue_data.Keys()) {
+      buf += String("\n  ") + Oxs_DerivedDataKey::Name(i) + String(" : @")
+        + Oc_MakeString(derived_scalar_meshvalue_data.Get(i)->GetArrayBlock());
     }
     buf += String("\n ThreeVector field derived values---");
-    for(const auto& cit : derived_threevector_meshvalue_data) {
-      buf += String("\n  ") + cit.first
-        + String(" : @") + Oc_MakeString(cit.second.GetArrayBlock());
+    for(OC_INDEX i : derived_threevector_meshvalue_data.Keys()) {
+      buf += String("\n  ") + Oxs_DerivedDataKey::Name(i) + String(" : @")
+        + Oc_MakeString(derived_threevector_meshvalue_data.Get(i)
+                        ->GetArrayBlock());
     }
     buf += String("\n Auxiliary scalar values---");
     for(const auto& cit : auxiliary_data) {
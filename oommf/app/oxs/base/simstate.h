@@ -8,9 +8,11 @@
 #define _OXS_SIMSTATE
 
 
+#include <deque>
 #include <memory> // Shared pointers
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "oc.h"
@@ -27,6 +29,37 @@ OC_USE_STRING;
 class Oxs_Director; // Forward references
 class Oxs_Mesh;
 
+// Interned names for Oxs_SimState derived data.  Each distinct name is
+// assigned a small integer index the first time it is interned, and
+// that index is shared by all states for the life of the process.
+// Derived data in each Oxs_SimState are stored in flat arrays indexed
+// by key, so Add/Get/HaveDerivedData calls made through a key involve
+// no string construction or hashing.  Clients that access derived data
+// every step should build their keys once, typically in Init(), and
+// use the key versions of those calls.  Interned names are never
+// released, so keys should only be built from a fixed set of names
+// such as those returned by Oxs_Ext::DataName().
+class Oxs_DerivedDataKey {
+public:
+  Oxs_DerivedDataKey() : index(-1) {}
+  explicit Oxs_DerivedDataKey(const String& name) : index(Intern(name)) {}
+  explicit Oxs_DerivedDataKey(const char* name)
+    : index(Intern(String(name))) {}
+
+  OC_BOOL IsValid() const { return (index>=0); }
+  OC_INDEX Index() const { return index; }
+  String Name() const { return Name(index); }
+
+  static OC_INDEX Intern(const String& name); // Adds name if necessary
+  static OC_INDEX Find(const String& name);   // Returns -1 if name has
+  /// not been interned.
+  static String Name(OC_INDEX index);
+  static OC_INDEX Count(); // Number of interned names
+
+private:
+  OC_INDEX index;
+};
+
 class Oxs_SimState : public Oxs_Lock {
   // Perhaps the inheritance from Oxs_Lock should be private, but then
   // exposing the Oxs_Lock member functions is awkward.
@@ -43,16 +76,68 @@ class Oxs_SimState : public Oxs_Lock {
   // Note 2: If the Oxs_SimState structure changes, then the convenience
   //  method CloneHeader should be updated to reflect those changes.
 private:
-  typedef String DerivedDataKey;
   typedef String AuxDataKey;
 
+  // Derived data storage, indexed by Oxs_DerivedDataKey::Index().
+  // The keys list records the indices set in this state, in order
+  // of insertion, so that listing and clearing don't need to scan
+  // over entries that were never set.  Values are held in a deque
+  // so that growing the store for a new key doesn't move existing
+  // entries; pointers returned by Get remain valid until Clear.
+  template<class T> class DerivedDataStore {
+  public:
+    OC_BOOL Have(OC_INDEX i) const {
+      return (0<=i && i<static_cast<OC_INDEX>(isset.size()) && isset[i]);
+    }
+    const T* Get(OC_INDEX i) const {
+      return (Have(i) ? &value[i] : nullptr);
+    }
+    OC_BOOL Add(OC_INDEX i,T&& newvalue) {
+      if(i<0) return 0;
+      if(i>=static_cast<OC_INDEX>(isset.size())) Grow(i);
+      if(isset[i]) return 0; // Derived data can't be overwritten
+      value[i] = std::move(newvalue);
+      isset[i] = 1;
+      keys.push_back(i);
+      return 1;
+    }
+    void Clear() {
+      for(OC_INDEX i : keys) {
+        isset[i] = 0;
+        Discard(value[i]);
+      }
+      keys.clear();
+    }
+    const std::vector<OC_INDEX>& Keys() const { return keys; }
+  private:
+    std::deque<T> value;
+    std::vector<char> isset;
+    std::vector<OC_INDEX> keys;
+    void Grow(OC_INDEX i) {
+      // Size to the current key count, so that states don't need to
+      // be regrown for each new key as a problem starts up.
+      OC_INDEX newsize = Oxs_DerivedDataKey::Count();
+      if(newsize<=i) newsize = i+1;
+      value.resize(newsize);
+      isset.resize(newsize,0);
+    }
+    static void Discard(OC_REAL8m&) {}
+    template<class U> static void Discard(Oxs_MeshValue<U>& mv) {
+      // Release the array now rather than at the next Add.  Swap
+      // is used because shared derived arrays are read-only.
+      Oxs_MeshValue<U> tmp;
+      tmp.Swap(mv);
+    }
+  };
+
+  mutable DerivedDataStore<OC_REAL8m> derived_data;
+  mutable DerivedDataStore< Oxs_MeshValue<OC_REAL8m> >
+     derived_scalar_meshvalue_data;
+  mutable DerivedDataStore< Oxs_MeshValue<ThreeVector> >
+     derived_threevector_meshvalue_data;
+
   // NOTE: The key type for std::unordered_map can't be const; this
   //       might be related to LWG issue 2469 fixed in C++17.
-  mutable std::unordered_map<DerivedDataKey,OC_REAL8m> derived_data;
-  mutable std::unordered_map<DerivedDataKey, Oxs_MeshValue<OC_REAL8m> >
-  derived_scalar_meshvalue_data;
-  mutable std::unordered_map<DerivedDataKey,Oxs_MeshValue<ThreeVector> >
-     derived_threevector_meshvalue_data;
   mutable std::unordered_map<AuxDataKey,OC_REAL8m> auxiliary_data;
 
   void AppendListDerivedData(vector<String>& names) const;
@@ -150,19 +235,43 @@ public:
   // fails if name is already used.  (Maybe this should be changed
   // to throw an exception?)
   //
+  // Each routine comes in Oxs_DerivedDataKey, String, and char*
+  // versions.  The key versions are cheap; the String and char*
+  // versions look up the name in the Oxs_DerivedDataKey table, under
+  // a process-wide lock, on each call.  They are kept for
+  // compatibility with older extensions; new code should build its
+  // keys once and use the key versions.
+  //
+  // Pointers returned by GetDerivedData stay valid until the state is
+  // cleared or reset, even if other derived data are added later.
+  //
   // Single scalar values:
+  OC_BOOL AddDerivedData(const Oxs_DerivedDataKey& key,
+                         OC_REAL8m value) const {
+    return derived_data.Add(key.Index(),std::move(value));
+  }
   OC_BOOL AddDerivedData(const String& name,OC_REAL8m value) const;
   OC_BOOL AddDerivedData(const char* name,OC_REAL8m value) const {
     return AddDerivedData(String(name),value);
   }
 
+  OC_BOOL GetDerivedData(const Oxs_DerivedDataKey& key,
+                         OC_REAL8m& value) const {
+    const OC_REAL8m* ptr = derived_data.Get(key.Index());
+    if(ptr == nullptr) return 0;
+    value = *ptr;
+    return 1;
+  }
   OC_BOOL GetDerivedData(const String& name,OC_REAL8m& value) const;
   OC_BOOL GetDerivedData(const char* name,OC_REAL8m& value) const {
     return GetDerivedData(String(name),value);
   }
 
+  OC_BOOL HaveDerivedData(const Oxs_DerivedDataKey& key) const {
+    return derived_data.Have(key.Index());
+  }
   OC_BOOL HaveDerivedData(const String& name) const {
-    return (derived_data.count(name)>0 ? 1 : 0);
+    return derived_data.Have(Oxs_DerivedDataKey::Find(name));
   }
   OC_BOOL HaveDerivedData(const char* name) const {
     return HaveDerivedData(String(name));
@@ -171,7 +280,7 @@ public:
   // NB AddDerivedData+Oxs_MeshValue PERFORMANCE NOTE:
   // The const AddDerivedData(char*/String,const Oxs_MeshValue<T>&)
   // routines use the expensive Oxs_MeshValue<T> copy constructors to
-  // fill their unordered_map objects. If you want a cheap shared copy
+  // fill their derived data stores. If you want a cheap shared copy
   // then create an rvalue with Oxs_MeshValue<T>.SharedCopy() and feed
   // that into AddDerivedData(char*/String,Oxs_MeshValue<T>&&) instead,
   // e.g.,
@@ -179,7 +288,7 @@ public:
   // Note that as a side effect of SharedCopy(), both bar and the image
   // in foo will be marked as read-only.
 
-  // UPDATE: Expensive copy versions are disabled until a compelling
+  // UPDATE: Expensive copy versions are not provided until a compelling
   //         use case is found. If clients want an unshared copy,
   //         they can use the MeshValue copy constructor and move
   //         the copy into DerivedData. For example, you can do
@@ -189,30 +298,39 @@ public:
   //                         std::move(Oxs_MeshValue<ThreeVector>(*H)));
 
   // MeshValue array of scalar values:
-#if 0 // Expensive copy
-  OC_BOOL AddDerivedData(const String& name,
-                         const Oxs_MeshValue<OC_REAL8m>& value) const;
-  OC_BOOL AddDerivedData(const char* name,
-                         const Oxs_MeshValue<OC_REAL8m>& value) const {
-    return AddDerivedData(String(name),value);
+  OC_BOOL AddDerivedData(const Oxs_DerivedDataKey& key,
+                         Oxs_MeshValue<OC_REAL8m>&& value) const {
+    return derived_scalar_meshvalue_data.Add(key.Index(),std::move(value));
   }
-#endif // Expensive copy
   OC_BOOL AddDerivedData(const String& name, // Move assignment version
                          Oxs_MeshValue<OC_REAL8m>&& value) const;
   OC_BOOL AddDerivedData(const char* name,   // Move assignment version
                          Oxs_MeshValue<OC_REAL8m>&& value) const {
     return AddDerivedData(String(name),std::move(value));
   }
+  OC_BOOL GetDerivedData(const Oxs_DerivedDataKey& key,
+                         const Oxs_MeshValue<OC_REAL8m>* &value) const {
+    const Oxs_MeshValue<OC_REAL8m>* ptr
+      = derived_scalar_meshvalue_data.Get(key.Index());
+    if(ptr == nullptr) return 0;
+    value = ptr;
+    return 1;
+  }
   OC_BOOL GetDerivedData(const String& name,
                          const Oxs_MeshValue<OC_REAL8m>* &value) const;
   OC_BOOL GetDerivedData(const char* name,
                          const Oxs_MeshValue<OC_REAL8m>* &value) const {
     return GetDerivedData(String(name),value);
   }
+  OC_BOOL HaveDerivedData(const Oxs_DerivedDataKey& key,
+                          const Oxs_MeshValue<OC_REAL8m>*) const {
+    // Second argument is simply for overload selection (not used)
+    return derived_scalar_meshvalue_data.Have(key.Index());
+  }
   OC_BOOL HaveDerivedData(const String& name,
                           const Oxs_MeshValue<OC_REAL8m>*) const {
     // Second argument is simply for overload selection (not used)
-    return (derived_scalar_meshvalue_data.count(name)>0 ? 1 : 0);
+    return derived_scalar_meshvalue_data.Have(Oxs_DerivedDataKey::Find(name));
   }
   OC_BOOL HaveDerivedData(const char* name,
                           const Oxs_MeshValue<OC_REAL8m>* dummy) const {
@@ -220,30 +338,41 @@ public:
   }
 
   // MeshValue array of ThreeVector values:
-#if 0 // Expensive copy
-  OC_BOOL AddDerivedData(const String& name,
-                         const Oxs_MeshValue<ThreeVector>& value) const;
-  OC_BOOL AddDerivedData(const char* name,
-                         const Oxs_MeshValue<ThreeVector>& value) const {
-    return AddDerivedData(String(name),value);
+  OC_BOOL AddDerivedData(const Oxs_DerivedDataKey& key,
+                         Oxs_MeshValue<ThreeVector>&& value) const {
+    return derived_threevector_meshvalue_data.Add(key.Index(),
+                                                  std::move(value));
   }
-#endif // Expensive copy
   OC_BOOL AddDerivedData(const String& name, // Move assignment version
                          Oxs_MeshValue<ThreeVector>&& value) const;
   OC_BOOL AddDerivedData(const char* name,   // Move assignment version
                          Oxs_MeshValue<ThreeVector>&& value) const {
     return AddDerivedData(String(name),std::move(value));
   }
+  OC_BOOL GetDerivedData(const Oxs_DerivedDataKey& key,
+                         const Oxs_MeshValue<ThreeVector>* &value) const {
+    const Oxs_MeshValue<ThreeVector>* ptr
+      = derived_threevector_meshvalue_data.Get(key.Index());
+    if(ptr == nullptr) return 0;
+    value = ptr;
+    return 1;
+  }
   OC_BOOL GetDerivedData(const String& name,
                          const Oxs_MeshValue<ThreeVector>* &value) const;
   OC_BOOL GetDerivedData(const char* name,
                          const Oxs_MeshValue<ThreeVector>* &value) const {
     return GetDerivedData(String(name),value);
   }
+  OC_BOOL HaveDerivedData(const Oxs_DerivedDataKey& key,
+                          const Oxs_MeshValue<ThreeVector>*) const {
+    // Second argument is simply for overload selection (not used)
+    return derived_threevector_meshvalue_data.Have(key.Index());
+  }
   OC_BOOL HaveDerivedData(const String& name,
                           const Oxs_MeshValue<ThreeVector>*) const {
     // Second argument is simply for overload selection (not used)
-    return (derived_threevector_meshvalue_data.count(name)>0 ? 1 : 0);
+    return derived_threevector_meshvalue_data.Have(
+                                         Oxs_DerivedDataKey::Find(name));
   }
   OC_BOOL HaveDerivedData(const char* name,
                           const Oxs_MeshValue<ThreeVector>* dummy) const {
@@ -252,7 +381,8 @@ public:
 
   // NB: Oxs_Ext objects accessing any of the Add/GetDerivedData
   // or Add/GetAuxData routines should use the Oxs_Ext::DataName()
-  // wrapper to get an instance-specific item name.
+  // or Oxs_Ext::DataKey() wrappers to get an instance-specific item
+  // name.
 
   // Note that since all the List* variants have the same signature, we
   // have to use distinct names to distinguish between them.
@@ -261,7 +391,7 @@ public:
   void ListDerivedThreeVectorMeshValueData(vector<String>& names) const;
 
   void ClearDerivedData(); // This function only changes mutable
-  /// values (the derived_data maps), so it could be made "const".
+  /// values (the derived_data stores), so it could be made "const".
   /// However, one of the properties of derived_data is that once
   /// calculated for a given state, it doesn't change --- AddDerivedData
   /// fails if you try to overwrite an existing value.  Making
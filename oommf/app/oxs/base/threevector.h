@@ -476,4 +476,101 @@ inline void Oxs_ThreeVectorPairPack
 }
 #endif // OC_USE_SSE
 
+////////////////////////////////////////////////////////////////////////
+// Oxs_ThreeVectorPack holds OC_PACK_WIDTH consecutive three vectors in
+// component form, one Oc_Pack each for x, y, and z.  (See ocsse.h.)
+// The arithmetic follows the Oxs_ThreeVector member functions
+// operation for operation, so packed loops produce the same results
+// as the serial code.  Load() and Store() have no alignment
+// restrictions.
+class Oxs_ThreeVectorPack {
+public:
+  Oc_Pack x,y,z;
+
+  Oxs_ThreeVectorPack() {}
+  Oxs_ThreeVectorPack(const Oc_Pack& ix,const Oc_Pack& iy,const Oc_Pack& iz)
+    : x(ix), y(iy), z(iz) {}
+  explicit Oxs_ThreeVectorPack(const Oxs_ThreeVector* vec) { Load(vec); }
+
+  void Load(const Oxs_ThreeVector* vec) {
+    Oc_PackLoadInterleaved3(vec[0].x,x,y,z);
+  }
+  void Store(Oxs_ThreeVector* vec) const {
+    Oc_PackStoreInterleaved3(x,y,z,vec[0].x);
+  }
+
+  Oxs_ThreeVectorPack& SetZero() {
+    x.SetZero(); y.SetZero(); z.SetZero(); return *this;
+  }
+
+  Oxs_ThreeVectorPack& operator+=(const Oxs_ThreeVectorPack& v) {
+    x+=v.x; y+=v.y; z+=v.z; return *this;
+  }
+  Oxs_ThreeVectorPack& operator-=(const Oxs_ThreeVectorPack& v) {
+    x-=v.x; y-=v.y; z-=v.z; return *this;
+  }
+  Oxs_ThreeVectorPack& operator*=(const Oc_Pack& a) {
+    x*=a; y*=a; z*=a; return *this;
+  }
+  Oxs_ThreeVectorPack& operator*=(OC_REAL8m a) {
+    x*=a; y*=a; z*=a; return *this;
+  }
+
+  Oxs_ThreeVectorPack& operator^=(const Oxs_ThreeVectorPack& w) {
+    Oc_Pack tx = y*w.z - z*w.y;
+    Oc_Pack ty = z*w.x - x*w.z;
+    Oc_Pack tz = x*w.y - y*w.x;
+    x = tx; y = ty; z = tz;
+    return *this;
+  }
+
+  Oxs_ThreeVectorPack& Accum(const Oc_Pack& a,const Oxs_ThreeVectorPack& v) {
+    x = a*v.x + x;  y = a*v.y + y;  z = a*v.z + z;
+    return *this;
+  }
+  Oxs_ThreeVectorPack& Accum(OC_REAL8m a,const Oxs_ThreeVectorPack& v) {
+    x = a*v.x + x;  y = a*v.y + y;  z = a*v.z + z;
+    return *this;
+  }
+
+  const Oc_Pack MagSq() const { return x*x + (y*y + z*z); }
+
+  const Oc_Pack MakeUnit() {
+    // Packed Oxs_ThreeVector::MakeUnit().  The usual case, where
+    // |1-magsq| <= OC_CUBE_ROOT_REAL8_EPSILON for all vectors, is done
+    // in packed form.  Otherwise each vector is sent through
+    // Oxs_ThreeVector::MakeUnit().  Return value is original MagSq().
+    Oc_Pack error = Oc_Pack(1.0) - x*x;  error -= y*y;  error -= z*z;
+    const Oc_Pack orig_magsq = Oc_Pack(1.0) - error;
+    Oc_Pack abserror = error;  abserror.KeepMax(Oc_Pack(0.0) - error);
+    if(Oc_PackMaxElement(abserror) <= OC_CUBE_ROOT_REAL8_EPSILON) {
+      Oc_Pack adj = ((Oc_Pack(0.3125)*error+0.375)*error+0.5)*error;
+      adj = Oc_PackMaskGreater(abserror,Oc_Pack(2*OC_REAL8_EPSILON),adj);
+      x += adj*x;   y += adj*y;   z += adj*z;
+    } else {
+      Oxs_ThreeVector vec[OC_PACK_WIDTH];
+      Store(vec);
+      for(int i=0;i<OC_PACK_WIDTH;++i) vec[i].MakeUnit();
+      Load(vec);
+    }
+    return orig_magsq;
+  }
+};
+
+inline const Oxs_ThreeVectorPack
+operator+(const Oxs_ThreeVectorPack& lhs,const Oxs_ThreeVectorPack& rhs)
+{ Oxs_ThreeVectorPack result(lhs); return result+=rhs; }
+
+inline const Oxs_ThreeVectorPack
+operator-(const Oxs_ThreeVectorPack& lhs,const Oxs_ThreeVectorPack& rhs)
+{ Oxs_ThreeVectorPack result(lhs); return result-=rhs; }
+
+inline const Oxs_ThreeVectorPack
+operator*(const Oc_Pack& a,const Oxs_ThreeVectorPack& vec)
+{ Oxs_ThreeVectorPack result(vec); return result*=a; }
+
+inline const Oxs_ThreeVectorPack
+operator*(OC_REAL8m a,const Oxs_ThreeVectorPack& vec)
+{ Oxs_ThreeVectorPack result(vec); return result*=a; }
+
 #endif // _OXS_THREEVECTOR
@@ -0,0 +1,388 @@
+/* FILE: batchdemag.cc            -*-Mode: c++-*-
+ *
+ * Demagnetization field for a batch of independent problems.  See
+ * batchdemag.h for an overview.
+ *
+ * The mesh is rdimx x rdimy x (replica_count*rdimz), and replica r is
+ * the block of cells with r*rdimz <= k < (r+1)*rdimz.  Since the mesh
+ * is stored with x fastest and z slowest, each replica occupies a
+ * contiguous range of the mesh arrays, and is transformed directly
+ * from the spin and Ms arrays, and back into the field array, by a 3D
+ * FFT of size rdimx x rdimy x rdimz zero padded to cdimx x cdimy x
+ * cdimz.  Work is distributed across threads by replica, so that the
+ * transform, the kernel product and the energy computation for one
+ * replica stay in the cache of one processor.  This is efficient when
+ * replica_count is comparable to or larger than the thread count; for
+ * one large problem use Oxs_Demag.
+ *
+ * The demag tensor is computed with the same analytic and asymptotic
+ * formulae as Oxs_Demag, evaluated pointwise across the first octant
+ * of the block offsets.
+ *
+ * Nothing in this class decouples the replicas in other energy terms.
+ * In particular the exchange energy must not couple adjacent blocks;
+ * use Oxs_Exchange6Ngbr with one atlas region per replica and
+ * default_A 0.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nb.h"
+#include "director.h"
+#include "key.h"
+#include "mesh.h"
+#include "meshvalue.h"
+#include "oxsthread.h"
+#include "simstate.h"
+#include "threevector.h"
+#include "energy.h"             // Needed to make MSVC++ 5 happy
+
+#include "rectangularmesh.h"
+#include "batchdemag.h"
+#include "demagcoef.h"
+
+OC_USE_STRING;
+
+/* End includes */
+
+// Oxs_Ext registration support
+OXS_EXT_REGISTER(Oxs_BatchDemag);
+
+// Size of threevector.  This macro is defined for code legibility
+// and maintenance; it should always be "3".
+#define OBDTV_VECSIZE 3
+
+// Size of complex value, in real units.  This macro is defined for code
+// legibility and maintenance; it should always be "2".
+#define OBDTV_COMPLEXSIZE 2
+
+// Number of kernel components: xx, xy, xz, yy, yz, zz
+#define OBDTV_KERNELSIZE 6
+
+// Constructor
+Oxs_BatchDemag::Oxs_BatchDemag(
+  const char* name,     // Child instance id
+  Oxs_Director* newdtr, // App director
+  const char* argstr)   // MIF input block parameters
+  : Oxs_Energy(name,newdtr,argstr),
+    replica_count(0),demag_tensor_error(1e-15),
+    rdimx(0),rdimy(0),rdimz(0),cdimx(0),cdimy(0),cdimz(0),
+    mesh_id(0),energy_density_error_estimate(-1)
+{
+  replica_count = GetIntInitValue("replica_count");
+  if(replica_count<1) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " replica_count must be positive.");
+  }
+  demag_tensor_error = GetRealInitValue("demag_tensor_error",1e-15);
+  if(demag_tensor_error<=0.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " demag_tensor_error must be positive.");
+  }
+  VerifyAllInitArgsUsed();
+}
+
+OC_BOOL Oxs_BatchDemag::Init()
+{
+  mesh_id = 0;
+  energy_density_error_estimate = -1;
+  ReleaseMemory();
+  return Oxs_Energy::Init();
+}
+
+void Oxs_BatchDemag::ReleaseMemory() const
+{ // Conceptually const
+  for(size_t t=0;t<fft.size();++t) delete fft[t];
+  fft.clear();
+  Hxfrm.clear();
+  A.clear();
+  rdimx=rdimy=rdimz=0;
+  cdimx=cdimy=cdimz=0;
+}
+
+void Oxs_BatchDemag::SetThreadCount(int thread_count) const
+{ // Conceptually const
+  const OC_INDEX xfrm_size
+    = OBDTV_COMPLEXSIZE*OBDTV_VECSIZE*cdimx*cdimy*cdimz;
+  while(int(fft.size())<thread_count) {
+    Oxs_FFT3DThreeVector* xfft = new Oxs_FFT3DThreeVector;
+    xfft->SetDimensions(rdimx,rdimy,rdimz,cdimx,cdimy,cdimz);
+    fft.push_back(xfft);
+    Hxfrm.push_back(vector<OXS_FFT_REAL_TYPE>(xfrm_size));
+  }
+}
+
+void Oxs_BatchDemag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
+{ // This routine is conceptually const.
+  const Oxs_RectangularMesh* mesh
+    = dynamic_cast<const Oxs_RectangularMesh*>(genmesh);
+  if(mesh==NULL) {
+    String msg = String("Object ")
+      + String(genmesh->InstanceName())
+      + String(" is not a (non-periodic) rectangular mesh.");
+    throw Oxs_ExtError(this,msg);
+  }
+
+  // Clean-up from previous allocation, if any.
+  ReleaseMemory();
+
+  if(mesh->DimZ()%replica_count != 0) {
+    char buf[1024];
+    Oc_Snprintf(buf,sizeof(buf),
+                "Mesh z-dimension (%ld) is not divisible by"
+                " replica_count (%ld).",
+                long(mesh->DimZ()),long(replica_count));
+    throw Oxs_ExtError(this,buf);
+  }
+  rdimx = mesh->DimX();
+  rdimy = mesh->DimY();
+  rdimz = mesh->DimZ()/replica_count;
+  if(rdimx==0 || rdimy==0 || rdimz==0) return; // Empty mesh!
+
+  Oxs_FFT3DThreeVector::RecommendDimensions((rdimx==1 ? 1 : 2*rdimx),
+                                            (rdimy==1 ? 1 : 2*rdimy),
+                                            (rdimz==1 ? 1 : 2*rdimz),
+                                            cdimx,cdimy,cdimz);
+  const int thread_count = Oc_GetMaxThreadCount();
+  SetThreadCount(thread_count);
+  OC_INDEX ldimx,ldimy,ldimz; // Logical dimensions
+  fft[0]->GetLogicalDimensions(ldimx,ldimy,ldimz);
+
+  // Demag tensor across the first octant of block offsets.  The
+  // tensor is scale invariant, so work with cell dimensions scaled so
+  // the largest is 1, as in Oxs_Demag.
+  typedef OXS_DEMAG_REAL_ANALYTIC DR;
+  DR ddx = mesh->EdgeLengthX();
+  DR ddy = mesh->EdgeLengthY();
+  DR ddz = mesh->EdgeLengthZ();
+  {
+    DR maxedge = ddx;
+    if(ddy>maxedge) maxedge = ddy;
+    if(ddz>maxedge) maxedge = ddz;
+    ddx/=maxedge; ddy/=maxedge; ddz/=maxedge;
+  }
+  OXS_DEMAG_REAL_ASYMP adx,ady,adz;
+  ddx.DownConvert(adx);  ddy.DownConvert(ady);  ddz.DownConvert(adz);
+
+  const int asymptotic_order = 11;
+  Oxs_DemagNxxAsymptotic ANxx(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNxyAsymptotic ANxy(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNxzAsymptotic ANxz(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNyyAsymptotic ANyy(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNyzAsymptotic ANyz(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNzzAsymptotic ANzz(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  const OXS_DEMAG_REAL_ASYMP arad = ANxx.GetAsymptoticStart();
+  const OXS_DEMAG_REAL_ASYMP aradsq = arad*arad;
+
+  vector<OC_REAL8m> quad(OBDTV_KERNELSIZE*rdimx*rdimy*rdimz);
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (rdimy*rdimz,[&](OC_INT4m,OC_INDEX rstart,OC_INDEX rstop) {
+      for(OC_INDEX r=rstart;r<rstop;++r) {
+        const OC_INDEX k = r/rdimy;
+        const OC_INDEX j = r - k*rdimy;
+        for(OC_INDEX i=0;i<rdimx;++i) {
+          OC_REAL8m* nptr = &(quad[OBDTV_KERNELSIZE*(r*rdimx+i)]);
+          const OXS_DEMAG_REAL_ASYMP x = adx*i;
+          const OXS_DEMAG_REAL_ASYMP y = ady*j;
+          const OXS_DEMAG_REAL_ASYMP z = adz*k;
+          if(x*x+y*y+z*z>=aradsq) {
+            nptr[0] = ANxx.Asymptotic(x,y,z);
+            nptr[1] = ANxy.Asymptotic(x,y,z);
+            nptr[2] = ANxz.Asymptotic(x,y,z);
+            nptr[3] = ANyy.Asymptotic(x,y,z);
+            nptr[4] = ANyz.Asymptotic(x,y,z);
+            nptr[5] = ANzz.Asymptotic(x,y,z);
+          } else {
+            const DR dxi = ddx*DR(double(i));
+            const DR dyj = ddy*DR(double(j));
+            const DR dzk = ddz*DR(double(k));
+            Oxs_CalculateNxx(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[0]);
+            Oxs_CalculateNxy(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[1]);
+            Oxs_CalculateNxz(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[2]);
+            Oxs_CalculateNyy(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[3]);
+            Oxs_CalculateNyz(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[4]);
+            Oxs_CalculateNzz(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[5]);
+          }
+        }
+      }
+    });
+
+  // Self term.  Oxs_SelfDemagN? is more accurate than the general
+  // formulae at the origin.
+  Oxs_SelfDemagNx(ddx,ddy,ddz).DownConvert(quad[0]);
+  Oxs_SelfDemagNy(ddx,ddy,ddz).DownConvert(quad[3]);
+  Oxs_SelfDemagNz(ddx,ddy,ddz).DownConvert(quad[5]);
+  quad[1] = quad[2] = quad[4] = 0.0;
+
+  // Unfold the octant onto the full logical transform grid, with
+  // negative offsets wrapped to the top of each axis.  Nxy is odd in x
+  // and y, Nxz in x and z, and Nyz in y and z; the diagonal terms are
+  // even.  The first three components are packed into kxx as three
+  // vectors, the last three into kyy, so that each can be transformed
+  // with an Oxs_FFT3DThreeVector.
+  const OC_INDEX lsize = ldimx*ldimy*ldimz;
+  vector<OXS_FFT_REAL_TYPE> kxx(OBDTV_VECSIZE*lsize,0.0);
+  vector<OXS_FFT_REAL_TYPE> kyy(OBDTV_VECSIZE*lsize,0.0);
+  for(OC_INDEX k=1-rdimz;k<rdimz;++k) {
+    const OC_REAL8m sz = (k<0 ? -1.0 : 1.0);
+    const OC_INDEX ak = (k<0 ? -k : k);
+    const OC_INDEX lk = (k<0 ? ldimz+k : k);
+    for(OC_INDEX j=1-rdimy;j<rdimy;++j) {
+      const OC_REAL8m sy = (j<0 ? -1.0 : 1.0);
+      const OC_INDEX aj = (j<0 ? -j : j);
+      const OC_INDEX lj = (j<0 ? ldimy+j : j);
+      for(OC_INDEX i=1-rdimx;i<rdimx;++i) {
+        const OC_REAL8m sx = (i<0 ? -1.0 : 1.0);
+        const OC_INDEX ai = (i<0 ? -i : i);
+        const OC_INDEX li = (i<0 ? ldimx+i : i);
+        const OC_REAL8m* qptr
+          = &(quad[OBDTV_KERNELSIZE*((ak*rdimy + aj)*rdimx + ai)]);
+        const OC_INDEX index = OBDTV_VECSIZE*((lk*ldimy + lj)*ldimx + li);
+        kxx[index]   = qptr[0];
+        kxx[index+1] = sx*sy*qptr[1];
+        kxx[index+2] = sx*sz*qptr[2];
+        kyy[index]   = qptr[3];
+        kyy[index+1] = sy*sz*qptr[4];
+        kyy[index+2] = qptr[5];
+      }
+    }
+  }
+  quad.clear();
+
+  // Transform.  The kernel components are real and either even or odd
+  // in each coordinate, with an even number of odd coordinates, so the
+  // transforms are real.  Only the real parts are kept.
+  //   Note: Since H = -N*M, we store "-N" instead of "N" so we don't
+  // have to multiply the output from the FFT + iFFT by -1 in
+  // ComputeEnergy() below.
+  const OC_INDEX fsize = cdimx*cdimy*cdimz;
+  A.resize(OBDTV_KERNELSIZE*fsize);
+  {
+    Oxs_FFT3DThreeVector kfft;
+    kfft.SetDimensions(ldimx,ldimy,ldimz,cdimx,cdimy,cdimz);
+    const OXS_FFT_REAL_TYPE fft_scaling = -1 * kfft.GetScaling();
+    vector<OXS_FFT_REAL_TYPE> kxfrm(OBDTV_COMPLEXSIZE*OBDTV_VECSIZE*fsize);
+    for(int pass=0;pass<2;++pass) {
+      kfft.ForwardRealToComplexFFT(pass==0 ? &(kxx[0]) : &(kyy[0]),
+                                   &(kxfrm[0]));
+      const int aoff = OBDTV_VECSIZE*pass;
+      for(OC_INDEX f=0;f<fsize;++f) {
+        const OXS_FFT_REAL_TYPE* kptr
+          = &(kxfrm[OBDTV_COMPLEXSIZE*OBDTV_VECSIZE*f]);
+        OXS_FFT_REAL_TYPE* aptr = &(A[OBDTV_KERNELSIZE*f+aoff]);
+        aptr[0] = fft_scaling*kptr[0];
+        aptr[1] = fft_scaling*kptr[2];
+        aptr[2] = fft_scaling*kptr[4];
+      }
+    }
+  }
+}
+
+void Oxs_BatchDemag::ComputeEnergy
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyData& oced
+ ) const
+{
+  // (Re)-initialize mesh coefficient array if mesh has changed.
+  if(mesh_id != state.mesh->Id()) {
+    mesh_id = 0; // Safety
+    FillCoefficientArrays(state.mesh);
+    mesh_id = state.mesh->Id();
+    energy_density_error_estimate
+      = 0.5*OC_REAL8m_EPSILON*MU0*state.max_absMs*state.max_absMs
+      *(log(double(cdimx))+log(double(cdimy))+log(double(cdimz)))/log(2.);
+  }
+  oced.energy_density_error_estimate = energy_density_error_estimate;
+
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+
+  Oxs_MeshValue<ThreeVector>& field
+    = *(oced.H != 0 ? oced.H : oced.scratch_H);
+  field.AdjustSize(state.mesh);
+
+  const OC_INDEX rsize = Ms.Size();
+  const OC_INDEX block_size = rdimx*rdimy*rdimz;
+  assert(block_size*replica_count == rsize);
+  if(rsize==0) {
+    oced.energy_sum = 0.0;
+    oced.pE_pt = 0.0;
+    return;
+  }
+
+  const int thread_count = Oc_GetMaxThreadCount();
+  SetThreadCount(thread_count); // In case thread count has changed
+
+#if (3*OC_REAL8m_WIDTH) != OC_THREE_VECTOR_REAL8m_WIDTH
+# error Oxs_ThreeVector not tightly packed.
+#endif
+  // The transforms pun the ThreeVector arrays spin and field into
+  // OXS_FFT_REAL_TYPE arrays.
+  const OXS_FFT_REAL_TYPE* const sptr
+    = static_cast<const OXS_FFT_REAL_TYPE*>
+    (static_cast<const void*>(&spin[OC_INDEX(0)]));
+  const OXS_FFT_REAL_TYPE* const msptr = &Ms[OC_INDEX(0)];
+  OXS_FFT_REAL_TYPE* const fptr
+    = static_cast<OXS_FFT_REAL_TYPE*>(static_cast<void*>(&field[OC_INDEX(0)]));
+  const OXS_FFT_REAL_TYPE* const abase = &(A[0]);
+  const OC_INDEX fsize = cdimx*cdimy*cdimz;
+
+  // For each replica, the forward transform of Ms*m, the kernel
+  // product H = A*M at each frequency, the inverse transform directly
+  // into field, and the pointwise energy density -0.5*MU0*<M,H> and
+  // output arrays.
+  vector<Oxs_Energy::SUMTYPE> thread_esum(thread_count,0.0);
+  const OXS_FFT_REAL_TYPE emult =  -0.5 * MU0;
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (replica_count,
+     [&](OC_INT4m thread_id,OC_INDEX rstart,OC_INDEX rstop) {
+      const Oxs_FFT3DThreeVector& xfft = *(fft[thread_id]);
+      OXS_FFT_REAL_TYPE* const hptr = &(Hxfrm[thread_id][0]);
+      Oxs_Energy::SUMTYPE esum = 0.0;
+      for(OC_INDEX r=rstart;r<rstop;++r) {
+        const OC_INDEX offset = r*block_size;
+        xfft.ForwardRealToComplexFFT(sptr+OBDTV_VECSIZE*offset,hptr,
+                                     msptr+offset);
+        for(OC_INDEX f=0;f<fsize;++f) {
+          const OXS_FFT_REAL_TYPE* a = abase + OBDTV_KERNELSIZE*f;
+          OXS_FFT_REAL_TYPE* h = hptr + OBDTV_COMPLEXSIZE*OBDTV_VECSIZE*f;
+          const OXS_FFT_REAL_TYPE Mx_re = h[0];
+          const OXS_FFT_REAL_TYPE Mx_im = h[1];
+          const OXS_FFT_REAL_TYPE My_re = h[2];
+          const OXS_FFT_REAL_TYPE My_im = h[3];
+          const OXS_FFT_REAL_TYPE Mz_re = h[4];
+          const OXS_FFT_REAL_TYPE Mz_im = h[5];
+          h[0] = a[0]*Mx_re + a[1]*My_re + a[2]*Mz_re;
+          h[1] = a[0]*Mx_im + a[1]*My_im + a[2]*Mz_im;
+          h[2] = a[1]*Mx_re + a[3]*My_re + a[4]*Mz_re;
+          h[3] = a[1]*Mx_im + a[3]*My_im + a[4]*Mz_im;
+          h[4] = a[2]*Mx_re + a[4]*My_re + a[5]*Mz_re;
+          h[5] = a[2]*Mx_im + a[4]*My_im + a[5]*Mz_im;
+        }
+        xfft.InverseComplexToRealFFT(hptr,fptr+OBDTV_VECSIZE*offset);
+        for(OC_INDEX i=offset;i<offset+block_size;++i) {
+          OXS_FFT_REAL_TYPE dot = spin[i]*field[i];
+          ThreeVector torque = spin[i]^field[i];
+          OC_REAL8m ei = emult * dot * Ms[i];
+          esum += ei;
+          if(oced.H_accum)           (*oced.H_accum)[i] += field[i];
+          if(oced.energy)             (*oced.energy)[i]  = ei;
+          if(oced.energy_accum) (*oced.energy_accum)[i] += ei;
+          if(oced.mxH)                   (*oced.mxH)[i]  = torque;
+          if(oced.mxH_accum)       (*oced.mxH_accum)[i] += torque;
+        }
+      }
+      thread_esum[thread_id] += esum;
+    });
+  Oxs_Energy::SUMTYPE esum = 0.0;
+  for(int t=0;t<thread_count;++t) esum += thread_esum[t];
+
+  oced.energy_sum = esum * state.mesh->Volume(0);
+  /// All cells have same volume in an Oxs_RectangularMesh.
+
+  oced.pE_pt = 0.0;
+}
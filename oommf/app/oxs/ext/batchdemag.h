@@ -0,0 +1,86 @@
+/* FILE: batchdemag.h            -*-Mode: c++-*-
+ *
+ * Demagnetization field for a batch of independent, identically
+ * meshed problems.  The mesh is divided along z into replica_count
+ * blocks of equal depth, and each block is treated as a separate
+ * specimen: the demag field in a block depends only on the
+ * magnetization of that block.  All blocks share one demag kernel,
+ * and the block transforms are done by one Oxs_FFT3DThreeVector per
+ * thread, so that many small problems can be evolved together in a
+ * single Oxs run, with one evolver step advancing every replica.
+ *
+ */
+
+#ifndef _OXS_BATCHDEMAG
+#define _OXS_BATCHDEMAG
+
+#include <vector>
+
+#include "energy.h"
+#include "fft3v.h"
+#include "key.h"
+#include "mesh.h"
+#include "meshvalue.h"
+#include "simstate.h"
+#include "threevector.h"
+#include "rectangularmesh.h"
+
+/* End includes */
+
+class Oxs_BatchDemag:public Oxs_Energy {
+private:
+  OC_INDEX replica_count;       // Number of blocks along z
+  OC_REAL8m demag_tensor_error; // Analytic/asymptotic split
+
+  mutable OC_INDEX rdimx; // Natural size of one replica block
+  mutable OC_INDEX rdimy;
+  mutable OC_INDEX rdimz;
+  mutable OC_INDEX cdimx; // Transform size; cdimx is the number of
+  mutable OC_INDEX cdimy; // complex values stored along x.
+  mutable OC_INDEX cdimz;
+
+  mutable OC_UINT4m mesh_id;
+  mutable OC_REAL8m energy_density_error_estimate; // Cached value,
+  /// initialized when mesh changes.
+
+  // Transformed kernel, one record of six reals per frequency, in the
+  // same order as the cdimx x cdimy x cdimz complex three vector
+  // transform arrays.  Components are xx, xy, xz, yy, yz, zz.  All six
+  // transforms are real.  The FFT scaling and the -1 in H = -N*M are
+  // folded in.  Replica meshes are small, so the full frequency domain
+  // is stored rather than one octant.
+  mutable std::vector<OXS_FFT_REAL_TYPE> A;
+
+  // One FFT object and one transform buffer per thread.  Each thread
+  // processes whole replicas.
+  mutable std::vector<Oxs_FFT3DThreeVector*> fft;
+  mutable std::vector< std::vector<OXS_FFT_REAL_TYPE> > Hxfrm;
+
+  void FillCoefficientArrays(const Oxs_Mesh* mesh) const;
+  /// Conceptually const.
+
+  void SetThreadCount(int thread_count) const; // Conceptually const.
+
+  void ReleaseMemory() const; // Conceptually const.
+
+protected:
+  virtual void GetEnergy(const Oxs_SimState& state,
+                         Oxs_EnergyData& oed) const {
+    GetEnergyAlt(state,oed);
+  }
+
+  virtual void ComputeEnergy(const Oxs_SimState& state,
+                             Oxs_ComputeEnergyData& oced) const;
+
+public:
+  virtual const char* ClassName() const; // ClassName() is
+  /// automatically generated by the OXS_EXT_REGISTER macro.
+  Oxs_BatchDemag(const char* name,     // Child instance id
+                 Oxs_Director* newdtr, // App director
+                 const char* argstr);  // MIF input block parameters
+  virtual ~Oxs_BatchDemag() { ReleaseMemory(); }
+  virtual OC_BOOL Init();
+};
+
+
+#endif // _OXS_BATCHDEMAG
@@ -0,0 +1,595 @@
+/* FILE: bbevolve.cc                 -*-Mode: c++-*-
+ *
+ * Concrete minimization evolver class, using steepest descent with
+ * Barzilai-Borwein step lengths
+ *
+ */
+
+#include <cassert>
+#include <cfloat>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nb.h"
+#include "director.h"
+#include "mindriver.h"
+#include "simstate.h"
+#include "bbevolve.h"
+#include "key.h"
+#include "oxsthread.h"
+#include "threevector.h"
+#include "util.h"
+
+// Read <algorithm> last, because with some pgc++ installs the
+// <emmintrin.h> header is not interpreted properly if <algorithm> is
+// read first.
+#include <algorithm>
+
+OC_USE_STRING;
+
+// Oxs_Ext registration support
+OXS_EXT_REGISTER(Oxs_BBEvolve);
+
+/* End includes */
+
+// Sufficient decrease coefficient in the step acceptance test.
+static const OC_REAL8m OXS_BBEVOLVE_ARMIJO_COEF = 1e-4;
+
+// Constructor
+Oxs_BBEvolve::Oxs_BBEvolve(
+  const char* name,     // Child instance id
+  Oxs_Director* newdtr, // App director
+  const char* argstr)   // MIF input block parameters
+  : Oxs_MinEvolver(name,newdtr,argstr),
+    energy_error_adj(1.0),
+    start_step(0.0), max_step(0.0), min_step(0.0),
+    nonmonotone_window(10),
+    step_attempt_count(0),
+    energy_calc_count(0),
+    rejected_step_count(0)
+{
+  // Process arguments.  Step sizes are input in degrees, and
+  // converted to tangents for use in TryStep().
+  OC_REAL8m start_ang = GetRealInitValue("start_step",1.0);
+  OC_REAL8m max_ang = GetRealInitValue("maximum_step",10.0);
+  OC_REAL8m min_ang = GetRealInitValue("minimum_step",1e-5);
+  if(min_ang<=0.0 || start_ang<min_ang || max_ang<start_ang
+     || max_ang>=90.0) {
+    throw Oxs_ExtError(this,"Invalid value for minimum_step,"
+                       " start_step and/or maximum_step;"
+                       " require 0 < minimum_step <= start_step"
+                       " <= maximum_step < 90.");
+  }
+  start_step = tan(start_ang*PI/180.);
+  max_step = tan(max_ang*PI/180.);
+  min_step = tan(min_ang*PI/180.);
+
+  nonmonotone_window = GetUIntInitValue("nonmonotone_window",10);
+  if(nonmonotone_window<1) {
+    throw Oxs_ExtError(this,"Invalid value for nonmonotone_window;"
+                       " must be 1 or larger.");
+  }
+
+  energy_error_adj = GetRealInitValue("energy_precision",1e-14)/1e-14;
+
+  // Setup output.  Note: MSVC++ 6.0 requires fully qualified
+  // member function names.
+  total_H_field_output.Setup(this,InstanceName(),"H","A/m",
+              &Oxs_BBEvolve::UpdateDerivedFieldOutputs);
+  mxHxm_output.Setup(this,InstanceName(),"mxHxm","A/m",
+              &Oxs_BBEvolve::UpdateDerivedFieldOutputs);
+  total_energy_density_output.Setup(this,InstanceName(),
+              "Total energy density","J/m^3",
+              &Oxs_BBEvolve::UpdateDerivedFieldOutputs);
+  max_mxHxm_output.Setup(this,InstanceName(),"Max mxHxm","A/m",
+              &Oxs_BBEvolve::UpdateDerivedOutputs);
+  total_energy_output.Setup(this,InstanceName(),"Total energy","J",
+              &Oxs_BBEvolve::UpdateDerivedOutputs);
+  delta_E_output.Setup(this,InstanceName(),"Delta E","J",
+              &Oxs_BBEvolve::UpdateDerivedOutputs);
+  energy_calc_count_output.Setup(this,InstanceName(),
+              "Energy calc count","",
+              &Oxs_BBEvolve::UpdateDerivedOutputs);
+  rejected_step_count_output.Setup(this,InstanceName(),
+              "Rejected step count","",
+              &Oxs_BBEvolve::UpdateDerivedOutputs);
+  step_angle_output.Setup(this,InstanceName(),"Step angle","deg",
+              &Oxs_BBEvolve::UpdateDerivedOutputs);
+
+  total_H_field_output.Register(director,-5);
+  mxHxm_output.Register(director,-5);
+  total_energy_density_output.Register(director,-5);
+  max_mxHxm_output.Register(director,-5);
+  total_energy_output.Register(director,-5);
+  delta_E_output.Register(director,-5);
+  energy_calc_count_output.Register(director,-5);
+  rejected_step_count_output.Register(director,-5);
+  step_angle_output.Register(director,-5);
+
+  energy_calc_count_key = Oxs_DerivedDataKey("Energy calc count");
+  energy_density_error_estimate_key
+    = Oxs_DerivedDataKey("Energy density error estimate");
+  last_energy_key = Oxs_DerivedDataKey("Last energy");
+  max_mxHxm_key = Oxs_DerivedDataKey("Max mxHxm");
+  rejected_step_count_key = Oxs_DerivedDataKey("Rejected step count");
+  step_angle_key = Oxs_DerivedDataKey("Step angle");
+  total_energy_key = Oxs_DerivedDataKey("Total energy");
+
+  VerifyAllInitArgsUsed();
+
+  // Reserve space for the trial state; see TryStep() below.
+  director->ReserveSimulationStateRequest(1);
+}
+
+OC_BOOL Oxs_BBEvolve::Init()
+{
+  // Initialize instance variables
+  step_attempt_count=0;
+  energy_calc_count=0;
+  rejected_step_count=0;
+  basept.Init();
+
+  scratch_energy.Release();
+  scratch_field.Release();
+  work_energy.Release();
+  work_mxHxm.Release();
+
+  // Attach mxHxm field to Oxs_SimState so that it is available to
+  // the mxHxm_output w/o re-computation.
+  director->WellKnownQuantityAttachRequest
+    (Oxs_Director::WellKnownQuantity::total_mxHxm);
+
+  return Oxs_MinEvolver::Init();
+}
+
+void Oxs_BBEvolve::GetEnergyAndmxHxm
+(const Oxs_SimState* state,                 // Import
+ Oxs_MeshValue<OC_REAL8m>& export_energy,   // Export
+ Oxs_MeshValue<ThreeVector>& export_mxHxm,  // Export
+ Oxs_MeshValue<ThreeVector>* Hptr)          // Export
+{ // Fills export_energy and export_mxHxm, which must be different than
+  // scratch_energy and scratch_field.  If the well-known quantity
+  // total_mxHxm is attached then export_mxHxm is left read-only
+  // (shared with state), so callers should Release() it before reuse.
+  //   This routine also updates energy_calc_count, and fills "Max
+  // mxHxm", "Energy density error estimate", "Total energy", "Energy
+  // calc count" and "Rejected step count" derived data into state.
+  //   SIDE EFFECTS: scratch_energy & scratch_field are altered
+  if(&export_energy == &scratch_energy) {
+      throw Oxs_ExtError(this,
+        "Programming error in Oxs_BBEvolve::GetEnergyAndmxHxm():"
+        " export_energy is same as scratch_energy.");
+  }
+  if(&export_mxHxm == &scratch_field) {
+      throw Oxs_ExtError(this,
+        "Programming error in Oxs_BBEvolve::GetEnergyAndmxHxm():"
+        " export_mxHxm is same as scratch_field.");
+  }
+
+  ++energy_calc_count;    // Update call count
+
+  // For convenience
+  const Oxs_Mesh* mesh = state->mesh;
+
+  // Set up energy computation data structures
+  UpdateFixedSpinList(mesh);
+  Oxs_ComputeEnergiesImports ocei(*director,*state,
+                                  director->GetEnergyObjects(),
+                                  GetFixedSpinList(),
+                                  &scratch_energy,
+                                  &scratch_field);
+
+  Oxs_ComputeEnergiesExports ocee;
+  ocee.energy   = &export_energy;
+  ocee.H        = Hptr;
+  ocee.mxH      = nullptr;  // Fill export_mxHxm instead
+  ocee.mxHxm    = &export_mxHxm;
+  // Remaining ocee members are initialized to zero by default.
+
+  GetEnergies(ocei,ocee);
+
+  if(ocee.pE_pt != 0.0) {
+    String msg =
+      String("Oxs_BBEvolve::GetEnergyAndmxHxm:"
+             " At least one energy object is time varying; this"
+             " property is not supported by minimization evolvers.");
+    throw Oxs_Ext::Error(this,msg.c_str());
+  }
+
+  // Total energy
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  Oc_AlignedVector<Nb_Xpfloat> thread_energy(number_of_threads,0.0);
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (export_energy,
+     [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+      Nb_Xpfloat thd_energy = 0.0;
+      for(OC_INDEX i=istart;i<istop;++i) {
+        thd_energy.Accum(export_energy[i]*mesh->Volume(i));
+      }
+      thread_energy[thread_id] += thd_energy;
+    });
+  Nb_Xpfloat total_energy = thread_energy[0];
+  for(int i=1;i<number_of_threads;++i) {
+    total_energy += thread_energy[i];
+  }
+  if(!isfinite(total_energy.GetValue())) {
+    throw Oxs_ExtError(this,"Floating point overflow detected"
+                       " in energy density computation.");
+  }
+
+  // Fill supplemental derived data.
+  state->AddDerivedData(max_mxHxm_key,ocee.max_mxH);
+  state->AddDerivedData(energy_density_error_estimate_key,
+                        ocee.energy_density_error_estimate);
+  state->AddDerivedData(total_energy_key,total_energy.GetValue());
+  state->AddDerivedData(energy_calc_count_key,
+                        OC_REAL8m(energy_calc_count));
+  state->AddDerivedData(rejected_step_count_key,
+                        OC_REAL8m(rejected_step_count));
+}
+
+OC_REAL8m Oxs_BBEvolve::EnergySlack
+(OC_REAL8m E,    // Trial state energy
+ OC_REAL8m edee, // Trial state energy density error estimate
+ const Oxs_Mesh* mesh) const
+{ // Estimate of rounding error in E - basept.total_energy.  See
+  // Oxs_CGEvolve::GetRelativeEnergyAndDerivative() for the derivation.
+  OC_REAL8m slack
+    = (fabs(E) + fabs(basept.total_energy))*OC_REAL8m_EPSILON*8;
+  if(mesh->Size()>0) {
+    slack += (edee + basept.energy_density_error_estimate)
+      * mesh->TotalVolume()/sqrt(2.0*OC_REAL8m(mesh->Size()));
+  }
+  return slack*energy_error_adj;
+}
+
+void Oxs_BBEvolve::PushEnergyHistory(OC_REAL8m energy)
+{
+  if(basept.energy_history.size()<nonmonotone_window) {
+    basept.energy_history.push_back(energy);
+  } else {
+    basept.energy_history[basept.history_next] = energy;
+  }
+  basept.history_next = (basept.history_next+1) % nonmonotone_window;
+}
+
+OC_REAL8m Oxs_BBEvolve::ReferenceEnergy() const
+{ // Largest energy among the last nonmonotone_window accepted states.
+  assert(!basept.energy_history.empty());
+  return *std::max_element(basept.energy_history.begin(),
+                           basept.energy_history.end());
+}
+
+void Oxs_BBEvolve::SetBasePoint(Oxs_ConstKey<Oxs_SimState> cstate_key)
+{ // Computes mxHxm and energy at cstate, and resets step length
+  // and energy history.  Called at the start of each stage, or if
+  // the driver hands TryStep() a state other than the last one
+  // accepted (e.g., on restart).
+  const Oxs_SimState& cstate = cstate_key.GetReadReference();
+  const Oxs_Mesh* mesh = cstate.mesh;
+
+  basept.Init();
+  work_energy.Release();
+  GetEnergyAndmxHxm(&cstate,work_energy,basept.mxHxm);
+
+  if(!cstate.GetDerivedData(total_energy_key,basept.total_energy) ||
+     !cstate.GetDerivedData(energy_density_error_estimate_key,
+                            basept.energy_density_error_estimate) ||
+     !cstate.GetDerivedData(max_mxHxm_key,basept.max_mxHxm)) {
+    throw Oxs_ExtError(this,"Missing energy data in"
+                       " Oxs_BBEvolve::SetBasePoint()."
+                       " Programming error?");
+  }
+
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(cstate.Ms);
+  const Oxs_MeshValue<ThreeVector>& mxHxm = basept.mxHxm;
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  Oc_AlignedVector<Nb_Xpfloat> thread_gg(number_of_threads,0.0);
+  Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (mxHxm,
+     [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+      Nb_Xpfloat thd_gg = 0.0;
+      for(OC_INDEX i=istart;i<istop;++i) {
+        thd_gg.Accum(Ms[i]*mesh->Volume(i)*mxHxm[i].MagSq());
+      }
+      thread_gg[thread_id] += thd_gg;
+    });
+  Nb_Xpfloat gg = thread_gg[0];
+  for(int i=1;i<number_of_threads;++i) gg += thread_gg[i];
+  basept.grad_sumsq = gg.GetValue();
+
+  PushEnergyHistory(basept.total_energy);
+  basept.id = cstate.Id();
+  basept.stage = cstate.stage_number;
+  basept.valid = 1;
+}
+
+void Oxs_BBEvolve::InitializeWorkState
+(const Oxs_MinDriver* driver,
+ const Oxs_SimState* cstate,
+ Oxs_Key<Oxs_SimState>& work_state_key)
+{
+  // Get Oxs_SimState from director and place a write lock on it.
+  director->GetNewSimulationState(work_state_key);
+
+  // Do the first part of work_state structure initialization.
+  driver->FillStateMemberData(*cstate,
+                              work_state_key.GetWriteReference());
+  driver->FillStateSupplemental(*cstate,
+                              work_state_key.GetWriteReference());
+  // Note: Leaves work_state_key holding a write lock
+}
+
+OC_BOOL Oxs_BBEvolve::InitNewStage
+(const Oxs_MinDriver* /* driver */,
+ Oxs_ConstKey<Oxs_SimState> state,
+ Oxs_ConstKey<Oxs_SimState> /* prevstate */,
+ Oxs_DriverStageInfo& /* stage_info */)
+{
+  SetBasePoint(state);
+  return 1;
+}
+
+OC_BOOL Oxs_BBEvolve::TryStep(const Oxs_MinDriver* driver,
+                        Oxs_ConstKey<Oxs_SimState> current_state_key,
+                        Oxs_DriverStepInfo& /* step_info */,
+                        Oxs_ConstKey<Oxs_SimState>& next_state_key)
+{
+  const Oxs_SimState* cstate = &(current_state_key.GetReadReference());
+
+  if(++step_attempt_count == 1) {
+    // Update counts from current state, if available.  This keeps
+    // counts in-sync with data saved in checkpoint (restart) files.
+    OC_REAL8m temp_value;
+    if(cstate->GetDerivedData(energy_calc_count_key,temp_value)) {
+      energy_calc_count = static_cast<OC_UINT4m>(temp_value);
+    }
+    if(cstate->GetDerivedData(rejected_step_count_key,temp_value)) {
+      rejected_step_count = static_cast<OC_UINT4m>(temp_value);
+    }
+  }
+
+  if(!basept.valid
+     || basept.id != cstate->Id()
+     || basept.stage != cstate->stage_number) {
+    SetBasePoint(current_state_key);
+  }
+
+  if(basept.max_mxHxm <= 0.0) {
+    // Zero torque; no descent direction.
+    next_state_key = current_state_key;
+    next_state_key.GetReadReference();
+    return 0;
+  }
+
+  // Step length.  The max spin rotation on this step is
+  // atan(tau*basept.max_mxHxm).
+  OC_REAL8m tau = basept.tau;
+  if(tau <= 0.0) tau = start_step/basept.max_mxHxm;
+  if(tau*basept.max_mxHxm > max_step) tau = max_step/basept.max_mxHxm;
+
+  // Fill trial state: m + tau*mxHxm, normalized.
+  Oxs_Key<Oxs_SimState> work_state_key;
+  const Oxs_MeshValue<ThreeVector>& base_spin = cstate->spin;
+  const Oxs_MeshValue<ThreeVector>& base_mxHxm = basept.mxHxm;
+  try {
+    InitializeWorkState(driver,cstate,work_state_key);
+    Oxs_SimState& workstate
+      = work_state_key.GetWriteReference(); // Write lock
+    Oxs_MeshValue<ThreeVector>& spin = workstate.spin;
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (base_spin,
+       [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+        for(OC_INDEX i=istart;i<istop;++i) {
+          ThreeVector temp = base_spin[i];
+          temp.Accum(tau,base_mxHxm[i]);
+          temp.MakeUnit();
+          spin[i] = temp;
+        }
+      });
+    workstate.iteration_count = cstate->iteration_count + 1;
+    workstate.stage_iteration_count = cstate->stage_iteration_count + 1;
+    work_state_key.GetReadReference(); // Release write lock
+  } catch (...) {
+    if(work_state_key.GetPtr() != 0) {
+      work_state_key.GetReadReference(); // Release write lock
+    }
+    throw;
+  }
+  const Oxs_SimState* workstate = work_state_key.GetPtr();
+  const Oxs_Mesh* mesh = workstate->mesh;
+
+  work_energy.Release();
+  work_mxHxm.Release();
+  GetEnergyAndmxHxm(workstate,work_energy,work_mxHxm);
+
+  OC_REAL8m new_energy,new_edee,new_max_mxHxm;
+  if(!workstate->GetDerivedData(total_energy_key,new_energy) ||
+     !workstate->GetDerivedData(energy_density_error_estimate_key,new_edee) ||
+     !workstate->GetDerivedData(max_mxHxm_key,new_max_mxHxm)) {
+    throw Oxs_ExtError(this,"Missing energy data in"
+                       " Oxs_BBEvolve::TryStep(). Programming error?");
+  }
+
+  // Nonmonotone acceptance test.  First order energy change along the
+  // step is -mu0*tau*grad_sumsq.  Steps too small to matter are
+  // accepted regardless, to avoid stalling when the energy change is
+  // lost in rounding error.
+  const OC_REAL8m Ep = -MU0*basept.grad_sumsq; // dE/dtau at tau=0
+  if(tau*basept.max_mxHxm > min_step
+     && new_energy > ReferenceEnergy() + OXS_BBEVOLVE_ARMIJO_COEF*tau*Ep
+                     + EnergySlack(new_energy,new_edee,mesh)) {
+    // Reject step.  Next try uses the minimizer of the quadratic
+    // through E(0), E'(0) and E(tau), restricted to [0.1,0.5]*tau.
+    ++rejected_step_count;
+    OC_REAL8m new_tau = 0.5*tau;
+    const OC_REAL8m denom = (new_energy - basept.total_energy) - Ep*tau;
+    if(denom>0.0) {
+      OC_REAL8m test_tau = -0.5*Ep*tau*tau/denom;
+      if(isfinite(test_tau)) {
+        new_tau = std::min(0.5*tau,std::max(0.1*tau,test_tau));
+      }
+    }
+    basept.tau = new_tau;
+    next_state_key = work_state_key;
+    next_state_key.GetReadReference();
+    return 0;
+  }
+
+  // Step accepted.  Collect BB inner products for the next step:
+  //   s = m[k+1]-m[k],   y = mxHxm[k]-mxHxm[k+1]
+  // along with the gradient norm at the new point.
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(workstate->Ms);
+  const Oxs_MeshValue<ThreeVector>& new_spin = workstate->spin;
+  const Oxs_MeshValue<ThreeVector>& new_mxHxm = work_mxHxm;
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  Oc_AlignedVector<Nb_Xpfloat> thread_ss(number_of_threads,0.0);
+  Oc_AlignedVector<Nb_Xpfloat> thread_sy(number_of_threads,0.0);
+  Oc_AlignedVector<Nb_Xpfloat> thread_yy(number_of_threads,0.0);
+  Oc_AlignedVector<Nb_Xpfloat> thread_gg(number_of_threads,0.0);
+  Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (new_spin,
+     [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+      Nb_Xpfloat thd_ss = 0.0, thd_sy = 0.0, thd_yy = 0.0, thd_gg = 0.0;
+      for(OC_INDEX i=istart;i<istop;++i) {
+        const OC_REAL8m wgt = Ms[i]*mesh->Volume(i);
+        if(wgt == 0.0) continue;
+        const ThreeVector s = new_spin[i] - base_spin[i];
+        const ThreeVector y = base_mxHxm[i] - new_mxHxm[i];
+        thd_ss.Accum(wgt*s.MagSq());
+        thd_sy.Accum(wgt*(s*y));
+        thd_yy.Accum(wgt*y.MagSq());
+        thd_gg.Accum(wgt*new_mxHxm[i].MagSq());
+      }
+      thread_ss[thread_id] += thd_ss;
+      thread_sy[thread_id] += thd_sy;
+      thread_yy[thread_id] += thd_yy;
+      thread_gg[thread_id] += thd_gg;
+    });
+  Nb_Xpfloat ss = thread_ss[0], sy = thread_sy[0];
+  Nb_Xpfloat yy = thread_yy[0], gg = thread_gg[0];
+  for(int i=1;i<number_of_threads;++i) {
+    ss += thread_ss[i];  sy += thread_sy[i];
+    yy += thread_yy[i];  gg += thread_gg[i];
+  }
+
+  // y is in field units (A/m) and s is dimensionless, so both BB
+  // ratios have the units of tau.  If <s,y> is not positive then the
+  // local quadratic model is not convex; fall back to start_step.
+  OC_REAL8m next_tau = 0.0;
+  if(sy.GetValue() > 0.0) {
+    next_tau = (basept.use_bb1 ? ss.GetValue()/sy.GetValue()
+                : sy.GetValue()/yy.GetValue());
+    if(!isfinite(next_tau)) next_tau = 0.0;
+  }
+  basept.use_bb1 = !basept.use_bb1;
+
+  workstate->AddDerivedData(step_angle_key,
+                            atan(tau*basept.max_mxHxm)*180./PI);
+
+  // Update base point
+  basept.mxHxm.Swap(work_mxHxm);
+  basept.id = workstate->Id();
+  basept.total_energy = new_energy;
+  basept.energy_density_error_estimate = new_edee;
+  basept.max_mxHxm = new_max_mxHxm;
+  basept.grad_sumsq = gg.GetValue();
+  basept.tau = next_tau;
+  PushEnergyHistory(new_energy);
+
+  driver->FillStateDerivedData(*cstate,*workstate);
+
+  next_state_key = work_state_key;
+  next_state_key.GetReadReference();
+  return 1;
+}
+
+void Oxs_BBEvolve::UpdateDerivedFieldOutputs(const Oxs_SimState& state)
+{ // Fill Oxs_VectorOutput's that have CacheRequest enabled.
+  Oxs_MeshValue<ThreeVector>* Hptr = nullptr;
+  if(total_H_field_output.GetCacheRequestCount()>0
+     && total_H_field_output.GetCacheStateId() != state.Id()) {
+    total_H_field_output.ResetCache(&state);
+    Hptr = total_H_field_output.GetCacheBuffer(&state);
+  }
+  const OC_BOOL mxHxm_cache_current = mxHxm_output.IsCacheValid(&state);
+  const OC_BOOL energy_cache_current
+    = total_energy_density_output.IsCacheValid(&state);
+
+  if(Hptr ||
+     (mxHxm_output.GetCacheRequestCount()>0 && !mxHxm_cache_current) ||
+     (total_energy_density_output.GetCacheRequestCount()>0
+      && !energy_cache_current)) {
+    // Need to call GetEnergyAndmxHxm
+    Oxs_MeshValue<OC_REAL8m> energy_density_value(state.GetMeshNodesPtr());
+    Oxs_MeshValue<ThreeVector> mxHxm_value(state.GetMeshNodesPtr());
+    GetEnergyAndmxHxm(&state,energy_density_value,mxHxm_value,Hptr);
+    if(!mxHxm_cache_current) {
+      mxHxm_output.MoveToCache(&state,mxHxm_value);
+    }
+    if(!energy_cache_current) {
+      total_energy_density_output.MoveToCache(&state,energy_density_value);
+    }
+    if(Hptr) total_H_field_output.SetCacheStateId(state.Id());
+  }
+}
+
+void Oxs_BBEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
+{ // This routine fills all the Oxs_BBEvolve Oxs_ScalarOutput's to
+  // the appropriate value based on the import "state".
+
+  energy_calc_count_output.cache.state_id
+    = max_mxHxm_output.cache.state_id
+    = delta_E_output.cache.state_id
+    = total_energy_output.cache.state_id
+    = rejected_step_count_output.cache.state_id
+    = step_angle_output.cache.state_id
+    = 0;  // Mark change in progress
+
+  OC_REAL8m last_energy;
+  if(!state.GetDerivedData(energy_calc_count_key,
+                           energy_calc_count_output.cache.value) ||
+     !state.GetDerivedData(max_mxHxm_key,max_mxHxm_output.cache.value) ||
+     !state.GetDerivedData(last_energy_key,last_energy) ||
+     !state.GetDerivedData(total_energy_key,
+                           total_energy_output.cache.value) ||
+     !state.GetDerivedData(rejected_step_count_key,
+                           rejected_step_count_output.cache.value)) {
+    // Missing at least some data.  Compute, and attach energy density
+    // and mxHxm fields to state as in Oxs_CGEvolve.
+    Oxs_MeshValue<OC_REAL8m> energy_density_value(state.GetMeshNodesPtr());
+    Oxs_MeshValue<ThreeVector> mxHxm_value(state.GetMeshNodesPtr());
+    GetEnergyAndmxHxm(&state,energy_density_value,mxHxm_value);
+    total_energy_density_output.MoveToCache(&state,energy_density_value);
+    mxHxm_output.MoveToCache(&state,mxHxm_value);
+    if(!state.GetDerivedData(energy_calc_count_key,
+                             energy_calc_count_output.cache.value) ||
+       !state.GetDerivedData(max_mxHxm_key,max_mxHxm_output.cache.value) ||
+       !state.GetDerivedData(last_energy_key,last_energy) ||
+       !state.GetDerivedData(total_energy_key,
+                             total_energy_output.cache.value) ||
+       !state.GetDerivedData(rejected_step_count_key,
+                             rejected_step_count_output.cache.value)) {
+      throw Oxs_ExtError(this,"Missing output data."
+                         " Programming error?");
+    }
+  }
+  delta_E_output.cache.value
+    = total_energy_output.cache.value - last_energy;
+
+  // Step angle is set in TryStep for accepted steps.  Stage start
+  // states have no step, so record zero.
+  if(!state.GetDerivedData(step_angle_key,step_angle_output.cache.value)) {
+    state.AddDerivedData(step_angle_key,0.0);
+    step_angle_output.cache.value = 0.0;
+  }
+
+  energy_calc_count_output.cache.state_id
+    = max_mxHxm_output.cache.state_id
+    = delta_E_output.cache.state_id
+    = total_energy_output.cache.state_id
+    = rejected_step_count_output.cache.state_id
+    = step_angle_output.cache.state_id
+    = state.Id();
+}
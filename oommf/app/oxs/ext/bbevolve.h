@@ -0,0 +1,160 @@
+/* FILE: bbevolve.h                 -*-Mode: c++-*-
+ *
+ * Concrete minimization evolver class, using steepest descent with
+ * Barzilai-Borwein step lengths
+ *
+ */
+
+#ifndef _OXS_BBEVOLVE
+#define _OXS_BBEVOLVE
+
+#include <vector>
+
+#include "energy.h"
+#include "minevolver.h"
+#include "key.h"
+#include "output.h"
+
+/* End includes */
+
+class Oxs_BBEvolve:public Oxs_MinEvolver {
+private:
+  // Each iteration takes the step
+  //
+  //    m[k+1] = normalize(m[k] + tau[k]*mxHxm[k])
+  //
+  // where the step length tau[k] is chosen by the Barzilai-Borwein
+  // rules applied to the previous step s = m[k]-m[k-1] and change in
+  // gradient y = -(mxHxm[k]-mxHxm[k-1]):
+  //
+  //    BB1:  tau = <s,s>/<s,y>       BB2:  tau = <s,y>/<y,y>
+  //
+  // The two rules are used on alternate steps.  Inner products are
+  // weighted by Ms*Volume, so that mu0*<s,mxHxm> is the first order
+  // energy change along s.  Each iteration requires only one energy
+  // and field evaluation.  Because BB steps are not monotone in
+  // energy, a step is accepted if the new energy is less than the
+  // largest energy across the last nonmonotone_window accepted states
+  // (plus a sufficient decrease term and an allowance for rounding
+  // error).  Otherwise the step is rejected and tau is reduced.
+
+  // See Oxs_CGEvolve for a description of energy_error_adj.
+  OC_REAL8m energy_error_adj;
+
+  // Step size controls.  Internally these are stored as tangents of
+  // the maximum spin rotation angle; MIF input is in degrees.
+  OC_REAL8m start_step;  // Used for first step, and whenever the BB
+  /// step length is unavailable (e.g., <s,y> <= 0).
+  OC_REAL8m max_step;    // Upper bound on every step.
+  OC_REAL8m min_step;    // Rejected steps smaller than this are
+  /// accepted anyway, to prevent stalling when energy differences
+  /// are lost in rounding error.
+
+  OC_UINT4m nonmonotone_window; // Number of previous energies
+  /// checked in acceptance test.  Value of 1 yields a monotone
+  /// (Armijo) line search.
+
+  // Counts
+  OC_UINT4m step_attempt_count; // Set to 0 in Init()
+  OC_UINT4m energy_calc_count;
+  OC_UINT4m rejected_step_count;
+
+  // Base point data, i.e., the most recently accepted state.
+  struct Basept_Data {
+    OC_BOOL valid; // Set this to zero to mark data invalid
+    OC_UINT4m id;
+    OC_UINT4m stage;
+    OC_REAL8m total_energy;
+    OC_REAL8m energy_density_error_estimate;
+    OC_REAL8m max_mxHxm;
+    OC_REAL8m grad_sumsq;     // \sum_k Ms[k]*Volume(k)*mxHxm[k]^2
+    Oxs_MeshValue<ThreeVector> mxHxm;
+    OC_REAL8m tau;            // Step length to use from this point
+    OC_BOOL use_bb1;          // BB rule for next step length
+    std::vector<OC_REAL8m> energy_history; // Circular buffer
+    OC_UINT4m history_next;
+    void Init() {
+      valid=0; id=0; stage=0;
+      total_energy=energy_density_error_estimate=0.0;
+      max_mxHxm=grad_sumsq=0.0;
+      mxHxm.Release();
+      tau=0.0; use_bb1=1;
+      energy_history.clear();
+      history_next=0;
+    }
+    Basept_Data() { Init(); }
+  } basept;
+
+  void SetBasePoint(Oxs_ConstKey<Oxs_SimState> cstate_key);
+
+  void PushEnergyHistory(OC_REAL8m energy);
+  OC_REAL8m ReferenceEnergy() const;
+
+  void InitializeWorkState(const Oxs_MinDriver* driver,
+                           const Oxs_SimState* cstate,
+                           Oxs_Key<Oxs_SimState>& work_state_key);
+
+  void GetEnergyAndmxHxm
+  (const Oxs_SimState* state,                 // Import
+   Oxs_MeshValue<OC_REAL8m>& export_energy,   // Export
+   Oxs_MeshValue<ThreeVector>& export_mxHxm,  // Export
+   Oxs_MeshValue<ThreeVector>* export_H = nullptr); // Export
+
+  OC_REAL8m EnergySlack(OC_REAL8m E,OC_REAL8m edee,
+                        const Oxs_Mesh* mesh) const;
+
+  // Scratch space
+  Oxs_MeshValue<OC_REAL8m> scratch_energy;
+  Oxs_MeshValue<ThreeVector> scratch_field;
+  Oxs_MeshValue<OC_REAL8m> work_energy;
+  Oxs_MeshValue<ThreeVector> work_mxHxm;
+
+  // Field outputs
+  void UpdateDerivedFieldOutputs(const Oxs_SimState& state);
+  Oxs_VectorFieldOutput<Oxs_BBEvolve> total_H_field_output;
+  Oxs_SimStateVectorFieldOutput<Oxs_BBEvolve> mxHxm_output;
+  Oxs_SimStateScalarFieldOutput<Oxs_BBEvolve> total_energy_density_output;
+
+  // State derived data keys, set by constructor
+  Oxs_DerivedDataKey energy_calc_count_key;
+  Oxs_DerivedDataKey energy_density_error_estimate_key;
+  Oxs_DerivedDataKey last_energy_key;
+  Oxs_DerivedDataKey max_mxHxm_key;
+  Oxs_DerivedDataKey rejected_step_count_key;
+  Oxs_DerivedDataKey step_angle_key;
+  Oxs_DerivedDataKey total_energy_key;
+
+  // Scalar outputs
+  void UpdateDerivedOutputs(const Oxs_SimState&);
+  Oxs_ScalarOutput<Oxs_BBEvolve> max_mxHxm_output;
+  Oxs_ScalarOutput<Oxs_BBEvolve> total_energy_output;
+  Oxs_ScalarOutput<Oxs_BBEvolve> delta_E_output;
+  Oxs_ScalarOutput<Oxs_BBEvolve> energy_calc_count_output;
+  Oxs_ScalarOutput<Oxs_BBEvolve> rejected_step_count_output;
+  Oxs_ScalarOutput<Oxs_BBEvolve> step_angle_output;
+
+public:
+  virtual const char* ClassName() const; // ClassName() is
+  /// automatically generated by the OXS_EXT_REGISTER macro.
+  virtual OC_BOOL Init();
+  Oxs_BBEvolve(const char* name,      // Child instance id
+               Oxs_Director* newdtr,  // App director
+               const char* argstr);   // MIF input block parameters
+  virtual ~Oxs_BBEvolve() {}
+
+  virtual OC_BOOL
+  InitNewStage(const Oxs_MinDriver* driver,
+               Oxs_ConstKey<Oxs_SimState> state,
+               Oxs_ConstKey<Oxs_SimState> prevstate,
+               Oxs_DriverStageInfo& stage_info);
+
+  virtual  OC_BOOL
+  TryStep(const Oxs_MinDriver* driver,
+          Oxs_ConstKey<Oxs_SimState> current_state,
+          Oxs_DriverStepInfo& step_info,
+          Oxs_ConstKey<Oxs_SimState>& next_state);
+  // Returns true if step was successful, false if
+  // unable to step as requested.
+};
+
+#endif // _OXS_BBEVOLVE
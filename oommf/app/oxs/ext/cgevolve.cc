@@ -84,7 +84,8 @@ Oxs_CGEvolve::Oxs_CGEvolve(
     preconditioner_type(Oxs_EnergyPreconditionerSupport::NONE),
     preconditioner_weight(0.5),
     preconditioner_mesh_id(0),
-    sum_error_estimate(0)
+    sum_error_estimate(0),
+    lbfgs_memory(5), lbfgs_head(0), lbfgs_count(0)
 {
   // Check code assumptions, if any
 #if OC_USE_SSE
@@ -157,13 +158,28 @@ Oxs_CGEvolve::Oxs_CGEvolve(
     basept.method = Basept_Data::FLETCHER_REEVES;
   } else if(method_name.compare("Polak-Ribiere")==0) {
     basept.method = Basept_Data::POLAK_RIBIERE;
+  } else if(method_name.compare("L-BFGS")==0) {
+    basept.method = Basept_Data::LBFGS;
   } else {
     String msg=String("Invalid conjugate-gradient method request: ")
       + method_name
-      + String("\n Should be either Fletcher-Reeves or Polak-Ribiere.");
+      + String("\n Should be one of Fletcher-Reeves, Polak-Ribiere,"
+               " or L-BFGS.");
     throw Oxs_ExtError(this,msg.c_str());
   }
 
+  lbfgs_memory = GetUIntInitValue("lbfgs_memory",5);
+  if(lbfgs_memory<1) {
+    throw Oxs_ExtError(this,"Invalid lbfgs_memory value;"
+                       " must be 1 or larger.");
+  }
+  if(basept.method == Basept_Data::LBFGS) {
+    lbfgs_s.resize(lbfgs_memory+1);
+    lbfgs_y.resize(lbfgs_memory+1);
+    lbfgs_rho.resize(lbfgs_memory);
+    lbfgs_alpha.resize(lbfgs_memory);
+  }
+
   String preconditioner_type_name
     = GetStringInitValue("preconditioner","none");
   std::transform(preconditioner_type_name.begin(),
@@ -236,6 +252,20 @@ Oxs_CGEvolve::Oxs_CGEvolve(
   cycle_sub_count_output.Register(director,-5);
   energy_calc_count_output.Register(director,-5);
 
+  bracket_count_key = Oxs_DerivedDataKey("Bracket count");
+  conjugate_cycle_count_key = Oxs_DerivedDataKey("Conjugate cycle count");
+  cycle_count_key = Oxs_DerivedDataKey("Cycle count");
+  cycle_sub_count_key = Oxs_DerivedDataKey("Cycle sub count");
+  energy_best_state_id_key = Oxs_DerivedDataKey("Energy best state id");
+  energy_calc_count_key = Oxs_DerivedDataKey("Energy calc count");
+  energy_density_error_estimate_key
+    = Oxs_DerivedDataKey("Energy density error estimate");
+  last_energy_key = Oxs_DerivedDataKey("Last energy");
+  line_min_count_key = Oxs_DerivedDataKey("Line min count");
+  max_mxHxm_key = Oxs_DerivedDataKey("Max mxHxm");
+  relative_energy_key = Oxs_DerivedDataKey("Relative energy");
+  total_energy_key = Oxs_DerivedDataKey("Total energy");
+
   VerifyAllInitArgsUsed();
 
   // Each bracket holds a key to an Oxs_SimState.  There are three
@@ -369,6 +399,11 @@ OC_BOOL Oxs_CGEvolve::Init()
   basept.Init();
   bestpt.Init();
   bracket.Init();
+  for(OC_UINT4m i=0;i<lbfgs_s.size();++i) {
+    lbfgs_s[i].Release();
+    lbfgs_y[i].Release();
+  }
+  lbfgs_head = lbfgs_count = 0;
 
   preconditioner_mesh_id = 0; // Invalidate
   preconditioner_Ms2_V2.Release();
@@ -1727,8 +1762,8 @@ void Oxs_CGEvolve::GetEnergyAndmxHxm
   }
 
   // Fill supplemental derived data.
-  state->AddDerivedData("Max mxHxm",ocee.max_mxH);
-  state->AddDerivedData("Energy density error estimate",
+  state->AddDerivedData(max_mxHxm_key,ocee.max_mxH);
+  state->AddDerivedData(energy_density_error_estimate_key,
                         ocee.energy_density_error_estimate);
 
 #if REPORT_TIME_CGDEVEL
@@ -1741,7 +1776,7 @@ TS(timer[8].Start()); /**/ // 2 secs
   for(OC_INDEX i=0;i<vecsize;++i) {
     total_energy.Accum(export_energy[i] * mesh->Volume(i));
   }
-  state->AddDerivedData("Total energy",total_energy.GetValue());
+  state->AddDerivedData(total_energy_key,total_energy.GetValue());
 #else // OOMMF_THREADS
   {
     const int thread_count = Oc_GetMaxThreadCount();
@@ -1762,7 +1797,7 @@ TS(timer[8].Start()); /**/ // 2 secs
       throw Oxs_ExtError(this,"Floating point overflow detected"
                          " in energy density computation.");
     }
-    state->AddDerivedData("Total energy",etemp.GetValue());
+    state->AddDerivedData(total_energy_key,etemp.GetValue());
   }
 #endif // OOMMF_THREADS
 
@@ -1772,11 +1807,11 @@ timer_counts[8].Increment(timer[8],mesh->Size()*(1*sizeof(OC_REAL8m)));
 /// Volume(i) call can be done w/o main memory access
 #endif // REPORT_TIME_CGDEVEL
 
-  state->AddDerivedData("Bracket count",
+  state->AddDerivedData(bracket_count_key,
 			OC_REAL8m(bracket_count));
-  state->AddDerivedData("Line min count",
+  state->AddDerivedData(line_min_count_key,
 			OC_REAL8m(line_minimum_count));
-  state->AddDerivedData("Energy calc count",
+  state->AddDerivedData(energy_calc_count_key,
 			OC_REAL8m(energy_calc_count));
 #if REPORT_TIME_CGDEVEL
   TS(getenergyandmxHxmtime.Stop());
@@ -1812,7 +1847,7 @@ void Oxs_CGEvolve::GetRelativeEnergyAndDerivative(
   const Oxs_Mesh* mesh = state->mesh; // For convenience
 
   OC_REAL8m energy_density_error_estimate;
-  if(!state->GetDerivedData("Energy density error estimate",
+  if(!state->GetDerivedData(energy_density_error_estimate_key,
                             energy_density_error_estimate)) {
       throw Oxs_ExtError(this,
         "Missing \"Energy density error estimate\" data"
@@ -1821,7 +1856,7 @@ void Oxs_CGEvolve::GetRelativeEnergyAndDerivative(
   }
   OC_REAL8m bestpt_energy_density_error_estimate;
   if(!(bestpt.bracket->key.GetPtr()->GetDerivedData(
-                                      "Energy density error estimate",
+                                      energy_density_error_estimate_key,
                                       bestpt_energy_density_error_estimate))) {
     throw Oxs_ExtError(this,
         "Missing best point \"Energy density error estimate\" data"
@@ -1921,8 +1956,8 @@ void Oxs_CGEvolve::GetRelativeEnergyAndDerivative(
   endpt.offset = offset;
 
   endpt.E = relenergy;
-  state->AddDerivedData("Relative energy",relenergy);
-  state->AddDerivedData("Energy best state id",
+  state->AddDerivedData(relative_energy_key,relenergy);
+  state->AddDerivedData(energy_best_state_id_key,
                     static_cast<OC_REAL8m>(bestpt.bracket->key.ObjectId()));
   /// Note: Relative energy is relative to energy in best state.
 
@@ -3004,6 +3039,221 @@ void Oxs_CGEvolve::AdjustDirection
   work_Ep = thread_Ep[0];
 }
 
+OC_BOOL Oxs_CGEvolve::LBFGSDirection
+(const Oxs_SimState* cstate,
+ OC_REAL8m& maxmagsq,
+ OC_REAL8m& normsumsq,
+ OC_REAL8m& gradsumsq,
+ OC_REAL8m& Ep)
+{ // Computes basept.direction = H.(Ms*V*mxHxm) with the L-BFGS
+  // two-loop recursion (Nocedal & Wright, Numerical Optimization,
+  // Algorithm 7.4).  H is the inverse Hessian approximation built from
+  // the stored (s,y) pairs on top of gamma*P, where P is the
+  // preconditioner and gamma = (s.y)/(y.P.y) for the newest pair.
+  // With y stored in mxHxm units, the s.y and s.q inner products are
+  // weighted by Ms_V, and y.P.y is weighted by preconditioner_Ms2_V2.
+  // The pair s and y vectors are projected onto the tangent plane at
+  // the current spin as they are used, and the final direction is
+  // likewise projected.
+  //   Each sweep fuses the vector update from one step of the
+  // recursion with the inner product needed by the next, so n pairs
+  // take 2n+1 sweeps.  Export values match those of AdjustDirection,
+  // with Ep not yet scaled by -MU0.
+  //   Intended solely for internal use by Oxs_CGEvolve::SetBasePoint.
+  const Oxs_MeshValue<ThreeVector>& spin = cstate->spin;
+  const Oxs_MeshValue<ThreeVector>& bestpt_mxHxm = bestpt.bracket->mxHxm;
+  Oxs_MeshValue<ThreeVector>& dir = basept.direction; // q, then r
+  const OC_UINT4m slots = lbfgs_memory+1;
+  if(lbfgs_s[lbfgs_head].Size() != spin.Size()
+     || lbfgs_y[lbfgs_head].Size() != spin.Size()) {
+    lbfgs_count = 0; // No saved base point data
+    return 0;
+  }
+
+  // Per-thread workspace
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  Oc_AlignedVector<Nb_Xpfloat> thread_a(number_of_threads,0.0);
+  Oc_AlignedVector<Nb_Xpfloat> thread_b(number_of_threads,0.0);
+  Oc_AlignedVector<Nb_Xpfloat> thread_c(number_of_threads,0.0);
+  auto collect = [&](Oc_AlignedVector<Nb_Xpfloat>& arr) -> OC_REAL8m {
+    Nb_Xpfloat sum = arr[0];
+    for(int i=1;i<number_of_threads;++i) sum += arr[i];
+    for(int i=0;i<number_of_threads;++i) arr[i] = 0.0; // Reset for reuse
+    return sum.GetValue();
+  };
+
+  // First sweep: form newest pair from the saved base point data in
+  // slot lbfgs_head, and initialize q = mxHxm.
+  {
+    Oxs_MeshValue<ThreeVector>& snew = lbfgs_s[lbfgs_head];
+    Oxs_MeshValue<ThreeVector>& ynew = lbfgs_y[lbfgs_head];
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (spin,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        Nb_Xpfloat thd_sy = 0.0, thd_sq = 0.0, thd_yPy = 0.0;
+        for(OC_INDEX i=istart;i<istop;++i) {
+          const ThreeVector& m = spin[i];
+          const ThreeVector& g = bestpt_mxHxm[i];
+          ThreeVector s = m - snew[i];
+          ThreeVector y = ynew[i] - g;
+          s.Accum(-1*(s*m),m);
+          y.Accum(-1*(y*m),m);
+          snew[i] = s;
+          ynew[i] = y;
+          dir[i] = g;
+          thd_sy.Accum(Ms_V[i]*(s*y));
+          thd_sq.Accum(Ms_V[i]*(s*g));
+          const ThreeVector& pc2 = preconditioner_Ms2_V2[i];
+          thd_yPy.Accum(pc2.x*y.x*y.x + pc2.y*y.y*y.y + pc2.z*y.z*y.z);
+        }
+        thread_a[thread_id] += thd_sy;
+        thread_b[thread_id] += thd_sq;
+        thread_c[thread_id] += thd_yPy;
+      });
+  }
+  const OC_REAL8m sy_new = collect(thread_a);
+  const OC_REAL8m sq_new = collect(thread_b);
+  const OC_REAL8m yPy_new = collect(thread_c);
+  const OC_REAL8m gamma = sy_new/yPy_new;
+  if(!(sy_new>0.0) || !(yPy_new>0.0)
+     || !isfinite(1.0/sy_new) || !isfinite(gamma)) {
+    // Curvature condition fails; restart from gradient.
+    lbfgs_count = 0;
+    return 0;
+  }
+  lbfgs_head = (lbfgs_head+1)%slots;
+  if(lbfgs_count<lbfgs_memory) ++lbfgs_count;
+  const OC_UINT4m n = lbfgs_count;
+  auto slot = [&](OC_UINT4m j) { // Ring index of j-th newest pair
+    return (lbfgs_head + slots - 1 - j) % slots;
+  };
+  lbfgs_rho[0] = 1.0/sy_new;
+  lbfgs_alpha[0] = lbfgs_rho[0]*sq_new;
+
+  // First loop, newest to oldest: q -= alpha[j-1]*y[j-1], then
+  // alpha[j] = rho[j]*(s[j].q).  Pairs that fail the curvature
+  // condition after transport get rho = 0, i.e., are skipped.
+  for(OC_UINT4m j=1;j<n;++j) {
+    const Oxs_MeshValue<ThreeVector>& yprev = lbfgs_y[slot(j-1)];
+    const OC_REAL8m aprev = lbfgs_alpha[j-1];
+    Oxs_MeshValue<ThreeVector>& sj = lbfgs_s[slot(j)];
+    Oxs_MeshValue<ThreeVector>& yj = lbfgs_y[slot(j)];
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (spin,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        Nb_Xpfloat thd_sy = 0.0, thd_sq = 0.0;
+        for(OC_INDEX i=istart;i<istop;++i) {
+          const ThreeVector& m = spin[i];
+          ThreeVector q = dir[i];
+          q.Accum(-aprev,yprev[i]);
+          dir[i] = q;
+          ThreeVector s = sj[i];
+          ThreeVector y = yj[i];
+          s.Accum(-1*(s*m),m);
+          y.Accum(-1*(y*m),m);
+          sj[i] = s;
+          yj[i] = y;
+          thd_sy.Accum(Ms_V[i]*(s*y));
+          thd_sq.Accum(Ms_V[i]*(s*q));
+        }
+        thread_a[thread_id] += thd_sy;
+        thread_b[thread_id] += thd_sq;
+      });
+    const OC_REAL8m sy = collect(thread_a);
+    const OC_REAL8m sq = collect(thread_b);
+    OC_REAL8m rho = 0.0;
+    if(sy>0.0 && isfinite(1.0/sy)) rho = 1.0/sy;
+    lbfgs_rho[j] = rho;
+    lbfgs_alpha[j] = rho*sq;
+  }
+
+  // Transition sweep: finish first loop, apply initial matrix
+  //   r = gamma*P*(Ms_V*q) = gamma*preconditioner_Ms_V*q,
+  // and start second loop with beta = rho[n-1]*(y[n-1].r).
+  OC_REAL8m beta = 0.0;
+  {
+    const Oxs_MeshValue<ThreeVector>& yl = lbfgs_y[slot(n-1)];
+    const OC_REAL8m al = lbfgs_alpha[n-1];
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (spin,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        Nb_Xpfloat thd_yr = 0.0;
+        for(OC_INDEX i=istart;i<istop;++i) {
+          ThreeVector r = dir[i];
+          r.Accum(-al,yl[i]);
+          const ThreeVector& pc = preconditioner_Ms_V[i];
+          r.x *= gamma*pc.x;  r.y *= gamma*pc.y;  r.z *= gamma*pc.z;
+          dir[i] = r;
+          thd_yr.Accum(Ms_V[i]*(yl[i]*r));
+        }
+        thread_a[thread_id] += thd_yr;
+      });
+    beta = lbfgs_rho[n-1]*collect(thread_a);
+  }
+
+  // Second loop, oldest to newest: r += (alpha[j]-beta[j])*s[j], then
+  // beta[j-1] = rho[j-1]*(y[j-1].r).
+  for(OC_UINT4m j=n-1;j>0;--j) {
+    const Oxs_MeshValue<ThreeVector>& sj = lbfgs_s[slot(j)];
+    const Oxs_MeshValue<ThreeVector>& ynext = lbfgs_y[slot(j-1)];
+    const OC_REAL8m coef = lbfgs_alpha[j] - beta;
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (spin,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        Nb_Xpfloat thd_yr = 0.0;
+        for(OC_INDEX i=istart;i<istop;++i) {
+          ThreeVector r = dir[i];
+          r.Accum(coef,sj[i]);
+          dir[i] = r;
+          thd_yr.Accum(Ms_V[i]*(ynext[i]*r));
+        }
+        thread_a[thread_id] += thd_yr;
+      });
+    beta = lbfgs_rho[j-1]*collect(thread_a);
+  }
+
+  // Final sweep: last update, projection onto tangent plane, and
+  // export values.
+  std::vector<OC_REAL8m> thread_maxmagsq(number_of_threads,0.0);
+  {
+    const Oxs_MeshValue<ThreeVector>& s0 = lbfgs_s[slot(0)];
+    const OC_REAL8m coef = lbfgs_alpha[0] - beta;
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (spin,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        OC_REAL8m thd_maxmagsq = thread_maxmagsq[thread_id];
+        Nb_Xpfloat thd_normsumsq = 0.0;
+        Nb_Xpfloat thd_gradsumsq = 0.0;
+        Nb_Xpfloat thd_Ep = 0.0;
+        for(OC_INDEX i=istart;i<istop;++i) {
+          const ThreeVector& m = spin[i];
+          const ThreeVector& g = bestpt_mxHxm[i];
+          ThreeVector r = dir[i];
+          r.Accum(coef,s0[i]);
+          r.Accum(-1*(r*m),m); // NOTE: Assumes |spin[i]| == 1.
+          dir[i] = r;
+          OC_REAL8m magsq = r.MagSq();
+          if(magsq>thd_maxmagsq) thd_maxmagsq = magsq;
+          thd_normsumsq.Accum(magsq);
+          thd_Ep.Accum(Ms_V[i]*(r*g));
+          thd_gradsumsq.Accum(g.MagSq()*Ms_V[i]*Ms_V[i]);
+        }
+        thread_maxmagsq[thread_id] = thd_maxmagsq;
+        thread_a[thread_id] += thd_normsumsq;
+        thread_b[thread_id] += thd_gradsumsq;
+        thread_c[thread_id] += thd_Ep;
+      });
+  }
+  maxmagsq = thread_maxmagsq[0];
+  for(int i=1;i<number_of_threads;++i) {
+    if(thread_maxmagsq[i]>maxmagsq) maxmagsq = thread_maxmagsq[i];
+  }
+  normsumsq = collect(thread_a);
+  gradsumsq = collect(thread_b);
+  Ep = collect(thread_c);
+  return 1;
+}
+
 void Oxs_CGEvolve::SetBasePoint
 (Oxs_ConstKey<Oxs_SimState> cstate_key)
 {
@@ -3030,7 +3280,7 @@ void Oxs_CGEvolve::SetBasePoint
 
   ++cycle_count;
   ++cycle_sub_count;
-  cstate->AddDerivedData("Cycle count",
+  cstate->AddDerivedData(cycle_count_key,
                          OC_REAL8m(cycle_count));
   // cycle_sub_count will change if conjugate direction is reset to
   // gradient below.  So wait to set "Cycle sub count" derived data.
@@ -3070,7 +3320,7 @@ void Oxs_CGEvolve::SetBasePoint
     /// Should next_step_guess be set to 0 in this case???
   }
   OC_REAL8m edee;
-  if(!(cstate->GetDerivedData("Energy density error estimate",edee))) {
+  if(!(cstate->GetDerivedData(energy_density_error_estimate_key,edee))) {
     throw Oxs_ExtError(this,
               "Missing \"Energy density error estimate\" data"
               " in Oxs_CGEvolve::SetBasePoint()."
@@ -3094,6 +3344,25 @@ void Oxs_CGEvolve::SetBasePoint
     if(basept.method == Basept_Data::POLAK_RIBIERE) {
       basept.mxHxm = bestpt_mxHxm;  // Element-wise copy
     }
+  } else if(basept.method == Basept_Data::LBFGS) {
+    // Limited-memory BFGS direction.  Fall back to the gradient if no
+    // (s,y) pairs are usable, or if the direction is not sufficiently
+    // downhill.  (This is the same angle test used below to trigger
+    // KludgeDirection for conjugate gradient directions; for L-BFGS
+    // a gradient restart is the usual remedy.)
+    OC_REAL8m maxmagsq, normsumsq, gradsumsq;
+    basept.valid = 0;
+    if(LBFGSDirection(cstate,maxmagsq,normsumsq,gradsumsq,Ep)) {
+      bracket.left.grad_norm = sqrt(gradsumsq);
+      if(Ep > kludge_adjust_angle_cos * sqrt(normsumsq)
+         * bracket.left.grad_norm * (1+8*OC_REAL8m_EPSILON)) {
+        basept.direction_max_mag = sqrt(maxmagsq);
+        basept.direction_norm = sqrt(normsumsq);
+        Ep *= -MU0; // See mjd's NOTES II, 29-May-2002, p156.
+        basept.Ep = bracket.left.Ep = Ep;
+        basept.valid = 1;
+      }
+    }
   } else {
     // Use conjugate gradient as new direction, where
     //              n = cycle count
@@ -3335,6 +3604,7 @@ void Oxs_CGEvolve::SetBasePoint
 #endif // REPORT_TIME_CGDEVEL
     // Use gradient as new direction
     basept.direction.AdjustSize(mesh);
+    lbfgs_count=0;
     cycle_sub_count=0;
     ++conjugate_cycle_count;
     gradient_reset_score=0.0;
@@ -3422,15 +3692,21 @@ void Oxs_CGEvolve::SetBasePoint
 #endif // REPORT_TIME_CGDEVEL
   }
 
-  cstate->AddDerivedData("Cycle sub count",
+  cstate->AddDerivedData(cycle_sub_count_key,
                          OC_REAL8m(cycle_sub_count));
-  cstate->AddDerivedData("Conjugate cycle count",
+  cstate->AddDerivedData(conjugate_cycle_count_key,
                          OC_REAL8m(conjugate_cycle_count));
 
+  if(basept.method == Basept_Data::LBFGS) {
+    // Save base point for the next (s,y) pair.  See LBFGSDirection().
+    lbfgs_s[lbfgs_head] = cstate->spin;  // Element-wise copy
+    lbfgs_y[lbfgs_head] = bestpt_mxHxm;
+  }
+
   // Fill remaining basept fields
   basept.id = cstate->Id();
   basept.stage = cstate->stage_number;
-  if(!cstate->GetDerivedData("Total energy",basept.total_energy)) {
+  if(!cstate->GetDerivedData(total_energy_key,basept.total_energy)) {
       throw Oxs_ExtError(this,
         "Missing \"Total energy\" data in Oxs_CGEvolve::SetBasePoint()."
 	" Programming error?");
@@ -3645,22 +3921,22 @@ OC_BOOL Oxs_CGEvolve::TryStep(const Oxs_MinDriver* driver,
     // hackish.  It seems like it would be better to get these
     // values set up inside the Init() function.
     OC_REAL8m temp_value;
-    if(cstate->GetDerivedData("Energy calc count",temp_value)) {
+    if(cstate->GetDerivedData(energy_calc_count_key,temp_value)) {
       energy_calc_count = static_cast<OC_UINT4m>(temp_value);
     }
-    if(cstate->GetDerivedData("Cycle count",temp_value)) {
+    if(cstate->GetDerivedData(cycle_count_key,temp_value)) {
       cycle_count = static_cast<OC_UINT4m>(temp_value);
     }
-    if(cstate->GetDerivedData("Cycle sub count",temp_value)) {
+    if(cstate->GetDerivedData(cycle_sub_count_key,temp_value)) {
       cycle_sub_count = static_cast<OC_UINT4m>(temp_value);
     }
-    if(cstate->GetDerivedData("Bracket count",temp_value)) {
+    if(cstate->GetDerivedData(bracket_count_key,temp_value)) {
       bracket_count = static_cast<OC_UINT4m>(temp_value);
     }
-    if(cstate->GetDerivedData("Line min count",temp_value)) {
+    if(cstate->GetDerivedData(line_min_count_key,temp_value)) {
       line_minimum_count = static_cast<OC_UINT4m>(temp_value);
     }
-    if(cstate->GetDerivedData("Conjugate cycle count",temp_value)) {
+    if(cstate->GetDerivedData(conjugate_cycle_count_key,temp_value)) {
       conjugate_cycle_count = static_cast<OC_UINT4m>(temp_value);
     }
   }
@@ -3795,15 +4071,15 @@ void Oxs_CGEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
     = 0;  // Mark change in progress
 
   OC_REAL8m last_energy;
-  if(!state.GetDerivedData("Energy calc count",
+  if(!state.GetDerivedData(energy_calc_count_key,
 			   energy_calc_count_output.cache.value) ||
-     !state.GetDerivedData("Max mxHxm",max_mxHxm_output.cache.value) ||
-     !state.GetDerivedData("Last energy",last_energy) ||
-     !state.GetDerivedData("Total energy",
+     !state.GetDerivedData(max_mxHxm_key,max_mxHxm_output.cache.value) ||
+     !state.GetDerivedData(last_energy_key,last_energy) ||
+     !state.GetDerivedData(total_energy_key,
 			   total_energy_output.cache.value) ||
-     !state.GetDerivedData("Bracket count",
+     !state.GetDerivedData(bracket_count_key,
 			   bracket_count_output.cache.value) ||
-     !state.GetDerivedData("Line min count",
+     !state.GetDerivedData(line_min_count_key,
 			   line_min_count_output.cache.value)) {
     // Missing at least some data
 
@@ -3824,15 +4100,15 @@ void Oxs_CGEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
     // will be left unchanged (until it is deleted at block end).
     total_energy_density_output.MoveToCache(&state,energy_density_value);
     mxHxm_output.MoveToCache(&state,mxHxm_value);
-    if(!state.GetDerivedData("Energy calc count",
+    if(!state.GetDerivedData(energy_calc_count_key,
 			     energy_calc_count_output.cache.value) ||
-       !state.GetDerivedData("Max mxHxm",max_mxHxm_output.cache.value) ||
-       !state.GetDerivedData("Last energy",last_energy) ||
-       !state.GetDerivedData("Total energy",
+       !state.GetDerivedData(max_mxHxm_key,max_mxHxm_output.cache.value) ||
+       !state.GetDerivedData(last_energy_key,last_energy) ||
+       !state.GetDerivedData(total_energy_key,
 			     total_energy_output.cache.value) ||
-       !state.GetDerivedData("Bracket count",
+       !state.GetDerivedData(bracket_count_key,
 			     bracket_count_output.cache.value) ||
-       !state.GetDerivedData("Line min count",
+       !state.GetDerivedData(line_min_count_key,
 			     line_min_count_output.cache.value)) {
       throw Oxs_ExtError(this,"Missing output data."
 			   " Programming error?");
@@ -3845,21 +4121,21 @@ void Oxs_CGEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
   // filled in GetEnergyAndmxHxm, but rather in SetBasePoint.  We
   // assume here that if these are not already set in state, then
   // the current values in the shadow variables are correct.
-  if(!state.GetDerivedData("Cycle count",
+  if(!state.GetDerivedData(cycle_count_key,
 			   cycle_count_output.cache.value)) {
-    state.AddDerivedData("Cycle count",
+    state.AddDerivedData(cycle_count_key,
                          OC_REAL8m(cycle_count));
     cycle_count_output.cache.value = OC_REAL8m(cycle_count);
   }
-  if(!state.GetDerivedData("Cycle sub count",
+  if(!state.GetDerivedData(cycle_sub_count_key,
 			   cycle_sub_count_output.cache.value)) {
-    state.AddDerivedData("Cycle sub count",
+    state.AddDerivedData(cycle_sub_count_key,
                          OC_REAL8m(cycle_sub_count));
     cycle_sub_count_output.cache.value = OC_REAL8m(cycle_sub_count);
   }
-  if(!state.GetDerivedData("Conjugate cycle count",
+  if(!state.GetDerivedData(conjugate_cycle_count_key,
 			   conjugate_cycle_count_output.cache.value)) {
-    state.AddDerivedData("Conjugate cycle count",
+    state.AddDerivedData(conjugate_cycle_count_key,
                          OC_REAL8m(conjugate_cycle_count));
     conjugate_cycle_count_output.cache.value
       = OC_REAL8m(conjugate_cycle_count);
@@ -7,6 +7,8 @@
 #ifndef _OXS_CGEVOLVE
 #define _OXS_CGEVOLVE
 
+#include <vector>
+
 #include "energy.h"
 #include "minevolver.h"
 #include "key.h"
@@ -97,7 +99,7 @@ private:
     OC_REAL8m direction_max_mag; // sup-norm: max_k sqrt(direction[k]^2)
     OC_REAL8m direction_norm;    // L2-norm: sqrt(\sum_k direction[k]^2)
 
-    enum Conjugate_Method { FLETCHER_REEVES, POLAK_RIBIERE } method;
+    enum Conjugate_Method { FLETCHER_REEVES, POLAK_RIBIERE, LBFGS } method;
     /// "method" is fixed from user data.  Conjugate gradient
     /// direction is calculated via
     ///    direction[n] = mxHxm[n] + gamma*direction[n-1],
@@ -109,7 +111,9 @@ private:
     /// array is only needed for the Polak-Ribiere method.
     /// If using the Fletcher-Reeves method, only the mxHxm^2
     /// scalar value needs to be saved between cycles, reducing
-    /// memory requirements.
+    /// memory requirements.  The LBFGS method replaces the
+    /// conjugation step with a limited-memory BFGS direction; see
+    /// the lbfgs_* members below.
     Oxs_MeshValue<ThreeVector> mxHxm; // Use only if Polak-Ribiere
     OC_REAL8m g_sum_sq;  // (V[k].Ms[k].mxHxm[k])^2
     OC_REAL8m Ep;
@@ -239,6 +243,24 @@ private:
   // and volume don't change without a change in the mesh.  If this
   // assumption becomes untrue, then modifications will be necessary.
 
+  // L-BFGS support, used only if basept.method == LBFGS.  The
+  // lbfgs_s and lbfgs_y arrays form a ring buffer of lbfgs_memory+1
+  // slots.  Slot lbfgs_head holds the spin and mxHxm of the current
+  // base point; at the next SetBasePoint call these are converted
+  // in place to the pair
+  //    s = m[n] - m[n-1],   y = mxHxm[n-1] - mxHxm[n].
+  // The previous lbfgs_count pairs precede lbfgs_head in the ring.
+  // y is stored in mxHxm units; the gradient difference is Ms*V*y.
+  // Pairs are transported to the tangent plane at the current base
+  // point by projection each time they are used.
+  OC_UINT4m lbfgs_memory;  // Set from user data: "lbfgs_memory"
+  std::vector< Oxs_MeshValue<ThreeVector> > lbfgs_s;
+  std::vector< Oxs_MeshValue<ThreeVector> > lbfgs_y;
+  std::vector<OC_REAL8m> lbfgs_rho;   // Workspace, size lbfgs_memory
+  std::vector<OC_REAL8m> lbfgs_alpha; // Workspace, size lbfgs_memory
+  OC_UINT4m lbfgs_head;
+  OC_UINT4m lbfgs_count;
+
   // Scratch space
   Oxs_MeshValue<OC_REAL8m> scratch_energy;
   Oxs_MeshValue<ThreeVector> scratch_field;
@@ -249,6 +271,20 @@ private:
   Oxs_SimStateVectorFieldOutput<Oxs_CGEvolve> mxHxm_output;
   Oxs_SimStateScalarFieldOutput<Oxs_CGEvolve> total_energy_density_output;
 
+  // State derived data keys, set by constructor
+  Oxs_DerivedDataKey bracket_count_key;
+  Oxs_DerivedDataKey conjugate_cycle_count_key;
+  Oxs_DerivedDataKey cycle_count_key;
+  Oxs_DerivedDataKey cycle_sub_count_key;
+  Oxs_DerivedDataKey energy_best_state_id_key;
+  Oxs_DerivedDataKey energy_calc_count_key;
+  Oxs_DerivedDataKey energy_density_error_estimate_key;
+  Oxs_DerivedDataKey last_energy_key;
+  Oxs_DerivedDataKey line_min_count_key;
+  Oxs_DerivedDataKey max_mxHxm_key;
+  Oxs_DerivedDataKey relative_energy_key;
+  Oxs_DerivedDataKey total_energy_key;
+
   // Scalar outputs
   void UpdateDerivedOutputs(const Oxs_SimState&);
   Oxs_ScalarOutput<Oxs_CGEvolve> energy_calc_count_output;
@@ -326,6 +362,13 @@ private:
                        OC_REAL8m& maxmagsq,Nb_Xpfloat& work_normsumsq,
                        Nb_Xpfloat& work_gradsumsq,Nb_Xpfloat& work_Ep);
 
+  OC_BOOL LBFGSDirection(const Oxs_SimState* cstate,
+                         OC_REAL8m& maxmagsq,OC_REAL8m& normsumsq,
+                         OC_REAL8m& gradsumsq,OC_REAL8m& Ep);
+  // Fills basept.direction using the L-BFGS two-loop recursion.
+  // Returns false if no direction is available, in which case the
+  // pair history has been cleared.
+
   void SetBasePoint(Oxs_ConstKey<Oxs_SimState> cstate_key);
 
   void RuffleBasePoint(const Oxs_MinDriver* driver,
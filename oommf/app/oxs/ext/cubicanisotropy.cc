@@ -235,7 +235,82 @@ void Oxs_CubicAnisotropy::ComputeEnergyChunk
   ThreeVector unifaxis1 = uniform_axis1_value;
   ThreeVector unifaxis2 = uniform_axis2_value;
 
+  Oxs_ThreeVectorPack pu1(Oc_Pack(unifaxis1.x),Oc_Pack(unifaxis1.y),
+                          Oc_Pack(unifaxis1.z));
+  Oxs_ThreeVectorPack pu2(Oc_Pack(unifaxis2.x),Oc_Pack(unifaxis2.y),
+                          Oc_Pack(unifaxis2.z));
+
   for(OC_INDEX i=node_start;i<node_stop;++i) {
+    // Blocks of OC_PACK_WIDTH cells with nonzero anisotropy are
+    // computed with Oc_Pack.  This follows the #else branch of the
+    // single cell code below, with the same operation order.
+    if(i+OC_PACK_WIDTH<=node_stop) {
+      OC_REAL8m kbuf[OC_PACK_WIDTH], fmbuf[OC_PACK_WIDTH];
+      OC_INDEX n=0;
+      for(;n<OC_PACK_WIDTH;++n) {
+        if(aniscoeftype == K1_TYPE) {
+          if(!K1_is_uniform) k = K1[i+n];
+          field_mult = (-2.0/MU0)*k*Ms_inverse[i+n];
+        } else {
+          if(!Ha_is_uniform) field_mult = -1*Ha[i+n];
+          k = -0.5*MU0*field_mult*Ms[i+n];
+        }
+        if(k==0.0 || field_mult==0.0) break;
+        kbuf[n] = k;  fmbuf[n] = field_mult;
+      }
+      if(n==OC_PACK_WIDTH) {
+        if(!axis1_is_uniform) pu1 = Oxs_ThreeVectorPack(&axis1[i]);
+        if(!axis2_is_uniform) pu2 = Oxs_ThreeVectorPack(&axis2[i]);
+        const Oxs_ThreeVectorPack m(&spin[i]);
+        const Oc_Pack a2 = m.x*pu2.x + (m.y*pu2.y + m.z*pu2.z);
+        const Oc_Pack a1 = m.x*pu1.x + (m.y*pu1.y + m.z*pu1.z);
+        Oxs_ThreeVectorPack H = (a1*(1-2*a1*a1-a2*a2))*pu1;
+        H.Accum(a2*(1-a1*a1-2*a2*a2),pu2);
+        H.Accum(a1*a1+a2*a2,m);
+
+        Oc_Pack pk;  pk.LoadUnaligned(kbuf[0]);
+        Oc_Pack pfm; pfm.LoadUnaligned(fmbuf[0]);
+        const Oc_Pack ei
+          = pk * (a1*a1*a2*a2+(a1*a1+a2*a2)*(1.0-(a1*a1+a2*a2)));
+        H *= pfm;
+
+        if(ocedt.H) H.Store(&(*ocedt.H)[i]);
+        if(ocedt.H_accum) {
+          (Oxs_ThreeVectorPack(&(*ocedt.H_accum)[i])+H)
+            .Store(&(*ocedt.H_accum)[i]);
+        }
+
+        Oc_Pack tz = m.x*H.y;  // t = m x H
+        Oc_Pack ty = m.x*H.z;
+        Oc_Pack tx = m.y*H.z;
+        tz -= m.y*H.x;
+        ty  = m.z*H.x - ty;
+        tx -= m.z*H.y;
+        const Oxs_ThreeVectorPack torque(tx,ty,tz);
+
+        OC_REAL8m eibuf[OC_PACK_WIDTH];
+        ei.StoreUnaligned(eibuf[0]);
+        for(n=0;n<OC_PACK_WIDTH;++n) {
+          energy_sum += eibuf[n] * mesh->Volume(i+n);
+        }
+
+        if(ocedt.energy) ei.StoreUnaligned((*ocedt.energy)[i]);
+        if(ocedt.energy_accum) {
+          Oc_Pack etmp;
+          etmp.LoadUnaligned((*ocedt.energy_accum)[i]);
+          etmp += ei;
+          etmp.StoreUnaligned((*ocedt.energy_accum)[i]);
+        }
+        if(ocedt.mxH) torque.Store(&(*ocedt.mxH)[i]);
+        if(ocedt.mxH_accum) {
+          (Oxs_ThreeVectorPack(&(*ocedt.mxH_accum)[i])+torque)
+            .Store(&(*ocedt.mxH_accum)[i]);
+        }
+        i += OC_PACK_WIDTH - 1;
+        continue;
+      }
+    }
+
     // This code requires u1 and u2 to be orthonormal, and m to be a
     // unit vector.  Basically, decompose
     //
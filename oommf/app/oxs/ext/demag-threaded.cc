@@ -50,123 +50,6 @@ OC_USE_STRING;
 // legibility and maintenance; it should always be "2".
 #define ODTV_COMPLEXSIZE 2
 
-class _Oxs_DemagJobControl {
-public:
-
-  _Oxs_DemagJobControl() : imax(0),big_block_limit(0),big_blocksize(0),
-                            small_blocksize(0),next_job_start(0) {}
-
-  // Note: The initializer is not thread-safe.  It should be called
-  // only from the control thread.
-  void Init(OC_INDEX i_imax,OC_INT4m threadcount,OC_INDEX minjobsize);
-
-  // ClaimJob is thread safe.  It is called from inside worker
-  // threads to get job assignments.  The return value istop
-  // is guaranteed to be less than imax.
-  void ClaimJob(OC_INDEX& istart,OC_INDEX& istop);
-
-private:
-  // Variable next_job_start marks the next available job.  Jobs are
-  // incremented by big_blocksize until big_block_limit is reached,
-  // after which jobs are handed out of size small_blocksize.
-  OC_INDEX imax;
-  OC_INDEX big_block_limit;
-  OC_INDEX big_blocksize;
-  OC_INDEX small_blocksize;
-  OC_INDEX next_job_start;
-  std::mutex job_mutex;
-};
-
-void _Oxs_DemagJobControl::Init
-(OC_INDEX i_imax,
- OC_INT4m threadcount,
- OC_INDEX minjobsize)
-{
-  imax = i_imax;
-  next_job_start = 0;
-  assert(imax>=1 && threadcount>=1 && minjobsize>=1);
-  if(threadcount<1) threadcount = 1; // Safety
-  if(minjobsize<1) minjobsize = 1;
-
-  // big_proportion + small_proportion should be <= 1.0
-#if 1
-  const OC_REAL8m small_proportion = 0.05;
-  const OC_REAL8m big_proportion   = 0.95;
-#else
-  // On some systems (8 threads, non-numa), slightly more
-  // and slightly larger small blocks works slightly better.
-  const OC_REAL8m small_proportion = 0.10;
-  const OC_REAL8m big_proportion   = 0.80;
-#endif
-
-  small_blocksize = OC_INDEX(floor(0.5+(small_proportion*imax)/threadcount));
-  // Round small_blocksize to an integral multiple of minjobsize
-  if(small_blocksize<=minjobsize) {
-    small_blocksize = minjobsize;
-  } else {
-    small_blocksize = minjobsize*((small_blocksize+minjobsize/2)/minjobsize);
-  }
-
-  // Select big_block_limit close to big_proportion of imax, but
-  // round so that remainder is an integral multiple of small_blocksize.
-  OC_INDEX remainder = imax - OC_INDEX(floor(0.5+big_proportion*imax));
-  if(0<remainder && remainder<=small_blocksize) {
-    remainder = small_blocksize;
-  } else {
-    remainder
-      = small_blocksize*(OC_INDEX(floor((0.5+remainder)/small_blocksize)));
-  }
-  big_block_limit = imax - remainder;
-
-  // Pick big_blocksize close to (but not smaller than)
-  // big_block_limit/threadcount, and make it a multiple of minjobsize.
-  // The size of the last (short) big block will be big_block_limit -
-  // big_blocksize*(threadcount-1) (see ::ClaimJob); if imax is a
-  // multiple of minjobsize, then big_block_limit will also be a
-  // multiple of minjobsize, and so in this case the last (short) big
-  // block will also be a multiple of minjobsize.
-  big_blocksize = minjobsize*
-    ((big_block_limit+minjobsize*threadcount-1)/(minjobsize*threadcount));
-
-#if 0
-  // On some systems (8 threads, non-numa), breaking up the
-  // big blocks seems to help.
-  if(big_blocksize>=4*minjobsize) {
-    big_blocksize = (big_blocksize+3)/4;
-  }
-#endif
-
-static int foocount=0; /**/ // asdf
-if(foocount<5) {
-  ++foocount;
-  fprintf(stderr,"Total limit=%ld, big limit=%ld,"
-          " big size=%ld, small size=%ld\n",
-          long(imax),long(big_block_limit),
-          long(big_blocksize),long(small_blocksize));
- } /**/ // asdf
-
-}
-
-void _Oxs_DemagJobControl::ClaimJob(OC_INDEX& istart,OC_INDEX& istop)
-{
-  OC_INDEX tmp_start,tmp_stop;
-  {
-    std::lock_guard<std::mutex> lck(job_mutex);
-    if((tmp_start = next_job_start)<big_block_limit) {
-      if(next_job_start + big_blocksize>big_block_limit) {
-        tmp_stop = next_job_start = big_block_limit;
-      } else {
-        tmp_stop = (next_job_start += big_blocksize);
-      }
-    } else {
-      tmp_stop = (next_job_start += small_blocksize);
-    }
-  }
-  if(tmp_stop>imax) tmp_stop=imax;  // Guarantee that istop is in-range.
-  istart = tmp_start;
-  istop  = tmp_stop;
-}
-
 ////////////////////////////////////////////////////////////////////////
 // Oxs_Demag::Oxs_FFTLocker provides thread-specific instance of FFT
 // objects.
@@ -176,6 +59,7 @@ Oxs_Demag::Oxs_FFTLocker::Oxs_FFTLocker
  int in_threadnumber)
   : fftx_scratch(0), fftx_scratch_base(0),
     fftx_scratch_size(0), fftx_scratch_base_size(0),
+    fftx_cbuf(0), fftx_cbuf_base(0), fftx_cbuf_base_size(0),
     ffty_Hwork(0), ffty_Hwork_base(0),
     ffty_Hwork_zstride(0), ffty_Hwork_xstride(0),
     ffty_Hwork_size(0), ffty_Hwork_base_size(0),
@@ -218,6 +102,23 @@ Oxs_Demag::Oxs_FFTLocker::Oxs_FFTLocker
   fftx_scratch
     = reinterpret_cast<OXS_FFT_REAL_TYPE*>(fftx_scratch_base + alignoff);
 
+  // Full precision row buffer for x-FFTs when Hxfrm is stored in
+  // reduced precision.
+  if(info.Hxfrm_float) {
+    fftx_cbuf_base_size
+      = info.cdimx*ODTV_COMPLEXSIZE*ODTV_VECSIZE*sizeof(OXS_FFT_REAL_TYPE)
+      + OC_CACHE_LINESIZE - 1;
+    fftx_cbuf_base = static_cast<char*>
+      (Oc_AllocThreadLocal(fftx_cbuf_base_size));
+    alignoff = reinterpret_cast<OC_UINDEX>(fftx_cbuf_base)
+      % OC_CACHE_LINESIZE;
+    if(alignoff>0) {
+      alignoff = OC_CACHE_LINESIZE - alignoff;
+    }
+    fftx_cbuf
+      = reinterpret_cast<OXS_FFT_REAL_TYPE*>(fftx_cbuf_base + alignoff);
+  }
+
   // Workspace for yz-FFTs + convolve
   OC_INDEX cache_real_gcd
     = Nb_Gcd(int(sizeof(OXS_FFT_REAL_TYPE)),OC_CACHE_LINESIZE);
@@ -346,6 +247,8 @@ Oxs_Demag::Oxs_FFTLocker::~Oxs_FFTLocker()
 {
   if(fftx_scratch_base) Oc_FreeThreadLocal(fftx_scratch_base,
                                            fftx_scratch_base_size);
+  if(fftx_cbuf_base)    Oc_FreeThreadLocal(fftx_cbuf_base,
+                                           fftx_cbuf_base_size);
   if(fftz_Hwork_base)   Oc_FreeThreadLocal(fftz_Hwork_base,
                                            fftz_Hwork_base_size);
   if(ffty_Hwork_base)   Oc_FreeThreadLocal(ffty_Hwork_base,
@@ -1458,7 +1361,7 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
   // Dimension and stride info for thread lockers
   locker_info.Set(rdimx,rdimy,rdimz,cdimx,cdimy,cdimz,
                   Hxfrm_jstride,Hxfrm_kstride,embed_block_size,
-                  MakeLockerName());
+                  fft_float,MakeLockerName());
 
 #if (VERBOSE_DEBUG && !defined(NDEBUG))
   fprintf(stderr,"RDIMS: (%ld,%ld,%ld)\n",
@@ -1491,6 +1394,17 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
   OC_INDEX asize = astridex*adimx;
   A.SetSize(asize);
 
+  // If a matching tensor is found in the cache then we are done.  The
+  // cache holds only the transformed tensor, so skip this if saveN is
+  // requested.
+  if(saveN.size()==0 && LoadTensorCache(mesh)) {
+#if REPORT_TIME
+    inittime.Stop();
+    dvltimer[0].Stop();
+#endif // REPORT_TIME
+    return;
+  }
+
   // According (16) in Newell's paper, the demag field is given by
   //                        H = -N*M
   // where N is the "demagnetizing tensor," with components Nxx, Nxy,
@@ -1907,7 +1821,8 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
     // been applied to A, so correct for that.
     //   Note: If the FFT's are power-of-two, then the scaling is a
     // power of two so this adjustment should not introduce any
-    // additional rounding error.
+    // additional rounding error.  Mixed radix dimensions may introduce
+    // rounding at the level of machine epsilon.
     vector<OC_REAL8m> data;
     data.reserve(6*rdimx*rdimy*rdimz);
     OXS_FFT_REAL_TYPE N_scaling = 1.0/fft_scaling;
@@ -1976,6 +1891,9 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
 #endif // REPORT_TIME
   }
 
+  // Save transformed tensor for reuse by later runs, if requested.
+  SaveTensorCache(mesh);
+
 #if REPORT_TIME
   inittime.Stop();
 #endif // REPORT_TIME
@@ -1985,6 +1903,75 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
 }
 
 
+// Transfer routines between the Hxfrm transform array and full
+// precision workspace.  Hxfrm is stored either as OXS_FFT_REAL_TYPE
+// (fft_precision double) or OC_REAL4 (fft_precision float); the thread
+// classes below are templated on the storage type and use these
+// overloads to convert at load and store.  All arithmetic is done in
+// OXS_FFT_REAL_TYPE.  The cbuf argument to the x-FFT routines is a
+// full precision buffer holding one x-row (Oxs_FFTLocker::fftx_cbuf),
+// used only by the OC_REAL4 variants.
+inline void _Oxs_DemagLoadPair(const OXS_FFT_REAL_TYPE& pair,Oc_Duet& val)
+{
+  val.LoadAligned(pair);
+}
+
+inline void _Oxs_DemagLoadPair(const OC_REAL4& pair,Oc_Duet& val)
+{
+  const OC_REAL4* ptr = &pair;
+  val.Set(ptr[0],ptr[1]);
+}
+
+inline void _Oxs_DemagStorePair(const Oc_Duet& val,OXS_FFT_REAL_TYPE& pair)
+{
+  val.StoreAligned(pair);
+}
+
+inline void _Oxs_DemagStorePair(const Oc_Duet& val,OC_REAL4& pair)
+{
+  OC_REAL4* ptr = &pair;
+  ptr[0] = static_cast<OC_REAL4>(val.GetA());
+  ptr[1] = static_cast<OC_REAL4>(val.GetB());
+}
+
+inline void _Oxs_DemagForwardFFTx
+(const Oxs_FFT1DThreeVector& fftx,OXS_FFT_REAL_TYPE* /* cbuf */,
+ OC_INDEX /* rowsize */,const OXS_FFT_REAL_TYPE* spin,
+ const OXS_FFT_REAL_TYPE* Ms,OXS_FFT_REAL_TYPE* carr_row)
+{
+  fftx.ForwardRealToComplexFFT(spin,carr_row,Ms);
+}
+
+inline void _Oxs_DemagForwardFFTx
+(const Oxs_FFT1DThreeVector& fftx,OXS_FFT_REAL_TYPE* cbuf,
+ OC_INDEX rowsize,const OXS_FFT_REAL_TYPE* spin,
+ const OXS_FFT_REAL_TYPE* Ms,OC_REAL4* carr_row)
+{
+  fftx.ForwardRealToComplexFFT(spin,cbuf,Ms);
+  for(OC_INDEX i=0;i<rowsize;++i) {
+    carr_row[i] = static_cast<OC_REAL4>(cbuf[i]);
+  }
+}
+
+inline void _Oxs_DemagInverseFFTx
+(const Oxs_FFT1DThreeVector& fftx,OXS_FFT_REAL_TYPE* /* cbuf */,
+ OC_INDEX /* rowsize */,OXS_FFT_REAL_TYPE* carr_row,
+ OXS_FFT_REAL_TYPE* scratch)
+{
+  fftx.InverseComplexToRealFFT(carr_row,scratch);
+}
+
+inline void _Oxs_DemagInverseFFTx
+(const Oxs_FFT1DThreeVector& fftx,OXS_FFT_REAL_TYPE* cbuf,
+ OC_INDEX rowsize,OC_REAL4* carr_row,OXS_FFT_REAL_TYPE* scratch)
+{
+  for(OC_INDEX i=0;i<rowsize;++i) {
+    cbuf[i] = carr_row[i];
+  }
+  fftx.InverseComplexToRealFFT(cbuf,scratch);
+}
+
+template<typename HREAL>
 class _Oxs_DemagFFTxThread : public Oxs_ThreadRunObj {
 public:
   // Note: The job basket is static, so only one "set" (tree) of this
@@ -1994,7 +1981,7 @@ public:
   const Oxs_MeshValue<ThreeVector>* spin;
   const Oxs_MeshValue<OC_REAL8m>* Ms;
 
-  OXS_FFT_REAL_TYPE* carr;
+  HREAL* carr;
 
   const Oxs_Demag::Oxs_FFTLocker_Info* locker_info;
 
@@ -2003,9 +1990,11 @@ public:
   void Cmd(int threadnumber, void* data);
 };
 
-Oxs_JobControl<OC_REAL8m> _Oxs_DemagFFTxThread::job_basket;
+template<typename HREAL>
+Oxs_JobControl<OC_REAL8m> _Oxs_DemagFFTxThread<HREAL>::job_basket;
 
-void _Oxs_DemagFFTxThread::Cmd(int threadnumber, void* /* data */)
+template<typename HREAL>
+void _Oxs_DemagFFTxThread<HREAL>::Cmd(int threadnumber, void* /* data */)
 {
   // Thread local storage
   Oxs_ThreadMapDataObject* foo = local_locker.GetItem(locker_info->name);
@@ -2032,6 +2021,8 @@ void _Oxs_DemagFFTxThread::Cmd(int threadnumber, void* /* data */)
   const OC_INDEX carr_kstride = locker_info->Hxfrm_kstride;
 
   const OC_INDEX j_dim = locker_info->rdimy;
+  const OC_INDEX rowsize
+    = ODTV_COMPLEXSIZE*ODTV_VECSIZE*locker_info->cdimx;
 
   // OXS_FFT_REAL_TYPE* const scratch = (locker->fftx_scratch);
   fftx.AdjustArrayCount(1); // If carr is padded along x axis then the
@@ -2083,23 +2074,25 @@ void _Oxs_DemagFFTxThread::Cmd(int threadnumber, void* /* data */)
       for(OC_INDEX j=jstart; j<j_line_stop; ++j) {
         const OC_INDEX jk_in = j*Ms_jstride + k*Ms_kstride;
         const OC_INDEX jk_out = j*carr_jstride + k*carr_kstride;
-        fftx.ForwardRealToComplexFFT
-          (reinterpret_cast<const OC_REAL8m*>(&((*spin)[jk_in].x)), // CHEAT
-           carr+jk_out,
-           reinterpret_cast<const OC_REAL8m*>(&((*Ms)[jk_in]))); // CHEAT
+        _Oxs_DemagForwardFFTx
+          (fftx,locker->fftx_cbuf,rowsize,
+           reinterpret_cast<const OC_REAL8m*>(&((*spin)[jk_in].x)), // CHEAT
+           reinterpret_cast<const OC_REAL8m*>(&((*Ms)[jk_in])), // CHEAT
+           carr+jk_out);
       }
       jstart=0;
     }
   }
 }
 
+template<typename HREAL>
 class _Oxs_DemagiFFTxDotThread : public Oxs_ThreadRunObj {
 public:
   // Note: The job basket is static, so only one "set" (tree) of this
   // class may be run at any one time.
   static Oxs_JobControl<OC_REAL8m> job_basket;
 
-  OXS_FFT_REAL_TYPE* carr;
+  HREAL* carr;
   const Oxs_MeshValue<ThreeVector> *spin_ptr;
   const Oxs_MeshValue<OC_REAL8m> *Ms_ptr;
   Oxs_ComputeEnergyData* oced_ptr;
@@ -2126,9 +2119,11 @@ public:
   void Cmd(int threadnumber, void* data);
 };
 
-Oxs_JobControl<OC_REAL8m> _Oxs_DemagiFFTxDotThread::job_basket;
+template<typename HREAL>
+Oxs_JobControl<OC_REAL8m> _Oxs_DemagiFFTxDotThread<HREAL>::job_basket;
 
-void _Oxs_DemagiFFTxDotThread::Cmd(int threadnumber, void* /* data */)
+template<typename HREAL>
+void _Oxs_DemagiFFTxDotThread<HREAL>::Cmd(int threadnumber, void* /* data */)
 {
   // Thread local storage
   Oxs_ThreadMapDataObject* foo = local_locker.GetItem(locker_info->name);
@@ -2155,6 +2150,8 @@ void _Oxs_DemagiFFTxDotThread::Cmd(int threadnumber, void* /* data */)
   const OC_INDEX carr_kstride = locker_info->Hxfrm_kstride;
   const OC_INDEX i_dim = locker_info->rdimx;
   const OC_INDEX j_dim = locker_info->rdimy;
+  const OC_INDEX rowsize
+    = ODTV_COMPLEXSIZE*ODTV_VECSIZE*locker_info->cdimx;
 
   const OXS_FFT_REAL_TYPE emult =  -0.5 * MU0;
 
@@ -2206,8 +2203,8 @@ void _Oxs_DemagiFFTxDotThread::Cmd(int threadnumber, void* /* data */)
         /// Note that fftx_scratch is allocated in the Oxs_FFTLocker
         /// constructor to size info.cdimx+1 >= info.rdimx+1 exactly to
         /// allow this.
-        fftx.InverseComplexToRealFFT(carr+j*carr_jstride
-                                     +k*carr_kstride,scratch);
+        _Oxs_DemagInverseFFTx(fftx,locker->fftx_cbuf,rowsize,
+                              carr+j*carr_jstride+k*carr_kstride,scratch);
 
         if(oced.H) {
           for(OC_INDEX i=0;i<i_dim;++i) {
@@ -2400,14 +2397,16 @@ void _Oxs_DemagiFFTxDotThread::Cmd(int threadnumber, void* /* data */)
   energy_sum[OC_INDEX(threadnumber)] = energy_sumA;
 }
 
+template<typename HREAL,typename ACOEF>
 class _Oxs_DemagFFTyzConvolveThread : public Oxs_ThreadRunObj {
 public:
   // Note: The job basket is static, so only one "set" (tree) of this
   // class may be run at any one time.
-  static Oxs_JobControl<Oxs_Demag::A_coefs> job_basket;
+  static Oxs_JobControl<ACOEF> job_basket;
 
-  const Oxs_StripedArray<Oxs_Demag::A_coefs>* A_ptr;
-  OXS_FFT_REAL_TYPE* carr;
+  const Oxs_StripedArray<ACOEF>* A_ptr;
+  OXS_FFT_REAL_TYPE A_trace; // Used if ACOEF doesn't store A22
+  HREAL* carr;
 
   const Oxs_Demag::Oxs_FFTLocker_Info* locker_info;
 
@@ -2416,16 +2415,20 @@ public:
   OC_INDEX thread_count;
 
   _Oxs_DemagFFTyzConvolveThread()
-    : A_ptr(0), carr(0), locker_info(0),
+    : A_ptr(0), A_trace(0), carr(0), locker_info(0),
       adimx(0),adimy(0),adimz(0),
       thread_count(0) {}
 
   void Cmd(int threadnumber, void* data);
 };
 
-Oxs_JobControl<Oxs_Demag::A_coefs> _Oxs_DemagFFTyzConvolveThread::job_basket;
+template<typename HREAL,typename ACOEF>
+Oxs_JobControl<ACOEF>
+_Oxs_DemagFFTyzConvolveThread<HREAL,ACOEF>::job_basket;
 
-void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
+template<typename HREAL,typename ACOEF>
+void _Oxs_DemagFFTyzConvolveThread<HREAL,ACOEF>::Cmd
+(int threadnumber, void* /* data */)
 {
   // Access thread local storage
   Oxs_Demag::Oxs_FFTLocker* locker = 0;
@@ -2488,7 +2491,7 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
   assert(reinterpret_cast<OC_UINDEX>(Hzwork)%16==0);
 #endif
 
-  const Oxs_Demag::A_coefs* A = A_ptr->GetArrBase();
+  const ACOEF* A = A_ptr->GetArrBase();
 
   // Adjust ffty to use Hywork and fftz to use Hzwork
   ffty->AdjustInputDimensions(rdimy,ODTV_VECSIZE*ODTV_COMPLEXSIZE,
@@ -2524,7 +2527,7 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
       for(k=0;k<rdimz;++k) {
         StartTimer(2);
         OXS_FFT_REAL_TYPE* const Hbase = Hywork + k*Hy_kstride;
-        OXS_FFT_REAL_TYPE* const cbase = carr
+        HREAL* const cbase = carr
           + ODTV_VECSIZE*ODTV_COMPLEXSIZE*i1 + k*ckstride;
         for(j=0;j<rdimy;++j) {
           OC_INDEX Hindex = j*ODTV_VECSIZE*ODTV_COMPLEXSIZE;
@@ -2534,9 +2537,9 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
             Oc_Prefetch<Ocpd_T0>(Hbase+Hindex+2*ODTV_VECSIZE*ODTV_COMPLEXSIZE);
             Oc_Prefetch<Ocpd_NTA>(cbase+cindex+4*cjstride);
             Oc_Duet tmp0,tmp1,tmp2;
-            tmp0.LoadAligned(cbase[cindex]);    // x
-            tmp1.LoadAligned(cbase[cindex+2]);  // y
-            tmp2.LoadAligned(cbase[cindex+4]);  // z
+            _Oxs_DemagLoadPair(cbase[cindex],tmp0);    // x
+            _Oxs_DemagLoadPair(cbase[cindex+2],tmp1);  // y
+            _Oxs_DemagLoadPair(cbase[cindex+4],tmp2);  // z
             tmp0.StoreAligned(Hbase[Hindex]);
             tmp1.StoreAligned(Hbase[Hindex+2]);
             tmp2.StoreAligned(Hbase[Hindex+4]);
@@ -2623,19 +2626,19 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
           // Do matrix-vector multiply ("convolution") for block
           const OC_INDEX astridek = adimy;
           const OC_INDEX astridei = astridek*adimz;
-          const Oxs_Demag::A_coefs* Abase = A + (i1+i)*astridei;
+          const ACOEF* Abase = A + (i1+i)*astridei;
           for(OC_INDEX ka=0;ka<adimz;++ka) {
-            const Oxs_Demag::A_coefs* Atmp = Abase + ka*astridek;
+            const ACOEF* Atmp = Abase + ka*astridek;
             OXS_FFT_REAL_TYPE* const Htmpa = Hzbase + ka*Hz_kstride;
             OXS_FFT_REAL_TYPE* const Htmpb
               = (0<ka && ka<adimz-1 ? Hzbase + (cdimz-ka)*Hz_kstride : 0);
 
             for(OC_INDEX ja=jstart;ja<jstop;++ja) {
               Oc_Prefetch<Ocpd_NTA>(Atmp+(astridek+ja));
-              const Oxs_Demag::A_coefs& Aref = Atmp[ja];
+              const ACOEF& Aref = Atmp[ja];
               Oc_Duet A_00(Aref.A00);   Oc_Duet A_01(Aref.A01);
               Oc_Duet A_02(Aref.A02);   Oc_Duet A_11(Aref.A11);
-              Oc_Duet A_12(Aref.A12);   Oc_Duet A_22(Aref.A22);
+              Oc_Duet A_12(Aref.A12);   Oc_Duet A_22(Aref.GetA22(A_trace));
 
               const OC_INDEX jaoff = ja - jstart;
               const OC_INDEX aindex = jaoff*ODTV_VECSIZE*ODTV_COMPLEXSIZE;
@@ -2803,7 +2806,7 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
       const OC_INDEX ileadstop = ispan - (ispan%4);
       for(k=0;k<rdimz;++k) {
         OXS_FFT_REAL_TYPE* const Hbase = Hywork + k*Hy_kstride;
-        OXS_FFT_REAL_TYPE* const cbase = carr
+        HREAL* const cbase = carr
           + ODTV_VECSIZE*ODTV_COMPLEXSIZE*i1 + k*ckstride;
         for(i=0;i<ileadstop;i+=4) {
           StartTimer(9);
@@ -2833,10 +2836,10 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
             tmpC.LoadAligned(Hbase[i*Hy_istride+6*j+4]);
             tmpD.LoadAligned(Hbase[(i+1)*Hy_istride+6*j]);
 
-            tmpA.StoreAligned(cbase[6*i+j*cjstride]);
-            tmpB.StoreAligned(cbase[6*i+j*cjstride+2]);
-            tmpC.StoreAligned(cbase[6*i+j*cjstride+4]);
-            tmpD.StoreAligned(cbase[6*(i+1)+j*cjstride]);
+            _Oxs_DemagStorePair(tmpA,cbase[6*i+j*cjstride]);
+            _Oxs_DemagStorePair(tmpB,cbase[6*i+j*cjstride+2]);
+            _Oxs_DemagStorePair(tmpC,cbase[6*i+j*cjstride+4]);
+            _Oxs_DemagStorePair(tmpD,cbase[6*(i+1)+j*cjstride]);
 #endif
           }
           StopTimer(10);
@@ -2861,10 +2864,10 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
             tmpC.LoadAligned(Hbase[(i+2)*Hy_istride+6*j]);
             tmpD.LoadAligned(Hbase[(i+2)*Hy_istride+6*j+2]);
 
-            tmpA.StoreAligned(cbase[6*(i+1)+j*cjstride+2]);
-            tmpB.StoreAligned(cbase[6*(i+1)+j*cjstride+4]);
-            tmpC.StoreAligned(cbase[6*(i+2)+j*cjstride]);
-            tmpD.StoreAligned(cbase[6*(i+2)+j*cjstride+2]);
+            _Oxs_DemagStorePair(tmpA,cbase[6*(i+1)+j*cjstride+2]);
+            _Oxs_DemagStorePair(tmpB,cbase[6*(i+1)+j*cjstride+4]);
+            _Oxs_DemagStorePair(tmpC,cbase[6*(i+2)+j*cjstride]);
+            _Oxs_DemagStorePair(tmpD,cbase[6*(i+2)+j*cjstride+2]);
 #endif
           }
           StopTimer(10);
@@ -2889,10 +2892,10 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
             tmpC.LoadAligned(Hbase[(i+3)*Hy_istride+6*j+2]);
             tmpD.LoadAligned(Hbase[(i+3)*Hy_istride+6*j+4]);
 
-            tmpA.StoreAligned(cbase[6*(i+2)+j*cjstride+4]);
-            tmpB.StoreAligned(cbase[6*(i+3)+j*cjstride]);
-            tmpC.StoreAligned(cbase[6*(i+3)+j*cjstride+2]);
-            tmpD.StoreAligned(cbase[6*(i+3)+j*cjstride+4]);
+            _Oxs_DemagStorePair(tmpA,cbase[6*(i+2)+j*cjstride+4]);
+            _Oxs_DemagStorePair(tmpB,cbase[6*(i+3)+j*cjstride]);
+            _Oxs_DemagStorePair(tmpC,cbase[6*(i+3)+j*cjstride+2]);
+            _Oxs_DemagStorePair(tmpD,cbase[6*(i+3)+j*cjstride+4]);
 #endif
           }
           StopTimer(10);
@@ -2918,9 +2921,9 @@ void _Oxs_DemagFFTyzConvolveThread::Cmd(int threadnumber, void* /* data */)
             tmpA.LoadAligned(Hbase[i*Hy_istride+6*j]);
             tmpB.LoadAligned(Hbase[i*Hy_istride+6*j+2]);
             tmpC.LoadAligned(Hbase[i*Hy_istride+6*j+4]);
-            tmpA.StoreAligned(cbase[6*i+j*cjstride]);
-            tmpB.StoreAligned(cbase[6*i+j*cjstride+2]);
-            tmpC.StoreAligned(cbase[6*i+j*cjstride+4]);
+            _Oxs_DemagStorePair(tmpA,cbase[6*i+j*cjstride]);
+            _Oxs_DemagStorePair(tmpB,cbase[6*i+j*cjstride+2]);
+            _Oxs_DemagStorePair(tmpC,cbase[6*i+j*cjstride+4]);
 #endif
           }
         } // j
@@ -2941,31 +2944,56 @@ void Oxs_Demag::ComputeEnergy
   if(mesh_id != state.mesh->Id()) {
     mesh_id = 0; // Safety
     FillCoefficientArrays(state.mesh);
+    CompactCoefficientArrays();
     mesh_id = state.mesh->Id();
+    const OC_REAL8m eps = (fft_float ? OC_REAL4_EPSILON : OC_REAL8m_EPSILON);
     energy_density_error_estimate
-      = 0.5*OC_REAL8m_EPSILON*MU0*state.max_absMs*state.max_absMs
+      = 0.5*eps*MU0*state.max_absMs*state.max_absMs
       *(log(double(cdimx))+log(double(cdimy))+log(double(cdimz)))/log(2.);
   }
   oced.energy_density_error_estimate = energy_density_error_estimate;
 
+  if(fft_float) {
+    if(A5_float.GetSize()>0) {
+      ComputeEnergyThreaded(state,oced,Hxfrm_base_float,A5_float);
+    } else {
+      ComputeEnergyThreaded(state,oced,Hxfrm_base_float,A_float);
+    }
+  } else {
+    if(A5.GetSize()>0) {
+      ComputeEnergyThreaded(state,oced,Hxfrm_base,A5);
+    } else {
+      ComputeEnergyThreaded(state,oced,Hxfrm_base,A);
+    }
+  }
+}
+
+template<typename HREAL,typename ACOEF>
+void Oxs_Demag::ComputeEnergyThreaded
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyData& oced,
+ Oxs_StripedArray<HREAL>& Hxfrm_arr,
+ const Oxs_StripedArray<ACOEF>& A_arr
+ ) const
+{
   const Oxs_MeshValue<ThreeVector>& spin = state.spin;
   const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
   assert(rdimx*rdimy*rdimz == Ms.Size());
 
   // Calculate forward x-axis FFTs
   {
-    Hxfrm_base.SetSize(Hxfrm_kstride*rdimz);
+    Hxfrm_arr.SetSize(Hxfrm_kstride*rdimz);
 
 #if REPORT_TIME
   fftxforwardtime.Start();
 #endif // REPORT_TIME
 
-    _Oxs_DemagFFTxThread fftx_thread;
-    _Oxs_DemagFFTxThread::job_basket.Init(MaxThreadCount,
+    _Oxs_DemagFFTxThread<HREAL> fftx_thread;
+    _Oxs_DemagFFTxThread<HREAL>::job_basket.Init(MaxThreadCount,
                                       Ms.GetArrayBlock(),Hxfrm_jstride);
     fftx_thread.spin = &spin;
     fftx_thread.Ms   = &Ms;
-    fftx_thread.carr = Hxfrm_base.GetArrBase();
+    fftx_thread.carr = Hxfrm_arr.GetArrBase();
     fftx_thread.locker_info = &locker_info;
 
     threadtree.LaunchTree(fftx_thread,0);
@@ -3003,11 +3031,12 @@ void Oxs_Demag::ComputeEnergy
     assert(adimx>=cdimx);
     assert(cdimy-adimy<adimy);
     assert(cdimz-adimz<adimz);
-    _Oxs_DemagFFTyzConvolveThread::job_basket.Init(MaxThreadCount,
-                                                   &A,adimy*adimz);
-    _Oxs_DemagFFTyzConvolveThread fftyzconv;
-    fftyzconv.A_ptr = &A;
-    fftyzconv.carr = Hxfrm_base.GetArrBase();
+    _Oxs_DemagFFTyzConvolveThread<HREAL,ACOEF>::job_basket.Init
+      (MaxThreadCount,&A_arr,adimy*adimz);
+    _Oxs_DemagFFTyzConvolveThread<HREAL,ACOEF> fftyzconv;
+    fftyzconv.A_ptr = &A_arr;
+    fftyzconv.A_trace = A_trace;
+    fftyzconv.carr = Hxfrm_arr.GetArrBase();
     fftyzconv.locker_info = &locker_info;
     fftyzconv.adimx=adimx; fftyzconv.adimy=adimy; fftyzconv.adimz=adimz;
     fftyzconv.thread_count = MaxThreadCount;
@@ -3022,10 +3051,10 @@ void Oxs_Demag::ComputeEnergy
   fftxinversetime.Start();
 #endif // REPORT_TIME
   {
-    _Oxs_DemagiFFTxDotThread ifftx_thread(MaxThreadCount);
-    _Oxs_DemagiFFTxDotThread::job_basket.Init(MaxThreadCount,
+    _Oxs_DemagiFFTxDotThread<HREAL> ifftx_thread(MaxThreadCount);
+    _Oxs_DemagiFFTxDotThread<HREAL>::job_basket.Init(MaxThreadCount,
                                               Ms.GetArrayBlock(),rdimx);
-    ifftx_thread.carr = Hxfrm_base.GetArrBase();
+    ifftx_thread.carr = Hxfrm_arr.GetArrBase();
     ifftx_thread.spin_ptr = &spin;
     ifftx_thread.Ms_ptr   = &Ms;
     ifftx_thread.oced_ptr = &oced;
@@ -27,7 +27,21 @@
 /// also common single/multi-threaded code at bottom of this file.
 
 #include <cassert>
+#include <cstddef>  // offsetof
+#include <cstdio>
+#include <cstring>
+#include <list>
 #include <string>
+#include <vector>
+#if OOMMF_THREADS
+# include <mutex>
+#endif
+
+#if (OC_SYSTEM_TYPE == OC_UNIX)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>  // mmap, used for reading tensor cache files
+#endif
 
 #include "nb.h"
 #include "vf.h"
@@ -60,6 +74,111 @@ OXS_EXT_REGISTER(Oxs_Demag);
 // legibility and maintenance; it should always be "2".
 #define ODTV_COMPLEXSIZE 2
 
+// Process-wide registry of transformed demag tensors, used by the
+// in-memory tensor cache (see LoadTensorCache and SaveTensorCache).
+// The registry outlives individual Oxs_Demag objects, so a problem
+// that is reloaded, or a second Oxs_Demag instance on the same mesh,
+// can copy the tensor instead of recomputing it.  Keys are the same
+// byte strings used to identify tensor cache files.  Entries are kept
+// in most-recently-used order, and the least recently used entries
+// are dropped whenever the total data size exceeds the budget.  A
+// budget of zero disables the registry and frees all entries.
+class _Oxs_DemagTensorRegistry {
+public:
+  static void SetBudget(OC_UINDEX bytes);
+  static OC_BOOL Load(const unsigned char* key,size_t keysize,
+                      unsigned char* data,OC_UINDEX data_size);
+  static void Store(const unsigned char* key,size_t keysize,
+                    const unsigned char* data,OC_UINDEX data_size);
+private:
+  struct Entry {
+    vector<unsigned char> key;
+    vector<unsigned char> data;
+  };
+  static std::list<Entry> entries; // Most recently used first
+  static OC_UINDEX budget;  // Bytes
+  static OC_UINDEX total;   // Sum of entry data sizes
+#if OOMMF_THREADS
+  static std::mutex mutex;
+#endif
+  static std::list<Entry>::iterator
+  Find(const unsigned char* key,size_t keysize);
+  static void Trim(); // Caller must hold mutex
+};
+
+std::list<_Oxs_DemagTensorRegistry::Entry>
+_Oxs_DemagTensorRegistry::entries;
+OC_UINDEX _Oxs_DemagTensorRegistry::budget = 0;
+OC_UINDEX _Oxs_DemagTensorRegistry::total = 0;
+#if OOMMF_THREADS
+std::mutex _Oxs_DemagTensorRegistry::mutex;
+# define OXS_DEMAG_REGISTRY_LOCK std::lock_guard<std::mutex> lck(mutex)
+#else
+# define OXS_DEMAG_REGISTRY_LOCK
+#endif
+
+std::list<_Oxs_DemagTensorRegistry::Entry>::iterator
+_Oxs_DemagTensorRegistry::Find(const unsigned char* key,size_t keysize)
+{
+  std::list<Entry>::iterator it = entries.begin();
+  while(it!=entries.end()) {
+    if(it->key.size()==keysize && memcmp(&(it->key[0]),key,keysize)==0) {
+      break;
+    }
+    ++it;
+  }
+  return it;
+}
+
+void _Oxs_DemagTensorRegistry::Trim()
+{
+  while(total>budget && !entries.empty()) {
+    total -= entries.back().data.size();
+    entries.pop_back();
+  }
+}
+
+void _Oxs_DemagTensorRegistry::SetBudget(OC_UINDEX bytes)
+{
+  OXS_DEMAG_REGISTRY_LOCK;
+  budget = bytes;
+  Trim();
+}
+
+OC_BOOL
+_Oxs_DemagTensorRegistry::Load(const unsigned char* key,size_t keysize,
+                               unsigned char* data,OC_UINDEX data_size)
+{
+  OXS_DEMAG_REGISTRY_LOCK;
+  std::list<Entry>::iterator it = Find(key,keysize);
+  if(it==entries.end() || it->data.size()!=data_size) return 0;
+  if(data_size>0) memcpy(data,&(it->data[0]),data_size);
+  entries.splice(entries.begin(),entries,it); // Mark as most recent
+  return 1;
+}
+
+void
+_Oxs_DemagTensorRegistry::Store(const unsigned char* key,size_t keysize,
+                                const unsigned char* data,
+                                OC_UINDEX data_size)
+{
+  OXS_DEMAG_REGISTRY_LOCK;
+  std::list<Entry>::iterator it = Find(key,keysize);
+  if(it!=entries.end()) {
+    total -= it->data.size();
+    entries.erase(it);
+  }
+  if(data_size==0 || data_size>budget) return; // Won't fit
+  entries.push_front(Entry());
+  Entry& entry = entries.front();
+  entry.key.assign(key,key+keysize);
+  entry.data.assign(data,data+data_size);
+  total += data_size;
+  Trim();
+}
+
+#undef OXS_DEMAG_REGISTRY_LOCK
+
 // Constructor
 Oxs_Demag::Oxs_Demag(
   const char* name,     // Child instance id
@@ -78,7 +197,7 @@ Oxs_Demag::Oxs_Demag(
     xperiodic(0),yperiodic(0),zperiodic(0),
     mesh_id(0),energy_density_error_estimate(-1),
     asymptotic_order(11),
-    demag_tensor_error(1e-15),
+    demag_tensor_error(1e-15),fft_float(0),A_trace(0),
 #if !OOMMF_THREADS
     Hxfrm(0),Mtemp(0),embed_convolution(0),
 #else
@@ -152,6 +271,42 @@ Oxs_Demag::Oxs_Demag(
   /// fmt is an optional printf-style format; the default value for fmt
   /// is %.16e.
 
+  tensor_cache_dir = GetStringInitValue("tensor_cache_dir","");
+  /// If non-empty, the transformed demag tensor is saved to and
+  /// restored from files in this directory.  Tensors are keyed on all
+  /// parameters that affect the tensor, so this can be shared across
+  /// runs and problems.
+
+  tensor_cache_memory = director->GetTensorCacheMemory();
+  /// Memory budget of the process-wide registry of transformed demag
+  /// tensors.  This is a process setting, not a MIF option, since the
+  /// registry is shared by all Oxs_Demag objects; see the Oxs
+  /// demag_tensor_cache_memory_MB option in config/options.tcl.  Zero
+  /// (the default) disables the registry.
+  _Oxs_DemagTensorRegistry::SetBudget(tensor_cache_memory);
+
+  String fft_precision = GetStringInitValue("fft_precision","double");
+  /// Storage precision for the frequency domain coefficients and
+  /// transform workspace; either "double" (default) or "float".  See
+  /// the compact storage notes in demag.h.
+  Oxs_ToLower(fft_precision);
+  if(fft_precision.compare("float")==0) {
+    fft_float = 1;
+  } else if(fft_precision.compare("double")!=0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " \"fft_precision\" value must be one of"
+                       " double or float.");
+  }
+#if !OOMMF_THREADS
+  if(fft_float) {
+    static Oxs_WarningMessage nofloat(1);
+    nofloat.Send(__FILE__,OC_STRINGIFY(__LINE__),
+                 "fft_precision float is not supported in non-threaded"
+                 " builds; using double.");
+    fft_float = 0;
+  }
+#endif
+
 #if REPORT_TIME
   // Set default names for development timers
   char buf[256];
@@ -214,8 +369,12 @@ OC_BOOL Oxs_Demag::Init()
 void Oxs_Demag::ReleaseMemory() const
 { // Conceptually const
   A.Free();
+  A_float.Free();
+  A5.Free();
+  A5_float.Free();
 #if OOMMF_THREADS
   Hxfrm_base.Free();
+  Hxfrm_base_float.Free();
 #else
   if(Hxfrm!=0)       { delete[] Hxfrm;       Hxfrm=0;       }
   if(Mtemp!=0)       { delete[] Mtemp;       Mtemp=0;       }
@@ -225,6 +384,57 @@ void Oxs_Demag::ReleaseMemory() const
   adimx=adimy=adimz=0;
 }
 
+// Copies src to dst elementwise, converting to the storage type of
+// dst.  Used by Oxs_Demag::CompactCoefficientArrays.
+template<typename DST>
+static void Oxs_DemagCopyCoefs
+(const Oxs_StripedArray<Oxs_Demag::A_coefs>& src,
+ Oxs_StripedArray<DST>& dst)
+{
+  const OC_INDEX asize = src.GetSize();
+  dst.SetSize(asize);
+  const Oxs_Demag::A_coefs* sptr = src.GetArrBase();
+  DST* dptr = dst.GetArrBase();
+  for(OC_INDEX i=0;i<asize;++i) {
+    dptr[i] = DST(sptr[i]);
+  }
+}
+
+void Oxs_Demag::CompactCoefficientArrays() const
+{ // Conceptually const
+  A5.Free();
+  A5_float.Free();
+  A_float.Free();
+  const OC_INDEX asize = A.GetSize();
+  if(asize<1) return;
+
+  // Check the trace identity.  The tolerance allows for rounding in
+  // the tensor computation and the FFTs; A22 as reconstructed is no
+  // less accurate than the tensor itself.
+  const A_coefs* aptr = A.GetArrBase();
+  const OXS_FFT_REAL_TYPE trace = aptr[0].A00 + aptr[0].A11 + aptr[0].A22;
+  const OXS_FFT_REAL_TYPE tol = 16*fabs(trace)
+    *(demag_tensor_error>OC_REAL8m_EPSILON
+      ? demag_tensor_error : OC_REAL8m_EPSILON);
+  OC_BOOL trace_ok = 1;
+  for(OC_INDEX i=1;i<asize;++i) {
+    const OXS_FFT_REAL_TYPE diff
+      = aptr[i].A00 + aptr[i].A11 + aptr[i].A22 - trace;
+    if(fabs(diff)>tol) { trace_ok = 0; break; }
+  }
+
+  if(trace_ok) {
+    A_trace = trace;
+    if(fft_float) Oxs_DemagCopyCoefs(A,A5_float);
+    else          Oxs_DemagCopyCoefs(A,A5);
+  } else if(fft_float) {
+    Oxs_DemagCopyCoefs(A,A_float);
+  } else {
+    return; // Keep A
+  }
+  A.Free();
+}
+
 ////////////////// SINGLE-THREADED IMPLEMENTATION  ///////////////
 #if !OOMMF_THREADS
 
@@ -504,11 +714,40 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
     }
   }
 
+  // Do we want to embed "convolution" computation inside z-axis FFTs?
+  // If so, setup control variables.
+  OC_INDEX footprint
+    = ODTV_COMPLEXSIZE*ODTV_VECSIZE*sizeof(OXS_FFT_REAL_TYPE) // Data
+    + sizeof(A_coefs)                           // Interaction matrix
+    + 2*ODTV_COMPLEXSIZE*sizeof(OXS_FFT_REAL_TYPE); // Roots of unity
+  footprint *= cdimz;
+  OC_INDEX trialsize = cache_size/(2*footprint); // "2" is fudge factor
+  if(trialsize>cdimx) trialsize=cdimx;
+  if(cdimz>1 && trialsize>4) {
+    // Note: If cdimz==1, then the z-axis FFT is a nop, so there is
+    // nothing to embed the "convolution" with and we are better off
+    // using the non-embedded code.
+    embed_convolution = 1;
+    embed_block_size = trialsize;
+  } else {
+    embed_convolution = 0;
+    embed_block_size = 0;  // A cry for help...
+  }
+
   OC_INDEX astridey = adimx;
   OC_INDEX astridez = astridey*adimy;
   OC_INDEX asize = astridez*adimz;
   A.SetSize(asize);
 
+  // If a matching tensor is found in the cache then we are done.  The
+  // cache holds only the transformed tensor, so skip this if saveN is
+  // requested.
+  if(saveN.size()==0 && LoadTensorCache(mesh)) {
+#if REPORT_TIME
+    inittime.Stop();
+#endif // REPORT_TIME
+    return;
+  }
 
   // According (16) in Newell's paper, the demag field is given by
   //                        H = -N*M
@@ -1122,25 +1361,8 @@ void Oxs_Demag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
     // workfft, sourcebuf, and targetbuf are deleted by end of scope.
   }
 
-  // Do we want to embed "convolution" computation inside z-axis FFTs?
-  // If so, setup control variables.
-  OC_INDEX footprint
-    = ODTV_COMPLEXSIZE*ODTV_VECSIZE*sizeof(OXS_FFT_REAL_TYPE) // Data
-    + sizeof(A_coefs)                           // Interaction matrix
-    + 2*ODTV_COMPLEXSIZE*sizeof(OXS_FFT_REAL_TYPE); // Roots of unity
-  footprint *= cdimz;
-  OC_INDEX trialsize = cache_size/(2*footprint); // "2" is fudge factor
-  if(trialsize>cdimx) trialsize=cdimx;
-  if(cdimz>1 && trialsize>4) {
-    // Note: If cdimz==1, then the z-axis FFT is a nop, so there is
-    // nothing to embed the "convolution" with and we are better off
-    // using the non-embedded code.
-    embed_convolution = 1;
-    embed_block_size = trialsize;
-  } else {
-    embed_convolution = 0;
-    embed_block_size = 0;  // A cry for help...
-  }
+  // Save transformed tensor for reuse by later runs, if requested.
+  SaveTensorCache(mesh);
 
 #if REPORT_TIME
     inittime.Stop();
@@ -1849,6 +2071,272 @@ Oxs_Demag::IncrementPreconditioner(PreconditionerData& pcd)
   return 1;
 }
 
+// Demag tensor cache support.  A cache file consists of the header
+// below followed by the raw A array.  The leading part of the header,
+// up to but not including data_size, is the cache key; the file name
+// is built from the CRC of the key bytes, and the full key is compared
+// on load to guard against CRC collisions.  The A array layout differs
+// between the threaded and non-threaded code, and also depends on the
+// FFT dimensions and floating point type, so these are included in the
+// key.  Cache files are not portable across machines.  The same key
+// identifies tensors in the in-memory _Oxs_DemagTensorRegistry.
+struct _Oxs_DemagTensorCacheHeader {
+  char magic[16];
+  OC_INDEX rdim[3];
+  OC_INDEX cdim[3];
+  OC_INDEX adim[3];
+  OC_REAL8m cellsize[3];
+  OC_REAL8m demag_tensor_error;
+  OC_INT4m periodic[3];
+  OC_INT4m asymptotic_order;
+  OC_INT4m zero_self_demag;
+  OC_INT4m fft_real_size;   // sizeof(OXS_FFT_REAL_TYPE)
+  OC_INT4m threaded_layout; // OOMMF_THREADS
+  OC_INT4m key_pad;
+  // End of key
+  OC_UINDEX data_size;      // Size of A array, in bytes
+  OC_UINT4m data_crc;       // CRC of A array
+  OC_UINT4m data_pad;
+};
+
+#define OXS_DEMAG_CACHE_MAGIC "OxsDemagA 1.0"
+
+static size_t
+Oxs_DemagTensorCacheKeySize()
+{
+  return offsetof(_Oxs_DemagTensorCacheHeader,data_size);
+}
+
+// Read-only view of an entire file.  On unix systems the file is
+// memory mapped, so that only the header needs to be read if the key
+// does not match.  Elsewhere the file is read into a buffer.  In
+// either case, GetData returns NULL if the file cannot be read.
+class _Oxs_DemagCacheFileView {
+public:
+  _Oxs_DemagCacheFileView(const char* filename);
+  ~_Oxs_DemagCacheFileView();
+  const unsigned char* GetData() const { return data; }
+  OC_UINDEX GetSize() const { return size; }
+private:
+  const unsigned char* data;
+  OC_UINDEX size;
+#if (OC_SYSTEM_TYPE != OC_UNIX)
+  vector<unsigned char> buf;
+#endif
+  // Disable copy operators
+  _Oxs_DemagCacheFileView(const _Oxs_DemagCacheFileView&);
+  _Oxs_DemagCacheFileView& operator=(const _Oxs_DemagCacheFileView&);
+};
+
+_Oxs_DemagCacheFileView::_Oxs_DemagCacheFileView(const char* filename)
+  : data(0), size(0)
+{
+  FILE* fptr = Nb_FOpen(filename,"rb");
+  if(fptr==NULL) return;
+#if (OC_SYSTEM_TYPE == OC_UNIX)
+  struct stat filestat;
+  if(fstat(fileno(fptr),&filestat)==0 && filestat.st_size>0) {
+    void* addr = mmap(0,static_cast<size_t>(filestat.st_size),
+                      PROT_READ,MAP_PRIVATE,fileno(fptr),0);
+    if(addr!=MAP_FAILED) {
+      data = static_cast<const unsigned char*>(addr);
+      size = static_cast<OC_UINDEX>(filestat.st_size);
+    }
+  }
+#else // OC_SYSTEM_TYPE != OC_UNIX
+  if(fseek(fptr,0,SEEK_END)==0) {
+    long filesize = ftell(fptr);
+    if(filesize>0 && fseek(fptr,0,SEEK_SET)==0) {
+      buf.resize(static_cast<size_t>(filesize));
+      if(fread(&(buf[0]),1,buf.size(),fptr)==buf.size()) {
+        data = &(buf[0]);
+        size = static_cast<OC_UINDEX>(buf.size());
+      }
+    }
+  }
+#endif // OC_SYSTEM_TYPE
+  fclose(fptr); // Mapping, if any, remains valid after close.
+}
+
+_Oxs_DemagCacheFileView::~_Oxs_DemagCacheFileView()
+{
+#if (OC_SYSTEM_TYPE == OC_UNIX)
+  if(data) munmap(const_cast<unsigned char*>(data),size);
+#endif
+}
+
+// Fills header key and constructs cache file name.  The data_size and
+// data_crc fields are set for A, but the CRC is computed only if
+// compute_crc is true.
+static String
+Oxs_DemagTensorCacheSetup
+(const String& cache_dir,
+ const Oxs_CommonRectangularMesh* mesh,
+ OC_INDEX rdimx,OC_INDEX rdimy,OC_INDEX rdimz,
+ OC_INDEX cdimx,OC_INDEX cdimy,OC_INDEX cdimz,
+ OC_INDEX adimx,OC_INDEX adimy,OC_INDEX adimz,
+ int xperiodic,int yperiodic,int zperiodic,
+ int asymptotic_order,OC_REAL8m demag_tensor_error,
+ OC_INT4m zero_self_demag,
+ _Oxs_DemagTensorCacheHeader& header)
+{
+  memset(&header,0,sizeof(header)); // Zero padding bytes too
+  Oc_Snprintf(header.magic,sizeof(header.magic),"%s",
+              OXS_DEMAG_CACHE_MAGIC);
+  header.rdim[0] = rdimx; header.rdim[1] = rdimy; header.rdim[2] = rdimz;
+  header.cdim[0] = cdimx; header.cdim[1] = cdimy; header.cdim[2] = cdimz;
+  header.adim[0] = adimx; header.adim[1] = adimy; header.adim[2] = adimz;
+  header.cellsize[0] = mesh->EdgeLengthX();
+  header.cellsize[1] = mesh->EdgeLengthY();
+  header.cellsize[2] = mesh->EdgeLengthZ();
+  header.demag_tensor_error = demag_tensor_error;
+  header.periodic[0] = (xperiodic ? 1 : 0);
+  header.periodic[1] = (yperiodic ? 1 : 0);
+  header.periodic[2] = (zperiodic ? 1 : 0);
+  header.asymptotic_order = asymptotic_order;
+  header.zero_self_demag = (zero_self_demag ? 1 : 0);
+  header.fft_real_size = sizeof(OXS_FFT_REAL_TYPE);
+  header.threaded_layout = OOMMF_THREADS;
+
+  OC_UINT4m keycrc
+    = Nb_ComputeCRC(Oxs_DemagTensorCacheKeySize(),
+                    reinterpret_cast<const unsigned char*>(&header));
+  char buf[256];
+  Oc_Snprintf(buf,sizeof(buf),
+              "oxsdemag-%" OC_INDEX_MOD "dx%" OC_INDEX_MOD "dx%"
+              OC_INDEX_MOD "d-%08lx.dat",
+              rdimx,rdimy,rdimz,static_cast<unsigned long>(keycrc));
+  Nb_List<Nb_DString> pathparts;
+  pathparts.Append(Nb_DString(cache_dir.c_str()));
+  pathparts.Append(Nb_DString(buf));
+  Nb_DString filename = Nb_TclFileJoin(pathparts);
+  return String(filename.GetStr());
+}
+
+OC_BOOL
+Oxs_Demag::LoadTensorCache(const Oxs_CommonRectangularMesh* mesh) const
+{
+  if(tensor_cache_dir.empty() && tensor_cache_memory==0) return 0;
+  _Oxs_DemagTensorCacheHeader header;
+  String filename
+    = Oxs_DemagTensorCacheSetup(tensor_cache_dir,mesh,
+                                rdimx,rdimy,rdimz,cdimx,cdimy,cdimz,
+                                adimx,adimy,adimz,
+                                xperiodic,yperiodic,zperiodic,
+                                asymptotic_order,demag_tensor_error,
+                                zero_self_demag,header);
+  const unsigned char* key = reinterpret_cast<const unsigned char*>(&header);
+  unsigned char* adata = reinterpret_cast<unsigned char*>(A.GetArrBase());
+  const OC_UINDEX data_size
+    = static_cast<OC_UINDEX>(A.GetSize())*sizeof(A_coefs);
+
+  if(tensor_cache_memory>0
+     && _Oxs_DemagTensorRegistry::Load(key,Oxs_DemagTensorCacheKeySize(),
+                                       adata,data_size)) {
+    return 1;
+  }
+  if(tensor_cache_dir.empty()) return 0;
+
+  _Oxs_DemagCacheFileView view(filename.c_str());
+  const unsigned char* filedata = view.GetData();
+  if(filedata==NULL) return 0; // No cache file
+
+  const char* badfile = 0;
+  _Oxs_DemagTensorCacheHeader fileheader;
+  if(view.GetSize()<sizeof(fileheader)) {
+    badfile = "truncated header";
+  } else {
+    memcpy(&fileheader,filedata,sizeof(fileheader));
+    if(memcmp(&fileheader,&header,Oxs_DemagTensorCacheKeySize())!=0) {
+      badfile = "key mismatch";
+    } else if(fileheader.data_size != data_size
+              || view.GetSize() != sizeof(fileheader) + data_size) {
+      badfile = "wrong data size";
+    } else if(Nb_ComputeCRC(data_size,filedata+sizeof(fileheader))
+              != fileheader.data_crc) {
+      badfile = "CRC check failed";
+    }
+  }
+  if(badfile) {
+    // File will be replaced by SaveTensorCache.
+    char buf[4096];
+    Oc_Snprintf(buf,sizeof(buf),
+                "Ignoring invalid demag tensor cache file \"%.3000s\": %s",
+                filename.c_str(),badfile);
+    static Oxs_WarningMessage badcache(3);
+    badcache.Send(__FILE__,OC_STRINGIFY(__LINE__),buf);
+    return 0;
+  }
+
+  memcpy(adata,filedata+sizeof(fileheader),data_size);
+  if(tensor_cache_memory>0) {
+    _Oxs_DemagTensorRegistry::Store(key,Oxs_DemagTensorCacheKeySize(),
+                                    adata,data_size);
+  }
+  return 1;
+}
+
+void
+Oxs_Demag::SaveTensorCache(const Oxs_CommonRectangularMesh* mesh) const
+{
+  if(tensor_cache_dir.empty() && tensor_cache_memory==0) return;
+  _Oxs_DemagTensorCacheHeader header;
+  String filename
+    = Oxs_DemagTensorCacheSetup(tensor_cache_dir,mesh,
+                                rdimx,rdimy,rdimz,cdimx,cdimy,cdimz,
+                                adimx,adimy,adimz,
+                                xperiodic,yperiodic,zperiodic,
+                                asymptotic_order,demag_tensor_error,
+                                zero_self_demag,header);
+  const unsigned char* data
+    = reinterpret_cast<const unsigned char*>(A.GetArrBase());
+  header.data_size = static_cast<OC_UINDEX>(A.GetSize())*sizeof(A_coefs);
+  if(tensor_cache_memory>0) {
+    _Oxs_DemagTensorRegistry::Store
+      (reinterpret_cast<const unsigned char*>(&header),
+       Oxs_DemagTensorCacheKeySize(),data,header.data_size);
+  }
+  if(tensor_cache_dir.empty()) return;
+  header.data_crc = Nb_ComputeCRC(header.data_size,data);
+
+  // Write to a temporary file and rename, so that concurrent runs
+  // never see a partially written cache file.
+  const char* errmsg = 0;
+  String tmpname;
+  try {
+    Nb_DString tmpfile = Nb_TempName("oxsdemag-",".tmp",
+                                     tensor_cache_dir.c_str());
+    tmpname = tmpfile.GetStr();
+    FILE* fptr = Nb_FOpen(tmpname.c_str(),"wb");
+    if(fptr==NULL) {
+      errmsg = "unable to open file for writing";
+    } else {
+      if(fwrite(&header,sizeof(header),1,fptr)!=1
+         || (header.data_size>0
+             && fwrite(data,static_cast<size_t>(header.data_size),1,fptr)!=1)) {
+        errmsg = "write error";
+      }
+      if(fclose(fptr)!=0 && errmsg==0) errmsg = "write error";
+      if(errmsg==0) {
+        Nb_RenameNoInterp(tmpname.c_str(),filename.c_str(),0);
+      } else {
+        Nb_Remove(tmpname.c_str());
+      }
+    }
+  } catch(...) {
+    errmsg = "unable to create file";
+    if(!tmpname.empty()) Nb_Remove(tmpname.c_str());
+  }
+  if(errmsg) {
+    char buf[4096];
+    Oc_Snprintf(buf,sizeof(buf),
+                "Unable to save demag tensor cache file \"%.3000s\": %s",
+                filename.c_str(),errmsg);
+    static Oxs_WarningMessage savefail(3);
+    savefail.Send(__FILE__,OC_STRINGIFY(__LINE__),buf);
+  }
+}
+
 // For debugging.
 // CAUTION: This routine prints the entire 6-component A_coefs structure
 //          across the entire A array.  You probably don't want to do
@@ -43,9 +43,9 @@ class Oxs_Demag
 
 #if OOMMF_THREADS
   friend class Oxs_FFTLocker;
-  friend class _Oxs_DemagFFTxThread;
-  friend class _Oxs_DemagiFFTxDotThread;
-  friend class _Oxs_DemagFFTyzConvolveThread;
+  template<typename> friend class _Oxs_DemagFFTxThread;
+  template<typename> friend class _Oxs_DemagiFFTxDotThread;
+  template<typename,typename> friend class _Oxs_DemagFFTyzConvolveThread;
 #endif // OOMMF_THREADS
 
 public:
@@ -54,25 +54,55 @@ public:
   // is inside private: block.  OK, fine...
   // More recently, this struct is referenced by thread classes in
   // demag-threaded.cc
-  struct A_coefs {
+  template<typename REAL>
+  struct A_coefs_t {
   public:
-    OXS_FFT_REAL_TYPE A00;
-    OXS_FFT_REAL_TYPE A01;
-    OXS_FFT_REAL_TYPE A02;
-    OXS_FFT_REAL_TYPE A11;
-    OXS_FFT_REAL_TYPE A12;
-    OXS_FFT_REAL_TYPE A22;
-    A_coefs() {}
-    A_coefs(OXS_FFT_REAL_TYPE iA00,OXS_FFT_REAL_TYPE iA01,
-            OXS_FFT_REAL_TYPE iA02,OXS_FFT_REAL_TYPE iA11,
-            OXS_FFT_REAL_TYPE iA12,OXS_FFT_REAL_TYPE iA22)
+    REAL A00;
+    REAL A01;
+    REAL A02;
+    REAL A11;
+    REAL A12;
+    REAL A22;
+    A_coefs_t() {}
+    A_coefs_t(REAL iA00,REAL iA01,REAL iA02,
+              REAL iA11,REAL iA12,REAL iA22)
       : A00(iA00), A01(iA01), A02(iA02), A11(iA11), A12(iA12), A22(iA22) {}
-    A_coefs& operator+=(const A_coefs& other) {
+    template<typename OTHER>
+    explicit A_coefs_t(const A_coefs_t<OTHER>& other)
+      : A00(REAL(other.A00)), A01(REAL(other.A01)), A02(REAL(other.A02)),
+        A11(REAL(other.A11)), A12(REAL(other.A12)), A22(REAL(other.A22)) {}
+    A_coefs_t& operator+=(const A_coefs_t& other) {
       A00 += other.A00;   A01 += other.A01;   A02 += other.A02;
       A11 += other.A11;   A12 += other.A12;   A22 += other.A22;
       return *this;
     }
+    REAL GetA22(OXS_FFT_REAL_TYPE /* trace */) const { return A22; }
   };
+  typedef A_coefs_t<OXS_FFT_REAL_TYPE> A_coefs;
+  typedef A_coefs_t<OC_REAL4> A_coefs_float; // fft_precision float
+
+  // Five component variant of A_coefs_t, with A22 recovered from the
+  // trace A00+A11+A22, which is the same at all frequencies.  See
+  // CompactCoefficientArrays().
+  template<typename REAL>
+  struct A_coefs_trace_t {
+  public:
+    REAL A00;
+    REAL A01;
+    REAL A02;
+    REAL A11;
+    REAL A12;
+    A_coefs_trace_t() {}
+    template<typename OTHER>
+    explicit A_coefs_trace_t(const A_coefs_t<OTHER>& other)
+      : A00(REAL(other.A00)), A01(REAL(other.A01)), A02(REAL(other.A02)),
+        A11(REAL(other.A11)), A12(REAL(other.A12)) {}
+    OXS_FFT_REAL_TYPE GetA22(OXS_FFT_REAL_TYPE trace) const {
+      return trace - A00 - A11;
+    }
+  };
+  typedef A_coefs_trace_t<OXS_FFT_REAL_TYPE> A_coefs_trace;
+  typedef A_coefs_trace_t<OC_REAL4> A_coefs_trace_float;
 
 #if OOMMF_THREADS
   // Sun CC, Forte Developer 7 C++ 5.4 2002/03/09, complains inside
@@ -90,6 +120,7 @@ public:
     OC_INDEX Hxfrm_jstride;
     OC_INDEX Hxfrm_kstride;
     OC_INDEX embed_block_size;
+    OC_BOOL Hxfrm_float; // True if Hxfrm is stored as OC_REAL4
     String name; // In use, we just set this to
     /// "InstanceName() + this_addr", so that each
     /// Oxs_Demag object gets a separate locker.
@@ -99,28 +130,32 @@ public:
       : rdimx(0), rdimy(0), rdimz(0),
         cdimx(0), cdimy(0), cdimz(0),
         Hxfrm_jstride(0),Hxfrm_kstride(0),
-        embed_block_size(0) {}
+        embed_block_size(0), Hxfrm_float(0) {}
 
     Oxs_FFTLocker_Info(OC_INDEX in_rdimx,OC_INDEX in_rdimy,OC_INDEX in_rdimz,
                        OC_INDEX in_cdimx,OC_INDEX in_cdimy,OC_INDEX in_cdimz,
                        OC_INDEX in_Hxfrm_jstride,OC_INDEX in_Hxfrm_kstride,
                        OC_INDEX in_embed_block_size,
+                       OC_BOOL in_Hxfrm_float,
                        const char* in_name)
       : rdimx(in_rdimx), rdimy(in_rdimy), rdimz(in_rdimz),
         cdimx(in_cdimx), cdimy(in_cdimy), cdimz(in_cdimz),
         Hxfrm_jstride(in_Hxfrm_jstride),Hxfrm_kstride(in_Hxfrm_kstride),
-        embed_block_size(in_embed_block_size), name(in_name) {}
+        embed_block_size(in_embed_block_size),
+        Hxfrm_float(in_Hxfrm_float), name(in_name) {}
 
     void Set(OC_INDEX in_rdimx,OC_INDEX in_rdimy,OC_INDEX in_rdimz,
              OC_INDEX in_cdimx,OC_INDEX in_cdimy,OC_INDEX in_cdimz,
              OC_INDEX in_Hxfrm_jstride,OC_INDEX in_Hxfrm_kstride,
              OC_INDEX in_embed_block_size,
+             OC_BOOL in_Hxfrm_float,
              const String& in_name) {
       rdimx = in_rdimx;      rdimy = in_rdimy;      rdimz = in_rdimz;
       cdimx = in_cdimx;      cdimy = in_cdimy;      cdimz = in_cdimz;
       Hxfrm_jstride = in_Hxfrm_jstride;
       Hxfrm_kstride = in_Hxfrm_kstride;
       embed_block_size = in_embed_block_size;
+      Hxfrm_float = in_Hxfrm_float;
       name = in_name;
     }
     // Default copy constructor and assignment operator are okay.
@@ -153,7 +188,9 @@ private:
   mutable OC_INDEX cdimy;
   mutable OC_INDEX cdimz;
   // 2*(cdimx-1)>=rdimx, cdimy>=rdimy, cdimz>=rdimz
-  // cdimx-1 and cdim[yz] should be powers of 2.
+  // cdimx-1 and cdim[yz] should have no prime factors other than
+  // 2, 3, 5 and 7, and cdim[yz] should be even or 1.  See
+  // Oxs_FFT3DThreeVector::RecommendDimensions.
   mutable OC_INDEX adimx; // Dimensions of A## storage (see below).
   mutable OC_INDEX adimy;
   mutable OC_INDEX adimz;
@@ -192,6 +229,32 @@ private:
   /// slowest.  Multi-threaded code flips this so that j increments
   /// fastest and i slowest.
 
+  // Compact storage.  The demag tensor N is trace free away from the
+  // origin, and Nxx+Nyy+Nzz=1 at the origin, so after transformation
+  // A00+A11+A22 is the same constant (the FFT scaling) at every
+  // frequency.  Threaded builds exploit this by storing only five
+  // components (A5 or A5_float) and reconstructing A22 from A_trace in
+  // the convolution.  CompactCoefficientArrays() checks the identity
+  // against the computed coefficients before dropping A22; if the check
+  // fails the full six components are retained.
+  //   Reduced precision storage.  If fft_float is true (MIF option
+  // "fft_precision float") then the long term coefficient arrays are
+  // stored as OC_REAL4 (A5_float, or A_float if the trace check fails),
+  // and the Hxfrm transform array is stored as OC_REAL4.  The FFTs and
+  // the matrix-vector multiply are still computed in OXS_FFT_REAL_TYPE;
+  // only the long term storage between passes is rounded.  This halves
+  // the coefficient memory and the memory traffic through Hxfrm.
+  // Supported in threaded builds only.
+  //   In all cases the coefficients are computed in A, which is
+  // released if one of the other arrays is filled.
+  OC_BOOL fft_float;
+  mutable OXS_FFT_REAL_TYPE A_trace;
+  mutable Oxs_StripedArray<A_coefs_float> A_float;
+  mutable Oxs_StripedArray<A_coefs_trace> A5;
+  mutable Oxs_StripedArray<A_coefs_trace_float> A5_float;
+  void CompactCoefficientArrays() const; // Moves A to A5, A5_float
+  /// or A_float, as appropriate.
+
   // Max asymptotic method order
   int asymptotic_order;
 
@@ -225,6 +288,7 @@ private:
   mutable OC_BOOL embed_convolution; // Note: Always true in threaded version
 #else // OOMMF_THREADS
   mutable Oxs_StripedArray<OXS_FFT_REAL_TYPE> Hxfrm_base;
+  mutable Oxs_StripedArray<OC_REAL4> Hxfrm_base_float; // fft_float
   const int MaxThreadCount;
   mutable Oxs_ThreadTree threadtree;
 
@@ -240,6 +304,10 @@ private:
     size_t fftx_scratch_size;
     size_t fftx_scratch_base_size;
 
+    OXS_FFT_REAL_TYPE* fftx_cbuf; // Full precision copy of one x-row
+    char*  fftx_cbuf_base;        // of Hxfrm.  Allocated only if
+    size_t fftx_cbuf_base_size;   // info.Hxfrm_float is true.
+
     OXS_FFT_REAL_TYPE* ffty_Hwork;
     char*  ffty_Hwork_base; // Block used for aligning ffty_Hwork
     OC_INDEX ffty_Hwork_zstride;  // In OXS_FFT_REAL_TYPE units
@@ -274,6 +342,14 @@ private:
     return name;
   }
 
+  // Body of ComputeEnergy, templated on the storage type of Hxfrm
+  // and A (full or reduced precision; see fft_float).
+  template<typename HREAL,typename ACOEF>
+  void ComputeEnergyThreaded(const Oxs_SimState& state,
+                             Oxs_ComputeEnergyData& oced,
+                             Oxs_StripedArray<HREAL>& Hxfrm_arr,
+                             const Oxs_StripedArray<ACOEF>& A_arr) const;
+
 #endif // OOMMF_THREADS
 
   mutable OC_INDEX embed_block_size;
@@ -294,6 +370,34 @@ private:
 
   String saveN_fmt;  // File format for saveN
 
+  String tensor_cache_dir;
+  /// If non-empty, directory holding cached copies of the frequency
+  /// domain A## arrays.  Each cache file is named by a CRC of the
+  /// parameters the tensor depends on (mesh dimensions, cell size,
+  /// periodicity, asymptotic_order, demag_tensor_error, etc.), so
+  /// runs that differ only in, say, Ms or applied field share a file.
+
+  OC_UINDEX tensor_cache_memory;
+  /// Budget in bytes for the process-wide, in-memory registry of
+  /// transformed A## arrays, shared by all Oxs_Demag instances.  This
+  /// makes reloads of a problem on the same mesh, or a second demag
+  /// term on the same mesh, skip the tensor computation.  Least
+  /// recently used tensors are dropped to stay within the budget.
+  /// The value is copied from Oxs_Director::GetTensorCacheMemory() at
+  /// construction, so all instances use the same budget.  Zero (the
+  /// default) disables the registry.
+
+  // Support for tensor_cache_memory and tensor_cache_dir.
+  // LoadTensorCache returns 1 and fills A if a matching tensor is held
+  // in the registry or a valid cache file is found, otherwise it
+  // returns 0 and leaves A unchanged.  SaveTensorCache stores A in the
+  // registry and writes the cache file; errors are reported as
+  // warnings, not exceptions, since the caches are only an
+  // optimization.  Both routines must be called after the dimension,
+  // periodicity and A storage setup in FillCoefficientArrays.
+  OC_BOOL LoadTensorCache(const Oxs_CommonRectangularMesh* mesh) const;
+  void SaveTensorCache(const Oxs_CommonRectangularMesh* mesh) const;
+
   void FillCoefficientArrays(const Oxs_Mesh* mesh) const;
 
   void ReleaseMemory() const;
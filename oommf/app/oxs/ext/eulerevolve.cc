@@ -25,7 +25,9 @@ Oxs_EulerEvolve::Oxs_EulerEvolve(
   const char* argstr)   // MIF input block parameters
   : Oxs_TimeEvolver(name,newdtr,argstr),
     max_step_increase(1.25), max_step_decrease(0.5),
-    energy_state_id(0),next_timestep(0.)
+    energy_state_id(0),next_timestep(0.),
+    max_dm_dt_key("Max dm/dt"),dE_dt_key("dE/dt"),delta_E_key("Delta E"),
+    pE_pt_key("pE/pt"),timestep_lower_bound_key("Timestep lower bound")
 {
   // Process arguments
   min_timestep=GetRealInitValue("min_timestep",0.);
@@ -172,8 +174,16 @@ void Oxs_EulerEvolve::Calculate_dm_dt
     (Ms_,
      [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
       Oxs_Energy::SUMTYPE thd_dE_dt_sum = 0.0;   // Local copy
-      OC_REAL8m thd_max_dm_dt_sq = 0.0; // Ditto
-      for(OC_INDEX j=jstart;j<jstop;++j) {
+      Oc_Pack pack_max_dm_dt_sq(0.0);            // Ditto
+      OC_INDEX j=jstart;
+      for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+        Calculate_dm_dt_pack(mesh_,Ms_,mxH_,spin_,dm_dt_,
+                             pack_max_dm_dt_sq,
+                             thd_dE_dt_sum,
+                             coef1,coef2,j);
+      }
+      OC_REAL8m thd_max_dm_dt_sq = Oc_PackMaxElement(pack_max_dm_dt_sq);
+      for(;j<jstop;++j) {
         Calculate_dm_dt_i(mesh_,Ms_,mxH_,spin_,dm_dt_,
                           thd_max_dm_dt_sq,
                           thd_dE_dt_sum,
@@ -374,11 +384,11 @@ Oxs_EulerEvolve::Step(const Oxs_TimeDriver* driver,
   /// calculated so that max_dm_dt * timestep = start_dm (subject to
   /// min/max_timestep constraints).
 
-  cache_good &= cstate.GetDerivedData("Max dm/dt",max_dm_dt);
-  cache_good &= cstate.GetDerivedData("dE/dt",dE_dt);
-  cache_good &= cstate.GetDerivedData("Delta E",delta_E);
-  cache_good &= cstate.GetDerivedData("pE/pt",pE_pt);
-  cache_good &= cstate.GetDerivedData("Timestep lower bound",
+  cache_good &= cstate.GetDerivedData(max_dm_dt_key,max_dm_dt);
+  cache_good &= cstate.GetDerivedData(dE_dt_key,dE_dt);
+  cache_good &= cstate.GetDerivedData(delta_E_key,delta_E);
+  cache_good &= cstate.GetDerivedData(pE_pt_key,pE_pt);
+  cache_good &= cstate.GetDerivedData(timestep_lower_bound_key,
 				      timestep_lower_bound);
   cache_good &= (energy_state_id == cstate.Id());
   cache_good &= (dm_dt_output.cache.state_id == cstate.Id());
@@ -463,7 +473,20 @@ Oxs_EulerEvolve::Step(const Oxs_TimeDriver* driver,
   Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
     (cstate.spin,
      [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
-      for(OC_INDEX j=jstart;j<jstop;++j) {
+      OC_INDEX j=jstart;
+      for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+        // Packed version of the loop below.
+        const Oxs_ThreeVectorPack spin0(&cstate.spin[j]);
+        Oxs_ThreeVectorPack tempspin(&dm_dt[j]);
+        tempspin *= stepsize;
+        const Oc_Pack adj = 0.5 * tempspin.MagSq();
+        tempspin -= adj*spin0;
+        tempspin *= Oc_Pack(1.0)/(Oc_Pack(1.0)+adj);
+        tempspin += spin0;
+        tempspin.MakeUnit();
+        tempspin.Store(&workstate.spin[j]);
+      }
+      for(;j<jstop;++j) {
         ThreeVector tempspin = dm_dt[j];
         tempspin *= stepsize;
 
@@ -491,55 +514,25 @@ Oxs_EulerEvolve::Step(const Oxs_TimeDriver* driver,
   mxH_output.cache.state_id=nstate.Id();
   const Oxs_MeshValue<ThreeVector>& mxH = mxH_output.cache.value;
 
-  //  Calculate delta E
-  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
-    thread_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
-  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
-    thread_var_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
-  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
-    thread_total_E(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
-  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
-    (energy,
-     [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
-      Oxs_Energy::SUMTYPE thd_dE = 0.0;       // Local copy
-      Oxs_Energy::SUMTYPE thd_var_dE = 0.0;   // Ditto
-      Oxs_Energy::SUMTYPE thd_total_E = 0.0;  // Ditto
-      for(OC_INDEX j=jstart;j<jstop;++j) {
-        OC_REAL8m vol = nstate.mesh->Volume(j);
-        OC_REAL8m e = energy[j];
-        thd_total_E += e * vol;
-        OC_REAL8m new_e = new_energy[j];
-        thd_dE += (new_e - e) * vol;
-        thd_var_dE += (new_e*new_e + e*e)*vol*vol;
-      }
-      thread_dE[thread_id]      += thd_dE;
-      thread_var_dE[thread_id]  += thd_var_dE;
-      thread_total_E[thread_id] += thd_total_E;
-    });
-  for(int i=1;i<number_of_threads;++i) {
-    thread_dE[0] += thread_dE[i];
-    thread_var_dE[0] += thread_var_dE[i];
-    thread_total_E[0] += thread_total_E[i];
-  }
-  OC_REAL8m total_E = static_cast<OC_REAL8m>(thread_total_E[0]);
-  OC_REAL8m dE      = static_cast<OC_REAL8m>(thread_dE[0]);
-  OC_REAL8m var_dE  = static_cast<OC_REAL8m>(thread_var_dE[0]);
-  var_dE *= 256*OC_REAL8_EPSILON*OC_REAL8_EPSILON; // Variance, assuming
-  /// error in each energy[i] term is independent, uniformly
-  /// distributed, 0-mean, with range +/- 16*OC_REAL8_EPSILON*energy[i].
-  /// It would probably be better to get an error estimate directly
-  /// from each energy term.
-
-  // Get error estimate.  See step size adjustment discussion in MJD
-  // Notes II, p72 (18-Jan-2001).  Basically, estimate the error as the
-  // difference between the obtained step endpoint and what would have
-  // been obtained if a 2nd order Heun step had been taken.
+  // Calculate delta E, and get error estimate.  See step size
+  // adjustment discussion in MJD Notes II, p72 (18-Jan-2001).
+  // Basically, estimate the error as the difference between the
+  // obtained step endpoint and what would have been obtained if a 2nd
+  // order Heun step had been taken.  Both reductions, together with
+  // new dm/dt, max dm/dt and dE/dt, are done in one sweep across the
+  // mesh.
   const Oxs_Mesh& new_mesh = *(nstate.mesh);
   new_dm_dt.AdjustSize(&new_mesh);
   const Oxs_MeshValue<OC_REAL8m>& new_Ms = *(nstate.Ms);
   const Oxs_MeshValue<ThreeVector>& new_spin = nstate.spin;
   const OC_REAL8m coef1 = (do_precess ? -1*gamma : 0.0 );
   const OC_REAL8m coef2 = alpha * gamma;
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_var_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_total_E(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
   std::vector<OC_REAL8m> thread_max_dm_dt_sq(number_of_threads,0.0);
   std::vector<OC_REAL8m> thread_max_error_sq(number_of_threads,0.0);
   Oc_AlignedVector<Oxs_Energy::SUMTYPE>
@@ -548,10 +541,36 @@ Oxs_EulerEvolve::Step(const Oxs_TimeDriver* driver,
   Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
     (new_Ms,
      [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
-      Oxs_Energy::SUMTYPE thd_dE_dt_sum = 0.0;                // Local copy
-      OC_REAL8m thd_max_dm_dt_sq = thread_max_dm_dt_sq[thread_id]; // Ditto
-      OC_REAL8m thd_max_error_sq = thread_max_error_sq[thread_id]; // Ditto
-      for(OC_INDEX j=jstart;j<jstop;++j) {
+      Oxs_Energy::SUMTYPE thd_dE = 0.0;         // Local copy
+      Oxs_Energy::SUMTYPE thd_var_dE = 0.0;     // Ditto
+      Oxs_Energy::SUMTYPE thd_total_E = 0.0;    // Ditto
+      Oxs_Energy::SUMTYPE thd_dE_dt_sum = 0.0;  // Ditto
+      auto accum_dE = [&](OC_INDEX k) {
+        OC_REAL8m vol = new_mesh.Volume(k);
+        OC_REAL8m e = energy[k];
+        thd_total_E += e * vol;
+        OC_REAL8m new_e = new_energy[k];
+        thd_dE += (new_e - e) * vol;
+        thd_var_dE += (new_e*new_e + e*e)*vol*vol;
+      };
+      Oc_Pack pack_max_dm_dt_sq(0.0);
+      Oc_Pack pack_max_error_sq(0.0);
+      OC_INDEX j=jstart;
+      for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+        Calculate_dm_dt_pack(new_mesh,new_Ms,mxH,new_spin,new_dm_dt,
+                             pack_max_dm_dt_sq,
+                             thd_dE_dt_sum,
+                             coef1,coef2,j);
+        Oxs_ThreeVectorPack temp(&dm_dt[j]);
+        temp -= Oxs_ThreeVectorPack(&new_dm_dt[j]);
+        pack_max_error_sq.KeepMax(temp.MagSq());
+        for(OC_INDEX k=j;k<j+OC_PACK_WIDTH;++k) accum_dE(k);
+      }
+      OC_REAL8m thd_max_dm_dt_sq = OC_MAX(thread_max_dm_dt_sq[thread_id],
+                                   Oc_PackMaxElement(pack_max_dm_dt_sq));
+      OC_REAL8m thd_max_error_sq = OC_MAX(thread_max_error_sq[thread_id],
+                                   Oc_PackMaxElement(pack_max_error_sq));
+      for(;j<jstop;++j) {
         Calculate_dm_dt_i(new_mesh,new_Ms,mxH,new_spin,new_dm_dt,
                           thd_max_dm_dt_sq,
                           thd_dE_dt_sum,
@@ -560,21 +579,36 @@ Oxs_EulerEvolve::Step(const Oxs_TimeDriver* driver,
         temp -= new_dm_dt[j];
         OC_REAL8m temp_error_sq = temp.MagSq();
         if(temp_error_sq>thd_max_error_sq) thd_max_error_sq = temp_error_sq;
+        accum_dE(j);
       }
+      thread_dE[thread_id]        += thd_dE;
+      thread_var_dE[thread_id]    += thd_var_dE;
+      thread_total_E[thread_id]   += thd_total_E;
       thread_dE_dt_sum[thread_id] += thd_dE_dt_sum;
       thread_max_dm_dt_sq[thread_id] = thd_max_dm_dt_sq;
       thread_max_error_sq[thread_id] = thd_max_error_sq;
     });
 
   for(int i=1;i<number_of_threads;++i) {
-      thread_dE_dt_sum[0] += thread_dE_dt_sum[i];
-      if(thread_max_dm_dt_sq[0] < thread_max_dm_dt_sq[i]) {
-        thread_max_dm_dt_sq[0] = thread_max_dm_dt_sq[i];
-      }
-      if(thread_max_error_sq[0] < thread_max_error_sq[i]) {
-        thread_max_error_sq[0] = thread_max_error_sq[i];
-      }
+    thread_dE[0] += thread_dE[i];
+    thread_var_dE[0] += thread_var_dE[i];
+    thread_total_E[0] += thread_total_E[i];
+    thread_dE_dt_sum[0] += thread_dE_dt_sum[i];
+    if(thread_max_dm_dt_sq[0] < thread_max_dm_dt_sq[i]) {
+      thread_max_dm_dt_sq[0] = thread_max_dm_dt_sq[i];
+    }
+    if(thread_max_error_sq[0] < thread_max_error_sq[i]) {
+      thread_max_error_sq[0] = thread_max_error_sq[i];
+    }
   }
+  OC_REAL8m total_E = static_cast<OC_REAL8m>(thread_total_E[0]);
+  OC_REAL8m dE      = static_cast<OC_REAL8m>(thread_dE[0]);
+  OC_REAL8m var_dE  = static_cast<OC_REAL8m>(thread_var_dE[0]);
+  var_dE *= 256*OC_REAL8_EPSILON*OC_REAL8_EPSILON; // Variance, assuming
+  /// error in each energy[i] term is independent, uniformly
+  /// distributed, 0-mean, with range +/- 16*OC_REAL8_EPSILON*energy[i].
+  /// It would probably be better to get an error estimate directly
+  /// from each energy term.
 
   OC_REAL8m new_dE_dt
     = -1 * MU0 * gamma * alpha * OC_REAL8m(thread_dE_dt_sum[0]) + new_pE_pt;
@@ -649,12 +683,12 @@ Oxs_EulerEvolve::Step(const Oxs_TimeDriver* driver,
     next_timestep = timestep_lower_limit;
   }
 
-  if(!nstate.AddDerivedData("Timestep lower bound",
+  if(!nstate.AddDerivedData(timestep_lower_bound_key,
 			    new_timestep_lower_bound) ||
-     !nstate.AddDerivedData("Max dm/dt",new_max_dm_dt) ||
-     !nstate.AddDerivedData("dE/dt",new_dE_dt) ||
-     !nstate.AddDerivedData("Delta E",dE) ||
-     !nstate.AddDerivedData("pE/pt",new_pE_pt)) {
+     !nstate.AddDerivedData(max_dm_dt_key,new_max_dm_dt) ||
+     !nstate.AddDerivedData(dE_dt_key,new_dE_dt) ||
+     !nstate.AddDerivedData(delta_E_key,dE) ||
+     !nstate.AddDerivedData(pE_pt_key,new_pE_pt)) {
     throw Oxs_ExtError(this,
        "Oxs_EulerEvolve::Step:"
        " Programming error; data cache already set.");
@@ -684,11 +718,11 @@ void Oxs_EulerEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
     = 0;  // Mark change in progress
 
   OC_REAL8m dummy_value;
-  if(!state.GetDerivedData("Max dm/dt",max_dm_dt_output.cache.value) ||
-     !state.GetDerivedData("dE/dt",dE_dt_output.cache.value) ||
-     !state.GetDerivedData("Delta E",delta_E_output.cache.value) ||
-     !state.GetDerivedData("pE/pt",dummy_value) ||
-     !state.GetDerivedData("Timestep lower bound",dummy_value) ||
+  if(!state.GetDerivedData(max_dm_dt_key,max_dm_dt_output.cache.value) ||
+     !state.GetDerivedData(dE_dt_key,dE_dt_output.cache.value) ||
+     !state.GetDerivedData(delta_E_key,delta_E_output.cache.value) ||
+     !state.GetDerivedData(pE_pt_key,dummy_value) ||
+     !state.GetDerivedData(timestep_lower_bound_key,dummy_value) ||
      (dm_dt_output.GetCacheRequestCount()>0
       && dm_dt_output.cache.state_id != state.Id()) ||
      (mxH_output.GetCacheRequestCount()>0
@@ -702,8 +736,8 @@ void Oxs_EulerEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
     GetEnergyDensity(state,energy,&mxH,NULL,pE_pt);
     energy_state_id=state.Id();
     mxH_output.cache.state_id=state.Id();
-    if(!state.GetDerivedData("pE/pt",dummy_value)) {
-      state.AddDerivedData("pE/pt",pE_pt);
+    if(!state.GetDerivedData(pE_pt_key,dummy_value)) {
+      state.AddDerivedData(pE_pt_key,pE_pt);
     }
 
     // Calculate dm/dt, Max dm/dt and dE/dt
@@ -716,18 +750,18 @@ void Oxs_EulerEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
 		    max_dm_dt_output.cache.value,
 		    dE_dt_output.cache.value,timestep_lower_bound);
     dm_dt_output.cache.state_id=state.Id();
-    if(!state.GetDerivedData("Max dm/dt",dummy_value)) {
-      state.AddDerivedData("Max dm/dt",max_dm_dt_output.cache.value);
+    if(!state.GetDerivedData(max_dm_dt_key,dummy_value)) {
+      state.AddDerivedData(max_dm_dt_key,max_dm_dt_output.cache.value);
     }
-    if(!state.GetDerivedData("dE/dt",dummy_value)) {
-      state.AddDerivedData("dE/dt",dE_dt_output.cache.value);
+    if(!state.GetDerivedData(dE_dt_key,dummy_value)) {
+      state.AddDerivedData(dE_dt_key,dE_dt_output.cache.value);
     }
-    if(!state.GetDerivedData("Timestep lower bound",dummy_value)) {
-      state.AddDerivedData("Timestep lower bound",
+    if(!state.GetDerivedData(timestep_lower_bound_key,dummy_value)) {
+      state.AddDerivedData(timestep_lower_bound_key,
 			   timestep_lower_bound);
     }
 
-    if(!state.GetDerivedData("Delta E",dummy_value)) {
+    if(!state.GetDerivedData(delta_E_key,dummy_value)) {
       if(state.previous_state_id!=0 && state.stage_iteration_count>0) {
 	// Strictly speaking, we should be able to create dE for
 	// stage_iteration_count==0 for stages>0, but as a practical
@@ -737,7 +771,7 @@ void Oxs_EulerEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
 	   "Oxs_EulerEvolve::UpdateDerivedOutputs:"
 	   " Can't derive Delta E from single state.");
       }
-      state.AddDerivedData("Delta E",0.0);
+      state.AddDerivedData(delta_E_key,0.0);
       dummy_value = 0.;
     }
     delta_E_output.cache.value=dummy_value;
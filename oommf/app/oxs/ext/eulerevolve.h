@@ -77,6 +77,13 @@ private:
   Oxs_MeshValue<OC_REAL8m> energy;
   OC_REAL8m next_timestep;
 
+  // State derived data keys
+  Oxs_DerivedDataKey max_dm_dt_key;
+  Oxs_DerivedDataKey dE_dt_key;
+  Oxs_DerivedDataKey delta_E_key;
+  Oxs_DerivedDataKey pE_pt_key;
+  Oxs_DerivedDataKey timestep_lower_bound_key;
+
   // Outputs
   void UpdateDerivedOutputs(const Oxs_SimState&);
   Oxs_ScalarOutput<Oxs_EulerEvolve> max_dm_dt_output;
@@ -130,6 +137,46 @@ private:
     }
   }
 
+  inline void Calculate_dm_dt_pack
+  (const Oxs_Mesh& mesh,
+   const Oxs_MeshValue<OC_REAL8m>& Ms,
+   const Oxs_MeshValue<ThreeVector>& mxH,
+   const Oxs_MeshValue<ThreeVector>& spin,
+   Oxs_MeshValue<ThreeVector>& dm_dt,
+   Oc_Pack& max_dm_dt_sq,
+   Oxs_Energy::SUMTYPE& dE_dt_sum,
+   const OC_REAL8m coef1,
+   const OC_REAL8m coef2,
+   const OC_INDEX i) {
+    // Same as Calculate_dm_dt_i, but for the OC_PACK_WIDTH cells
+    // starting at i.  Falls back to Calculate_dm_dt_i if any of these
+    // cells have Ms == 0.  dE_dt_sum is accumulated cell by cell, in
+    // the same order as the serial code.
+    for(int k=0;k<OC_PACK_WIDTH;++k) {
+      if(Ms[i+k]==0) {
+        OC_REAL8m tmp_max_sq = 0.0;
+        for(k=0;k<OC_PACK_WIDTH;++k) {
+          Calculate_dm_dt_i(mesh,Ms,mxH,spin,dm_dt,tmp_max_sq,dE_dt_sum,
+                            coef1,coef2,i+k);
+        }
+        max_dm_dt_sq.KeepMax(Oc_Pack(tmp_max_sq));
+        return;
+      }
+    }
+    const Oxs_ThreeVectorPack torque(&mxH[i]);
+    OC_REAL8m torque_sq[OC_PACK_WIDTH];
+    torque.MagSq().StoreUnaligned(torque_sq[0]);
+    for(int k=0;k<OC_PACK_WIDTH;++k) {
+      dE_dt_sum += torque_sq[k] * Ms[i+k] * mesh.Volume(i+k);
+    }
+    Oxs_ThreeVectorPack scratch = torque;
+    scratch ^= Oxs_ThreeVectorPack(&spin[i]);
+    scratch *= coef2;
+    scratch.Accum(coef1,torque);
+    max_dm_dt_sq.KeepMax(scratch.MagSq());
+    scratch.Store(&dm_dt[i]);
+  }
+
 
 public:
   virtual const char* ClassName() const; // ClassName() is
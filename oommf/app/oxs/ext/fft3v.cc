@@ -52,6 +52,7 @@ typedef long OC_INDEX;
 typedef unsigned long OC_UINDEX;
 typedef double OC_REAL8m;
 typedef double OC_REALWIDE;
+typedef int OC_BOOL;
 typedef std::string String;
 
 #define OXS_THROW(x,buf) throw(buf)
@@ -136,6 +137,865 @@ error "OFS_ARRAY_MAXBLOCKSIZE < OFS_ARRAY_BLOCKSIZE"
 #define TRY6 // For development purposes.  Select FFT size 8
 /// code to use in Oxs_FFTStrided class.
 
+// Mixed radix support.  If OXS_FFT_MIXED_RADIX is 0, then the
+// RecommendSize routines return power-of-two sizes only, which
+// reproduces the padding of older versions of this code.  Transforms
+// of non-power-of-two size are supported either way.
+#ifndef OXS_FFT_MIXED_RADIX
+# define OXS_FFT_MIXED_RADIX 1
+#endif
+
+// Cost of the generic mixed radix code relative to the hand-coded
+// power-of-two routines, per unit of work as computed by
+// Oxs_FFTMixedRadix::EstimateCost().  Used by the RecommendSize
+// routines to decide whether a non-power-of-two size is worthwhile.
+#ifndef OXS_FFT_MIXED_RADIX_PENALTY
+# define OXS_FFT_MIXED_RADIX_PENALTY 1.25
+#endif
+
+// Number of complex columns processed in each block by the
+// Oxs_FFTStrided mixed radix code.
+#ifndef OFS_MIXED_RADIX_BLOCKSIZE
+# define OFS_MIXED_RADIX_BLOCKSIZE 16
+#endif
+
+// Coded value for log2fftsize indicating a non-power-of-two fftsize.
+#define OXS_FFT_MIXED_LOG2SIZE -2
+
+////////////////////////////////////////////////////////////////////////
+// Class Oxs_FFTMixedRadix /////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+
+// Radix passes for the Stockham autosort transform.  Each pass takes
+// sub-transforms of length L = P*m, with the s complex values of each
+// element (bundle_size times the product of the radices of the
+// preceding passes) adjacent in memory.  Element (p + t*m) of the
+// input, t=0,...,P-1, feeds a size P butterfly whose outputs u are
+// multiplied by w^(p*u) and stored to element (P*p + u) of the output.
+// All offsets below are in real units.  SIGN is -1 for forward
+// transforms and +1 for inverse transforms.
+//
+// Twiddle factors are stored for the forward transform; the inverse
+// uses the complex conjugates, which is effected by the -SIGN factor
+// on the imaginary part.
+
+// Oc_Pack versions of the butterfly loops process OC_PACK_WIDTH/2
+// complex values at a time.  Complex values are stored as adjacent
+// (re,im) pairs, so with Oc_PackSwapPairs and a pair-wise sign pack
+// the complex multiply and multiplication by i reduce to lane-wise
+// arithmetic.  The operation order follows the scalar code, so results
+// agree to the bit.  The scalar loops handle any remainder.
+#if OC_PACK_WIDTH > 1
+static inline const Oc_Pack
+Oxs_FFTPackTimesI(const Oc_Pack& a,const Oc_Pack& negre)
+{ // Returns i*a if negre = (-1,1,-1,1,...)
+  return Oc_PackSwapPairs(a)*negre;
+}
+
+static inline void
+Oxs_FFTPackTwiddleStore(const Oc_Pack& b,const Oc_Pack& wr,
+                        const Oc_Pack& wis,OXS_FFT_REAL_TYPE* y)
+{ // Stores b*w to y, where wr = (w.re,w.re,...) and
+  // wis = (-w.im,w.im,-w.im,w.im,...)
+  (b*wr + Oc_PackSwapPairs(b)*wis).StoreUnaligned(*y);
+}
+#endif // OC_PACK_WIDTH > 1
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass2(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                       OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{
+  const OC_INDEX ts = 2*s*m; // Input stride between butterfly legs
+  const OC_INDEX us = 2*s;   // Output stride between butterfly legs
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 2*2*s*p;
+    const OXS_FFT_REAL_TYPE w1r = U[2*p];
+    const OXS_FFT_REAL_TYPE w1i = -SIGN*U[2*p+1];
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    const Oc_Pack pw1r(w1r);
+    Oc_Pack pw1i;  pw1i.SetPairs(-w1i,w1i);
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0, a1;
+      a0.LoadUnaligned(xp[j]);
+      a1.LoadUnaligned(xp[j+ts]);
+      (a0 + a1).StoreUnaligned(yp[j]);
+      Oxs_FFTPackTwiddleStore(a0 - a1,pw1r,pw1i,yp+j+us);
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j],    a0i = xp[j+1];
+      const OXS_FFT_REAL_TYPE a1r = xp[j+ts], a1i = xp[j+ts+1];
+      yp[j]   = a0r + a1r;
+      yp[j+1] = a0i + a1i;
+      const OXS_FFT_REAL_TYPE b1r = a0r - a1r;
+      const OXS_FFT_REAL_TYPE b1i = a0i - a1i;
+      yp[j+us]   = b1r*w1r - b1i*w1i;
+      yp[j+us+1] = b1r*w1i + b1i*w1r;
+    }
+  }
+}
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass3(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                       OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{
+  const OXS_FFT_REAL_TYPE c3 = -0.5;
+  const OXS_FFT_REAL_TYPE s3
+    = SIGN*OXS_FFT_REAL_TYPE(0.8660254037844386467637231707529361834714L);
+  const OC_INDEX ts = 2*s*m;
+  const OC_INDEX us = 2*s;
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 3*2*s*p;
+    const OXS_FFT_REAL_TYPE* const Up = U + 2*2*p;
+    const OXS_FFT_REAL_TYPE w1r = Up[0], w1i = -SIGN*Up[1];
+    const OXS_FFT_REAL_TYPE w2r = Up[2], w2i = -SIGN*Up[3];
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    Oc_Pack negre;  negre.SetPairs(-1.0,1.0);
+    const Oc_Pack pw1r(w1r);
+    Oc_Pack pw1i;  pw1i.SetPairs(-w1i,w1i);
+    const Oc_Pack pw2r(w2r);
+    Oc_Pack pw2i;  pw2i.SetPairs(-w2i,w2i);
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0, a1, a2;
+      a0.LoadUnaligned(xp[j]);
+      a1.LoadUnaligned(xp[j+ts]);
+      a2.LoadUnaligned(xp[j+2*ts]);
+      const Oc_Pack t1 = a1 + a2;
+      const Oc_Pack t2 = a0 + c3*t1;
+      const Oc_Pack it3 = Oxs_FFTPackTimesI(s3*(a1 - a2),negre);
+      (a0 + t1).StoreUnaligned(yp[j]);
+      Oxs_FFTPackTwiddleStore(t2 + it3,pw1r,pw1i,yp+j+us);
+      Oxs_FFTPackTwiddleStore(t2 - it3,pw2r,pw2i,yp+j+2*us);
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j],      a0i = xp[j+1];
+      const OXS_FFT_REAL_TYPE a1r = xp[j+ts],   a1i = xp[j+ts+1];
+      const OXS_FFT_REAL_TYPE a2r = xp[j+2*ts], a2i = xp[j+2*ts+1];
+      const OXS_FFT_REAL_TYPE t1r = a1r + a2r, t1i = a1i + a2i;
+      const OXS_FFT_REAL_TYPE t2r = a0r + c3*t1r, t2i = a0i + c3*t1i;
+      const OXS_FFT_REAL_TYPE t3r = s3*(a1r - a2r), t3i = s3*(a1i - a2i);
+      yp[j]   = a0r + t1r;
+      yp[j+1] = a0i + t1i;
+      const OXS_FFT_REAL_TYPE b1r = t2r - t3i, b1i = t2i + t3r;
+      const OXS_FFT_REAL_TYPE b2r = t2r + t3i, b2i = t2i - t3r;
+      yp[j+us]     = b1r*w1r - b1i*w1i;
+      yp[j+us+1]   = b1r*w1i + b1i*w1r;
+      yp[j+2*us]   = b2r*w2r - b2i*w2i;
+      yp[j+2*us+1] = b2r*w2i + b2i*w2r;
+    }
+  }
+}
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass4(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                       OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{
+  const OC_INDEX ts = 2*s*m;
+  const OC_INDEX us = 2*s;
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 4*2*s*p;
+    const OXS_FFT_REAL_TYPE* const Up = U + 3*2*p;
+    const OXS_FFT_REAL_TYPE w1r = Up[0], w1i = -SIGN*Up[1];
+    const OXS_FFT_REAL_TYPE w2r = Up[2], w2i = -SIGN*Up[3];
+    const OXS_FFT_REAL_TYPE w3r = Up[4], w3i = -SIGN*Up[5];
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    Oc_Pack signi;  signi.SetPairs(-SIGN,SIGN);
+    const Oc_Pack pw1r(w1r);
+    Oc_Pack pw1i;  pw1i.SetPairs(-w1i,w1i);
+    const Oc_Pack pw2r(w2r);
+    Oc_Pack pw2i;  pw2i.SetPairs(-w2i,w2i);
+    const Oc_Pack pw3r(w3r);
+    Oc_Pack pw3i;  pw3i.SetPairs(-w3i,w3i);
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0, a1, a2, a3;
+      a0.LoadUnaligned(xp[j]);
+      a1.LoadUnaligned(xp[j+ts]);
+      a2.LoadUnaligned(xp[j+2*ts]);
+      a3.LoadUnaligned(xp[j+3*ts]);
+      const Oc_Pack t0 = a0 + a2;
+      const Oc_Pack t1 = a0 - a2;
+      const Oc_Pack t2 = a1 + a3;
+      const Oc_Pack t3 = Oxs_FFTPackTimesI(a1 - a3,signi); // SIGN*i*(a1-a3)
+      (t0 + t2).StoreUnaligned(yp[j]);
+      Oxs_FFTPackTwiddleStore(t1 + t3,pw1r,pw1i,yp+j+us);
+      Oxs_FFTPackTwiddleStore(t0 - t2,pw2r,pw2i,yp+j+2*us);
+      Oxs_FFTPackTwiddleStore(t1 - t3,pw3r,pw3i,yp+j+3*us);
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j],      a0i = xp[j+1];
+      const OXS_FFT_REAL_TYPE a1r = xp[j+ts],   a1i = xp[j+ts+1];
+      const OXS_FFT_REAL_TYPE a2r = xp[j+2*ts], a2i = xp[j+2*ts+1];
+      const OXS_FFT_REAL_TYPE a3r = xp[j+3*ts], a3i = xp[j+3*ts+1];
+      const OXS_FFT_REAL_TYPE t0r = a0r + a2r, t0i = a0i + a2i;
+      const OXS_FFT_REAL_TYPE t1r = a0r - a2r, t1i = a0i - a2i;
+      const OXS_FFT_REAL_TYPE t2r = a1r + a3r, t2i = a1i + a3i;
+      // t3 = SIGN*i*(a1-a3)
+      const OXS_FFT_REAL_TYPE t3r = -SIGN*(a1i - a3i);
+      const OXS_FFT_REAL_TYPE t3i =  SIGN*(a1r - a3r);
+      yp[j]   = t0r + t2r;
+      yp[j+1] = t0i + t2i;
+      const OXS_FFT_REAL_TYPE b1r = t1r + t3r, b1i = t1i + t3i;
+      const OXS_FFT_REAL_TYPE b2r = t0r - t2r, b2i = t0i - t2i;
+      const OXS_FFT_REAL_TYPE b3r = t1r - t3r, b3i = t1i - t3i;
+      yp[j+us]     = b1r*w1r - b1i*w1i;
+      yp[j+us+1]   = b1r*w1i + b1i*w1r;
+      yp[j+2*us]   = b2r*w2r - b2i*w2i;
+      yp[j+2*us+1] = b2r*w2i + b2i*w2r;
+      yp[j+3*us]   = b3r*w3r - b3i*w3i;
+      yp[j+3*us+1] = b3r*w3i + b3i*w3r;
+    }
+  }
+}
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass5(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                       OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{ // c# = cos(2.pi.#/5), s# = SIGN*sin(2.pi.#/5)
+  const OXS_FFT_REAL_TYPE c1
+    = OXS_FFT_REAL_TYPE(0.3090169943749474241022934171828190588602L);
+  const OXS_FFT_REAL_TYPE c2
+    = OXS_FFT_REAL_TYPE(-0.8090169943749474241022934171828190588602L);
+  const OXS_FFT_REAL_TYPE s1
+    = SIGN*OXS_FFT_REAL_TYPE(0.9510565162951535721164393333793821434057L);
+  const OXS_FFT_REAL_TYPE s2
+    = SIGN*OXS_FFT_REAL_TYPE(0.5877852522924731291687059546390727685977L);
+  const OC_INDEX ts = 2*s*m;
+  const OC_INDEX us = 2*s;
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 5*2*s*p;
+    const OXS_FFT_REAL_TYPE* const Up = U + 4*2*p;
+    const OXS_FFT_REAL_TYPE w1r = Up[0], w1i = -SIGN*Up[1];
+    const OXS_FFT_REAL_TYPE w2r = Up[2], w2i = -SIGN*Up[3];
+    const OXS_FFT_REAL_TYPE w3r = Up[4], w3i = -SIGN*Up[5];
+    const OXS_FFT_REAL_TYPE w4r = Up[6], w4i = -SIGN*Up[7];
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    Oc_Pack negre;  negre.SetPairs(-1.0,1.0);
+    const Oc_Pack pw1r(w1r);
+    Oc_Pack pw1i;  pw1i.SetPairs(-w1i,w1i);
+    const Oc_Pack pw2r(w2r);
+    Oc_Pack pw2i;  pw2i.SetPairs(-w2i,w2i);
+    const Oc_Pack pw3r(w3r);
+    Oc_Pack pw3i;  pw3i.SetPairs(-w3i,w3i);
+    const Oc_Pack pw4r(w4r);
+    Oc_Pack pw4i;  pw4i.SetPairs(-w4i,w4i);
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0, a1, a2, a3, a4;
+      a0.LoadUnaligned(xp[j]);
+      a1.LoadUnaligned(xp[j+ts]);
+      a2.LoadUnaligned(xp[j+2*ts]);
+      a3.LoadUnaligned(xp[j+3*ts]);
+      a4.LoadUnaligned(xp[j+4*ts]);
+      const Oc_Pack p1 = a1 + a4, m1 = a1 - a4;
+      const Oc_Pack p2 = a2 + a3, m2 = a2 - a3;
+      const Oc_Pack r1 = a0 + c1*p1 + c2*p2;
+      const Oc_Pack r2 = a0 + c2*p1 + c1*p2;
+      const Oc_Pack iq1 = Oxs_FFTPackTimesI(s1*m1 + s2*m2,negre);
+      const Oc_Pack iq2 = Oxs_FFTPackTimesI(s2*m1 - s1*m2,negre);
+      (a0 + p1 + p2).StoreUnaligned(yp[j]);
+      Oxs_FFTPackTwiddleStore(r1 + iq1,pw1r,pw1i,yp+j+us);
+      Oxs_FFTPackTwiddleStore(r2 + iq2,pw2r,pw2i,yp+j+2*us);
+      Oxs_FFTPackTwiddleStore(r2 - iq2,pw3r,pw3i,yp+j+3*us);
+      Oxs_FFTPackTwiddleStore(r1 - iq1,pw4r,pw4i,yp+j+4*us);
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j],      a0i = xp[j+1];
+      const OXS_FFT_REAL_TYPE a1r = xp[j+ts],   a1i = xp[j+ts+1];
+      const OXS_FFT_REAL_TYPE a2r = xp[j+2*ts], a2i = xp[j+2*ts+1];
+      const OXS_FFT_REAL_TYPE a3r = xp[j+3*ts], a3i = xp[j+3*ts+1];
+      const OXS_FFT_REAL_TYPE a4r = xp[j+4*ts], a4i = xp[j+4*ts+1];
+      const OXS_FFT_REAL_TYPE p1r = a1r + a4r, p1i = a1i + a4i;
+      const OXS_FFT_REAL_TYPE m1r = a1r - a4r, m1i = a1i - a4i;
+      const OXS_FFT_REAL_TYPE p2r = a2r + a3r, p2i = a2i + a3i;
+      const OXS_FFT_REAL_TYPE m2r = a2r - a3r, m2i = a2i - a3i;
+      const OXS_FFT_REAL_TYPE r1r = a0r + c1*p1r + c2*p2r;
+      const OXS_FFT_REAL_TYPE r1i = a0i + c1*p1i + c2*p2i;
+      const OXS_FFT_REAL_TYPE r2r = a0r + c2*p1r + c1*p2r;
+      const OXS_FFT_REAL_TYPE r2i = a0i + c2*p1i + c1*p2i;
+      const OXS_FFT_REAL_TYPE q1r = s1*m1r + s2*m2r;
+      const OXS_FFT_REAL_TYPE q1i = s1*m1i + s2*m2i;
+      const OXS_FFT_REAL_TYPE q2r = s2*m1r - s1*m2r;
+      const OXS_FFT_REAL_TYPE q2i = s2*m1i - s1*m2i;
+      yp[j]   = a0r + p1r + p2r;
+      yp[j+1] = a0i + p1i + p2i;
+      // b1 = r1 + i*q1, b4 = r1 - i*q1, b2 = r2 + i*q2, b3 = r2 - i*q2
+      const OXS_FFT_REAL_TYPE b1r = r1r - q1i, b1i = r1i + q1r;
+      const OXS_FFT_REAL_TYPE b4r = r1r + q1i, b4i = r1i - q1r;
+      const OXS_FFT_REAL_TYPE b2r = r2r - q2i, b2i = r2i + q2r;
+      const OXS_FFT_REAL_TYPE b3r = r2r + q2i, b3i = r2i - q2r;
+      yp[j+us]     = b1r*w1r - b1i*w1i;
+      yp[j+us+1]   = b1r*w1i + b1i*w1r;
+      yp[j+2*us]   = b2r*w2r - b2i*w2i;
+      yp[j+2*us+1] = b2r*w2i + b2i*w2r;
+      yp[j+3*us]   = b3r*w3r - b3i*w3i;
+      yp[j+3*us+1] = b3r*w3i + b3i*w3r;
+      yp[j+4*us]   = b4r*w4r - b4i*w4i;
+      yp[j+4*us+1] = b4r*w4i + b4i*w4r;
+    }
+  }
+}
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass7(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                       OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{ // c# = cos(2.pi.#/7), s# = SIGN*sin(2.pi.#/7)
+  const OXS_FFT_REAL_TYPE c1
+    = OXS_FFT_REAL_TYPE(0.6234898018587335305250048840042398106323L);
+  const OXS_FFT_REAL_TYPE c2
+    = OXS_FFT_REAL_TYPE(-0.2225209339563144042889025644967947594664L);
+  const OXS_FFT_REAL_TYPE c3
+    = OXS_FFT_REAL_TYPE(-0.9009688679024191262361023195074450511659L);
+  const OXS_FFT_REAL_TYPE s1
+    = SIGN*OXS_FFT_REAL_TYPE(0.7818314824680298087084445266740577502323L);
+  const OXS_FFT_REAL_TYPE s2
+    = SIGN*OXS_FFT_REAL_TYPE(0.9749279121818236070181316829939312172327L);
+  const OXS_FFT_REAL_TYPE s3
+    = SIGN*OXS_FFT_REAL_TYPE(0.4338837391175581204757683328483587546099L);
+  const OC_INDEX ts = 2*s*m;
+  const OC_INDEX us = 2*s;
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 7*2*s*p;
+    const OXS_FFT_REAL_TYPE* const Up = U + 6*2*p;
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    Oc_Pack negre;  negre.SetPairs(-1.0,1.0);
+    Oc_Pack pwr[6], pwi[6];
+    for(int u=0;u<6;++u) {
+      const OXS_FFT_REAL_TYPE wi = -SIGN*Up[2*u+1];
+      pwr[u].Set(Up[2*u]);
+      pwi[u].SetPairs(-wi,wi);
+    }
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0, ap, am;
+      a0.LoadUnaligned(xp[j]);
+      Oc_Pack p[3], mm[3];
+      for(int u=1;u<=3;++u) {
+        ap.LoadUnaligned(xp[j+u*ts]);
+        am.LoadUnaligned(xp[j+(7-u)*ts]);
+        p[u-1] = ap + am;
+        mm[u-1] = ap - am;
+      }
+      (a0 + p[0] + p[1] + p[2]).StoreUnaligned(yp[j]);
+      Oc_Pack r[3], iq[3];
+      r[0] = a0 + c1*p[0] + c2*p[1] + c3*p[2];
+      iq[0] = Oxs_FFTPackTimesI(s1*mm[0] + s2*mm[1] + s3*mm[2],negre);
+      r[1] = a0 + c2*p[0] + c3*p[1] + c1*p[2];
+      iq[1] = Oxs_FFTPackTimesI(s2*mm[0] - s3*mm[1] - s1*mm[2],negre);
+      r[2] = a0 + c3*p[0] + c1*p[1] + c2*p[2];
+      iq[2] = Oxs_FFTPackTimesI(s3*mm[0] - s1*mm[1] + s2*mm[2],negre);
+      for(int u=1;u<=3;++u) {
+        Oxs_FFTPackTwiddleStore(r[u-1] + iq[u-1],pwr[u-1],pwi[u-1],
+                                yp+j+u*us);
+        Oxs_FFTPackTwiddleStore(r[u-1] - iq[u-1],pwr[6-u],pwi[6-u],
+                                yp+j+(7-u)*us);
+      }
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j],      a0i = xp[j+1];
+      const OXS_FFT_REAL_TYPE p1r = xp[j+ts]   + xp[j+6*ts];
+      const OXS_FFT_REAL_TYPE p1i = xp[j+ts+1] + xp[j+6*ts+1];
+      const OXS_FFT_REAL_TYPE m1r = xp[j+ts]   - xp[j+6*ts];
+      const OXS_FFT_REAL_TYPE m1i = xp[j+ts+1] - xp[j+6*ts+1];
+      const OXS_FFT_REAL_TYPE p2r = xp[j+2*ts]   + xp[j+5*ts];
+      const OXS_FFT_REAL_TYPE p2i = xp[j+2*ts+1] + xp[j+5*ts+1];
+      const OXS_FFT_REAL_TYPE m2r = xp[j+2*ts]   - xp[j+5*ts];
+      const OXS_FFT_REAL_TYPE m2i = xp[j+2*ts+1] - xp[j+5*ts+1];
+      const OXS_FFT_REAL_TYPE p3r = xp[j+3*ts]   + xp[j+4*ts];
+      const OXS_FFT_REAL_TYPE p3i = xp[j+3*ts+1] + xp[j+4*ts+1];
+      const OXS_FFT_REAL_TYPE m3r = xp[j+3*ts]   - xp[j+4*ts];
+      const OXS_FFT_REAL_TYPE m3i = xp[j+3*ts+1] - xp[j+4*ts+1];
+      yp[j]   = a0r + p1r + p2r + p3r;
+      yp[j+1] = a0i + p1i + p2i + p3i;
+      // Output pairs (u,7-u) share the r# and q# terms:
+      //   b_u = r_u + i*q_u,  b_(7-u) = r_u - i*q_u.
+      OXS_FFT_REAL_TYPE rr[3],ri[3],qr[3],qi[3];
+      rr[0] = a0r + c1*p1r + c2*p2r + c3*p3r;
+      ri[0] = a0i + c1*p1i + c2*p2i + c3*p3i;
+      qr[0] = s1*m1r + s2*m2r + s3*m3r;
+      qi[0] = s1*m1i + s2*m2i + s3*m3i;
+      rr[1] = a0r + c2*p1r + c3*p2r + c1*p3r;
+      ri[1] = a0i + c2*p1i + c3*p2i + c1*p3i;
+      qr[1] = s2*m1r - s3*m2r - s1*m3r;
+      qi[1] = s2*m1i - s3*m2i - s1*m3i;
+      rr[2] = a0r + c3*p1r + c1*p2r + c2*p3r;
+      ri[2] = a0i + c3*p1i + c1*p2i + c2*p3i;
+      qr[2] = s3*m1r - s1*m2r + s2*m3r;
+      qi[2] = s3*m1i - s1*m2i + s2*m3i;
+      for(int u=1;u<=3;++u) {
+        const OXS_FFT_REAL_TYPE bar = rr[u-1] - qi[u-1];
+        const OXS_FFT_REAL_TYPE bai = ri[u-1] + qr[u-1];
+        const OXS_FFT_REAL_TYPE bbr = rr[u-1] + qi[u-1];
+        const OXS_FFT_REAL_TYPE bbi = ri[u-1] - qr[u-1];
+        const OXS_FFT_REAL_TYPE war = Up[2*(u-1)];
+        const OXS_FFT_REAL_TYPE wai = -SIGN*Up[2*(u-1)+1];
+        const OXS_FFT_REAL_TYPE wbr = Up[2*(6-u)];
+        const OXS_FFT_REAL_TYPE wbi = -SIGN*Up[2*(6-u)+1];
+        yp[j+u*us]       = bar*war - bai*wai;
+        yp[j+u*us+1]     = bar*wai + bai*war;
+        yp[j+(7-u)*us]   = bbr*wbr - bbi*wbi;
+        yp[j+(7-u)*us+1] = bbr*wbi + bbi*wbr;
+      }
+    }
+  }
+}
+
+// Pruned passes for zero-padded transforms.  With padding to at least
+// twice the data length, the input to a forward transform is zero in
+// the upper half, and only the lower half of the output of an inverse
+// transform is used.  The factorization in SetSize puts radix 4 and 2
+// passes first, so for even sizes the first pass of a padded forward
+// transform has only the low legs nonzero: legs 2 and 3 of a radix 4
+// pass (Oxs_FFTMixedRadixPass4ZP), or leg 1 of a radix 2 pass
+// (Oxs_FFTMixedRadixPass2ZP).  The odd radices come last, and the last
+// pass has m=1, so it has no twiddles and its output u lands in rows
+// u*(n/P) through (u+1)*(n/P)-1 of the result.  The inverse transform
+// skips the outputs u that lie wholly in the discarded upper rows
+// (Oxs_FFTMixedRadixLastPassZP).
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass2ZP(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                         OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{ // Radix 2 pass with leg 1 zero.
+  const OC_INDEX us = 2*s;
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 2*2*s*p;
+    const OXS_FFT_REAL_TYPE w1r = U[2*p];
+    const OXS_FFT_REAL_TYPE w1i = -SIGN*U[2*p+1];
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    const Oc_Pack pw1r(w1r);
+    Oc_Pack pw1i;  pw1i.SetPairs(-w1i,w1i);
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0;
+      a0.LoadUnaligned(xp[j]);
+      a0.StoreUnaligned(yp[j]);
+      Oxs_FFTPackTwiddleStore(a0,pw1r,pw1i,yp+j+us);
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j], a0i = xp[j+1];
+      yp[j]      = a0r;
+      yp[j+1]    = a0i;
+      yp[j+us]   = a0r*w1r - a0i*w1i;
+      yp[j+us+1] = a0r*w1i + a0i*w1r;
+    }
+  }
+}
+
+template<int SIGN>
+static void
+Oxs_FFTMixedRadixPass4ZP(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                         OC_INDEX m,OC_INDEX s,const OXS_FFT_REAL_TYPE* U)
+{ // Radix 4 pass with legs 2 and 3 zero.
+  const OC_INDEX ts = 2*s*m;
+  const OC_INDEX us = 2*s;
+  for(OC_INDEX p=0;p<m;++p) {
+    const OXS_FFT_REAL_TYPE* const xp = x + 2*s*p;
+    OXS_FFT_REAL_TYPE* const yp = y + 4*2*s*p;
+    const OXS_FFT_REAL_TYPE* const Up = U + 3*2*p;
+    const OXS_FFT_REAL_TYPE w1r = Up[0], w1i = -SIGN*Up[1];
+    const OXS_FFT_REAL_TYPE w2r = Up[2], w2i = -SIGN*Up[3];
+    const OXS_FFT_REAL_TYPE w3r = Up[4], w3i = -SIGN*Up[5];
+    OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+    Oc_Pack signi;  signi.SetPairs(-SIGN,SIGN);
+    const Oc_Pack pw1r(w1r);
+    Oc_Pack pw1i;  pw1i.SetPairs(-w1i,w1i);
+    const Oc_Pack pw2r(w2r);
+    Oc_Pack pw2i;  pw2i.SetPairs(-w2i,w2i);
+    const Oc_Pack pw3r(w3r);
+    Oc_Pack pw3i;  pw3i.SetPairs(-w3i,w3i);
+    for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+      Oc_Pack a0, a1;
+      a0.LoadUnaligned(xp[j]);
+      a1.LoadUnaligned(xp[j+ts]);
+      const Oc_Pack t3 = Oxs_FFTPackTimesI(a1,signi); // SIGN*i*a1
+      (a0 + a1).StoreUnaligned(yp[j]);
+      Oxs_FFTPackTwiddleStore(a0 + t3,pw1r,pw1i,yp+j+us);
+      Oxs_FFTPackTwiddleStore(a0 - a1,pw2r,pw2i,yp+j+2*us);
+      Oxs_FFTPackTwiddleStore(a0 - t3,pw3r,pw3i,yp+j+3*us);
+    }
+#endif // OC_PACK_WIDTH > 1
+    for(;j<2*s;j+=2) {
+      const OXS_FFT_REAL_TYPE a0r = xp[j],    a0i = xp[j+1];
+      const OXS_FFT_REAL_TYPE a1r = xp[j+ts], a1i = xp[j+ts+1];
+      // t3 = SIGN*i*a1
+      const OXS_FFT_REAL_TYPE t3r = -SIGN*a1i;
+      const OXS_FFT_REAL_TYPE t3i =  SIGN*a1r;
+      yp[j]   = a0r + a1r;
+      yp[j+1] = a0i + a1i;
+      const OXS_FFT_REAL_TYPE b1r = a0r + t3r, b1i = a0i + t3i;
+      const OXS_FFT_REAL_TYPE b2r = a0r - a1r, b2i = a0i - a1i;
+      const OXS_FFT_REAL_TYPE b3r = a0r - t3r, b3i = a0i - t3i;
+      yp[j+us]     = b1r*w1r - b1i*w1i;
+      yp[j+us+1]   = b1r*w1i + b1i*w1r;
+      yp[j+2*us]   = b2r*w2r - b2i*w2i;
+      yp[j+2*us+1] = b2r*w2i + b2i*w2r;
+      yp[j+3*us]   = b3r*w3r - b3i*w3i;
+      yp[j+3*us+1] = b3r*w3i + b3i*w3r;
+    }
+  }
+}
+
+template<int SIGN,int P>
+static void
+Oxs_FFTMixedRadixLastPassZP(const OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+                            OC_INDEX s,int ucount)
+{ // Last pass (m=1) of odd radix P, computing outputs u<ucount only.
+  // As in Oxs_FFTMixedRadixPass5 and Pass7, with p_t = a_t + a_(P-t)
+  // and m_t = a_t - a_(P-t) for t=1,...,(P-1)/2,
+  //
+  //    r_u = a0 + sum_t cos(2.pi.t.u/P)*p_t,
+  //    q_u = sum_t SIGN*sin(2.pi.t.u/P)*m_t,
+  //    b_u = r_u + i*q_u,  b_(P-u) = r_u - i*q_u.
+  enum { H = (P-1)/2 };
+  OXS_FFT_REAL_TYPE c[H+1][H+1], sn[H+1][H+1]; // Indexed [u][t]
+  for(int u=1;u<=H;++u) {
+    for(int t=1;t<=H;++t) {
+      const OC_REALWIDE theta
+        = 2*WIDE_PI*static_cast<OC_REALWIDE>((t*u)%P)/OC_REALWIDE(P);
+      c[u][t]  = static_cast<OXS_FFT_REAL_TYPE>(cos(theta));
+      sn[u][t] = SIGN*static_cast<OXS_FFT_REAL_TYPE>(sin(theta));
+    }
+  }
+  const OC_INDEX ts = 2*s;
+  const OC_INDEX us = 2*s;
+  OC_INDEX j=0;
+#if OC_PACK_WIDTH > 1
+  Oc_Pack negre;  negre.SetPairs(-1.0,1.0);
+  for(;j+OC_PACK_WIDTH<=2*s;j+=OC_PACK_WIDTH) {
+    Oc_Pack a0, ap, am;
+    a0.LoadUnaligned(x[j]);
+    Oc_Pack pp[H+1], mm[H+1];
+    Oc_Pack sum = a0;
+    for(int t=1;t<=H;++t) {
+      ap.LoadUnaligned(x[j+t*ts]);
+      am.LoadUnaligned(x[j+(P-t)*ts]);
+      pp[t] = ap + am;
+      mm[t] = ap - am;
+      sum += pp[t];
+    }
+    sum.StoreUnaligned(y[j]);
+    for(int u=1;u<=H && u<ucount;++u) {
+      Oc_Pack r = a0 + c[u][1]*pp[1];
+      Oc_Pack q = sn[u][1]*mm[1];
+      for(int t=2;t<=H;++t) {
+        r += c[u][t]*pp[t];
+        q += sn[u][t]*mm[t];
+      }
+      const Oc_Pack iq = Oxs_FFTPackTimesI(q,negre);
+      (r + iq).StoreUnaligned(y[j+u*us]);
+      if(P-u<ucount) (r - iq).StoreUnaligned(y[j+(P-u)*us]);
+    }
+  }
+#endif // OC_PACK_WIDTH > 1
+  for(;j<2*s;j+=2) {
+    const OXS_FFT_REAL_TYPE a0r = x[j], a0i = x[j+1];
+    OXS_FFT_REAL_TYPE pr[H+1],pi[H+1],mr[H+1],mi[H+1];
+    OXS_FFT_REAL_TYPE sumr = a0r, sumi = a0i;
+    for(int t=1;t<=H;++t) {
+      pr[t] = x[j+t*ts]   + x[j+(P-t)*ts];
+      pi[t] = x[j+t*ts+1] + x[j+(P-t)*ts+1];
+      mr[t] = x[j+t*ts]   - x[j+(P-t)*ts];
+      mi[t] = x[j+t*ts+1] - x[j+(P-t)*ts+1];
+      sumr += pr[t];
+      sumi += pi[t];
+    }
+    y[j]   = sumr;
+    y[j+1] = sumi;
+    for(int u=1;u<=H && u<ucount;++u) {
+      OXS_FFT_REAL_TYPE rr = a0r, ri = a0i, qr = 0.0, qi = 0.0;
+      for(int t=1;t<=H;++t) {
+        rr += c[u][t]*pr[t];   ri += c[u][t]*pi[t];
+        qr += sn[u][t]*mr[t];  qi += sn[u][t]*mi[t];
+      }
+      y[j+u*us]   = rr - qi;
+      y[j+u*us+1] = ri + qr;
+      if(P-u<ucount) {
+        y[j+(P-u)*us]   = rr + qi;
+        y[j+(P-u)*us+1] = ri - qr;
+      }
+    }
+  }
+}
+
+Oxs_FFTMixedRadix::Oxs_FFTMixedRadix()
+  : fftsize(0), factor_count(0), roots_size(0), roots(0)
+{}
+
+Oxs_FFTMixedRadix::Oxs_FFTMixedRadix(const Oxs_FFTMixedRadix& other)
+  : fftsize(0), factor_count(0), roots_size(0), roots(0)
+{
+  Dup(other);
+}
+
+Oxs_FFTMixedRadix&
+Oxs_FFTMixedRadix::operator=(const Oxs_FFTMixedRadix& other)
+{
+  if(this != &other) Dup(other);
+  return *this;
+}
+
+Oxs_FFTMixedRadix::~Oxs_FFTMixedRadix()
+{
+  FreeMemory();
+}
+
+void Oxs_FFTMixedRadix::FreeMemory()
+{
+  if(roots) delete[] roots;
+  roots = 0;
+  roots_size = 0;
+  fftsize = 0;
+  factor_count = 0;
+}
+
+void Oxs_FFTMixedRadix::Dup(const Oxs_FFTMixedRadix& other)
+{
+  FreeMemory();
+  fftsize = other.fftsize;
+  factor_count = other.factor_count;
+  for(int i=0;i<factor_count;++i) factor[i] = other.factor[i];
+  if(other.roots != 0 && other.roots_size>0) {
+    roots_size = other.roots_size;
+    roots = new OXS_FFT_REAL_TYPE[roots_size];
+    for(OC_INDEX i=0;i<roots_size;++i) roots[i] = other.roots[i];
+  }
+}
+
+OC_BOOL Oxs_FFTMixedRadix::IsPowerOfTwo(OC_INDEX n)
+{
+  return (n>0 && (n & (n-1)) == 0);
+}
+
+OC_BOOL Oxs_FFTMixedRadix::IsSupportedSize(OC_INDEX n)
+{
+  if(n<1) return 0;
+  static const OC_INDEX primes[] = { 2, 3, 5, 7 };
+  for(size_t i=0;i<sizeof(primes)/sizeof(primes[0]);++i) {
+    while(n%primes[i]==0) n /= primes[i];
+  }
+  return (n==1);
+}
+
+double Oxs_FFTMixedRadix::EstimateCost(OC_INDEX n)
+{ // The weights are roughly the number of radix-2 passes equivalent
+  // to one pass of each radix, based on floating point operation
+  // counts per point.  The power-of-two routines are hand coded and
+  // do not need the copy-in/copy-out of the mixed radix code, so
+  // non-power-of-two sizes are additionally charged the
+  // OXS_FFT_MIXED_RADIX_PENALTY factor.
+  if(n<2) return 0.0;
+  const double dn = static_cast<double>(n);
+  if(IsPowerOfTwo(n)) {
+    return dn*log(dn)/log(2.0);
+  }
+  double work = 0.0;
+  while(n%4==0) { work += 1.7; n /= 4; }
+  while(n%2==0) { work += 1.0; n /= 2; }
+  while(n%3==0) { work += 1.7; n /= 3; }
+  while(n%5==0) { work += 2.6; n /= 5; }
+  while(n%7==0) { work += 3.3; n /= 7; }
+  return OXS_FFT_MIXED_RADIX_PENALTY*dn*work;
+}
+
+OC_INDEX Oxs_FFTMixedRadix::RecommendSize(OC_INDEX minsize,OC_INDEX multiple)
+{
+  if(multiple<1 || !IsPowerOfTwo(multiple)) {
+    OXS_THROW(Oxs_BadParameter,
+              "Illegal multiple import to Oxs_FFTMixedRadix::RecommendSize().");
+  }
+  if(minsize<1) minsize = 1;
+
+  // Smallest power-of-two >= minsize that is a multiple of multiple.
+  OC_INDEX pow2size = multiple;
+  while(pow2size<minsize) {
+    pow2size *= 2;
+    if(pow2size<1) {
+      char msgbuf[1024];
+      Oc_Snprintf(msgbuf,sizeof(msgbuf),
+                  ": Import minsize=%ld too big",
+                  static_cast<long int>(minsize));
+      String msg =
+        String("OC_INDEX overflow in Oxs_FFTMixedRadix::RecommendSize")
+        + String(msgbuf);
+      OXS_THROW(Oxs_BadParameter,msg);
+    }
+  }
+
+#if OXS_FFT_MIXED_RADIX
+  OC_INDEX bestsize = pow2size;
+  double bestcost = EstimateCost(pow2size);
+  OC_INDEX n = ((minsize + multiple - 1)/multiple)*multiple;
+  for(;n<pow2size;n+=multiple) {
+    if(!IsSupportedSize(n)) continue;
+    const double cost = EstimateCost(n);
+    if(cost<bestcost) {
+      bestcost = cost;
+      bestsize = n;
+    }
+  }
+  return bestsize;
+#else
+  return pow2size;
+#endif
+}
+
+void Oxs_FFTMixedRadix::SetSize(OC_INDEX size)
+{
+  FreeMemory();
+  if(size==0) return;
+  if(!IsSupportedSize(size)) {
+    char msgbuf[1024];
+    Oc_Snprintf(msgbuf,sizeof(msgbuf),
+                "Illegal size import to Oxs_FFTMixedRadix::SetSize(): %ld;"
+                " only prime factors 2, 3, 5 and 7 are supported.",
+                static_cast<long int>(size));
+    OXS_THROW(Oxs_BadParameter,msgbuf);
+  }
+  fftsize = size;
+
+  // Factor.  Radix 4 passes first, then a possible single radix 2
+  // pass, followed by the odd radices.
+  OC_INDEX n = size;
+  factor_count = 0;
+  while(n%4==0) { factor[factor_count++] = 4; n /= 4; }
+  while(n%2==0) { factor[factor_count++] = 2; n /= 2; }
+  while(n%3==0) { factor[factor_count++] = 3; n /= 3; }
+  while(n%5==0) { factor[factor_count++] = 5; n /= 5; }
+  while(n%7==0) { factor[factor_count++] = 7; n /= 7; }
+  assert(n==1 && factor_count<=MAXFACTORS);
+
+  // Twiddle factors.  Angles are computed from the reduced integer
+  // index (p*u mod L) to retain full accuracy for large L.
+  roots_size = 0;
+  n = size;
+  for(int f=0;f<factor_count;++f) {
+    OC_INDEX m = n/factor[f];
+    roots_size += 2*(factor[f]-1)*m;
+    n = m;
+  }
+  roots = new OXS_FFT_REAL_TYPE[roots_size > 0 ? roots_size : 1];
+  OC_INDEX offset = 0;
+  n = size;
+  for(int f=0;f<factor_count;++f) {
+    const int P = factor[f];
+    const OC_INDEX m = n/P;
+    const OC_REALWIDE theta_base = -2*WIDE_PI/static_cast<OC_REALWIDE>(n);
+    for(OC_INDEX p=0;p<m;++p) {
+      for(int u=1;u<P;++u) {
+        const OC_INDEX k = (p*u) % n;
+        const OC_REALWIDE theta = theta_base*static_cast<OC_REALWIDE>(k);
+        roots[offset++] = static_cast<OXS_FFT_REAL_TYPE>(cos(theta));
+        roots[offset++] = static_cast<OXS_FFT_REAL_TYPE>(sin(theta));
+      }
+    }
+    n = m;
+  }
+  assert(offset == roots_size);
+}
+
+template<int SIGN> OXS_FFT_REAL_TYPE*
+Oxs_FFTMixedRadix::Transform
+(OXS_FFT_REAL_TYPE* x,
+ OXS_FFT_REAL_TYPE* y,
+ OC_INDEX bundle_size,
+ OC_INDEX input_size,
+ OC_INDEX output_size) const
+{
+  OC_INDEX n = fftsize;
+  OC_INDEX s = bundle_size;
+  const OXS_FFT_REAL_TYPE* U = roots;
+  for(int f=0;f<factor_count;++f) {
+    const int P = factor[f];
+    const OC_INDEX m = n/P;
+    OC_BOOL pruned = 0;
+    if(f==0 && input_size<fftsize) {
+      // Zero padding.  Legs t>=nzlegs of the first pass are entirely
+      // zero.  The pruned passes read the lower P/2 legs, and any
+      // rows there at or above input_size are filled explicitly.
+      const OC_INDEX nzlegs = (input_size + m - 1)/m;
+      if((P==4 && nzlegs<=2) || (P==2 && nzlegs<=1)) {
+        for(OC_INDEX i=2*s*input_size;i<2*s*(P/2)*m;++i) x[i] = 0.0;
+        if(P==4) Oxs_FFTMixedRadixPass4ZP<SIGN>(x,y,m,s,U);
+        else     Oxs_FFTMixedRadixPass2ZP<SIGN>(x,y,m,s,U);
+        pruned = 1;
+      } else {
+        for(OC_INDEX i=2*s*input_size;i<2*s*fftsize;++i) x[i] = 0.0;
+      }
+    } else if(f==factor_count-1 && output_size<fftsize) {
+      // Last pass: output u fills rows u*(fftsize/P) and up.
+      const OC_INDEX rows = fftsize/P;
+      const int ucount = static_cast<int>((output_size + rows - 1)/rows);
+      switch(P) {
+      case 3: Oxs_FFTMixedRadixLastPassZP<SIGN,3>(x,y,s,ucount);
+        pruned = 1; break;
+      case 5: Oxs_FFTMixedRadixLastPassZP<SIGN,5>(x,y,s,ucount);
+        pruned = 1; break;
+      case 7: Oxs_FFTMixedRadixLastPassZP<SIGN,7>(x,y,s,ucount);
+        pruned = 1; break;
+      default: break; // Radix 2 and 4 handled by the full pass
+      }
+    }
+    if(!pruned) {
+      switch(P) {
+      case 4: Oxs_FFTMixedRadixPass4<SIGN>(x,y,m,s,U); break;
+      case 2: Oxs_FFTMixedRadixPass2<SIGN>(x,y,m,s,U); break;
+      case 3: Oxs_FFTMixedRadixPass3<SIGN>(x,y,m,s,U); break;
+      case 5: Oxs_FFTMixedRadixPass5<SIGN>(x,y,m,s,U); break;
+      case 7: Oxs_FFTMixedRadixPass7<SIGN>(x,y,m,s,U); break;
+      default:
+        OXS_THROW(Oxs_ProgramLogicError,
+                  "Unsupported radix in Oxs_FFTMixedRadix::Transform().");
+      }
+    }
+    U += 2*(P-1)*m;
+    OXS_FFT_REAL_TYPE* t = x; x = y; y = t;
+    n = m;
+    s *= P;
+  }
+  return x;
+}
+
+OXS_FFT_REAL_TYPE*
+Oxs_FFTMixedRadix::ForwardFFT
+(OXS_FFT_REAL_TYPE* bufa,
+ OXS_FFT_REAL_TYPE* bufb,
+ OC_INDEX bundle_size,
+ OC_INDEX input_size) const
+{
+  return Transform<-1>(bufa,bufb,bundle_size,input_size,fftsize);
+}
+
+OXS_FFT_REAL_TYPE*
+Oxs_FFTMixedRadix::InverseFFT
+(OXS_FFT_REAL_TYPE* bufa,
+ OXS_FFT_REAL_TYPE* bufb,
+ OC_INDEX bundle_size,
+ OC_INDEX output_size) const
+{
+  return Transform<1>(bufa,bufb,bundle_size,fftsize,output_size);
+}
+
 ////////////////////////////////////////////////////////////////////////
 // Class Oxs_FFT1DThreeVector //////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
@@ -143,9 +1003,7 @@ error "OFS_ARRAY_MAXBLOCKSIZE < OFS_ARRAY_BLOCKSIZE"
 OC_INDEX Oxs_FFT1DThreeVector::GetNextPowerOfTwo(OC_INDEX n,OC_INT4m& logsize)
 { // Returns first power of two >= n
   // This is a private function, for use by power-of-two
-  // code.  The client interface is RecommendSize(), which
-  // at present just calls this routine, but may be adapted
-  // in the future to a mixed-radix code.
+  // code.  The client interface is RecommendSize().
   OC_INDEX m=1;
   logsize=0;
   while(m<n) {
@@ -164,9 +1022,14 @@ OC_INDEX Oxs_FFT1DThreeVector::GetNextPowerOfTwo(OC_INDEX n,OC_INT4m& logsize)
 }
 
 OC_INDEX Oxs_FFT1DThreeVector::RecommendSize(OC_INDEX size)
-{ // Returns first power of two >= size
-  OC_INT4m dummy;
-  return GetNextPowerOfTwo(size,dummy);
+{ // Returns csize = 2*fftsize >= size with the smallest estimated
+  // cost.  The work is dominated by the complex FFT of length fftsize,
+  // so the cost comparison is made on that length.
+  if(size<=2) {
+    OC_INT4m dummy;
+    return GetNextPowerOfTwo(size,dummy);
+  }
+  return 2*Oxs_FFTMixedRadix::RecommendSize((size+1)/2,1);
 }
 
 void Oxs_FFT1DThreeVector::FreeMemory()
@@ -193,6 +1056,24 @@ void Oxs_FFT1DThreeVector::FreeMemory()
 #endif
   scratch_size = 0;
   workbuffer_size = 0;
+  mrfft.SetSize(0);
+}
+
+void Oxs_FFT1DThreeVector::FillMixedRadixRoots()
+{ // Fills UReals for non-power-of-two fftsize.  The layout is the
+  // same as in the power-of-two case, namely UReals[2*k] + i
+  // UReals[2*k+1] = exp(-pi.i.k/fftsize), k=0,...,fftsize-1.  Only
+  // the first half of this array is used by the unpacking code, but
+  // the full size is retained for compatibility with Dup().
+  if(UReals) delete[] UReals;
+  UReals = new OXS_FFT_REAL_TYPE[2*fftsize];
+  const OC_REALWIDE theta_base = WIDE_PI/static_cast<OC_REALWIDE>(fftsize);
+  for(OC_INDEX k=0;k<fftsize;++k) {
+    const OC_REALWIDE theta = theta_base*static_cast<OC_REALWIDE>(k);
+    UReals[2*k]   = static_cast<OXS_FFT_REAL_TYPE>(cos(theta));
+    UReals[2*k+1] = static_cast<OXS_FFT_REAL_TYPE>(-1*sin(theta));
+  }
+  mrfft.SetSize(fftsize);
 }
 
 void Oxs_FFT1DThreeVector::FillRootsOfUnity()
@@ -207,6 +1088,11 @@ void Oxs_FFT1DThreeVector::FillRootsOfUnity()
   if(UForwardRadix4) delete[] UForwardRadix4;
   UForwardRadix4=0;
 
+  if(log2fftsize == OXS_FFT_MIXED_LOG2SIZE) {
+    FillMixedRadixRoots();
+    return;
+  }
+
   if(fftsize<16) return; // Size 8 and smaller transforms
   // use hard-coded roots.
 
@@ -304,6 +1190,7 @@ void Oxs_FFT1DThreeVector::FillPreorderTraversalStateArray()
 
   if(fftsize<64) return; // ptsRadix4 array only used for
   /// complex FFT's of size 64 and larger.
+  if(log2fftsize == OXS_FFT_MIXED_LOG2SIZE) return; // Power-of-2 only
 
   OC_INDEX ptsRadix4_size = fftsize/((1+log2fftsize%2)*64);
   ptsRadix4 = new PreorderTraversalState[ptsRadix4_size+1];
@@ -345,6 +1232,8 @@ void Oxs_FFT1DThreeVector::FillBitReversalArray()
   bitreverse = 0;
 
   if(fftsize<32) return; // Bit reversal for fftsize<=16 is hard-coded.
+  if(log2fftsize == OXS_FFT_MIXED_LOG2SIZE) return; // Autosort; no
+  /// bit reversal needed.
 
   bitreverse = new OC_INDEX[fftsize];
 
@@ -428,6 +1317,7 @@ void Oxs_FFT1DThreeVector::Dup(const Oxs_FFT1DThreeVector& other)
   rstride      = other.rstride;
   fftsize      = other.fftsize;
   log2fftsize  = other.log2fftsize;
+  mrfft        = other.mrfft;
 
   if(other.UReals != 0) {
     UReals = new OXS_FFT_REAL_TYPE[2*fftsize];
@@ -494,6 +1384,13 @@ void Oxs_FFT1DThreeVector::AssignTransformPointers()
 
   // Assign Forward/Inverse routine pointers
   switch(log2fftsize) {
+    case OXS_FFT_MIXED_LOG2SIZE:
+      // Mixed radix code uses scratch and workbuffer as the two
+      // Stockham ping-pong buffers.
+      AllocScratchSpace(OFTV_VECSIZE*fftsize*OFTV_COMPLEXSIZE);
+      ForwardPtr = &Oxs_FFT1DThreeVector::ForwardRealToComplexFFTMixedRadix;
+      InversePtr = &Oxs_FFT1DThreeVector::InverseComplexToRealFFTMixedRadix;
+      break;
     case -1: // Special case; rsize==csize==1
       ForwardPtr = &Oxs_FFT1DThreeVector::ForwardRealToComplexFFTSize0;
       InversePtr = &Oxs_FFT1DThreeVector::InverseComplexToRealFFTSize0;
@@ -590,11 +1487,15 @@ void Oxs_FFT1DThreeVector::SetDimensions
   if(import_csize==1) {
     log2fftsize=-1; // Coded value
   } else {
-    OC_INDEX checksize = GetNextPowerOfTwo(fftsize,log2fftsize);
-    if(2*fftsize!=import_csize || fftsize!=checksize) {
+    if(2*fftsize!=import_csize
+       || !Oxs_FFTMixedRadix::IsSupportedSize(fftsize)) {
       OXS_THROW(Oxs_BadParameter,
 	"Illegal csize import to Oxs_FFT1DThreeVector::SetDimensions().");
     }
+    OC_INDEX checksize = GetNextPowerOfTwo(fftsize,log2fftsize);
+    if(fftsize!=checksize) {
+      log2fftsize = OXS_FFT_MIXED_LOG2SIZE; // Coded value
+    }
   }
 
   if(import_csize<import_rsize) {
@@ -8629,6 +9530,169 @@ Oxs_FFT1DThreeVector::InverseComplexToRealFFTSize0
   }
 }
 
+void
+Oxs_FFT1DThreeVector::ForwardRealToComplexFFTMixedRadix
+(const OXS_FFT_REAL_TYPE* rarr_in,
+ OXS_FFT_REAL_TYPE* carr_out,
+ const OXS_FFT_REAL_TYPE* mult_base) const
+{ // Real-to-complex FFT for fftsize not a power of two.  Each row is
+  // packed into a complex vector of length fftsize in scratch; the
+  // zero padding is left to mrfft.  The complex FFT is computed
+  // by mrfft using scratch and workbuffer as ping-pong buffers, and
+  // the result is unpacked into carr_out.  See mjd's NOTES for the
+  // unpacking identities; with Z the packed transform, W =
+  // exp(-pi.i/fftsize), M = fftsize, and k=0,...,M/2:
+  //
+  //    Fe = (Z[k] + conj(Z[M-k]))/2,  Fo = (Z[k] - conj(Z[M-k]))/2,
+  //    G  = W^k * Fo,
+  //    X[k] = Fe - i.G,  X[M-k] = conj(Fe + i.G).
+  const OC_INDEX cstride = 2*(fftsize+1)*OFTV_VECSIZE;
+  const OC_INDEX istop = OFTV_VECSIZE*rsize;
+  for(OC_INDEX row=0;row<arrcount;
+      ++row,rarr_in+=rstride,carr_out+=cstride) {
+    // Pack current row of rarr_in into scratch.  Successive real
+    // three vectors are interleaved as the real and imaginary parts
+    // of complex three vectors.
+    OC_INDEX i;
+    if(mult_base!=NULL) {
+      const OXS_FFT_REAL_TYPE* mult = mult_base;
+      mult_base += rstride/OFTV_VECSIZE;
+      for(i=0;i<istop-5;i+=6) {
+        scratch[i]   = (*mult)*rarr_in[i];
+        scratch[i+2] = (*mult)*rarr_in[i+1];
+        scratch[i+4] = (*mult)*rarr_in[i+2];
+        ++mult;
+        scratch[i+1] = (*mult)*rarr_in[i+3];
+        scratch[i+3] = (*mult)*rarr_in[i+4];
+        scratch[i+5] = (*mult)*rarr_in[i+5];
+        ++mult;
+      }
+      if(i<istop) {
+        scratch[i]   = (*mult)*rarr_in[i];
+        scratch[i+2] = (*mult)*rarr_in[i+1];
+        scratch[i+4] = (*mult)*rarr_in[i+2];
+        scratch[i+1] = scratch[i+3] = scratch[i+5] = 0.0;
+        i += 6;
+      }
+    } else {
+      for(i=0;i<istop-5;i+=6) {
+        scratch[i]   = rarr_in[i];
+        scratch[i+2] = rarr_in[i+1];
+        scratch[i+4] = rarr_in[i+2];
+        scratch[i+1] = rarr_in[i+3];
+        scratch[i+3] = rarr_in[i+4];
+        scratch[i+5] = rarr_in[i+5];
+      }
+      if(i<istop) {
+        scratch[i]   = rarr_in[i];
+        scratch[i+2] = rarr_in[i+1];
+        scratch[i+4] = rarr_in[i+2];
+        scratch[i+1] = scratch[i+3] = scratch[i+5] = 0.0;
+        i += 6;
+      }
+    }
+    // Zero padding beyond i is handled by mrfft.
+    const OXS_FFT_REAL_TYPE* const z
+      = mrfft.ForwardFFT(scratch,workbuffer,OFTV_VECSIZE,(rsize+1)/2);
+
+    // Unpack
+    OXS_FFT_REAL_TYPE* const v = carr_out;
+    const OC_INDEX vM = OFTV_COMPLEXSIZE*OFTV_VECSIZE*fftsize;
+    for(i=0;i<2*OFTV_VECSIZE;i+=2) {
+      v[i]      = z[i] + z[i+1];   v[i+1]    = 0.0;
+      v[vM+i]   = z[i] - z[i+1];   v[vM+i+1] = 0.0;
+    }
+    for(OC_INDEX k=1;2*k<=fftsize;++k) {
+      const OXS_FFT_REAL_TYPE wr = UReals[2*k];
+      const OXS_FFT_REAL_TYPE wi = UReals[2*k+1];
+      const OC_INDEX ka = OFTV_COMPLEXSIZE*OFTV_VECSIZE*k;
+      const OC_INDEX kb = OFTV_COMPLEXSIZE*OFTV_VECSIZE*(fftsize-k);
+      for(i=0;i<2*OFTV_VECSIZE;i+=2) {
+        const OXS_FFT_REAL_TYPE ar = z[ka+i], ai = z[ka+i+1];
+        const OXS_FFT_REAL_TYPE br = z[kb+i], bi = z[kb+i+1];
+        const OXS_FFT_REAL_TYPE fer = 0.5*(ar + br);
+        const OXS_FFT_REAL_TYPE fei = 0.5*(ai - bi);
+        const OXS_FFT_REAL_TYPE for_ = 0.5*(ar - br);
+        const OXS_FFT_REAL_TYPE foi = 0.5*(ai + bi);
+        const OXS_FFT_REAL_TYPE gr = wr*for_ - wi*foi;
+        const OXS_FFT_REAL_TYPE gi = wr*foi + wi*for_;
+        v[kb+i]   = fer - gi;      v[kb+i+1] = -1*(fei + gr);
+        v[ka+i]   = fer + gi;      v[ka+i+1] = fei - gr;
+        /// NB: If 2*k==fftsize then ka==kb, and both assignments
+        /// produce the same value.
+      }
+    }
+  }
+}
+
+void
+Oxs_FFT1DThreeVector::InverseComplexToRealFFTMixedRadix
+(OXS_FFT_REAL_TYPE* carr_in,
+ OXS_FFT_REAL_TYPE* rarr_out) const
+{ // Complex-to-real FFT for fftsize not a power of two.  This is the
+  // reverse of ForwardRealToComplexFFTMixedRadix: first pack, i.e.,
+  // for k=0,...,M/2,
+  //
+  //    Fe = (X[k] + conj(X[M-k]))/2,  G = i.(X[k] - conj(X[M-k]))/2,
+  //    Fo = conj(W^k) * G,
+  //    Z[k] = Fe + Fo,  Z[M-k] = conj(Fe - Fo),
+  //
+  // then take the complex inverse FFT of Z and unpack the real and
+  // imaginary parts as successive output three vectors.  As in the
+  // power-of-two code, the imaginary parts of X[0] and X[M] are
+  // assumed to be zero, and the resulting scaling is fftsize.
+  const OC_INDEX cstride = 2*(fftsize+1)*OFTV_VECSIZE;
+  const OC_INDEX istop = OFTV_VECSIZE*rsize;
+  for(OC_INDEX row=0;row<arrcount;
+      ++row,rarr_out+=rstride,carr_in+=cstride) {
+    const OXS_FFT_REAL_TYPE* const v = carr_in;
+    OXS_FFT_REAL_TYPE* const z = scratch;
+    const OC_INDEX vM = OFTV_COMPLEXSIZE*OFTV_VECSIZE*fftsize;
+    OC_INDEX i;
+    for(i=0;i<2*OFTV_VECSIZE;i+=2) {
+      z[i]   = 0.5*(v[i] + v[vM+i]);
+      z[i+1] = 0.5*(v[i] - v[vM+i]);
+    }
+    for(OC_INDEX k=1;2*k<=fftsize;++k) {
+      const OXS_FFT_REAL_TYPE wr = UReals[2*k];
+      const OXS_FFT_REAL_TYPE wi = UReals[2*k+1];
+      const OC_INDEX ka = OFTV_COMPLEXSIZE*OFTV_VECSIZE*k;
+      const OC_INDEX kb = OFTV_COMPLEXSIZE*OFTV_VECSIZE*(fftsize-k);
+      for(i=0;i<2*OFTV_VECSIZE;i+=2) {
+        const OXS_FFT_REAL_TYPE ar = v[ka+i], ai = v[ka+i+1];
+        const OXS_FFT_REAL_TYPE br = v[kb+i], bi = v[kb+i+1];
+        const OXS_FFT_REAL_TYPE fer = 0.5*(ar + br);
+        const OXS_FFT_REAL_TYPE fei = 0.5*(ai - bi);
+        const OXS_FFT_REAL_TYPE gr = -0.5*(ai + bi);
+        const OXS_FFT_REAL_TYPE gi =  0.5*(ar - br);
+        // Fo = conj(W^k) * G
+        const OXS_FFT_REAL_TYPE for_ = wr*gr + wi*gi;
+        const OXS_FFT_REAL_TYPE foi = wr*gi - wi*gr;
+        z[kb+i] = fer - for_;   z[kb+i+1] = foi - fei;
+        z[ka+i] = fer + for_;   z[ka+i+1] = fei + foi;
+      }
+    }
+
+    const OXS_FFT_REAL_TYPE* const r
+      = mrfft.InverseFFT(scratch,workbuffer,OFTV_VECSIZE,(rsize+1)/2);
+
+    // Unpack into rarr_out, ignoring data outside rsize.
+    for(i=0;i<istop-5;i+=6) {
+      rarr_out[i]   = r[i];
+      rarr_out[i+1] = r[i+2];
+      rarr_out[i+2] = r[i+4];
+      rarr_out[i+3] = r[i+1];
+      rarr_out[i+4] = r[i+3];
+      rarr_out[i+5] = r[i+5];
+    }
+    if(i<istop) {
+      rarr_out[i]   = r[i];
+      rarr_out[i+1] = r[i+2];
+      rarr_out[i+2] = r[i+4];
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // Class Oxs_FFTStrided ////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
@@ -8664,9 +9728,7 @@ Oxs_FFT1DThreeVector::InverseComplexToRealFFTSize0
 OC_INDEX Oxs_FFTStrided::GetNextPowerOfTwo(OC_INDEX n,OC_INT4m& logsize)
 { // Returns first power of two >= n
   // This is a private function, for use by power-of-two
-  // code.  The client interface is RecommendSize(), which
-  // at present just calls this routine, but may be adapted
-  // in the future to a mixed-radix code.
+  // code.  The client interface is RecommendSize().
   OC_INDEX m=1;
   logsize=0;
   while(m<n) {
@@ -8685,9 +9747,14 @@ OC_INDEX Oxs_FFTStrided::GetNextPowerOfTwo(OC_INDEX n,OC_INT4m& logsize)
 }
 
 OC_INDEX Oxs_FFTStrided::RecommendSize(OC_INDEX size)
-{ // Returns first power of two >= size
-  OC_INT4m dummy;
-  return GetNextPowerOfTwo(size,dummy);
+{ // Returns the size >= import size with the smallest estimated
+  // cost.  Sizes larger than 2 are restricted to even values, because
+  // the demag code relies on the mirror symmetry about csize_zp/2.
+  if(size<=2) {
+    OC_INT4m dummy;
+    return GetNextPowerOfTwo(size,dummy);
+  }
+  return Oxs_FFTMixedRadix::RecommendSize(size,2);
 }
 
 void Oxs_FFTStrided::FreeMemory()
@@ -8701,6 +9768,7 @@ void Oxs_FFTStrided::FreeMemory()
   if(scratch)        delete[] scratch;
   scratch=0;
   scratch_size = 0;
+  mrfft.SetSize(0);
 }
 
 void Oxs_FFTStrided::FillRootsOfUnity()
@@ -8713,6 +9781,12 @@ void Oxs_FFTStrided::FillRootsOfUnity()
   if(UForwardRadix4) delete[] UForwardRadix4;
   UForwardRadix4=0;
 
+  if(log2fftsize == OXS_FFT_MIXED_LOG2SIZE) {
+    // Roots for non-power-of-two sizes are held by mrfft.
+    mrfft.SetSize(fftsize);
+    return;
+  }
+
   if(fftsize<32) return; // Size 16 and smaller transforms
   // use hard-coded roots.
 
@@ -8825,6 +9899,7 @@ void Oxs_FFTStrided::FillPreorderTraversalStateArray()
 
   if(fftsize<64) return; // ptsRadix4 array only used for
   /// FFT's of size 64 and larger.
+  if(log2fftsize == OXS_FFT_MIXED_LOG2SIZE) return; // Power-of-2 only
 
   OC_INDEX ptsRadix4_size = fftsize/((1+log2fftsize%2)*64);
   ptsRadix4 = new PreorderTraversalState[ptsRadix4_size+1];
@@ -8866,6 +9941,8 @@ void Oxs_FFTStrided::FillBitReversalArray()
   bitreverse = 0;
 
   if(fftsize<32) return; // Bit reversal for fftsize<=16 is hard-coded.
+  if(log2fftsize == OXS_FFT_MIXED_LOG2SIZE) return; // Autosort; no
+  /// bit reversal needed.
 
   bitreverse = new OC_INDEX[fftsize];
 
@@ -8935,7 +10012,7 @@ void Oxs_FFTStrided::Dup(const Oxs_FFTStrided& other)
   rstride     = other.rstride;
   fftsize     = other.fftsize;
   log2fftsize = other.log2fftsize;
-
+  mrfft       = other.mrfft;
 
   if(other.UForwardRadix4 != 0) {
     OC_INDEX UfR4_csize = fftsize - 3*(log2fftsize/2)
@@ -8979,6 +10056,14 @@ void Oxs_FFTStrided::AssignTransformPointers()
 
   // Assign Forward/Inverse routine pointers
   switch(log2fftsize) {
+  case OXS_FFT_MIXED_LOG2SIZE: // fftsize not a power of two
+    // Scratch holds two blocks, used as the Stockham ping-pong
+    // buffers by mrfft.  Zero padding is handled on the block copy,
+    // so there are no separate *ZP routines.
+    AllocScratchSpace(2*fftsize*2*OFS_MIXED_RADIX_BLOCKSIZE);
+    ForwardPtr = &Oxs_FFTStrided::ForwardFFTMixedRadix;
+    InversePtr = &Oxs_FFTStrided::InverseFFTMixedRadix;
+    break;
   case 0: // fftsize == 1
     ForwardPtr = &Oxs_FFTStrided::FFTNop;
     InversePtr = &Oxs_FFTStrided::FFTNop;
@@ -9066,11 +10151,14 @@ void Oxs_FFTStrided::SetDimensions
   rstride = import_rstride;
   arrcount = import_array_count;
 
-  OC_INDEX checksize = GetNextPowerOfTwo(fftsize,log2fftsize);
-  if(fftsize!=checksize) {
+  if(!Oxs_FFTMixedRadix::IsSupportedSize(fftsize)) {
     OXS_THROW(Oxs_BadParameter,
 	      "Illegal csize_zp import to Oxs_FFTStrided::SetDimensions().");
   }
+  OC_INDEX checksize = GetNextPowerOfTwo(fftsize,log2fftsize);
+  if(fftsize!=checksize) {
+    log2fftsize = OXS_FFT_MIXED_LOG2SIZE; // Coded value
+  }
 
   if(import_csize_zp<import_csize_base) {
     OXS_THROW(Oxs_BadParameter,
@@ -9130,6 +10218,69 @@ void Oxs_FFTStrided::AdjustInputDimensions
   /// but *ZP code selection might.
 }
 
+void
+Oxs_FFTStrided::ForwardFFTMixedRadix
+(OXS_FFT_REAL_TYPE* arr) const
+{ // Forward FFT for fftsize not a power of two.  Blocks of up to
+  // OFS_MIXED_RADIX_BLOCKSIZE columns are gathered into scratch, with
+  // transformed, and scattered back to arr.  mrfft treats rows
+  // csize_base and beyond as zero.
+  OXS_FFT_REAL_TYPE* const bufa = scratch;
+  OXS_FFT_REAL_TYPE* const bufb = scratch + 2*fftsize*OFS_MIXED_RADIX_BLOCKSIZE;
+  for(OC_INDEX block=0;block<arrcount;block+=OFS_MIXED_RADIX_BLOCKSIZE) {
+    const OC_INDEX bsize = (arrcount-block<OFS_MIXED_RADIX_BLOCKSIZE
+                            ? arrcount-block : OFS_MIXED_RADIX_BLOCKSIZE);
+    const OC_INDEX bstride = 2*bsize;
+    OXS_FFT_REAL_TYPE* const base = arr + 2*block;
+    OC_INDEX i,j;
+    for(j=0;j<csize_base;++j) {
+      const OXS_FFT_REAL_TYPE* src = base + j*rstride;
+      OXS_FFT_REAL_TYPE* dst = bufa + j*bstride;
+      for(i=0;i<bstride;++i) dst[i] = src[i];
+    }
+    const OXS_FFT_REAL_TYPE* const result
+      = mrfft.ForwardFFT(bufa,bufb,bsize,csize_base);
+
+    for(j=0;j<fftsize;++j) {
+      const OXS_FFT_REAL_TYPE* src = result + j*bstride;
+      OXS_FFT_REAL_TYPE* dst = base + j*rstride;
+      for(i=0;i<bstride;++i) dst[i] = src[i];
+    }
+  }
+}
+
+void
+Oxs_FFTStrided::InverseFFTMixedRadix
+(OXS_FFT_REAL_TYPE* arr) const
+{ // Inverse FFT for fftsize not a power of two.  Analogous to
+  // ForwardFFTMixedRadix, except that all fftsize rows are gathered
+  // and only the first csize_base rows of the result are computed and
+  // written back.
+  OXS_FFT_REAL_TYPE* const bufa = scratch;
+  OXS_FFT_REAL_TYPE* const bufb = scratch + 2*fftsize*OFS_MIXED_RADIX_BLOCKSIZE;
+  for(OC_INDEX block=0;block<arrcount;block+=OFS_MIXED_RADIX_BLOCKSIZE) {
+    const OC_INDEX bsize = (arrcount-block<OFS_MIXED_RADIX_BLOCKSIZE
+                            ? arrcount-block : OFS_MIXED_RADIX_BLOCKSIZE);
+    const OC_INDEX bstride = 2*bsize;
+    OXS_FFT_REAL_TYPE* const base = arr + 2*block;
+    OC_INDEX i,j;
+    for(j=0;j<fftsize;++j) {
+      const OXS_FFT_REAL_TYPE* src = base + j*rstride;
+      OXS_FFT_REAL_TYPE* dst = bufa + j*bstride;
+      for(i=0;i<bstride;++i) dst[i] = src[i];
+    }
+
+    const OXS_FFT_REAL_TYPE* const result
+      = mrfft.InverseFFT(bufa,bufb,bsize,csize_base);
+
+    for(j=0;j<csize_base;++j) {
+      const OXS_FFT_REAL_TYPE* src = result + j*bstride;
+      OXS_FFT_REAL_TYPE* dst = base + j*rstride;
+      for(i=0;i<bstride;++i) dst[i] = src[i];
+    }
+  }
+}
+
 void
 Oxs_FFTStrided::ForwardFFTRadix4
 (OXS_FFT_REAL_TYPE* arr) const
@@ -17269,12 +18420,14 @@ void Oxs_FFT3DThreeVector::AdjustInputDimensions
 void
 Oxs_FFT3DThreeVector::ForwardRealToComplexFFT
 (const OXS_FFT_REAL_TYPE* rarr_in,
- OXS_FFT_REAL_TYPE* carr_out) const
+ OXS_FFT_REAL_TYPE* carr_out,
+ const OXS_FFT_REAL_TYPE* mult) const
 {
   OC_INDEX k;
   for(k=0;k<rdim3;++k) {
     // Dim1 transforms in plane k
-    fftx.ForwardRealToComplexFFT(rarr_in+k*rxydim,carr_out+k*cxydim_rs);
+    fftx.ForwardRealToComplexFFT(rarr_in+k*rxydim,carr_out+k*cxydim_rs,
+                                 (mult ? mult+k*rdim1*rdim2 : NULL));
 
     // Dim2 transforms in plane k
     ffty.ForwardFFT(carr_out+k*cxydim_rs);
@@ -5,6 +5,10 @@
  *
  * These classes are:
  *
+ *      Oxs_FFTMixedRadix: Helper class for the next two classes,
+ *                         providing complex FFTs of sizes that are
+ *                         not a power of two.
+ *
  *   Oxs_FFT1DThreeVector: FFTs on 1D arrays of three vectors,
  *                         real <-> complex.  Not in-place.
  *
@@ -42,6 +46,103 @@ typedef OC_REAL8m OXS_FFT_REAL_TYPE;
 /// presumably doesn't proportionally cost that much extra to make all
 /// the OC_REAL8m structures long double.
 
+////////////////////////////////////////////////////////////////////////
+// Class Oxs_FFTMixedRadix /////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+
+/* Class Oxs_FFTMixedRadix
+ *
+ * Complex-to-complex FFTs of length n = 2^a 3^b 5^c 7^d.  This class
+ * is used internally by Oxs_FFT1DThreeVector and Oxs_FFTStrided for
+ * transform sizes that are not a power of two; power-of-two sizes are
+ * handled by the hand-coded radix 4 routines in those classes.
+ *
+ * The transform is a Stockham autosort, decimation-in-frequency
+ * algorithm with radix 4, 2, 3, 5 and 7 passes.  Data are organized
+ * as "bundles": element i of each sequence occupies bundle_size
+ * adjacent complex values starting at real offset 2*bundle_size*i,
+ * and all bundle_size sequences are transformed together.  The inner
+ * loop of each pass runs across the bundle and successive
+ * sub-transforms, which is the unit stride direction.  No bit reversal
+ * pass is needed, but the transform is not in-place; data ping-pong
+ * between two buffers, and the routines return a pointer to the
+ * buffer holding the result.  The results are not scaled.
+ */
+
+class Oxs_FFTMixedRadix {
+public:
+  Oxs_FFTMixedRadix();
+  Oxs_FFTMixedRadix(const Oxs_FFTMixedRadix& other);
+  Oxs_FFTMixedRadix& operator=(const Oxs_FFTMixedRadix& other);
+  ~Oxs_FFTMixedRadix();
+
+  void SetSize(OC_INDEX size); // Throws an exception if size is not
+  /// supported (see IsSupportedSize() below).  Size 0 releases
+  /// all memory.
+  OC_INDEX GetSize() const { return fftsize; }
+
+  // Both bufa and bufb must hold 2*bundle_size*fftsize reals.  Input
+  // is in bufa.  The contents of the buffer not returned are
+  // unspecified on exit.  Forward transforms use the kernel
+  // exp(-2.pi.i.jk/n), inverse transforms exp(+2.pi.i.jk/n).
+  //
+  // Zero-padded transforms are pruned.  For the forward transform,
+  // elements input_size and beyond are taken to be zero and need not
+  // be set in bufa; the first pass skips butterfly legs that are
+  // known to be zero.  For the inverse transform only elements 0
+  // through output_size-1 of the result are computed; the last pass
+  // skips the remaining outputs, whose values are unspecified.  Use
+  // fftsize for either value to compute the full transform.
+  OXS_FFT_REAL_TYPE* ForwardFFT(OXS_FFT_REAL_TYPE* bufa,
+                                OXS_FFT_REAL_TYPE* bufb,
+                                OC_INDEX bundle_size,
+                                OC_INDEX input_size) const;
+  OXS_FFT_REAL_TYPE* InverseFFT(OXS_FFT_REAL_TYPE* bufa,
+                                OXS_FFT_REAL_TYPE* bufb,
+                                OC_INDEX bundle_size,
+                                OC_INDEX output_size) const;
+
+  static OC_BOOL IsPowerOfTwo(OC_INDEX n);
+  static OC_BOOL IsSupportedSize(OC_INDEX n); // True iff n>0 and the
+  /// only prime factors of n are 2, 3, 5 and 7.
+
+  // Returns the supported n of the form n = multiple*m, n >= minsize,
+  // with the smallest estimated transform cost (see EstimateCost).
+  // The search stops at the first power-of-two >= minsize.  If the
+  // OXS_FFT_MIXED_RADIX macro is 0, then this routine returns the
+  // smallest power-of-two that is a multiple of multiple and >=
+  // minsize.  The import multiple must be a power of two.
+  static OC_INDEX RecommendSize(OC_INDEX minsize,OC_INDEX multiple);
+
+  // Rough operation count, relative to the hand-coded power-of-two
+  // routines, for a complex FFT of length n.
+  static double EstimateCost(OC_INDEX n);
+
+private:
+  enum { MAXFACTORS = 64 }; // 4^32 is much bigger than OC_INDEX_MAX
+
+  OC_INDEX fftsize;
+  int factor_count;
+  int factor[MAXFACTORS]; // Radix for each pass, in processing order
+
+  // Twiddle factors for each pass, stored consecutively as complex
+  // values (real part followed by imaginary part).  For a pass of
+  // radix P applied to sub-transforms of length L = P*m, the entries
+  // are w^(p*u) for p=0,...,m-1 and u=1,...,P-1, where
+  // w = exp(-2.pi.i/L).  Inverse transforms use the complex
+  // conjugates.
+  OC_INDEX roots_size; // In real units
+  OXS_FFT_REAL_TYPE* roots;
+
+  template<int SIGN> OXS_FFT_REAL_TYPE*
+  Transform(OXS_FFT_REAL_TYPE* x,OXS_FFT_REAL_TYPE* y,
+            OC_INDEX bundle_size,
+            OC_INDEX input_size,OC_INDEX output_size) const;
+
+  void Dup(const Oxs_FFTMixedRadix& other);
+  void FreeMemory();
+};
+
 ////////////////////////////////////////////////////////////////////////
 // Class Oxs_FFT1DThreeVector //////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
@@ -82,14 +183,15 @@ public:
   // vector of length csize.  If rsize < csize, then the missing
   // elements are treated as though zero filled.
   //
-  // NOTE 2: At present, this FFT code is strictly power-of-2, so
-  // csize must be a power of 2.  In case this changes in the future,
-  // client code should use the member function RecommendSize to get a
-  // valid value for csize.  Usually, one has an array of length
-  // rsize, which needs to be zero-padded to double length (in order
-  // to emulate a linear convolution via the circular convolution
-  // effected by FFTs), and then zero-padded up to an supported
-  // FFT-size.  So, set csize = RecommendSize(2*rsize).
+  // NOTE 2: csize must be 1 or else of the form csize = 2*m, where m
+  // has no prime factors other than 2, 3, 5 and 7.  Power-of-two m are
+  // handled by hand-coded radix 4 routines, other values by the
+  // generic Oxs_FFTMixedRadix code.  Client code should use the member
+  // function RecommendSize to get a valid value for csize.  Usually,
+  // one has an array of length rsize, which needs to be zero-padded to
+  // double length (in order to emulate a linear convolution via the
+  // circular convolution effected by FFTs), and then zero-padded up to
+  // an supported FFT-size.  So, set csize = RecommendSize(2*rsize).
   //
   // NOTE 3: "Complex" vectors are actually handled as real vectors
   // packed as real, imag, real, imag, ...  No complex type is
@@ -164,17 +266,14 @@ public:
     return 1.0;
   }
 
-  static OC_INDEX RecommendSize(OC_INDEX rsize); // Returns first
-  // integer >= rsize that is supported by FFT code.  Currently code
-  // is power of two only, so the returned value will be the smallest
-  // power of 2 >= rsize.  Client code is encouraged to use this
-  // member function for zero-pad sizing, in order to automatically
-  // take advantage of reduced carr sizes if this code is ever
-  // enhanced to support mixed radix FFT's.  This is especially
-  // important for multidimensional FFT's, where unnecessary padding
-  // is computationally expensive.  (Note to self: if mixed radix
-  // FFT's are introduced, update csize restrictions documented above
-  // in the constructor notes.)
+  static OC_INDEX RecommendSize(OC_INDEX rsize); // Returns a csize
+  // value >= rsize that is supported by the FFT code (see NOTE 2
+  // above).  The returned value is the supported size with the
+  // smallest estimated transform cost, which is either the smallest
+  // power of 2 >= rsize or else a smaller mixed radix size.  For
+  // example, RecommendSize(600) returns 600 rather than 1024.  This
+  // is especially important for multidimensional FFT's, where
+  // unnecessary padding is computationally expensive.
 
   OC_INDEX GetLogicalDimension() const {
     // Logical ("nominal") dimension of transform.
@@ -288,6 +387,16 @@ private:
   void InverseComplexToRealFFTSize64ZP(OXS_FFT_REAL_TYPE* carr_in,
                                        OXS_FFT_REAL_TYPE* rarr_out) const;
 
+  // Transforms for fftsize not a power of two.  The packed complex
+  // transform of size fftsize is computed by the mrfft member object,
+  // and the real/complex unpacking step uses UReals.  These routines
+  // handle both the rsize>fftsize and rsize<=fftsize cases.
+  void ForwardRealToComplexFFTMixedRadix(const OXS_FFT_REAL_TYPE* rarr_in,
+                                         OXS_FFT_REAL_TYPE* carr_out,
+                                         const OXS_FFT_REAL_TYPE* mult) const;
+  void InverseComplexToRealFFTMixedRadix(OXS_FFT_REAL_TYPE* carr_in,
+                                         OXS_FFT_REAL_TYPE* rarr_out) const;
+
   // Copy operators are required by STL vector template.
   void Dup(const Oxs_FFT1DThreeVector&);
 
@@ -295,6 +404,7 @@ private:
   // Utility functions
   static OC_INDEX GetNextPowerOfTwo(OC_INDEX n,OC_INT4m& logsize);
   void FillRootsOfUnity();
+  void FillMixedRadixRoots();
   void FillPreorderTraversalStateArray();
   void FillBitReversalArray();
   void FreeMemory();
@@ -305,15 +415,19 @@ private:
   /// and the next, when arrcount>1.  Standard constructor sets this
   /// to 3*rsize.
 
-  OC_INDEX fftsize;  // Complex FFT size.  This must be a power-of-2.
-  /// Real vector is transformed by packing successive pairs of reals
-  /// as real+imag parts of a complex vector of half-size.  Thus
-  /// fftsize will be exactly half of the constructor import csize.
-  /// The expansion of the general complex fftsize transform to the
-  /// conjugate symmetric transform of conceptual size csize is handled
-  /// in a separate pass through the data inside the forward/inverse
-  /// routines.
-  OC_INT4m log2fftsize;  // Convenience; log base 2 of fftsize
+  OC_INDEX fftsize;  // Complex FFT size.  Real vector is transformed
+  /// by packing successive pairs of reals as real+imag parts of a
+  /// complex vector of half-size.  Thus fftsize will be exactly half of
+  /// the constructor import csize.  The expansion of the general
+  /// complex fftsize transform to the conjugate symmetric transform of
+  /// conceptual size csize is handled in a separate pass through the
+  /// data inside the forward/inverse routines.
+  OC_INT4m log2fftsize;  // Convenience; log base 2 of fftsize.  Coded
+  /// value -1 indicates csize==1, and -2 indicates that fftsize is not
+  /// a power of two, in which case the mixed radix code is used.
+
+  Oxs_FFTMixedRadix mrfft; // Complex transform for non-power-of-two
+  /// fftsize.  Unused (size 0) otherwise.
 
   // Root of unity arrays.  These are complex values stored as
   // side-by-side reals, real part followed by imaginary part.  The
@@ -379,7 +493,8 @@ private:
   //                                    if n = log_2(fftsize) is odd.
 
   OXS_FFT_REAL_TYPE* UReals; // Roots of unity for unpacking
-  /// real transform.
+  /// real transform.  Also used by the mixed radix routines, in which
+  /// case it is filled for all fftsize>1.
   OXS_FFT_REAL_TYPE* UForwardRadix4; // Radix 4, inline,
   /// preorder-traversal, with perhaps appended the radix-2 roots at the
   /// 32 level, depending on whether log_2(fftsize) is even or odd.  The
@@ -506,12 +621,13 @@ public:
   // initialized, but the full csize_zp x array_count array must be
   // previously allocated.
   //
-  // csize_zp must be "compatible" with supported FFT dimensions.  At
-  // present, this mean csize_zp must be a power-of-2, but this may
-  // change in the future.  Clients should use the RecommendSize member
-  // function to select a valid csize_zp value.  If one is zero-padding
-  // to minimally twice the base size, then csize_zp should be set to
-  // RecommendSize(2*csize_base).
+  // csize_zp must be "compatible" with supported FFT dimensions,
+  // meaning csize_zp can have no prime factors other than 2, 3, 5 and
+  // 7.  Power-of-2 sizes are handled by hand-coded radix 4 routines,
+  // other sizes by the generic Oxs_FFTMixedRadix code.  Clients should
+  // use the RecommendSize member function to select a valid csize_zp
+  // value.  If one is zero-padding to minimally twice the base size,
+  // then csize_zp should be set to RecommendSize(2*csize_base).
   //
   // The results are not scaled.  Use the GetScaling member funtion to
   // find the proper scaling, which the client is responsible for
@@ -564,17 +680,14 @@ public:
     return 1.0;
   }
 
-  static OC_INDEX RecommendSize(OC_INDEX size); // Returns first
-  // integer >= size that is supported by FFT code.  Currently code
-  // is power of two only, so the returned value will be the smallest
-  // power of 2 >= size.  Client code is encouraged to use this
-  // member function for zero-pad sizing, in order to automatically
-  // take advantage of reduced array sizes if this code is ever
-  // enhanced to support mixed radix FFT's.  This is especially
-  // important for multidimensional FFT's, where unnecessary padding
-  // is computationally expensive.  (Note to self: if mixed radix
-  // FFT's are introduced, update size restrictions documented above
-  // in the constructor notes.)
+  static OC_INDEX RecommendSize(OC_INDEX size); // Returns an
+  // integer >= size that is supported by FFT code, selected to
+  // minimize the estimated transform cost.  This is either the
+  // smallest power of 2 >= size, or else a smaller mixed radix size.
+  // For size>1 the return value is always even, because Oxs_Demag
+  // relies on the mirror symmetry about csize_zp/2 and also uses the
+  // same dimensions with Oxs_FFT1DThreeVector when filling the demag
+  // tensor.
 
   OC_INDEX GetLogicalDimension() const {
     // Logical ("nominal") dimension of transform.
@@ -644,6 +757,13 @@ private:
   void ForwardFFTSize64ZP(OXS_FFT_REAL_TYPE* arr) const;
   void InverseFFTSize64ZP(OXS_FFT_REAL_TYPE* arr) const;
 
+  // Transforms for fftsize not a power of two.  Columns are processed
+  // in blocks of up to OFS_MIXED_RADIX_BLOCKSIZE complex values, which
+  // are copied into scratch space, transformed by mrfft, and copied
+  // back.  Zero padding is handled on the copy in/out.
+  void ForwardFFTMixedRadix(OXS_FFT_REAL_TYPE* arr) const;
+  void InverseFFTMixedRadix(OXS_FFT_REAL_TYPE* arr) const;
+
   // Copy operators are required by STL vector template.
   void Dup(const Oxs_FFTStrided& other);
 
@@ -660,8 +780,13 @@ private:
   OC_INDEX rstride;  // Stride between successive elements in one
   /// FFT sequence, in OXS_FFT_REAL_TYPE units.
 
-  OC_INDEX fftsize;  // Complex FFT size.  This must be a power-of-2.
-  OC_INT4m log2fftsize;    // Convenience; log base 2 of fftsize
+  OC_INDEX fftsize;  // Complex FFT size.
+  OC_INT4m log2fftsize;    // Convenience; log base 2 of fftsize.  Coded
+  /// value -2 indicates fftsize is not a power of two, in which case
+  /// the mixed radix code is used.
+
+  Oxs_FFTMixedRadix mrfft; // Complex transform for non-power-of-two
+  /// fftsize.  Unused (size 0) otherwise.
 
   // Root of unity arrays.  These are complex values stored as
   // side-by-side reals, real part followed by imaginary part.  The
@@ -796,18 +921,15 @@ public:
   //       carr = new OXS_FFT_REAL_TYPE[2*cdim1*cdim2*cdim3];
   // where the "2" comes because 1 complex value is 2 REAL values.
   //
-  // Each corresponding csize value is the smallest integer >= the
-  // corresponding rsize that is supported by FFT code.  As discussed
-  // above, cdim2 = csize2, cdim3 = csize3, but cdim1 = (csize1/2)+1.
-  // Currently code is power of two only, so the computed csize value
-  // will be the smallest power of 2 >= rsize.  Client code is
-  // encouraged to use this member function for zero-pad sizing, in
-  // order to automatically take advantage of reduced csize values if
-  // this code is ever enhanced to support mixed radix FFT's.  This is
-  // especially important for multidimensional FFT's, where unnecessary
-  // padding is computationally expensive.  (Note to self: if mixed
-  // radix FFT's are introduced, update csize restrictions documented
-  // above in the constructor notes.)
+  // Each corresponding csize value is an integer >= the corresponding
+  // rsize that is supported by FFT code, as selected by the
+  // RecommendSize member functions of the Oxs_FFT1DThreeVector and
+  // Oxs_FFTStrided classes.  As discussed above, cdim2 = csize2, cdim3
+  // = csize3, but cdim1 = (csize1/2)+1.  The csize values are chosen to
+  // minimize estimated transform cost, and need not be powers of two.
+  // Client code should use this member function for zero-pad sizing;
+  // this is especially important for multidimensional FFT's, where
+  // unnecessary padding is computationally expensive.
 
 #if !OC_INDEX_CHECKS && OC_INT4m_WIDTH != OC_INDEX_WIDTH
   // Wrapper for backward compatibility
@@ -844,7 +966,7 @@ public:
   // ==> cdim1 >= (rdim1/2)+1.  In any event, it is best to use the
   // RecommendDimensions member function to select appropriate values
   // for cdim?, because there are other dimension restrictions (in
-  // particular power-of-2 requirements) that must also be adhered to.
+  // particular, allowed prime factors) that must also be adhered to.
   //
   // The relation csize1 = 2*(cdim1-1) only holds for cdim1>1.  For
   // cdim1=1 we have the special case csize1=1 iff cdim=1.
@@ -858,10 +980,11 @@ public:
   // the missing elements are treated as though zero filled, i.e., this
   // class supports implicit zero-padding.
   //
-  // NOTE 2: At present, this FFT code is strictly power-of-2, so each
-  // csize? must be a power of 2.  In case this changes in the future,
-  // client code should use the member function RecommendDimensions to get
-  // valid values for cdim?.  Usually, one has an array of dimensions
+  // NOTE 2: Each csize? must be a size supported by the component 1D
+  // FFT classes; see the notes for Oxs_FFT1DThreeVector::SetDimensions
+  // and Oxs_FFTStrided::SetDimensions.  Client code should use the
+  // member function RecommendDimensions to get valid values for
+  // cdim?.  Usually, one has an array of dimensions
   // rdim1 x rdim2 x rdim3, which needs to be zero-padded to double
   // length (in order to emulate a linear convolution via the circular
   // convolution effected by FFTs), and then zero-padded up to an
@@ -922,8 +1045,12 @@ public:
     return fftx.GetScaling()*ffty.GetScaling()*fftz.GetScaling();
   }
 
+  // If mult is non-NULL, then it is an array of rdim1 x rdim2 x rdim3
+  // scalars, and each three vector in rarr_in is multiplied by the
+  // corresponding element of mult on input.
   void ForwardRealToComplexFFT(const OXS_FFT_REAL_TYPE* rarr_in,
-                               OXS_FFT_REAL_TYPE* carr_out) const;
+                               OXS_FFT_REAL_TYPE* carr_out,
+                               const OXS_FFT_REAL_TYPE* mult=NULL) const;
 
   // NOTE: The inverse transform may use the carr_in as workspace during
   // computation; thus, carr_in is *not* const, unlike rarr_in for the
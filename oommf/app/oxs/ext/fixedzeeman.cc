@@ -130,6 +130,38 @@ void Oxs_FixedZeeman::ComputeEnergyChunk
   ocedtaux.energy_total_accum += energy_sum;
 }
 
+void Oxs_FixedZeeman::ComputeEnergyTile
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
+ Oxs_ChunkEnergyTile& tile,
+ int /* threadnumber */
+ ) const
+{ // Fused version of ComputeEnergyChunk; see chunkenergy.h.
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  const OC_INDEX offset = tile.node_start;
+  const OC_INDEX tsize = tile.node_stop - tile.node_start;
+
+  OC_REAL8m cell_volume;
+  const OC_BOOL uniform_volume
+    = state.mesh->HasUniformCellVolumes(cell_volume);
+
+  Nb_Xpfloat energy_sum = 0.0;
+  for(OC_INDEX k=0;k<tsize;++k) {
+    const OC_INDEX i = offset + k;
+    const Oxs_ThreeVector& hi = fixedfield[i];
+    OC_REAL8m ei = -MU0*Ms[i]*(hi*spin[i]);
+    if(uniform_volume) energy_sum += ei;
+    else               energy_sum += ei*state.mesh->Volume(i);
+    tile.energy[k] += ei;
+    tile.H[k] += hi;
+    tile.mxH[k] += spin[i] ^ hi;
+  }
+  if(uniform_volume) energy_sum *= cell_volume;
+
+  ocedtaux.energy_total_accum += energy_sum;
+}
+
 
 // Optional interface for conjugate-gradient evolver.
 // For details on this code, see NOTES VI, 21-July-2011, pp 10-11.
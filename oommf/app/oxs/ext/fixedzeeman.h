@@ -55,6 +55,14 @@ protected:
                                   OC_INDEX node_start,OC_INDEX node_stop,
                                   int threadnumber) const;
 
+  virtual OC_BOOL FusedTileSupport(const Oxs_SimState&) const {
+    return 1;
+  }
+  virtual void ComputeEnergyTile(const Oxs_SimState& state,
+                                 Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
+                                 Oxs_ChunkEnergyTile& tile,
+                                 int threadnumber) const;
+
 public:
   virtual const char* ClassName() const; // ClassName() is
   /// automatically generated by the OXS_EXT_REGISTER macro.
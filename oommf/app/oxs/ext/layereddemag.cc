@@ -0,0 +1,783 @@
+/* FILE: layereddemag.cc            -*-Mode: c++-*-
+ *
+ * Demagnetization field for stacks of thin layers.  See layereddemag.h
+ * for an overview.
+ *
+ * Each z-plane of the mesh is one layer, of thickness t_p with center
+ * zc_p, made up of rdimx x rdimy cells of size dx x dy x t_p.  The
+ * cell-averaged field in layer p is
+ *
+ *    H_p(r) = -sum_q sum_r' N_pq(r-r') M_q(r')
+ *
+ * where N_pq is the average over a target cell in layer p of the field
+ * from a uniformly magnetized source cell in layer q.  The state Ms is
+ * taken as the moment per mesh cell volume dx*dy*dz, so the source
+ * magnetization is M_q = Ms*m*dz/t_q.  Then the energy density
+ * -0.5*mu0*Ms*m.H_p times the mesh cell volume is the demag energy of
+ * the layer cell, and by the symmetry t_p*N_pq = t_q*N_qp^T the field
+ * H_p is the energy gradient with respect to m scaled by
+ * -1/(mu0*Ms*dx*dy*dz), as the evolvers assume for every term.  N_pq depends
+ * only on the in-plane offset, the two thicknesses and the center
+ * separation zc_p - zc_q, so the sum over r' is a 2D convolution which
+ * is computed with FFTs in the plane of each layer.  The sum over q is
+ * done in frequency space as a dense layer_count x layer_count
+ * matrix-vector product at each in-plane frequency.
+ *
+ * Near field.  With f and g the Newell functions of demagcoef.h, the
+ * kernel K = t_p*N_pq is the in-plane second difference of
+ *
+ *        F(x,y) =   f(x,y,Z+s) - f(x,y,Z+d)
+ *                 - f(x,y,Z-d) + f(x,y,Z-s)
+ *
+ * scaled by -1/(4*pi*dx*dy), where Z = zc_p - zc_q, s = (t_p+t_q)/2
+ * and d = (t_p-t_q)/2.  For t_p=t_q this reduces to the usual Newell
+ * formula.  The computation is done in OXS_DEMAG_REAL_ANALYTIC
+ * precision to control cancellation.
+ *
+ * Far field.  Outside a radius R the kernel is computed by integrating
+ * the dipole field over the source and target cells with a five point
+ * symmetric quadrature along each axis.  Along x and y the quadrature
+ * integrates the difference of two points uniformly distributed across
+ * a cell; along z the difference of points uniformly distributed
+ * across the target and source layers.  The quadrature nodes and
+ * weights are chosen to match the moments of the difference
+ * distribution through order 8, so the error relative to the dipole
+ * term falls off as (h/R)^10, where h is the largest cell dimension.
+ * R is selected from demag_tensor_error.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nb.h"
+#include "director.h"
+#include "key.h"
+#include "mesh.h"
+#include "meshvalue.h"
+#include "oxsthread.h"
+#include "simstate.h"
+#include "threevector.h"
+#include "energy.h"             // Needed to make MSVC++ 5 happy
+
+#include "rectangularmesh.h"
+#include "layereddemag.h"
+#include "demagcoef.h"
+
+OC_USE_STRING;
+
+/* End includes */
+
+// Oxs_Ext registration support
+OXS_EXT_REGISTER(Oxs_LayeredDemag);
+
+// Size of threevector.  This macro is defined for code legibility
+// and maintenance; it should always be "3".
+#define OLDTV_VECSIZE 3
+
+// Size of complex value, in real units.  This macro is defined for code
+// legibility and maintenance; it should always be "2".
+#define OLDTV_COMPLEXSIZE 2
+
+// Number of kernel components: xx, xy, xz, yy, yz, zz
+#define OLDTV_KERNELSIZE 6
+
+// Number of x-frequencies handled together by each y-axis FFT.
+#define OLDTV_COLUMN_BLOCK 8
+
+// Constructor
+Oxs_LayeredDemag::Oxs_LayeredDemag(
+  const char* name,     // Child instance id
+  Oxs_Director* newdtr, // App director
+  const char* argstr)   // MIF input block parameters
+  : Oxs_Energy(name,newdtr,argstr),
+    rdimx(0),rdimy(0),layer_count(0),cdimx(0),cdimy(0),adimy(0),
+    mesh_id(0),energy_density_error_estimate(-1),
+    demag_tensor_error(1e-15),kernel_count(0)
+{
+  if(HasInitValue("layer_thickness")) {
+    GetGroupedRealListInitValue("layer_thickness",layer_thickness);
+    for(size_t i=0;i<layer_thickness.size();++i) {
+      if(layer_thickness[i]<=0.0) {
+        throw Oxs_ExtError(this,"Invalid initialization detected:"
+                           " layer_thickness values must be positive.");
+      }
+    }
+  }
+  if(HasInitValue("layer_spacing")) {
+    GetGroupedRealListInitValue("layer_spacing",layer_spacing);
+    for(size_t i=0;i<layer_spacing.size();++i) {
+      if(layer_spacing[i]<0.0) {
+        throw Oxs_ExtError(this,"Invalid initialization detected:"
+                           " layer_spacing values must be non-negative.");
+      }
+    }
+  }
+  demag_tensor_error = GetRealInitValue("demag_tensor_error",1e-15);
+  if(demag_tensor_error<=0.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " demag_tensor_error must be positive.");
+  }
+  VerifyAllInitArgsUsed();
+}
+
+OC_BOOL Oxs_LayeredDemag::Init()
+{
+  mesh_id = 0;
+  energy_density_error_estimate = -1;
+  ReleaseMemory();
+  return Oxs_Energy::Init();
+}
+
+void Oxs_LayeredDemag::ReleaseMemory() const
+{ // Conceptually const
+  A.clear();
+  Hxfrm.clear();
+  fftx.clear();
+  ffty.clear();
+  Mwork.clear();
+  kernel_offset.clear();
+  layer_weight.clear();
+  source_weight.clear();
+  rdimx=rdimy=layer_count=0;
+  cdimx=cdimy=adimy=0;
+  kernel_count=0;
+}
+
+// Five point symmetric quadrature for the distribution of u-v, where u
+// and v are independent and uniformly distributed across intervals of
+// width a and b centered on zero.  The nodes and weights match the
+// even moments of u-v through order 8 (the odd moments are zero by
+// symmetry).
+static void
+Oxs_LayeredDemagQuadrature(OC_REAL8m a,OC_REAL8m b,
+                           OC_REAL8m node[5],OC_REAL8m weight[5])
+{
+  // Work in units of max(a,b) to keep the moments O(1).
+  const OC_REAL8m scale = (a>b ? a : b);
+  const OC_REAL8m ha = 0.5*a/scale, hb = 0.5*b/scale;
+  OC_REAL8m ma[9],mb[9]; // Moments of u and v; odd entries unused
+  for(int k=0;k<=8;k+=2) {
+    ma[k] = pow(ha,k)/(k+1);
+    mb[k] = pow(hb,k)/(k+1);
+  }
+  static const OC_REAL8m binom[9][9] = {
+    {1},{1,1},{1,2,1},{1,3,3,1},{1,4,6,4,1},{1,5,10,10,5,1},
+    {1,6,15,20,15,6,1},{1,7,21,35,35,21,7,1},{1,8,28,56,70,56,28,8,1}};
+  OC_REAL8m mu[9];
+  for(int n=0;n<=8;n+=2) {
+    mu[n] = 0.0;
+    for(int k=0;k<=n;k+=2) mu[n] += binom[n][k]*ma[k]*mb[n-k];
+  }
+  // Nodes at 0, +/-sqrt(u1), +/-sqrt(u2).  u1 and u2 are the roots of
+  // u^2 + p*u + q, chosen so that the weighted sums of u^k match
+  // mu[2k] for k=1,...,4.
+  const OC_REAL8m c0=mu[2], c1=mu[4], c2=mu[6], c3=mu[8];
+  const OC_REAL8m det = c1*c1 - c0*c2;
+  const OC_REAL8m p = (c0*c3 - c1*c2)/det;
+  const OC_REAL8m q = (c2*c2 - c1*c3)/det;
+  const OC_REAL8m disc = sqrt(p*p-4*q);
+  const OC_REAL8m u1 = 0.5*(-p+disc), u2 = 0.5*(-p-disc);
+  const OC_REAL8m V1 = (c1 - c0*u2)/(u1-u2), V2 = c0 - V1;
+  const OC_REAL8m W1 = V1/u1, W2 = V2/u2;
+  node[0] = 0.0;               weight[0] = 1.0 - W1 - W2;
+  node[1] = sqrt(u1)*scale;    weight[1] = 0.5*W1;
+  node[2] = -node[1];          weight[2] = weight[1];
+  node[3] = sqrt(u2)*scale;    weight[3] = 0.5*W2;
+  node[4] = -node[3];          weight[4] = weight[3];
+}
+
+void Oxs_LayeredDemag::ComputeKernel
+(const Oxs_RectangularMesh* mesh,
+ OC_REAL8m ta,   // Target layer thickness
+ OC_REAL8m tb,   // Source layer thickness
+ OC_REAL8m zoff, // Target layer center minus source layer center
+ OC_BOOL self,   // True iff target and source are the same layer
+ vector<OC_REAL8m>& K) const
+{ // Fills K with ta*N across the rdimx x rdimy first quadrant, indexed
+  // as [j][i][component].  Components are xx, xy, xz, yy, yz, zz.
+  typedef OXS_DEMAG_REAL_ANALYTIC DR;
+  typedef DR (*NewellFunc)(DR,DR,DR);
+  static const NewellFunc newell[OLDTV_KERNELSIZE]
+    = { Oxs_Newell_f_xx, Oxs_Newell_g_xy, Oxs_Newell_g_xz,
+        Oxs_Newell_f_yy, Oxs_Newell_g_yz, Oxs_Newell_f_zz };
+
+  const OC_REAL8m dx = mesh->EdgeLengthX();
+  const OC_REAL8m dy = mesh->EdgeLengthY();
+  K.assign(OLDTV_KERNELSIZE*rdimx*rdimy,0.0);
+
+  // Near field region.  Points (i,j) with i<na and j<nb are computed
+  // from the analytic formula; all others by quadrature.
+  OC_REAL8m h = (dx>dy ? dx : dy);
+  if(ta>h) h = ta;
+  if(tb>h) h = tb;
+  OC_REAL8m rad = h*pow(0.05/demag_tensor_error,0.1);
+  if(rad<2*h) rad = 2*h;
+  OC_INDEX na=0, nb=0;
+  if(fabs(zoff)<rad) {
+    const OC_REAL8m rxy = sqrt(rad*rad-zoff*zoff);
+    const OC_REAL8m tx = floor(rxy/dx)+1;
+    const OC_REAL8m ty = floor(rxy/dy)+1;
+    na = (tx>=OC_REAL8m(rdimx) ? rdimx : OC_INDEX(tx));
+    nb = (ty>=OC_REAL8m(rdimy) ? rdimy : OC_INDEX(ty));
+  }
+
+  if(na>0 && nb>0) {
+    // Fill S with F(x,y) across [-1,na] x [-1,nb], then take second
+    // differences in x and y.
+    const OC_INDEX sdimx = na+2;
+    const OC_INDEX sdimy = nb+2;
+    vector<DR> S(OLDTV_KERNELSIZE*sdimx*sdimy);
+    const DR ddx(dx), ddy(dy);
+    const DR hsum  = 0.5*(DR(ta)+DR(tb));
+    const DR hdiff = 0.5*(DR(ta)-DR(tb));
+    const DR zeta0 = DR(zoff)+hsum;
+    const DR zeta1 = DR(zoff)+hdiff;
+    const DR zeta2 = DR(zoff)-hdiff;
+    const DR zeta3 = DR(zoff)-hsum;
+    Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (sdimy,[&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
+        for(OC_INDEX j=jstart;j<jstop;++j) {
+          const DR y = DR(double(j-1))*ddy;
+          for(OC_INDEX i=0;i<sdimx;++i) {
+            const DR x = DR(double(i-1))*ddx;
+            DR* sptr = &(S[OLDTV_KERNELSIZE*(j*sdimx+i)]);
+            for(int c=0;c<OLDTV_KERNELSIZE;++c) {
+              const NewellFunc f = newell[c];
+              sptr[c] = f(x,y,zeta0) - f(x,y,zeta1)
+                      - f(x,y,zeta2) + f(x,y,zeta3);
+            }
+          }
+        }
+      });
+
+    const DR scale
+      = DR(-1.0)/(4*OXS_DEMAG_REAL_ANALYTIC_PI*ddx*ddy);
+    for(OC_INDEX j=0;j<nb;++j) {
+      for(OC_INDEX i=0;i<na;++i) {
+        for(int c=0;c<OLDTV_KERNELSIZE;++c) {
+          DR sum[3];
+          for(int jj=0;jj<3;++jj) {
+            const DR* srow
+              = &(S[OLDTV_KERNELSIZE*((j+jj)*sdimx+i)+c]);
+            sum[jj] = srow[0] - 2*srow[OLDTV_KERNELSIZE]
+              + srow[2*OLDTV_KERNELSIZE];
+          }
+          DR val = (sum[0] - 2*sum[1] + sum[2])*scale;
+          val.DownConvert(K[OLDTV_KERNELSIZE*(j*rdimx+i)+c]);
+        }
+      }
+    }
+  }
+
+  // Far field
+  OC_REAL8m xnode[5],xweight[5],ynode[5],yweight[5],znode[5],zweight[5];
+  Oxs_LayeredDemagQuadrature(dx,dx,xnode,xweight);
+  Oxs_LayeredDemagQuadrature(dy,dy,ynode,yweight);
+  Oxs_LayeredDemagQuadrature(ta,tb,znode,zweight);
+  const OC_REAL8m mult = -dx*dy*ta*tb/(4*PI);
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (rdimy,[&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        const OC_REAL8m y = dy*j;
+        for(OC_INDEX i=(j<nb ? na : 0);i<rdimx;++i) {
+          const OC_REAL8m x = dx*i;
+          OC_REAL8m sum[OLDTV_KERNELSIZE] = { 0,0,0,0,0,0 };
+          for(int kz=0;kz<5;++kz) {
+            const OC_REAL8m Z = zoff + znode[kz];
+            for(int ky=0;ky<5;++ky) {
+              const OC_REAL8m Y = y + ynode[ky];
+              const OC_REAL8m wyz = yweight[ky]*zweight[kz];
+              for(int kx=0;kx<5;++kx) {
+                const OC_REAL8m X = x + xnode[kx];
+                const OC_REAL8m rsq = X*X+Y*Y+Z*Z;
+                const OC_REAL8m r = sqrt(rsq);
+                const OC_REAL8m w = xweight[kx]*wyz/(rsq*rsq*r);
+                const OC_REAL8m w3 = 3*w;
+                const OC_REAL8m wr = w*rsq;
+                sum[0] += w3*X*X - wr;
+                sum[1] += w3*X*Y;
+                sum[2] += w3*X*Z;
+                sum[3] += w3*Y*Y - wr;
+                sum[4] += w3*Y*Z;
+                sum[5] += w3*Z*Z - wr;
+              }
+            }
+          }
+          OC_REAL8m* kptr = &(K[OLDTV_KERNELSIZE*(j*rdimx+i)]);
+          for(int c=0;c<OLDTV_KERNELSIZE;++c) kptr[c] = mult*sum[c];
+        }
+      }
+    });
+
+  if(self) {
+    // Self term from Oxs_SelfDemagN?, and by symmetry the xz and yz
+    // components vanish inside a layer.
+    const DR ddx(dx), ddy(dy), dta(ta);
+    DR nxx = Oxs_SelfDemagNx(ddx,ddy,dta)*dta;
+    DR nyy = Oxs_SelfDemagNy(ddx,ddy,dta)*dta;
+    DR nzz = Oxs_SelfDemagNz(ddx,ddy,dta)*dta;
+    nxx.DownConvert(K[0]);
+    K[1] = 0.0;
+    nyy.DownConvert(K[3]);
+    nzz.DownConvert(K[5]);
+    for(OC_INDEX m=0;m<rdimx*rdimy;++m) {
+      K[OLDTV_KERNELSIZE*m+2] = K[OLDTV_KERNELSIZE*m+4] = 0.0;
+    }
+  }
+}
+
+void Oxs_LayeredDemag::FillCoefficientArrays(const Oxs_Mesh* genmesh) const
+{ // This routine is conceptually const.
+  const Oxs_RectangularMesh* mesh
+    = dynamic_cast<const Oxs_RectangularMesh*>(genmesh);
+  if(mesh==NULL) {
+    String msg = String("Object ")
+      + String(genmesh->InstanceName())
+      + String(" is not a (non-periodic) rectangular mesh.");
+    throw Oxs_ExtError(this,msg);
+  }
+
+  // Clean-up from previous allocation, if any.
+  ReleaseMemory();
+
+  // Fill dimension variables
+  rdimx = mesh->DimX();
+  rdimy = mesh->DimY();
+  layer_count = mesh->DimZ();
+  if(rdimx==0 || rdimy==0 || layer_count==0) return; // Empty mesh!
+
+  // Layer geometry
+  vector<OC_REAL8m> thick(layer_count,mesh->EdgeLengthZ());
+  if(layer_thickness.size()==1) {
+    thick.assign(layer_count,layer_thickness[0]);
+  } else if(layer_thickness.size()>1) {
+    if(OC_INDEX(layer_thickness.size()) != layer_count) {
+      char msgbuf[1024];
+      Oc_Snprintf(msgbuf,sizeof(msgbuf),
+                  "layer_thickness list has %lu entries, but mesh has"
+                  " %ld layers.  Specify either one thickness, or one"
+                  " thickness per layer.",
+                  (unsigned long)layer_thickness.size(),
+                  (long)layer_count);
+      throw Oxs_ExtError(this,msgbuf);
+    }
+    thick = layer_thickness;
+  }
+  vector<OC_REAL8m> gap(layer_count,0.0); // Last entry unused
+  if(layer_spacing.size()==1) {
+    gap.assign(layer_count,layer_spacing[0]);
+  } else if(layer_spacing.size()>1) {
+    if(OC_INDEX(layer_spacing.size()) != layer_count-1) {
+      char msgbuf[1024];
+      Oc_Snprintf(msgbuf,sizeof(msgbuf),
+                  "layer_spacing list has %lu entries, but mesh has"
+                  " %ld layers.  Specify either one spacing, or one"
+                  " spacing per pair of adjacent layers.",
+                  (unsigned long)layer_spacing.size(),
+                  (long)layer_count);
+      throw Oxs_ExtError(this,msgbuf);
+    }
+    std::copy(layer_spacing.begin(),layer_spacing.end(),gap.begin());
+  }
+  vector<OC_REAL8m> zc(layer_count); // Layer centers
+  zc[0] = 0.5*thick[0];
+  for(OC_INDEX k=1;k<layer_count;++k) {
+    zc[k] = zc[k-1] + 0.5*thick[k-1] + gap[k-1] + 0.5*thick[k];
+  }
+
+  // Transform dimensions.  If a dimension equals 1, then zero padding
+  // is not required.  Otherwise, zero pad to at least twice the
+  // dimension.  No transform is taken along z.
+  OC_INDEX cdimz_unused;
+  Oxs_FFT3DThreeVector::RecommendDimensions((rdimx==1 ? 1 : 2*rdimx),
+                                            (rdimy==1 ? 1 : 2*rdimy),
+                                            1,cdimx,cdimy,cdimz_unused);
+
+  // Overflow test; restrict to signed value range
+  {
+    OC_INDEX testval = OC_INDEX_MAX/(2*OLDTV_VECSIZE);
+    testval /= cdimx;
+    testval /= cdimy;
+    if(testval<layer_count || cdimx<rdimx || cdimy<rdimy) {
+      char msgbuf[1024];
+      Oc_Snprintf(msgbuf,sizeof(msgbuf),"Requested mesh size ("
+                  "%" OC_INDEX_MOD "d x "
+                  "%" OC_INDEX_MOD "d x "
+                  "%" OC_INDEX_MOD "d)"
+                  " has too many elements",rdimx,rdimy,layer_count);
+      throw Oxs_ExtError(this,msgbuf);
+    }
+  }
+
+  Oxs_FFT1DThreeVector xfft;
+  xfft.SetDimensions(rdimx,(cdimx==1 ? 1 : 2*(cdimx-1)),rdimy);
+  Oxs_FFTStrided yfft;
+  yfft.SetDimensions(rdimy,cdimy,
+                     OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*cdimx,
+                     OLDTV_VECSIZE*cdimx);
+  const OC_INDEX ldimx = xfft.GetLogicalDimension();
+  const OC_INDEX ldimy = yfft.GetLogicalDimension();
+  adimy = (ldimy/2)+1;
+
+  // Since H = -N*M, we store -N (scaled by the FFT normalization) so
+  // the transform output needs no further adjustment.
+  const OXS_FFT_REAL_TYPE fft_scaling
+    = -1 * xfft.GetScaling() * yfft.GetScaling();
+
+  // Collect distinct layer pair geometries.  The kernel for pair (p,q)
+  // with p>q is the (q,p) kernel reflected through the origin, which
+  // flips the sign of the xz and yz components.
+  struct KernelKey {
+    OC_REAL8m ta, tb, zoff;
+    OC_BOOL self;
+  };
+  vector<KernelKey> keys;
+  const OC_REAL8m keytol = 16*OC_REAL8m_EPSILON
+    *(zc[layer_count-1]+0.5*thick[layer_count-1]);
+  kernel_offset.resize(layer_count*layer_count);
+  layer_weight.resize(layer_count);
+  source_weight.resize(layer_count);
+  for(OC_INDEX p=0;p<layer_count;++p) {
+    for(OC_INDEX q=0;q<layer_count;++q) {
+      const OC_INDEX lo = (p<q ? p : q);
+      const OC_INDEX hi = (p<q ? q : p);
+      KernelKey key;
+      key.ta = thick[lo];
+      key.tb = thick[hi];
+      key.zoff = zc[lo] - zc[hi];
+      key.self = (p==q);
+      size_t u=0;
+      while(u<keys.size()) {
+        if(keys[u].self == key.self
+           && fabs(keys[u].ta-key.ta)<=keytol
+           && fabs(keys[u].tb-key.tb)<=keytol
+           && fabs(keys[u].zoff-key.zoff)<=keytol) break;
+        ++u;
+      }
+      if(u==keys.size()) keys.push_back(key);
+      kernel_offset[p*layer_count+q] = OC_INDEX(u)*OLDTV_KERNELSIZE;
+    }
+    layer_weight[p] = 1.0/thick[p];
+    source_weight[p] = mesh->EdgeLengthZ()/thick[p];
+  }
+  kernel_count = OC_INDEX(keys.size());
+
+  // Compute and transform kernels.  As in Oxs_Demag, the symmetric
+  // (even or odd) extension of each component across the padded
+  // transform domain is transformed using half-length transforms of
+  // the first quadrant, keeping the real part for even symmetry and
+  // the imaginary part for odd symmetry.  Each axis contributes a
+  // factor of 2, and each odd axis a factor of sqrt(-1).  Nxy is odd
+  // in x and y, so its transform is real with a -1 factor.  Nxz and
+  // Nyz are odd along one axis only, so their transforms are pure
+  // imaginary; A holds the imaginary part.
+  A.assign(cdimx*adimy*kernel_count*OLDTV_KERNELSIZE,0.0);
+  {
+    vector<OC_REAL8m> K;
+    vector<OXS_FFT_REAL_TYPE> T(OLDTV_KERNELSIZE*cdimx*rdimy);
+    vector<OXS_FFT_REAL_TYPE> sourcebuf;
+    vector<OXS_FFT_REAL_TYPE> targetbuf;
+    Oxs_FFT1DThreeVector workfft;
+    for(OC_INDEX u=0;u<kernel_count;++u) {
+      ComputeKernel(mesh,keys[u].ta,keys[u].tb,keys[u].zoff,
+                    keys[u].self,K);
+
+      // FFTs in x-direction; results to T, indexed as [j][i][c].
+      workfft.SetDimensions(rdimx,ldimx,1);
+      sourcebuf.resize(OLDTV_VECSIZE*rdimx);
+      targetbuf.resize(OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*cdimx);
+      for(OC_INDEX j=0;j<rdimy;++j) {
+        const OC_REAL8m* krow = &(K[OLDTV_KERNELSIZE*j*rdimx]);
+        OXS_FFT_REAL_TYPE* trow = &(T[OLDTV_KERNELSIZE*j*cdimx]);
+        // xx, yy, zz: even in x
+        for(OC_INDEX i=0;i<rdimx;++i) {
+          sourcebuf[OLDTV_VECSIZE*i]   = krow[OLDTV_KERNELSIZE*i];
+          sourcebuf[OLDTV_VECSIZE*i+1] = krow[OLDTV_KERNELSIZE*i+3];
+          sourcebuf[OLDTV_VECSIZE*i+2] = krow[OLDTV_KERNELSIZE*i+5];
+        }
+        sourcebuf[0] *= 0.5; sourcebuf[1] *= 0.5; sourcebuf[2] *= 0.5;
+        workfft.ForwardRealToComplexFFT(&(sourcebuf[0]),&(targetbuf[0]));
+        for(OC_INDEX i=0;i<cdimx;++i) {
+          trow[OLDTV_KERNELSIZE*i]   = targetbuf[6*i];
+          trow[OLDTV_KERNELSIZE*i+3] = targetbuf[6*i+2];
+          trow[OLDTV_KERNELSIZE*i+5] = targetbuf[6*i+4];
+        }
+        // xy, xz: odd in x.  yz: even in x
+        for(OC_INDEX i=0;i<rdimx;++i) {
+          sourcebuf[OLDTV_VECSIZE*i]   = krow[OLDTV_KERNELSIZE*i+1];
+          sourcebuf[OLDTV_VECSIZE*i+1] = krow[OLDTV_KERNELSIZE*i+2];
+          sourcebuf[OLDTV_VECSIZE*i+2] = krow[OLDTV_KERNELSIZE*i+4];
+        }
+        sourcebuf[0] = 0.0; sourcebuf[1] = 0.0; sourcebuf[2] *= 0.5;
+        workfft.ForwardRealToComplexFFT(&(sourcebuf[0]),&(targetbuf[0]));
+        for(OC_INDEX i=0;i<cdimx;++i) {
+          trow[OLDTV_KERNELSIZE*i+1] = targetbuf[6*i+1];
+          trow[OLDTV_KERNELSIZE*i+2] = targetbuf[6*i+3];
+          trow[OLDTV_KERNELSIZE*i+4] = targetbuf[6*i+4];
+        }
+      }
+
+      // FFTs in y-direction; results to A.
+      workfft.SetDimensions(rdimy,ldimy,1);
+      sourcebuf.resize(OLDTV_VECSIZE*rdimy);
+      targetbuf.resize(OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*adimy);
+      for(OC_INDEX i=0;i<cdimx;++i) {
+        // xx, yy, zz: even in y
+        for(OC_INDEX j=0;j<rdimy;++j) {
+          const OXS_FFT_REAL_TYPE* tptr
+            = &(T[OLDTV_KERNELSIZE*(j*cdimx+i)]);
+          sourcebuf[OLDTV_VECSIZE*j]   = tptr[0];
+          sourcebuf[OLDTV_VECSIZE*j+1] = tptr[3];
+          sourcebuf[OLDTV_VECSIZE*j+2] = tptr[5];
+        }
+        sourcebuf[0] *= 0.5; sourcebuf[1] *= 0.5; sourcebuf[2] *= 0.5;
+        workfft.ForwardRealToComplexFFT(&(sourcebuf[0]),&(targetbuf[0]));
+        for(OC_INDEX j=0;j<adimy;++j) {
+          OXS_FFT_REAL_TYPE* aptr
+            = &(A[((i*adimy+j)*kernel_count+u)*OLDTV_KERNELSIZE]);
+          aptr[0] = 4*fft_scaling*targetbuf[6*j];
+          aptr[3] = 4*fft_scaling*targetbuf[6*j+2];
+          aptr[5] = 4*fft_scaling*targetbuf[6*j+4];
+        }
+        // xy, yz: odd in y.  xz: even in y
+        for(OC_INDEX j=0;j<rdimy;++j) {
+          const OXS_FFT_REAL_TYPE* tptr
+            = &(T[OLDTV_KERNELSIZE*(j*cdimx+i)]);
+          sourcebuf[OLDTV_VECSIZE*j]   = tptr[1];
+          sourcebuf[OLDTV_VECSIZE*j+1] = tptr[2];
+          sourcebuf[OLDTV_VECSIZE*j+2] = tptr[4];
+        }
+        sourcebuf[0] = 0.0; sourcebuf[1] *= 0.5; sourcebuf[2] = 0.0;
+        workfft.ForwardRealToComplexFFT(&(sourcebuf[0]),&(targetbuf[0]));
+        for(OC_INDEX j=0;j<adimy;++j) {
+          OXS_FFT_REAL_TYPE* aptr
+            = &(A[((i*adimy+j)*kernel_count+u)*OLDTV_KERNELSIZE]);
+          aptr[1] = -4*fft_scaling*targetbuf[6*j+1];
+          aptr[2] =  4*fft_scaling*targetbuf[6*j+2];
+          aptr[4] =  4*fft_scaling*targetbuf[6*j+5];
+        }
+      }
+    }
+  }
+
+  // Workspace and per-thread FFT objects
+  Hxfrm.resize(OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*cdimx*cdimy*layer_count);
+  const int thread_count = Oc_GetMaxThreadCount();
+  fftx.assign(thread_count,xfft);
+  ffty.assign(thread_count,yfft);
+  Mwork.assign(thread_count,vector<OXS_FFT_REAL_TYPE>
+               (2*OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*layer_count));
+}
+
+void Oxs_LayeredDemag::ComputeEnergy
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyData& oced
+ ) const
+{
+  // (Re)-initialize mesh coefficient array if mesh has changed.
+  if(mesh_id != state.mesh->Id()) {
+    mesh_id = 0; // Safety
+    FillCoefficientArrays(state.mesh);
+    mesh_id = state.mesh->Id();
+    energy_density_error_estimate
+      = 0.5*OC_REAL8m_EPSILON*MU0*state.max_absMs*state.max_absMs
+      *(log(double(cdimx))+log(double(cdimy))
+        +log(double(layer_count)))/log(2.);
+  }
+  oced.energy_density_error_estimate = energy_density_error_estimate;
+
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+
+  Oxs_MeshValue<ThreeVector>& field
+    = *(oced.H != 0 ? oced.H : oced.scratch_H);
+  field.AdjustSize(state.mesh);
+
+  const OC_INDEX rsize = Ms.Size();
+  assert(rdimx*rdimy*layer_count == rsize);
+  if(rsize==0) {
+    oced.energy_sum = 0.0;
+    oced.pE_pt = 0.0;
+    return;
+  }
+
+  const int thread_count = Oc_GetMaxThreadCount();
+  if(int(fftx.size())<thread_count) {
+    // Thread count changed since FillCoefficientArrays
+    Oxs_FFT1DThreeVector xfft = fftx[0];
+    Oxs_FFTStrided yfft = ffty[0];
+    fftx.assign(thread_count,xfft);
+    ffty.assign(thread_count,yfft);
+    Mwork.assign(thread_count,vector<OXS_FFT_REAL_TYPE>
+                 (2*OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*layer_count));
+  }
+
+#if (3*OC_REAL8m_WIDTH) != OC_THREE_VECTOR_REAL8m_WIDTH
+# error Oxs_ThreeVector not tightly packed.
+#endif
+  // The x-axis FFTs pun the ThreeVector arrays spin and field into
+  // OXS_FFT_REAL_TYPE arrays.
+  const OXS_FFT_REAL_TYPE* const sptr
+    = static_cast<const OXS_FFT_REAL_TYPE*>
+    (static_cast<const void*>(&spin[OC_INDEX(0)]));
+  const OXS_FFT_REAL_TYPE* const msptr = &Ms[OC_INDEX(0)];
+  OXS_FFT_REAL_TYPE* const fptr
+    = static_cast<OXS_FFT_REAL_TYPE*>(static_cast<void*>(&field[OC_INDEX(0)]));
+  OXS_FFT_REAL_TYPE* const hptr = &(Hxfrm[0]);
+
+  const OC_INDEX rjstride = OLDTV_VECSIZE*rdimx;
+  const OC_INDEX jstride = OLDTV_COMPLEXSIZE*OLDTV_VECSIZE*cdimx;
+  const OC_INDEX kstride = jstride*cdimy;
+  const OC_INDEX row_count = rdimy*layer_count;
+
+  // Forward x-axis FFTs, one row at a time, with Ms multiplied in on
+  // the fly.  Runs of rows within a layer are done in one call.
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (row_count,[&](OC_INT4m thread_id,OC_INDEX rstart,OC_INDEX rstop) {
+      Oxs_FFT1DThreeVector& xfft = fftx[thread_id];
+      OC_INDEX r = rstart;
+      while(r<rstop) {
+        const OC_INDEX k = r/rdimy;
+        const OC_INDEX j = r - k*rdimy;
+        OC_INDEX run = (k+1)*rdimy - r;
+        if(r+run>rstop) run = rstop - r;
+        xfft.AdjustArrayCount(run);
+        xfft.ForwardRealToComplexFFT(sptr+r*rjstride,
+                                     hptr+k*kstride+j*jstride,
+                                     msptr+r*rdimx);
+        r += run;
+      }
+    });
+
+  // For each block of x-frequencies, forward y-axis FFTs in each
+  // layer, the layer coupling at each frequency, and inverse y-axis
+  // FFTs.  At each frequency, for target layer p and source layer q,
+  //
+  //   H_p += w_p * [ Axx   Axy   iBxz ] [ s_q*Mx_q ]
+  //                [ Axy   Ayy   iByz ] [ s_q*My_q ]
+  //                [ iBxz  iByz  Azz  ] [ s_q*Mz_q ]
+  //
+  // with w_p = 1/t_p and s_q = dz/t_q.  Axy and Byz are odd in y, so for j>=adimy the
+  // y-components of M and H are negated instead.  Likewise Bxz and Byz
+  // flip sign for p>q, so those sources are summed with Mz negated and
+  // the z-component of that partial sum is negated.
+  const OC_INDEX lcount = layer_count;
+  const OC_INDEX mstride = OLDTV_COMPLEXSIZE*OLDTV_VECSIZE;
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (cdimx,[&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+      Oxs_FFTStrided& yfft = ffty[thread_id];
+      OXS_FFT_REAL_TYPE* mw = &(Mwork[thread_id][0]); // M_q
+      OXS_FFT_REAL_TYPE* mwz = mw + mstride*lcount;    // M_q, Mz negated
+      for(OC_INDEX i1=istart;i1<istop;i1+=OLDTV_COLUMN_BLOCK) {
+        OC_INDEX i2 = i1 + OLDTV_COLUMN_BLOCK;
+        if(i2>istop) i2 = istop;
+        yfft.AdjustArrayCount(OLDTV_VECSIZE*(i2-i1));
+        for(OC_INDEX k=0;k<lcount;++k) {
+          yfft.ForwardFFT(hptr+k*kstride+mstride*i1);
+        }
+        for(OC_INDEX j=0;j<cdimy;++j) {
+          const OC_INDEX ja = (j<adimy ? j : cdimy-j);
+          const OXS_FFT_REAL_TYPE ysign = (j<adimy ? 1 : -1);
+          for(OC_INDEX i=i1;i<i2;++i) {
+            OXS_FFT_REAL_TYPE* hbase = hptr + j*jstride + mstride*i;
+            for(OC_INDEX q=0;q<lcount;++q) {
+              const OXS_FFT_REAL_TYPE* h = hbase + q*kstride;
+              OXS_FFT_REAL_TYPE* m = mw + mstride*q;
+              OXS_FFT_REAL_TYPE* mz = mwz + mstride*q;
+              const OXS_FFT_REAL_TYPE s = source_weight[q];
+              const OXS_FFT_REAL_TYPE sy = ysign*s;
+              m[0] = mz[0] = s*h[0];
+              m[1] = mz[1] = s*h[1];
+              m[2] = mz[2] = sy*h[2];
+              m[3] = mz[3] = sy*h[3];
+              m[4] = s*h[4];  mz[4] = -m[4];
+              m[5] = s*h[5];  mz[5] = -m[5];
+            }
+            const OXS_FFT_REAL_TYPE* abase
+              = &(A[(i*adimy+ja)*kernel_count*OLDTV_KERNELSIZE]);
+            for(OC_INDEX p=0;p<lcount;++p) {
+              const OC_INDEX* koff = &(kernel_offset[p*lcount]);
+              OXS_FFT_REAL_TYPE Hx_re=0, Hx_im=0;
+              OXS_FFT_REAL_TYPE Hy_re=0, Hy_im=0;
+              OXS_FFT_REAL_TYPE Hz_re=0, Hz_im=0;
+              for(OC_INDEX q=0;q<p;++q) {
+                const OXS_FFT_REAL_TYPE* a = abase + koff[q];
+                const OXS_FFT_REAL_TYPE* m = mwz + mstride*q;
+                Hx_re += a[0]*m[0] + a[1]*m[2] - a[2]*m[5];
+                Hx_im += a[0]*m[1] + a[1]*m[3] + a[2]*m[4];
+                Hy_re += a[1]*m[0] + a[3]*m[2] - a[4]*m[5];
+                Hy_im += a[1]*m[1] + a[3]*m[3] + a[4]*m[4];
+                Hz_re -= a[5]*m[4] - a[2]*m[1] - a[4]*m[3];
+                Hz_im -= a[5]*m[5] + a[2]*m[0] + a[4]*m[2];
+              }
+              for(OC_INDEX q=p;q<lcount;++q) {
+                const OXS_FFT_REAL_TYPE* a = abase + koff[q];
+                const OXS_FFT_REAL_TYPE* m = mw + mstride*q;
+                Hx_re += a[0]*m[0] + a[1]*m[2] - a[2]*m[5];
+                Hx_im += a[0]*m[1] + a[1]*m[3] + a[2]*m[4];
+                Hy_re += a[1]*m[0] + a[3]*m[2] - a[4]*m[5];
+                Hy_im += a[1]*m[1] + a[3]*m[3] + a[4]*m[4];
+                Hz_re += a[5]*m[4] - a[2]*m[1] - a[4]*m[3];
+                Hz_im += a[5]*m[5] + a[2]*m[0] + a[4]*m[2];
+              }
+              const OXS_FFT_REAL_TYPE w = layer_weight[p];
+              const OXS_FFT_REAL_TYPE wy = ysign*w;
+              OXS_FFT_REAL_TYPE* h = hbase + p*kstride;
+              h[0] =  w*Hx_re;  h[1] =  w*Hx_im;
+              h[2] = wy*Hy_re;  h[3] = wy*Hy_im;
+              h[4] =  w*Hz_re;  h[5] =  w*Hz_im;
+            }
+          }
+        }
+        for(OC_INDEX k=0;k<lcount;++k) {
+          yfft.InverseFFT(hptr+k*kstride+mstride*i1);
+        }
+      }
+    });
+
+  // Inverse x-axis FFTs into field, followed by the pointwise energy
+  // density -0.5*MU0*<M,H> and output arrays for the same rows.
+  vector<Oxs_Energy::SUMTYPE> thread_esum(thread_count,0.0);
+  const OXS_FFT_REAL_TYPE emult =  -0.5 * MU0;
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (row_count,[&](OC_INT4m thread_id,OC_INDEX rstart,OC_INDEX rstop) {
+      Oxs_FFT1DThreeVector& xfft = fftx[thread_id];
+      OC_INDEX r = rstart;
+      while(r<rstop) {
+        const OC_INDEX k = r/rdimy;
+        const OC_INDEX j = r - k*rdimy;
+        OC_INDEX run = (k+1)*rdimy - r;
+        if(r+run>rstop) run = rstop - r;
+        xfft.AdjustArrayCount(run);
+        xfft.InverseComplexToRealFFT(hptr+k*kstride+j*jstride,
+                                     fptr+r*rjstride);
+        r += run;
+      }
+      Oxs_Energy::SUMTYPE esum = 0.0;
+      for(OC_INDEX i=rstart*rdimx;i<rstop*rdimx;++i) {
+        OXS_FFT_REAL_TYPE dot = spin[i]*field[i];
+        ThreeVector torque = spin[i]^field[i];
+        OC_REAL8m ei = emult * dot * Ms[i];
+        esum += ei;
+        if(oced.H_accum)           (*oced.H_accum)[i] += field[i];
+        if(oced.energy)             (*oced.energy)[i]  = ei;
+        if(oced.energy_accum) (*oced.energy_accum)[i] += ei;
+        if(oced.mxH)                   (*oced.mxH)[i]  = torque;
+        if(oced.mxH_accum)       (*oced.mxH_accum)[i] += torque;
+      }
+      thread_esum[thread_id] += esum;
+    });
+  Oxs_Energy::SUMTYPE esum = 0.0;
+  for(int t=0;t<thread_count;++t) esum += thread_esum[t];
+
+  oced.energy_sum = esum * state.mesh->Volume(0);
+  /// All cells have same volume in an Oxs_RectangularMesh.  Ms is the
+  /// moment per mesh cell volume, so the density times the mesh cell
+  /// volume is the energy of the layer cell.
+
+  oced.pE_pt = 0.0;
+}
@@ -0,0 +1,112 @@
+/* FILE: layereddemag.h            -*-Mode: c++-*-
+ *
+ * Demagnetization field for stacks of thin layers.  Each z-plane of
+ * the mesh is treated as one layer, with its own thickness, and with
+ * optional non-magnetic gaps between successive layers.  The field is
+ * computed with 2D FFTs in the plane of each layer, and the layers are
+ * coupled in frequency space through a precomputed layer-pair demag
+ * tensor.  No zero padding is required along z, and gaps do not
+ * require empty cells.
+ *
+ */
+
+#ifndef _OXS_LAYEREDDEMAG
+#define _OXS_LAYEREDDEMAG
+
+#include <vector>
+
+#include "energy.h"
+#include "fft3v.h"
+#include "key.h"
+#include "mesh.h"
+#include "meshvalue.h"
+#include "simstate.h"
+#include "threevector.h"
+#include "rectangularmesh.h"
+
+/* End includes */
+
+class Oxs_LayeredDemag:public Oxs_Energy {
+private:
+  mutable OC_INDEX rdimx; // Natural size (cells per layer: rdimx*rdimy)
+  mutable OC_INDEX rdimy;
+  mutable OC_INDEX layer_count; // Mesh zdim
+  mutable OC_INDEX cdimx; // Transform size; cdimx is the number of
+  mutable OC_INDEX cdimy; // complex values stored along x.
+  mutable OC_INDEX adimy; // Coefficients stored for j<adimy; the
+  /// remainder follow from symmetry in y.
+
+  mutable OC_UINT4m mesh_id;
+  mutable OC_REAL8m energy_density_error_estimate; // Cached value,
+  /// initialized when mesh changes.
+
+  // Layer geometry, from the MIF input.  layer_thickness has either
+  // one entry, which applies to all layers, or one entry per layer.
+  // layer_spacing is the gap between successive layers, either one
+  // entry or layer_count-1 entries.  An empty layer_thickness list
+  // means use the mesh cell dimension dz.
+  std::vector<OC_REAL8m> layer_thickness;
+  std::vector<OC_REAL8m> layer_spacing;
+  OC_REAL8m demag_tensor_error; // Target accuracy for far field
+
+  // Layer pairs with the same geometry (thicknesses and separation)
+  // share a kernel.  kernel_offset[p*layer_count+q] is the offset in A
+  // of the kernel giving the field at layer p from layer q, which is
+  // scaled by layer_weight[p] (1/thickness of p).  Kernels are stored
+  // for p<=q; for p>q the xz and yz components flip sign.
+  mutable OC_INDEX kernel_count;
+  mutable std::vector<OC_INDEX> kernel_offset;
+  mutable std::vector<OXS_FFT_REAL_TYPE> layer_weight;
+
+  // Ms in the simulation state is the moment per mesh cell volume, so
+  // the magnetization of layer q is Ms*dz/t_q.  source_weight[q] is
+  // dz/t_q, applied to the transformed M of layer q.
+  mutable std::vector<OXS_FFT_REAL_TYPE> source_weight;
+
+  // Transformed kernels, indexed as [i][j][kernel][component] for
+  // 0<=i<cdimx, 0<=j<adimy.  Components are xx, xy, xz, yy, yz, zz.
+  // The xx, xy, yy and zz transforms are real; xz and yz are pure
+  // imaginary, and the imaginary part is stored.  The FFT scaling and
+  // the -1 in H = -N*M are folded in.
+  mutable std::vector<OXS_FFT_REAL_TYPE> A;
+
+  // Hxfrm holds the transform of M and H, layer by layer, each layer
+  // an array of cdimx x cdimy complex three vectors.
+  mutable std::vector<OXS_FFT_REAL_TYPE> Hxfrm;
+
+  // One FFT object and one scratch buffer per thread.  The scratch
+  // buffer holds the transformed M for each layer at one frequency,
+  // and a copy with Mz negated.
+  mutable std::vector<Oxs_FFT1DThreeVector> fftx;
+  mutable std::vector<Oxs_FFTStrided> ffty;
+  mutable std::vector< std::vector<OXS_FFT_REAL_TYPE> > Mwork;
+
+  void ComputeKernel(const Oxs_RectangularMesh* mesh,
+                     OC_REAL8m ta,OC_REAL8m tb,OC_REAL8m zoff,
+                     OC_BOOL self,std::vector<OC_REAL8m>& K) const;
+  void FillCoefficientArrays(const Oxs_Mesh* mesh) const;
+  /// Conceptually const.
+
+  void ReleaseMemory() const; // Conceptually const.
+
+protected:
+  virtual void GetEnergy(const Oxs_SimState& state,
+                         Oxs_EnergyData& oed) const {
+    GetEnergyAlt(state,oed);
+  }
+
+  virtual void ComputeEnergy(const Oxs_SimState& state,
+                             Oxs_ComputeEnergyData& oced) const;
+
+public:
+  virtual const char* ClassName() const; // ClassName() is
+  /// automatically generated by the OXS_EXT_REGISTER macro.
+  Oxs_LayeredDemag(const char* name,     // Child instance id
+                   Oxs_Director* newdtr, // App director
+                   const char* argstr);  // MIF input block parameters
+  virtual ~Oxs_LayeredDemag() { ReleaseMemory(); }
+  virtual OC_BOOL Init();
+};
+
+
+#endif // _OXS_LAYEREDDEMAG
@@ -29,7 +29,8 @@ Oxs_MinDriver::Oxs_MinDriver(
   Oxs_Director* newdtr, // App director
   const char* argstr)   // MIF input block parameters
   : Oxs_Driver(name,newdtr,argstr),
-    max_mxHxm_output_obj_ptr(NULL), total_energy_output_obj_ptr(NULL)
+    max_mxHxm_output_obj_ptr(NULL), total_energy_output_obj_ptr(NULL),
+    last_energy_key("Last energy"), total_energy_key("Total energy")
 {
   // Process arguments
   // Get evolver name specification
@@ -63,7 +64,7 @@ Oxs_MinDriver::GetInitialState() const
   const Oxs_SimState& fstate = initial_state.GetReadReference();
   /// Release write lock. The read lock will be automatically
   /// released when the key "initial_state" is destroyed.
-  fstate.AddDerivedData("Last energy",0.);
+  fstate.AddDerivedData(last_energy_key,0.);
   return initial_state;
 }
 
@@ -194,7 +195,7 @@ OC_REAL8m
 Oxs_MinDriver::GetTotalEnergy(const Oxs_SimState& tstate) const
 {
   OC_REAL8m tenergy;
-  if(!tstate.GetDerivedData("Total energy",tenergy)) {
+  if(!tstate.GetDerivedData(total_energy_key,tenergy)) {
     // Energy field not filled in tstate.  Try calling output
     // object, which should call necessary update functions.
     Tcl_Interp* mif_interp = director->GetMifInterp();
@@ -234,7 +235,7 @@ void Oxs_MinDriver::FillStateDerivedData
   // Keep track of energy from previous state.  This is used
   // by "Delta E" output.
   OC_REAL8m old_energy = GetTotalEnergy(old_state);
-  new_state.AddDerivedData("Last energy",old_energy);
+  new_state.AddDerivedData(last_energy_key,old_energy);
 }
 
 void Oxs_MinDriver::FillNewStageStateDerivedData
@@ -245,7 +246,7 @@ void Oxs_MinDriver::FillNewStageStateDerivedData
   Oxs_Driver::FillNewStageStateDerivedData(old_state,new_stage_number,
                                            new_state);
   OC_REAL8m old_energy = GetTotalEnergy(old_state);
-  new_state.AddDerivedData("Last energy",old_energy);
+  new_state.AddDerivedData(last_energy_key,old_energy);
 }
 
 OC_BOOL
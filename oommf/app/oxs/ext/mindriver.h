@@ -28,6 +28,9 @@ private:
   /// providing "Total energy" data.  This is needed in some cases for
   /// initialization of new states.
 
+  Oxs_DerivedDataKey last_energy_key;  // State derived data keys,
+  Oxs_DerivedDataKey total_energy_key; // set by constructor.
+
   // Done checks, called by parent Oxs_Driver::IsStageDone and
   // Oxs_Driver::IsRunDone functions.
   virtual OC_BOOL ChildIsStageDone(const Oxs_SimState& state) const;
@@ -93,6 +93,10 @@ OC_BOOL Oxs_RandomSiteExchange::Init()
   // immediate predecessor of the current state.
   director->GetDriver()->SimstateHoldRequest(2);
 
+  maxspinangle_key = Oxs_DerivedDataKey(MaxSpinAngleStateName());
+  stage_maxspinangle_key = Oxs_DerivedDataKey(StageMaxSpinAngleStateName());
+  run_maxspinangle_key = Oxs_DerivedDataKey(RunMaxSpinAngleStateName());
+
   return Oxs_Energy::Init();
 }
 
@@ -273,8 +277,7 @@ void Oxs_RandomSiteExchange::ComputeEnergy
   const OC_REAL8m maxang = ( arg >= 1.0 ? 180.0 : asin(arg)*(360.0/PI));
 
   OC_REAL8m dummy_value;
-  String msa_name = MaxSpinAngleStateName();
-  if(state.GetDerivedData(msa_name,dummy_value)) {
+  if(state.GetDerivedData(maxspinangle_key,dummy_value)) {
     // Ideally, energy values would never be computed more than once
     // for any one state, but in practice it seems inevitable that
     // such will occur on occasion.  For example, suppose a user
@@ -313,7 +316,7 @@ void Oxs_RandomSiteExchange::ComputeEnergy
       throw Oxs_ExtError(this,errbuf);
     }
   } else {
-    state.AddDerivedData(msa_name,maxang);
+    state.AddDerivedData(maxspinangle_key,maxang);
   }
 
   // Run and stage angle data depend on data from the previous state.
@@ -326,19 +329,17 @@ void Oxs_RandomSiteExchange::ComputeEnergy
   const Oxs_SimState* oldstate = NULL;
   OC_REAL8m stage_maxang = -1;
   OC_REAL8m run_maxang = -1;
-  String smsa_name = StageMaxSpinAngleStateName();
-  String rmsa_name = RunMaxSpinAngleStateName();
   if(state.previous_state_id &&
      0 != (oldstate
       = director->FindExistingSimulationState(state.previous_state_id)) ) {
     if(oldstate->stage_number != state.stage_number) {
       stage_maxang = 0.0;
     } else {
-      if(oldstate->GetDerivedData(smsa_name,dummy_value)) {
+      if(oldstate->GetDerivedData(stage_maxspinangle_key,dummy_value)) {
         stage_maxang = dummy_value;
       }
     }
-    if(oldstate->GetDerivedData(rmsa_name,dummy_value)) {
+    if(oldstate->GetDerivedData(run_maxspinangle_key,dummy_value)) {
       run_maxang = dummy_value;
     }
   }
@@ -346,13 +347,13 @@ void Oxs_RandomSiteExchange::ComputeEnergy
   if(run_maxang<maxang)   run_maxang = maxang;
 
   // Stage max angle data
-  if(!state.GetDerivedData(smsa_name,dummy_value)) {
-    state.AddDerivedData(smsa_name,stage_maxang);
+  if(!state.GetDerivedData(stage_maxspinangle_key,dummy_value)) {
+    state.AddDerivedData(stage_maxspinangle_key,stage_maxang);
   }
 
   // Run max angle data
-  if(!state.GetDerivedData(rmsa_name,dummy_value)) {
-    state.AddDerivedData(rmsa_name,run_maxang);
+  if(!state.GetDerivedData(run_maxspinangle_key,dummy_value)) {
+    state.AddDerivedData(run_maxspinangle_key,run_maxang);
   }
 }
 
@@ -363,24 +364,21 @@ void Oxs_RandomSiteExchange::UpdateDerivedOutputs(const Oxs_SimState& state)
     = run_maxspinangle_output.cache.state_id
     = 0;  // Mark change in progress
 
-  String dummy_name = MaxSpinAngleStateName();
-  if(!state.GetDerivedData(dummy_name.c_str(),
+  if(!state.GetDerivedData(maxspinangle_key,
                            maxspinangle_output.cache.value)) {
     // Error; This should always be set.  For now, just set the value to
     // -1, but in the future should consider throwing an exception.
     maxspinangle_output.cache.value = -1.0;
   }
 
-  String stage_dummy_name = StageMaxSpinAngleStateName();
-  if(!state.GetDerivedData(stage_dummy_name.c_str(),
+  if(!state.GetDerivedData(stage_maxspinangle_key,
                            stage_maxspinangle_output.cache.value)) {
     // Error; This should always be set.  For now, just set the value to
     // -1, but in the future should consider throwing an exception.
     stage_maxspinangle_output.cache.value = -1.0;
   }
 
-  String run_dummy_name = RunMaxSpinAngleStateName();
-  if(!state.GetDerivedData(run_dummy_name.c_str(),
+  if(!state.GetDerivedData(run_maxspinangle_key,
                            run_maxspinangle_output.cache.value)) {
     // Error; This should always be set.  For now, just set the value to
     // -1, but in the future should consider throwing an exception.
@@ -74,6 +74,9 @@ private:
     dummy_name += ":Run Max Spin Angle";
     return dummy_name;
   }
+  Oxs_DerivedDataKey maxspinangle_key;       // Interned forms of the
+  Oxs_DerivedDataKey stage_maxspinangle_key; // above names, set in Init().
+  Oxs_DerivedDataKey run_maxspinangle_key;
 
 protected:
   virtual void GetEnergy(const Oxs_SimState& state,
@@ -141,6 +141,9 @@ Oxs_RungeKuttaEvolve::Oxs_RungeKuttaEvolve(
     mesh_ispan(0),mesh_jspan(0),mesh_kspan(0),
     mesh_delx(0.0),mesh_dely(0.0),mesh_delz(0.0),
     energy_state_id(0),next_timestep(0.),
+    multirate_extrapolate(1),multirate_base_id(0),
+    multirate_base_stage(0),multirate_base_time(0.),
+    multirate_prev_time(0.),multirate_prev_valid(0),
     rkstep_ptr(NULL),calculate_dm_dt_ptr(NULL)
 {
   // Process arguments
@@ -286,6 +289,23 @@ Oxs_RungeKuttaEvolve::Oxs_RungeKuttaEvolve(
     throw Oxs_ExtError(this,"Unsupported damping style selected.");
   }
 
+  // Multi-rate stepping.  The slow term names are resolved to energy
+  // objects in Init(), after all Specify blocks have been processed.
+  if(FindInitValue("multirate_slow_terms",multirate_slow_names)) {
+    DeleteInitValue("multirate_slow_terms");
+  }
+  multirate_extrapolate = GetIntInitValue("multirate_extrapolate",1);
+  if(!multirate_slow_names.empty()) {
+    String lcmethod = method;
+    Oxs_ToLower(lcmethod);
+    if(lcmethod.compare("rkf54")!=0 && lcmethod.compare("rkf54m")!=0
+       && lcmethod.compare("rkf54s")!=0) {
+      throw Oxs_ExtError(this,"Invalid initialization detected:"
+                         " \"multirate_slow_terms\" requires"
+                         " \"method\" rkf54, rkf54m, or rkf54s.");
+    }
+  }
+
   // Setup outputs
   max_dm_dt_output.Setup(this,InstanceName(),"Max dm/dt","deg/ns",
      &Oxs_RungeKuttaEvolve::UpdateDerivedOutputs);
@@ -369,6 +389,42 @@ OC_BOOL Oxs_RungeKuttaEvolve::Init()
 
   energy_state_id=0;   // Mark as invalid state
   next_timestep=0.;    // Dummy value
+
+  max_dm_dt_key = DataKey("Max dm/dt");
+  dE_dt_key = DataKey("dE/dt");
+  delta_E_key = DataKey("Delta E");
+  pE_pt_key = DataKey("pE/pt");
+  total_E_key = DataKey("Total E");
+  timestep_lower_bound_key = DataKey("Timestep lower bound");
+  aveMx_key = DataKey("Mx");
+  aveMy_key = DataKey("My");
+  aveMz_key = DataKey("Mz");
+  dMx_dt_key = DataKey("dMx/dt");
+  dMy_dt_key = DataKey("dMy/dt");
+  dMz_dt_key = DataKey("dMz/dt");
+
+  // Multi-rate setup
+  multirate_base_field.Release();
+  multirate_prev_field.Release();
+  multirate_fast_field.Release();
+  multirate_scratch.Release();
+  multirate_base_id = 0;
+  multirate_prev_valid = 0;
+  std::vector<Oxs_Energy*> slow_terms;
+  for(const auto& slow_name : multirate_slow_names) {
+    OC_UINT4m match_count;
+    Oxs_Energy* eterm = dynamic_cast<Oxs_Energy*>
+      (director->FindExtObject(slow_name,match_count));
+    if(eterm==NULL || match_count!=1) {
+      String msg = String("Invalid \"multirate_slow_terms\" entry: ")
+        + slow_name
+        + String(" does not uniquely identify an energy term.");
+      throw Oxs_ExtError(this,msg);
+    }
+    slow_terms.push_back(eterm);
+  }
+  SetSlowEnergyTerms(slow_terms);
+
   return 1;
 }
 
@@ -449,6 +505,118 @@ void Oxs_RungeKuttaEvolve::UpdateMeshArrays(const Oxs_Mesh* mesh)
   mesh_id = mesh->Id();
 }
 
+void Oxs_RungeKuttaEvolve::MultirateSetBase(const Oxs_SimState& cstate)
+{
+  if(multirate_base_id == cstate.Id()) {
+    return; // Retry of a rejected step from the same state
+  }
+  if(slow_field_state_id != cstate.Id()) {
+    // Slow field for cstate not available; this is the case at the
+    // start of each run, or if some other state was evaluated after
+    // cstate.  Fill slow_field by evaluating cstate.
+    OC_REAL8m pE_pt;
+    GetEnergyDensity(cstate,temp_energy,NULL,NULL,pE_pt);
+  }
+  if(multirate_extrapolate && multirate_base_id != 0
+     && cstate.previous_state_id == multirate_base_id
+     && cstate.stage_number == multirate_base_stage
+     && cstate.stage_elapsed_time > multirate_base_time) {
+    multirate_prev_field.Swap(multirate_base_field);
+    multirate_prev_time = multirate_base_time;
+    multirate_prev_valid = 1;
+  } else {
+    multirate_prev_valid = 0;
+  }
+  multirate_base_field.Swap(slow_field);
+  slow_field_state_id = 0; // slow_field contents no longer valid
+  multirate_base_id = cstate.Id();
+  multirate_base_stage = cstate.stage_number;
+  multirate_base_time = cstate.stage_elapsed_time;
+}
+
+void Oxs_RungeKuttaEvolve::GetStageTorque
+(const Oxs_SimState& state,
+ Oxs_MeshValue<ThreeVector>& mxH,
+ OC_REAL8m& pE_pt)
+{
+  if(GetSlowEnergyTerms().empty()
+     || director->WellKnownQuantityRequestStatus()) {
+    // Attached well-known quantities must cover all terms, so in that
+    // case the stage uses a full evaluation.
+    GetEnergyDensity(state,temp_energy,&mxH,NULL,pE_pt);
+    return;
+  }
+
+  UpdateFixedSpinList(state.mesh);
+  Oxs_ComputeEnergiesImports ocei(*director,state,GetFastEnergyTerms(),
+                                  GetFixedSpinList(),
+                                  &temp_energy,&multirate_scratch);
+  Oxs_ComputeEnergiesExports ocee;
+  ocee.H = &multirate_fast_field;
+  GetEnergies(ocei,ocee);
+  pE_pt = ocee.pE_pt; // NB: Excludes pE/pt from slow terms
+
+  mxH.AdjustSize(state.mesh);
+  const OC_REAL8m stage_time = state.stage_elapsed_time;
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(Ms[j]==0.0) { // Ignore zero-moment spins
+          mxH[j].Set(0.,0.,0.);
+          continue;
+        }
+        ThreeVector H;
+        MultirateSlowEstimate(stage_time,j,H);
+        H += multirate_fast_field[j];
+        ThreeVector torque = spin[j];
+        torque ^= H;
+        mxH[j] = torque;
+      }
+    });
+  const vector<OC_INDEX>* fixed = GetFixedSpinList();
+  for(auto index : *fixed) mxH[index].Set(0.,0.,0.);
+}
+
+OC_REAL8m
+Oxs_RungeKuttaEvolve::MultirateErrorRate(const Oxs_SimState& endstate) const
+{
+  if(slow_field_state_id != endstate.Id()) {
+    throw Oxs_ExtError(this,"Oxs_RungeKuttaEvolve::MultirateErrorRate:"
+                       " Programming error; slow field not available.");
+  }
+  const OC_REAL8m stage_time = endstate.stage_elapsed_time;
+  const Oxs_MeshValue<ThreeVector>& spin = endstate.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(endstate.Ms);
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  std::vector<OC_REAL8m> thread_max(number_of_threads,0.0);
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m threadid,OC_INDEX jstart,OC_INDEX jstop) {
+      OC_REAL8m thd_max = thread_max[threadid];
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(Ms[j]==0.0) continue;
+        ThreeVector dH;
+        MultirateSlowEstimate(stage_time,j,dH);
+        dH -= slow_field[j];
+        ThreeVector mxdH = spin[j];
+        mxdH ^= dH;
+        const OC_REAL8m a = alpha[j];
+        const OC_REAL8m rate_sq
+          = gamma[j]*gamma[j]*(1+a*a)*mxdH.MagSq();
+        if(rate_sq>thd_max) thd_max = rate_sq;
+      }
+      thread_max[threadid] = thd_max;
+    });
+  OC_REAL8m max_rate_sq = 0.0;
+  for(auto val : thread_max) {
+    if(val>max_rate_sq) max_rate_sq = val;
+  }
+  return sqrt(max_rate_sq);
+}
+
 OC_REAL8m
 Oxs_RungeKuttaEvolve::PositiveTimestepBound
 (OC_REAL8m max_dm_dt)
@@ -614,14 +782,14 @@ void Oxs_RungeKuttaEvolve::Calculate_dm_dt
   // Store average M and dM_dt data in state derived data space.
   // The ave M value might already be set; if so, check that it
   // agrees with the current computation.
-  if(!state_.AddDerivedData(DataName("Mx"),ave_M.x) ||
-     !state_.AddDerivedData(DataName("My"),ave_M.y) ||
-     !state_.AddDerivedData(DataName("Mz"),ave_M.z)) {
+  if(!state_.AddDerivedData(aveMx_key,ave_M.x) ||
+     !state_.AddDerivedData(aveMy_key,ave_M.y) ||
+     !state_.AddDerivedData(aveMz_key,ave_M.z)) {
     // Cache already set.  Check that values agree
     OC_REAL8m mx=0.0, my=0.0, mz=0.0; // Dummy inits to pacify compilers
-    if(!state_.GetDerivedData(DataName("Mx"),mx) ||
-       !state_.GetDerivedData(DataName("My"),my) ||
-       !state_.GetDerivedData(DataName("Mz"),mz)) {
+    if(!state_.GetDerivedData(aveMx_key,mx) ||
+       !state_.GetDerivedData(aveMy_key,my) ||
+       !state_.GetDerivedData(aveMz_key,mz)) {
       throw Oxs_ExtError(this,
          "Oxs_RungeKuttaEvolve::Calculate_dm_dt:"
                          " Programming error; ave M cache not properly set.");
@@ -648,9 +816,9 @@ void Oxs_RungeKuttaEvolve::Calculate_dm_dt
     }
   }
 
-  if(!state_.AddDerivedData(DataName("dMx/dt"),ave_dM_dt.x) ||
-     !state_.AddDerivedData(DataName("dMy/dt"),ave_dM_dt.y) ||
-     !state_.AddDerivedData(DataName("dMz/dt"),ave_dM_dt.z)) {
+  if(!state_.AddDerivedData(dMx_dt_key,ave_dM_dt.x) ||
+     !state_.AddDerivedData(dMy_dt_key,ave_dM_dt.y) ||
+     !state_.AddDerivedData(dMz_dt_key,ave_dM_dt.z)) {
       throw Oxs_ExtError(this,
          "Oxs_RungeKuttaEvolve::Calculate_dm_dt:"
          " Programming error; ave dM/dt cache already set.");
@@ -682,11 +850,11 @@ void Oxs_RungeKuttaEvolve::CheckCache(const Oxs_SimState& cstate)
   /// from the incoming current_state), then timestep is calculated
   /// so that max_dm_dt * timestep = start_dm.
 
-  cache_good &= cstate.GetDerivedData(DataName("Max dm/dt"),max_dm_dt);
-  cache_good &= cstate.GetDerivedData(DataName("dE/dt"),dE_dt);
-  cache_good &= cstate.GetDerivedData(DataName("Delta E"),delta_E);
-  cache_good &= cstate.GetDerivedData(DataName("pE/pt"),pE_pt);
-  cache_good &= cstate.GetDerivedData(DataName("Timestep lower bound"),
+  cache_good &= cstate.GetDerivedData(max_dm_dt_key,max_dm_dt);
+  cache_good &= cstate.GetDerivedData(dE_dt_key,dE_dt);
+  cache_good &= cstate.GetDerivedData(delta_E_key,delta_E);
+  cache_good &= cstate.GetDerivedData(pE_pt_key,pE_pt);
+  cache_good &= cstate.GetDerivedData(timestep_lower_bound_key,
                                       timestep_lower_bound);
   cache_good &= (energy_state_id == cstate.Id());
   cache_good &= (dm_dt_output.cache.state_id == cstate.Id());
@@ -767,7 +935,14 @@ Oxs_RungeKuttaEvolve::AdjustState
   Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
                   (old_spin,
                    [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
-                    for(OC_INDEX j=jstart;j<jstop;++j) {
+                    OC_INDEX j=jstart;
+                    for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+                      Oxs_ThreeVectorPack tempspin(&old_spin[j]);
+                      tempspin.Accum(mstep,Oxs_ThreeVectorPack(&dm_dt[j]));
+                      tempspin.MakeUnit();
+                      tempspin.Store(&new_spin[j]);
+                    }
+                    for(;j<jstop;++j) {
                       ThreeVector tempspin = old_spin[j];
                       tempspin.Accum(mstep,dm_dt[j]);
                       tempspin.MakeUnit();
@@ -802,13 +977,13 @@ void Oxs_RungeKuttaEvolve::NegotiateTimeStep
 
   // Pull needed cached values out from cstate.
   OC_REAL8m max_dm_dt;
-  if(!cstate.GetDerivedData(DataName("Max dm/dt"),max_dm_dt)) {
+  if(!cstate.GetDerivedData(max_dm_dt_key,max_dm_dt)) {
     throw Oxs_ExtError(this,
        "Oxs_RungeKuttaEvolve::NegotiateTimeStep: max_dm_dt not cached.");
   }
   OC_REAL8m timestep_lower_bound=0.;  // Smallest timestep that can actually
   /// change spin with max_dm_dt (due to OC_REAL8_EPSILON restrictions).
-  if(!cstate.GetDerivedData(DataName("Timestep lower bound"),
+  if(!cstate.GetDerivedData(timestep_lower_bound_key,
                             timestep_lower_bound)) {
     throw Oxs_ExtError(this,
        "Oxs_RungeKuttaEvolve::NegotiateTimeStep: "
@@ -1205,20 +1380,20 @@ void Oxs_RungeKuttaEvolve::TakeRungeKuttaStep2
     ave_dM_dt.z = thread_dM_dt_sum[0].z/endstate->Ms->Size();
 #endif // DO_MdM_SUM
   }
-  if(!endstate->AddDerivedData(DataName("Timestep lower bound"),
+  if(!endstate->AddDerivedData(timestep_lower_bound_key,
                                timestep_lower_bound) ||
-     !endstate->AddDerivedData(DataName("Max dm/dt"),max_dm_dt) ||
+     !endstate->AddDerivedData(max_dm_dt_key,max_dm_dt) ||
 #if DO_MdM_SUM
-     !endstate->AddDerivedData(DataName("Mx"),ave_M.x) ||
-     !endstate->AddDerivedData(DataName("My"),ave_M.y) ||
-     !endstate->AddDerivedData(DataName("Mz"),ave_M.z) ||
-     !endstate->AddDerivedData(DataName("dMx/dt"),ave_dM_dt.x) ||
-     !endstate->AddDerivedData(DataName("dMy/dt"),ave_dM_dt.y) ||
-     !endstate->AddDerivedData(DataName("dMz/dt"),ave_dM_dt.z) ||
+     !endstate->AddDerivedData(aveMx_key,ave_M.x) ||
+     !endstate->AddDerivedData(aveMy_key,ave_M.y) ||
+     !endstate->AddDerivedData(aveMz_key,ave_M.z) ||
+     !endstate->AddDerivedData(dMx_dt_key,ave_dM_dt.x) ||
+     !endstate->AddDerivedData(dMy_dt_key,ave_dM_dt.y) ||
+     !endstate->AddDerivedData(dMz_dt_key,ave_dM_dt.z) ||
 #endif // DO_MdM_SUM
-     !endstate->AddDerivedData(DataName("pE/pt"),pE_pt) ||
-     !endstate->AddDerivedData(DataName("Total E"),total_E) ||
-     !endstate->AddDerivedData(DataName("dE/dt"),dE_dt)
+     !endstate->AddDerivedData(pE_pt_key,pE_pt) ||
+     !endstate->AddDerivedData(total_E_key,total_E) ||
+     !endstate->AddDerivedData(dE_dt_key,dE_dt)
      ) {
     throw Oxs_ExtError(this,
                        "Oxs_RungeKuttaEvolve::TakeRungeKuttaStep2:"
@@ -1430,20 +1605,20 @@ void Oxs_RungeKuttaEvolve::TakeRungeKuttaStep2Heun
     ave_dM_dt.z = thread_dM_dt_sum[0].z/endstate->Ms->Size();
 #endif // DO_MdM_SUM
   }
-  if(!endstate->AddDerivedData(DataName("Timestep lower bound"),
+  if(!endstate->AddDerivedData(timestep_lower_bound_key,
                                timestep_lower_bound) ||
-     !endstate->AddDerivedData(DataName("Max dm/dt"),max_dm_dt) ||
+     !endstate->AddDerivedData(max_dm_dt_key,max_dm_dt) ||
 #if DO_MdM_SUM
-     !endstate->AddDerivedData(DataName("Mx"),ave_M.x) ||
-     !endstate->AddDerivedData(DataName("My"),ave_M.y) ||
-     !endstate->AddDerivedData(DataName("Mz"),ave_M.z) ||
-     !endstate->AddDerivedData(DataName("dMx/dt"),ave_dM_dt.x) ||
-     !endstate->AddDerivedData(DataName("dMy/dt"),ave_dM_dt.y) ||
-     !endstate->AddDerivedData(DataName("dMz/dt"),ave_dM_dt.z) ||
+     !endstate->AddDerivedData(aveMx_key,ave_M.x) ||
+     !endstate->AddDerivedData(aveMy_key,ave_M.y) ||
+     !endstate->AddDerivedData(aveMz_key,ave_M.z) ||
+     !endstate->AddDerivedData(dMx_dt_key,ave_dM_dt.x) ||
+     !endstate->AddDerivedData(dMy_dt_key,ave_dM_dt.y) ||
+     !endstate->AddDerivedData(dMz_dt_key,ave_dM_dt.z) ||
 #endif // DO_MdM_SUM
-     !endstate->AddDerivedData(DataName("pE/pt"),pE_pt) ||
-     !endstate->AddDerivedData(DataName("Total E"),total_E) ||
-     !endstate->AddDerivedData(DataName("dE/dt"),dE_dt)) {
+     !endstate->AddDerivedData(pE_pt_key,pE_pt) ||
+     !endstate->AddDerivedData(total_E_key,total_E) ||
+     !endstate->AddDerivedData(dE_dt_key,dE_dt)) {
     throw Oxs_ExtError(this,
                        "Oxs_RungeKuttaEvolve::TakeRungeKuttaStep2Heun:"
                        " Programming error; data cache already set.");
@@ -2254,6 +2429,9 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
   vtmpC.AdjustSize(cstate->mesh);
   vtmpD.AdjustSize(cstate->mesh);
 
+  const OC_BOOL multirate = !GetSlowEnergyTerms().empty();
+  if(multirate) MultirateSetBase(*cstate);
+
   RKTIME_STOP(2,"RKFB54 setup");
 
   // Step 1
@@ -2262,8 +2440,7 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
               next_state_key.GetWriteReference());
   RKTIME_STOP(3,"RKF54 step 1",(cstate->mesh->Size())*9*sizeof(OC_REAL8m));
 
-  GetEnergyDensity(next_state_key.GetReadReference(),temp_energy,
-                   &vtmpA,NULL,pE_pt);
+  GetStageTorque(next_state_key.GetReadReference(),vtmpA,pE_pt);
 
   // Steps 1 and 2
   RKTIME_START(4);
@@ -2278,7 +2455,18 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
       [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
         const Oxs_MeshValue<ThreeVector>& old_spin = cstate->spin;
         Oxs_MeshValue<ThreeVector>& new_spin = newstate.spin;
-        for(OC_INDEX j=jstart;j<jstop;++j) {
+        OC_INDEX j=jstart;
+        for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+          dmdt.ComputeCorePack(j); // Fills vtmpA with dmdt
+          Oxs_ThreeVectorPack vtmp
+            = b21*Oxs_ThreeVectorPack(&current_dm_dt[j])
+            + b22*Oxs_ThreeVectorPack(&vtmpA[j]);
+          vtmp *= stepsize;
+          vtmp += Oxs_ThreeVectorPack(&old_spin[j]);
+          vtmp.MakeUnit();
+          vtmp.Store(&new_spin[j]);
+        }
+        for(;j<jstop;++j) {
           dmdt.ComputeCore(j); // Fills vtmpA with dmdt
           ThreeVector vtmp = b21*current_dm_dt[j] + b22*vtmpA[j];
           vtmp *= stepsize;
@@ -2293,8 +2481,7 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
               (cstate->mesh->Size())*(11+3*4)*sizeof(OC_REAL8m));
 
   // Steps 3 and 4
-  GetEnergyDensity(next_state_key.GetReadReference(),temp_energy,
-                   &vtmpB,NULL,pE_pt);
+  GetStageTorque(next_state_key.GetReadReference(),vtmpB,pE_pt);
   RKTIME_START(5);
   {
     DMDT dmdt(this,next_state_key.GetReadReference(),vtmpB,vtmpB);
@@ -2307,7 +2494,19 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
       [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
         const Oxs_MeshValue<ThreeVector>& old_spin = cstate->spin;
         Oxs_MeshValue<ThreeVector>& new_spin = newstate.spin;
-        for(OC_INDEX j=jstart;j<jstop;++j) {
+        OC_INDEX j=jstart;
+        for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+          dmdt.ComputeCorePack(j); // Fills vtmpB with dmdt
+          Oxs_ThreeVectorPack vtmp
+            = b31*Oxs_ThreeVectorPack(&current_dm_dt[j])
+            + b32*Oxs_ThreeVectorPack(&vtmpA[j])
+            + b33*Oxs_ThreeVectorPack(&vtmpB[j]);
+          vtmp *= stepsize;
+          vtmp += Oxs_ThreeVectorPack(&old_spin[j]);
+          vtmp.MakeUnit();
+          vtmp.Store(&new_spin[j]);
+        }
+        for(;j<jstop;++j) {
           dmdt.ComputeCore(j); // Fills vtmpB with dmdt
           ThreeVector vtmp
             = b31*current_dm_dt[j] + b32*vtmpA[j] + b33*vtmpB[j];
@@ -2323,8 +2522,7 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
               (cstate->mesh->Size())*(11+3*5)*sizeof(OC_REAL8m));
 
   // Steps 5 and 6
-  GetEnergyDensity(next_state_key.GetReadReference(),temp_energy,
-                   &vtmpC,NULL,pE_pt);
+  GetStageTorque(next_state_key.GetReadReference(),vtmpC,pE_pt);
   RKTIME_START(6);
   {
     DMDT dmdt(this,next_state_key.GetReadReference(),vtmpC,vtmpC);
@@ -2337,7 +2535,20 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
       [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
         const Oxs_MeshValue<ThreeVector>& old_spin = cstate->spin;
         Oxs_MeshValue<ThreeVector>& new_spin = newstate.spin;
-        for(OC_INDEX j=jstart;j<jstop;++j) {
+        OC_INDEX j=jstart;
+        for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+          dmdt.ComputeCorePack(j); // Fills vtmpC with dmdt
+          Oxs_ThreeVectorPack vtmp
+            = b41*Oxs_ThreeVectorPack(&current_dm_dt[j])
+            + b42*Oxs_ThreeVectorPack(&vtmpA[j])
+            + b43*Oxs_ThreeVectorPack(&vtmpB[j])
+            + b44*Oxs_ThreeVectorPack(&vtmpC[j]);
+          vtmp *= stepsize;
+          vtmp += Oxs_ThreeVectorPack(&old_spin[j]);
+          vtmp.MakeUnit();
+          vtmp.Store(&new_spin[j]);
+        }
+        for(;j<jstop;++j) {
           dmdt.ComputeCore(j); // Fills vtmpC with dmdt
           ThreeVector vtmp
             = b41*current_dm_dt[j] + b42*vtmpA[j]
@@ -2354,8 +2565,7 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
               (cstate->mesh->Size())*(11+3*6)*sizeof(OC_REAL8m));
 
   // Steps 7 and 8
-  GetEnergyDensity(next_state_key.GetReadReference(),temp_energy,
-                   &vtmpD,NULL,pE_pt);
+  GetStageTorque(next_state_key.GetReadReference(),vtmpD,pE_pt);
 
   RKTIME_START(7);
   {
@@ -2369,7 +2579,21 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
       [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
         const Oxs_MeshValue<ThreeVector>& old_spin = cstate->spin;
         Oxs_MeshValue<ThreeVector>& new_spin = newstate.spin;
-        for(OC_INDEX j=jstart;j<jstop;++j) {
+        OC_INDEX j=jstart;
+        for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+          dmdt.ComputeCorePack(j); // Fills vtmpD with dmdt
+          Oxs_ThreeVectorPack vtmp
+            = b51*Oxs_ThreeVectorPack(&current_dm_dt[j])
+            + b52*Oxs_ThreeVectorPack(&vtmpA[j])
+            + b53*Oxs_ThreeVectorPack(&vtmpB[j])
+            + b54*Oxs_ThreeVectorPack(&vtmpC[j])
+            + b55*Oxs_ThreeVectorPack(&vtmpD[j]);
+          vtmp *= stepsize;
+          vtmp += Oxs_ThreeVectorPack(&old_spin[j]);
+          vtmp.MakeUnit();
+          vtmp.Store(&new_spin[j]);
+        }
+        for(;j<jstop;++j) {
           dmdt.ComputeCore(j); // Fills vtmpD with dmdt
           ThreeVector vtmp
             = b51*current_dm_dt[j] + b52*vtmpA[j]
@@ -2386,8 +2610,7 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
               (cstate->mesh->Size())*(11+3*7)*sizeof(OC_REAL8m));
 
   // Steps 9-11
-  GetEnergyDensity(next_state_key.GetReadReference(),temp_energy,
-                   &vtmpA,NULL,pE_pt);
+  GetStageTorque(next_state_key.GetReadReference(),vtmpA,pE_pt);
   RKTIME_START(8);
   {
     DMDT dmdt(this,next_state_key.GetReadReference(),vtmpA,vtmpA);
@@ -2404,7 +2627,31 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
         Oxs_MeshValue<ThreeVector>& new_spin = newstate.spin;
         OC_REAL8m min_normsq = DBL_MAX;
         OC_REAL8m max_normsq = 0.0;
-        for(OC_INDEX j=jstart;j<jstop;++j) {
+        OC_INDEX j=jstart;
+        if(j+OC_PACK_WIDTH<=jstop) {
+          Oc_Pack pack_min_normsq(DBL_MAX);
+          Oc_Pack pack_max_normsq(0.0);
+          for(;j+OC_PACK_WIDTH<=jstop;j+=OC_PACK_WIDTH) {
+            dmdt.ComputeCorePack(j); // Fills vtmpA with dmdt
+            Oxs_ThreeVectorPack vtmp6(&vtmpA[j]);
+            const Oxs_ThreeVectorPack vtmp3(&vtmpB[j]);
+            (dc6*vtmp6 + dc3*vtmp3).Store(&vtmpB[j]);
+            vtmp6 *= b66;
+            vtmp6 += b63*vtmp3
+              + b61*Oxs_ThreeVectorPack(&current_dm_dt[j])
+              + b64*Oxs_ThreeVectorPack(&vtmpC[j])
+              + b65*Oxs_ThreeVectorPack(&vtmpD[j]);
+            vtmp6 *= stepsize;
+            vtmp6 += Oxs_ThreeVectorPack(&old_spin[j]);
+            const Oc_Pack magsq = vtmp6.MakeUnit();
+            vtmp6.Store(&new_spin[j]);
+            pack_min_normsq.KeepMin(magsq);
+            pack_max_normsq.KeepMax(magsq);
+          }
+          min_normsq = Oc_PackMinElement(pack_min_normsq);
+          max_normsq = Oc_PackMaxElement(pack_max_normsq);
+        }
+        for(;j<jstop;++j) {
           dmdt.ComputeCore(j); // Fills vtmpA with dmdt
           ThreeVector vtmp6 = vtmpA[j];
           ThreeVector vtmp3 = vtmpB[j];
@@ -2555,20 +2802,20 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
   OC_REAL8m max_dm_dt = sqrt(max_dm_dt_sq);
   OC_REAL8m timestep_lower_bound = PositiveTimestepBound(max_dm_dt);
   OC_REAL8m dE_dt = pE_pt + pE_pM_sum;
-  if(!endstate.AddDerivedData(DataName("Timestep lower bound"),
+  if(!endstate.AddDerivedData(timestep_lower_bound_key,
                                 timestep_lower_bound) ||
-     !endstate.AddDerivedData(DataName("Max dm/dt"),max_dm_dt) ||
+     !endstate.AddDerivedData(max_dm_dt_key,max_dm_dt) ||
 #if DO_MdM_SUM
-     !endstate.AddDerivedData(DataName("Mx"),ave_M.x) ||
-     !endstate.AddDerivedData(DataName("My"),ave_M.y) ||
-     !endstate.AddDerivedData(DataName("Mz"),ave_M.z) ||
-     !endstate.AddDerivedData(DataName("dMx/dt"),ave_dM_dt.x) ||
-     !endstate.AddDerivedData(DataName("dMy/dt"),ave_dM_dt.y) ||
-     !endstate.AddDerivedData(DataName("dMz/dt"),ave_dM_dt.z) ||
+     !endstate.AddDerivedData(aveMx_key,ave_M.x) ||
+     !endstate.AddDerivedData(aveMy_key,ave_M.y) ||
+     !endstate.AddDerivedData(aveMz_key,ave_M.z) ||
+     !endstate.AddDerivedData(dMx_dt_key,ave_dM_dt.x) ||
+     !endstate.AddDerivedData(dMy_dt_key,ave_dM_dt.y) ||
+     !endstate.AddDerivedData(dMz_dt_key,ave_dM_dt.z) ||
 #endif // DO_MdM_SUM
-     !endstate.AddDerivedData(DataName("pE/pt"),pE_pt) ||
-     !endstate.AddDerivedData(DataName("Total E"),total_E) ||
-     !endstate.AddDerivedData(DataName("dE/dt"),dE_dt)) {
+     !endstate.AddDerivedData(pE_pt_key,pE_pt) ||
+     !endstate.AddDerivedData(total_E_key,total_E) ||
+     !endstate.AddDerivedData(dE_dt_key,dE_dt)) {
     throw Oxs_ExtError(this,
                  "Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54:"
                  " Programming error; data cache already set.");
@@ -2576,6 +2823,12 @@ void Oxs_RungeKuttaEvolve::RungeKuttaFehlbergBase54
   // Array holdings: A=dm_dt7   B=dD   C=dm_dt4   D=dm_dt5
 
   error_estimate = stepsize * sqrt(max_dD_sq);
+  if(multirate) {
+    // Add in error from estimating the slow field across the inner
+    // stages.  The estimate is exact at the step start, so the field
+    // error is taken to grow linearly across the step.
+    error_estimate += 0.5 * stepsize * MultirateErrorRate(endstate);
+  }
   global_error_order = 5.0;
 
   new_energy_and_dmdt_computed = 1;
@@ -2801,11 +3054,11 @@ Oxs_RungeKuttaEvolve::InitNewStage
   for(int i=1;i<number_of_threads;++i) {
     thread_M_sum[0] += thread_M_sum[i];
   }
-  cstate.AddDerivedData(DataName("Mx"),
+  cstate.AddDerivedData(aveMx_key,
      thread_M_sum[0].x/static_cast<OC_REAL8m>(spin.Size()));
-  cstate.AddDerivedData(DataName("My"),
+  cstate.AddDerivedData(aveMy_key,
      thread_M_sum[0].y/static_cast<OC_REAL8m>(spin.Size()));
-  cstate.AddDerivedData(DataName("Mz"),
+  cstate.AddDerivedData(aveMz_key,
      thread_M_sum[0].z/static_cast<OC_REAL8m>(spin.Size()));
 
   // Update additional derived data in state.
@@ -2857,8 +3110,8 @@ Oxs_RungeKuttaEvolve::Step(const Oxs_TimeDriver* driver,
       // Automatic detection based on energy values across
       // stage boundary.
       OC_REAL8m total_E,E_diff;
-      if(cstate.GetDerivedData(DataName("Total E"),total_E) &&
-         cstate.GetDerivedData(DataName("Delta E"),E_diff)  &&
+      if(cstate.GetDerivedData(total_E_key,total_E) &&
+         cstate.GetDerivedData(delta_E_key,E_diff)  &&
          fabs(E_diff) <= 256*OC_REAL8_EPSILON*fabs(total_E) ) {
         // The factor of 256 in the preceding line is a fudge factor,
         // selected with no particular justification.
@@ -2895,7 +3148,7 @@ Oxs_RungeKuttaEvolve::Step(const Oxs_TimeDriver* driver,
   const Oxs_SimState& nstate = next_state_key.GetReadReference();
 
   OC_REAL8m max_dm_dt;
-  cstate.GetDerivedData(DataName("Max dm/dt"),max_dm_dt);
+  cstate.GetDerivedData(max_dm_dt_key,max_dm_dt);
   OC_REAL8m reference_stepsize = stepsize;
   if(driver_set_step) reference_stepsize = previous_next_timestep;
   OC_BOOL good_step = CheckError(global_error_order,error_estimate,
@@ -2953,21 +3206,21 @@ Oxs_RungeKuttaEvolve::Step(const Oxs_TimeDriver* driver,
   // on the damping ratio alpha), which is another reason to try to build
   // it directly into the high order RK step routines.
   OC_REAL8m pE_pt,new_pE_pt=0.;
-  cstate.GetDerivedData(DataName("pE/pt"),pE_pt);
+  cstate.GetDerivedData(pE_pt_key,pE_pt);
   if(new_energy_and_dmdt_computed) {
-    nstate.GetDerivedData(DataName("pE/pt"),new_pE_pt);
+    nstate.GetDerivedData(pE_pt_key,new_pE_pt);
   } else {
     OC_REAL8m new_total_E;
     GetEnergyDensity(nstate,temp_energy,
                      &mxH_output.cache.value,
                      NULL,new_pE_pt,new_total_E);
     mxH_output.cache.state_id=nstate.Id();
-    if(!nstate.AddDerivedData(DataName("pE/pt"),new_pE_pt)) {
+    if(!nstate.AddDerivedData(pE_pt_key,new_pE_pt)) {
       throw Oxs_ExtError(this,
            "Oxs_RungeKuttaEvolve::Step:"
            " Programming error; data cache (pE/pt) already set.");
     }
-    if(!nstate.AddDerivedData(DataName("Total E"),new_total_E)) {
+    if(!nstate.AddDerivedData(total_E_key,new_total_E)) {
       throw Oxs_ExtError(this,
            "Oxs_RungeKuttaEvolve::Step:"
            " Programming error; data cache (Total E) already set.");
@@ -2979,7 +3232,7 @@ timer[0].Start();
 #endif // REPORT_TIME_RKDEVEL
   OC_REAL8m dE,var_dE,total_E;
   ComputeEnergyChange(nstate.mesh,energy,temp_energy,dE,var_dE,total_E);
-  if(!nstate.AddDerivedData(DataName("Delta E"),dE)) {
+  if(!nstate.AddDerivedData(delta_E_key,dE)) {
     throw Oxs_ExtError(this,
          "Oxs_RungeKuttaEvolve::Step:"
          " Programming error; data cache (Delta E) already set.");
@@ -3048,10 +3301,10 @@ timer[0].Stop();
                                  mxH_output.cache.value,new_pE_pt,
                                  dm_dt_output.cache.value,new_max_dm_dt,
                                  new_dE_dt,new_timestep_lower_bound);
-    if(!nstate.AddDerivedData(DataName("Timestep lower bound"),
+    if(!nstate.AddDerivedData(timestep_lower_bound_key,
                               new_timestep_lower_bound) ||
-       !nstate.AddDerivedData(DataName("Max dm/dt"),new_max_dm_dt) ||
-       !nstate.AddDerivedData(DataName("dE/dt"),new_dE_dt)) {
+       !nstate.AddDerivedData(max_dm_dt_key,new_max_dm_dt) ||
+       !nstate.AddDerivedData(dE_dt_key,new_dE_dt)) {
       throw Oxs_ExtError(this,
                            "Oxs_RungeKuttaEvolve::Step:"
                            " Programming error; data cache already set.");
@@ -3091,15 +3344,15 @@ Oxs_RungeKuttaEvolve::UpdateDerivedOutputs(const Oxs_SimState& state,
     = 0;  // Mark change in progress
 
   OC_REAL8m dummy_value;
-  if(!state.GetDerivedData(DataName("Max dm/dt"),
+  if(!state.GetDerivedData(max_dm_dt_key,
                            max_dm_dt_output.cache.value) ||
-     !state.GetDerivedData(DataName("dE/dt"),
+     !state.GetDerivedData(dE_dt_key,
                            dE_dt_output.cache.value) ||
-     !state.GetDerivedData(DataName("Delta E"),
+     !state.GetDerivedData(delta_E_key,
                            delta_E_output.cache.value) ||
-     !state.GetDerivedData(DataName("pE/pt"),dummy_value) ||
-     !state.GetDerivedData(DataName("Total E"),dummy_value) ||
-     !state.GetDerivedData(DataName("Timestep lower bound"),
+     !state.GetDerivedData(pE_pt_key,dummy_value) ||
+     !state.GetDerivedData(total_E_key,dummy_value) ||
+     !state.GetDerivedData(timestep_lower_bound_key,
                            dummy_value) ||
      (dm_dt_output.GetCacheRequestCount()>0
       && dm_dt_output.cache.state_id != state.Id()) ||
@@ -3109,17 +3362,17 @@ Oxs_RungeKuttaEvolve::UpdateDerivedOutputs(const Oxs_SimState& state,
     // Missing at least some data, so calculate from scratch
 
     // Check ahead for trouble computing Delta E:
-    if(!state.GetDerivedData(DataName("Delta E"),dummy_value)
+    if(!state.GetDerivedData(delta_E_key,dummy_value)
        && state.previous_state_id != 0
        && prevstate_ptr!=NULL
        && state.previous_state_id == prevstate_ptr->Id()) {
       OC_REAL8m old_E;
-      if(!prevstate_ptr->GetDerivedData(DataName("Total E"),old_E)) {
+      if(!prevstate_ptr->GetDerivedData(total_E_key,old_E)) {
 	// Previous state doesn't have stored Total E.  Compute it
 	// now.
 	OC_REAL8m old_pE_pt;
 	GetEnergyDensity(*prevstate_ptr,energy,NULL,NULL,old_pE_pt,old_E);
-	prevstate_ptr->AddDerivedData(DataName("Total E"),old_E);
+	prevstate_ptr->AddDerivedData(total_E_key,old_E);
       }
     }
 
@@ -3129,11 +3382,11 @@ Oxs_RungeKuttaEvolve::UpdateDerivedOutputs(const Oxs_SimState& state,
     GetEnergyDensity(state,energy,&mxH,NULL,pE_pt,total_E);
     energy_state_id=state.Id();
     mxH_output.cache.state_id=state.Id();
-    if(!state.GetDerivedData(DataName("pE/pt"),dummy_value)) {
-      state.AddDerivedData(DataName("pE/pt"),pE_pt);
+    if(!state.GetDerivedData(pE_pt_key,dummy_value)) {
+      state.AddDerivedData(pE_pt_key,pE_pt);
     }
-    if(!state.GetDerivedData(DataName("Total E"),dummy_value)) {
-      state.AddDerivedData(DataName("Total E"),total_E);
+    if(!state.GetDerivedData(total_E_key,dummy_value)) {
+      state.AddDerivedData(total_E_key,total_E);
     }
 
     // Calculate dm/dt, Max dm/dt and dE/dt
@@ -3147,28 +3400,28 @@ Oxs_RungeKuttaEvolve::UpdateDerivedOutputs(const Oxs_SimState& state,
                                  timestep_lower_bound);
     dm_dt_output.cache.state_id=state.Id();
 
-    if(!state.GetDerivedData(DataName("Max dm/dt"),dummy_value)) {
-      state.AddDerivedData(DataName("Max dm/dt"),
+    if(!state.GetDerivedData(max_dm_dt_key,dummy_value)) {
+      state.AddDerivedData(max_dm_dt_key,
                            max_dm_dt_output.cache.value);
     }
 
-    if(!state.GetDerivedData(DataName("dE/dt"),dummy_value)) {
-      state.AddDerivedData(DataName("dE/dt"),dE_dt_output.cache.value);
+    if(!state.GetDerivedData(dE_dt_key,dummy_value)) {
+      state.AddDerivedData(dE_dt_key,dE_dt_output.cache.value);
     }
 
-    if(!state.GetDerivedData(DataName("Timestep lower bound"),dummy_value)) {
-      state.AddDerivedData(DataName("Timestep lower bound"),
+    if(!state.GetDerivedData(timestep_lower_bound_key,dummy_value)) {
+      state.AddDerivedData(timestep_lower_bound_key,
                            timestep_lower_bound);
     }
 
-    if(!state.GetDerivedData(DataName("Delta E"),dummy_value)) {
+    if(!state.GetDerivedData(delta_E_key,dummy_value)) {
       if(state.previous_state_id == 0) {
         // No previous state
         dummy_value = 0.0;
       } else if(prevstate_ptr!=NULL
                 && state.previous_state_id == prevstate_ptr->Id()) {
         OC_REAL8m old_E;
-        if(!prevstate_ptr->GetDerivedData(DataName("Total E"),old_E)) {
+        if(!prevstate_ptr->GetDerivedData(total_E_key,old_E)) {
           throw Oxs_ExtError(this,
                              "Oxs_RungeKuttaEvolve::UpdateDerivedOutputs:"
                              " \"Total E\" not set in previous state.");
@@ -3182,7 +3435,7 @@ Oxs_RungeKuttaEvolve::UpdateDerivedOutputs(const Oxs_SimState& state,
            "Oxs_RungeKuttaEvolve::UpdateDerivedOutputs:"
            " Can't derive Delta E from single state.");
       }
-      state.AddDerivedData(DataName("Delta E"),dummy_value);
+      state.AddDerivedData(delta_E_key,dummy_value);
     }
     delta_E_output.cache.value=dummy_value;
   }
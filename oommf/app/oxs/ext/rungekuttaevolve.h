@@ -199,6 +199,16 @@ private:
   Oxs_MeshValue<OC_REAL8m> energy;
   OC_REAL8m next_timestep;
 
+  // State derived data keys, set in Init()
+  Oxs_DerivedDataKey max_dm_dt_key;
+  Oxs_DerivedDataKey dE_dt_key;
+  Oxs_DerivedDataKey delta_E_key;
+  Oxs_DerivedDataKey pE_pt_key;
+  Oxs_DerivedDataKey total_E_key;
+  Oxs_DerivedDataKey timestep_lower_bound_key;
+  Oxs_DerivedDataKey aveMx_key, aveMy_key, aveMz_key;
+  Oxs_DerivedDataKey dMx_dt_key, dMy_dt_key, dMz_dt_key;
+
   // Outputs
   void UpdateDerivedOutputs(const Oxs_SimState& state,
                             const Oxs_SimState* prevstate);
@@ -218,6 +228,55 @@ private:
   Oxs_MeshValue<ThreeVector> vtmpC;
   Oxs_MeshValue<ThreeVector> vtmpD;
 
+  // Multi-rate stepping.  Energy terms named in the MIF option
+  // multirate_slow_terms (typically demag) are evaluated only at the
+  // start and end points of each RKF54 step.  The intermediate stages
+  // use the fast terms plus the slow field from the start of the step,
+  // optionally extrapolated linearly in time using the slow field from
+  // the previous accepted step.  The difference between the
+  // extrapolated and actual slow field at the end of the step is
+  // folded into the step error estimate.
+  std::vector<String> multirate_slow_names;
+  OC_BOOL multirate_extrapolate;
+  Oxs_MeshValue<ThreeVector> multirate_base_field; // Slow field at
+  OC_UINT4m multirate_base_id;                     // step start.
+  OC_UINT4m multirate_base_stage;
+  OC_REAL8m multirate_base_time; // stage_elapsed_time
+  Oxs_MeshValue<ThreeVector> multirate_prev_field; // Slow field at
+  OC_REAL8m multirate_prev_time;                   // previous step
+  OC_BOOL multirate_prev_valid;                    // start.
+  Oxs_MeshValue<ThreeVector> multirate_fast_field; // Scratch
+  Oxs_MeshValue<ThreeVector> multirate_scratch;    // Scratch
+
+  void MultirateSetBase(const Oxs_SimState& cstate);
+  // Loads multirate_base_field with the slow field at cstate, and
+  // shifts the previous base into multirate_prev_field if cstate
+  // follows directly from the previous base state.
+
+  void MultirateSlowEstimate(OC_REAL8m stage_time,
+                             OC_INDEX j,ThreeVector& H) const {
+    H = multirate_base_field[j];
+    if(multirate_prev_valid) {
+      const OC_REAL8m c = (stage_time - multirate_base_time)
+        /(multirate_base_time - multirate_prev_time);
+      H += c*(multirate_base_field[j] - multirate_prev_field[j]);
+    }
+  }
+
+  void GetStageTorque(const Oxs_SimState& state,
+                      Oxs_MeshValue<ThreeVector>& mxH,
+                      OC_REAL8m& pE_pt);
+  // Fills mxH at an intermediate RKF54 stage.  If multi-rate stepping
+  // is enabled then the slow terms are replaced by the held or
+  // extrapolated slow field, otherwise this is a full GetEnergyDensity
+  // call.
+
+  OC_REAL8m MultirateErrorRate(const Oxs_SimState& endstate) const;
+  // Returns max over cells of |gamma|.sqrt(1+alpha^2).|m x dH| where
+  // dH is the difference between the actual slow field at endstate
+  // (as left in slow_field by GetEnergyDensity) and the stage
+  // estimate.  Units are rad/s.
+
   // Utility functions
   void CheckCache(const Oxs_SimState& cstate);
 
@@ -464,6 +523,28 @@ private:
       }
     }
 
+    inline void ComputeCorePack(OC_INDEX j) {
+      // Same as ComputeCore, but for the OC_PACK_WIDTH cells starting
+      // at j.  Falls back to ComputeCore if any of these cells have
+      // Ms == 0.
+      for(int k=0;k<OC_PACK_WIDTH;++k) {
+        if(Ms[j+k]==0) {
+          for(k=0;k<OC_PACK_WIDTH;++k) ComputeCore(j+k);
+          return;
+        }
+      }
+      // Note: mxH may be same as dm_dt
+      const Oxs_ThreeVectorPack torque(&mxH[j]);
+      Oxs_ThreeVectorPack scratch_precess = torque;
+      if(!do_precess) scratch_precess.SetZero();
+      Oxs_ThreeVectorPack scratch_damp(&spin[j]);
+      scratch_damp ^= torque; // (mx(mxH))
+      Oc_Pack a;  a.LoadUnaligned(alpha[j]);
+      scratch_precess.Accum(a,scratch_damp); // mxH + alpha.(mx(mxH))
+      Oc_Pack g;  g.LoadUnaligned(gamma[j]);
+      (g*scratch_precess).Store(&dm_dt[j]);
+    }
+
     void FinalizeCore() {}
 
     void Initialize() { dm_dt.AdjustSize(mesh); }
@@ -781,6 +862,10 @@ private:
       }
     }
 
+    inline void ComputeCorePack(OC_INDEX j) {
+      for(int k=0;k<OC_PACK_WIDTH;++k) ComputeCore(j+k);
+    }
+
     void FinalizeCore() {}
 
     void Initialize() {
@@ -1018,6 +1103,10 @@ private:
       }
     }
 
+    inline void ComputeCorePack(OC_INDEX j) {
+      for(int k=0;k<OC_PACK_WIDTH;++k) ComputeCore(j+k);
+    }
+
     void FinalizeCore() {}
 
     void Initialize() {
@@ -0,0 +1,973 @@
+/* FILE: semiimplicitevolve.cc                 -*-Mode: c++-*-
+ *
+ * Concrete evolver class, using a semi-implicit Gauss-Seidel
+ * projection step that treats the linear exchange term implicitly.
+ *
+ */
+
+#include <cfloat>
+#include <vector>
+
+#include "nb.h"
+#include "director.h"
+#include "timedriver.h"
+#include "simstate.h"
+#include "semiimplicitevolve.h"
+#include "key.h"
+
+// Oxs_Ext registration support
+OXS_EXT_REGISTER(Oxs_SemiImplicitEvolve);
+
+/* End includes */
+
+// Constructor
+Oxs_SemiImplicitEvolve::Oxs_SemiImplicitEvolve(
+  const char* name,     // Child instance id
+  Oxs_Director* newdtr, // App director
+  const char* argstr)   // MIF input block parameters
+  : Oxs_TimeEvolver(name,newdtr,argstr),
+    max_step_increase(1.25), max_step_decrease(0.5),
+    exchange_mesh_id(0), exchange_mesh(0),
+    wgtx(0.), wgty(0.), wgtz(0.),
+    xperiodic(0), yperiodic(0), zperiodic(0),
+    energy_state_id(0),next_timestep(0.)
+{
+  // Process arguments
+  min_timestep=GetRealInitValue("min_timestep",0.);
+  max_timestep=GetRealInitValue("max_timestep",1e-10);
+  if(max_timestep<=0.0) {
+    char buf[4096];
+    Oc_Snprintf(buf,sizeof(buf),
+                "Invalid parameter value:"
+                " Specified max time step is %g (should be >0.)",
+                static_cast<double>(max_timestep));
+    throw Oxs_ExtError(this,buf);
+  }
+
+  allowed_error_rate = GetRealInitValue("error_rate",-1);
+  if(allowed_error_rate>0.0) {
+    allowed_error_rate *= PI*1e9/180.; // Convert from deg/ns to rad/s
+  }
+  allowed_absolute_step_error
+    = GetRealInitValue("absolute_step_error",0.2);
+  if(allowed_absolute_step_error>0.0) {
+    allowed_absolute_step_error *= PI/180.; // Convert from deg to rad
+  }
+  allowed_relative_step_error
+    = GetRealInitValue("relative_step_error",0.2);
+
+  step_headroom = GetRealInitValue("step_headroom",0.85);
+  if(step_headroom<=0.) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " step_headroom value must be bigger than 0.");
+  }
+
+  alpha = GetRealInitValue("alpha",0.5);
+  if(alpha<0.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " alpha value must be non-negative.");
+  }
+
+  // User may specify either gamma_G (Gilbert) or
+  // gamma_LL (Landau-Lifshitz).  Code uses "gamma"
+  // which is LL form.
+  if(HasInitValue("gamma_G") && HasInitValue("gamma_LL")) {
+    throw Oxs_ExtError(this,"Invalid Specify block; "
+                       "both gamma_G and gamma_LL specified.");
+  } else if(HasInitValue("gamma_G")) {
+    gamma = GetRealInitValue("gamma_G")/(1+alpha*alpha);
+  } else if(HasInitValue("gamma_LL")) {
+    gamma = GetRealInitValue("gamma_LL");
+  } else {
+    gamma = 2.211e5/(1+alpha*alpha);
+  }
+  gamma = fabs(gamma); // Force positive
+
+  do_precess = GetIntInitValue("do_precess",1);
+
+  start_dm = GetRealInitValue("start_dm",0.01);
+  start_dm *= PI/180.; // Convert from deg to rad
+
+  solver_tolerance = GetRealInitValue("solver_tolerance",1e-8);
+  if(solver_tolerance<=0.0 || solver_tolerance>=1.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " solver_tolerance must lie in (0,1).");
+  }
+  solver_max_iterations = GetUIntInitValue("solver_max_iterations",1000);
+
+  // Setup outputs
+  max_dm_dt_output.Setup(this,InstanceName(),"Max dm/dt","deg/ns",
+     &Oxs_SemiImplicitEvolve::UpdateDerivedOutputs);
+  dE_dt_output.Setup(this,InstanceName(),"dE/dt","J/s",
+     &Oxs_SemiImplicitEvolve::UpdateDerivedOutputs);
+  delta_E_output.Setup(this,InstanceName(),"Delta E","J",
+     &Oxs_SemiImplicitEvolve::UpdateDerivedOutputs);
+  solver_iterations_output.Setup(this,InstanceName(),
+     "Solver iterations","",
+     &Oxs_SemiImplicitEvolve::UpdateDerivedOutputs);
+
+  dm_dt_output.Setup(this,InstanceName(),"dm/dt","rad/s",
+     &Oxs_SemiImplicitEvolve::UpdateDerivedOutputs);
+  mxH_output.Setup(this,InstanceName(),"mxH","A/m",
+     &Oxs_SemiImplicitEvolve::UpdateDerivedOutputs);
+
+  max_dm_dt_output.Register(director,-5);
+  dE_dt_output.Register(director,-5);
+  delta_E_output.Register(director,-5);
+  solver_iterations_output.Register(director,-5);
+  dm_dt_output.Register(director,-5);
+  mxH_output.Register(director,-5);
+
+  // dm_dt and mxH output caches are used for intermediate storage,
+  // so enable caching.
+  dm_dt_output.CacheRequestIncrement(1);
+  mxH_output.CacheRequestIncrement(1);
+
+  max_dm_dt_key = Oxs_DerivedDataKey("Max dm/dt");
+  dE_dt_key = Oxs_DerivedDataKey("dE/dt");
+  delta_E_key = Oxs_DerivedDataKey("Delta E");
+  pE_pt_key = Oxs_DerivedDataKey("pE/pt");
+  timestep_lower_bound_key = Oxs_DerivedDataKey("Timestep lower bound");
+  solver_iterations_key = Oxs_DerivedDataKey("Solver iterations");
+
+  VerifyAllInitArgsUsed();
+}
+
+OC_BOOL Oxs_SemiImplicitEvolve::Init()
+{
+  Oxs_TimeEvolver::Init();
+
+  energy_state_id=0;   // Mark as invalid state
+  next_timestep=0.;    // Dummy value
+  exchange_mesh_id=0;  // Force SetupLinearExchange refresh
+  exchange_mesh=0;
+  return 1;
+}
+
+
+Oxs_SemiImplicitEvolve::~Oxs_SemiImplicitEvolve()
+{}
+
+
+void Oxs_SemiImplicitEvolve::SetupLinearExchange(const Oxs_SimState& state)
+{ // Collects linear exchange weights from all energy terms that
+  // support the Oxs_EnergyLinearExchangeSupport interface.  Terms that
+  // don't are handled explicitly, as part of f = H - L.m.
+  if(exchange_mesh_id == state.mesh->Id()) return; // Already set up
+
+  exchange_mesh = 0;
+  wgtx = wgty = wgtz = 0.0;
+  xperiodic = yperiodic = zperiodic = 0;
+  exchange_mesh_id = state.mesh->Id();
+
+  const Oxs_CommonRectangularMesh* mesh
+    = dynamic_cast<const Oxs_CommonRectangularMesh*>(state.mesh);
+  if(mesh==NULL) return; // Exchange treated explicitly
+
+  OC_BOOL supported = 0;
+  Oxs_EnergyLinearExchangeSupport::LinearExchangeData led;
+  led.state = &state;
+  vector<Oxs_Energy*> energies = director->GetEnergyObjects();
+  for(vector<Oxs_Energy*>::iterator ei = energies.begin();
+      ei != energies.end(); ++ei) {
+    const Oxs_EnergyLinearExchangeSupport* eles
+      = dynamic_cast<const Oxs_EnergyLinearExchangeSupport*>(*ei);
+    if(eles != NULL && eles->GetLinearExchange(led)) {
+      wgtx += led.wgtx;
+      wgty += led.wgty;
+      wgtz += led.wgtz;
+      supported = 1;
+    }
+  }
+  if(!supported) return;
+
+  const Oxs_PeriodicRectangularMesh* pmesh
+    = dynamic_cast<const Oxs_PeriodicRectangularMesh*>(mesh);
+  if(pmesh!=NULL) {
+    xperiodic = pmesh->IsPeriodicX();
+    yperiodic = pmesh->IsPeriodicY();
+    zperiodic = pmesh->IsPeriodicZ();
+  }
+  exchange_mesh = mesh;
+}
+
+
+void Oxs_SemiImplicitEvolve::GetNeighbours
+(const Oxs_MeshValue<OC_REAL8m>& Ms,
+ OC_INDEX i,OC_INDEX offset[6]) const
+{ // Neighbour rules match those of the Oxs_UniformExchange 6ngbr
+  // kernel.  Requires exchange_mesh != 0.
+  const OC_INDEX xdim = exchange_mesh->DimX();
+  const OC_INDEX ydim = exchange_mesh->DimY();
+  const OC_INDEX zdim = exchange_mesh->DimZ();
+  const OC_INDEX xydim = xdim*ydim;
+  const OC_INDEX xyzdim = xydim*zdim;
+  OC_INDEX x,y,z;
+  exchange_mesh->GetCoords(i,x,y,z);
+  for(int k=0;k<6;++k) offset[k] = 0;
+  if(x>0)            offset[0] = -1;
+  else if(xperiodic) offset[0] = xdim-1;
+  if(x<xdim-1)       offset[1] = 1;
+  else if(xperiodic) offset[1] = 1-xdim;
+  if(y>0)            offset[2] = -xdim;
+  else if(yperiodic) offset[2] = xydim-xdim;
+  if(y<ydim-1)       offset[3] = xdim;
+  else if(yperiodic) offset[3] = xdim-xydim;
+  if(z>0)            offset[4] = -xydim;
+  else if(zperiodic) offset[4] = xyzdim-xydim;
+  if(z<zdim-1)       offset[5] = xydim;
+  else if(zperiodic) offset[5] = xydim-xyzdim;
+  for(int k=0;k<6;++k) {
+    if(offset[k]!=0 && Ms[i+offset[k]]==0.0) offset[k] = 0;
+  }
+}
+
+
+void Oxs_SemiImplicitEvolve::ComputeExplicitField
+(const Oxs_SimState& state,
+ const Oxs_MeshValue<ThreeVector>& H,
+ Oxs_MeshValue<ThreeVector>& f) const
+{ // Fills f = H - L.m
+  f.AdjustSize(state.mesh);
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  if(exchange_mesh==0) {
+    f = H;
+    return;
+  }
+  const OC_REAL8m wgt[6] = { wgtx, wgtx, wgty, wgty, wgtz, wgtz };
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+      OC_INDEX offset[6];
+      for(OC_INDEX i=istart;i<istop;++i) {
+        if(Ms[i]==0.0) {
+          f[i] = H[i];
+          continue;
+        }
+        GetNeighbours(Ms,i,offset);
+        ThreeVector sum(0.,0.,0.);
+        for(int k=0;k<6;++k) {
+          if(offset[k]!=0) sum.Accum(wgt[k],spin[i+offset[k]]-spin[i]);
+        }
+        ThreeVector temp = H[i];
+        temp.Accum(-1.0/(MU0*Ms[i]),sum);
+        f[i] = temp;
+      }
+    });
+}
+
+
+OC_UINT4m Oxs_SemiImplicitEvolve::Solve
+(const Oxs_MeshValue<OC_REAL8m>& Ms,
+ OC_REAL8m tau,
+ const Oxs_MeshValue<OC_REAL8m>& b,
+ Oxs_MeshValue<OC_REAL8m>& x)
+{ // Solves (I-tau*L) x = b, where L.m is the linear exchange field.
+  // Writing L = -Ms^-1 K/MU0, with K the symmetric, non-negative
+  // definite six-neighbour stiffness matrix
+  //    (K.v)[i] = \sum_j wgt_ij (v[i]-v[j]),
+  // the system is solved in the equivalent symmetric positive
+  // definite form
+  //    (Ms + (tau/MU0)*K) x = Ms*b
+  // using conjugate gradients with a Jacobi preconditioner.  Cells
+  // with Ms == 0 are decoupled, with x = b.  The initial guess is b,
+  // which is accurate for small tau.  Each iteration makes two sweeps
+  // through the mesh: the direction update is fused with the stencil
+  // application by writing the new direction to a second buffer.
+  x = b;
+  const OC_REAL8m c = tau/MU0;
+  if(exchange_mesh==0 || c<=0.0) return 0;
+
+  cg_r.AdjustSize(exchange_mesh);
+  cg_z.AdjustSize(exchange_mesh);
+  cg_p.AdjustSize(exchange_mesh);
+  cg_pn.AdjustSize(exchange_mesh);
+  cg_Ap.AdjustSize(exchange_mesh);
+  cg_diag.AdjustSize(exchange_mesh);
+
+  const OC_REAL8m wgt[6] = { wgtx, wgtx, wgty, wgty, wgtz, wgtz };
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  Oc_AlignedVector<Nb_Xpfloat> thread_a(number_of_threads,0.0);
+  Oc_AlignedVector<Nb_Xpfloat> thread_b(number_of_threads,0.0);
+  auto collect = [&](Oc_AlignedVector<Nb_Xpfloat>& arr) -> OC_REAL8m {
+    Nb_Xpfloat sum = arr[0];
+    for(int i=1;i<number_of_threads;++i) sum += arr[i];
+    for(int i=0;i<number_of_threads;++i) arr[i] = 0.0; // Reset for reuse
+    return sum.GetValue();
+  };
+
+  // Initialization: r = Ms*b - A.x = -c*K.b, z = r/diag, p = 0.
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+      Nb_Xpfloat thd_rz = 0.0, thd_bb = 0.0;
+      OC_INDEX offset[6];
+      for(OC_INDEX i=istart;i<istop;++i) {
+        cg_p[i] = 0.0;
+        if(Ms[i]==0.0) {
+          cg_r[i] = cg_z[i] = 0.0;
+          cg_diag[i] = 1.0;
+          continue;
+        }
+        GetNeighbours(Ms,i,offset);
+        OC_REAL8m Kb = 0.0, wsum = 0.0;
+        for(int k=0;k<6;++k) {
+          if(offset[k]!=0) {
+            Kb += wgt[k]*(b[i]-b[i+offset[k]]);
+            wsum += wgt[k];
+          }
+        }
+        const OC_REAL8m d = Ms[i] + c*wsum;
+        const OC_REAL8m r = -c*Kb;
+        cg_diag[i] = d;
+        cg_r[i] = r;
+        cg_z[i] = r/d;
+        thd_rz.Accum(r*r/d);
+        thd_bb.Accum(Ms[i]*b[i]*Ms[i]*b[i]);
+      }
+      thread_a[thread_id] += thd_rz;
+      thread_b[thread_id] += thd_bb;
+    });
+  OC_REAL8m rz = collect(thread_a);
+  const OC_REAL8m bb = collect(thread_b);
+  const OC_REAL8m tolsq = solver_tolerance*solver_tolerance*bb;
+
+  OC_REAL8m beta = 0.0;
+  OC_UINT4m iteration = 0;
+  while(rz>0.0 && iteration<solver_max_iterations) {
+    ++iteration;
+
+    // pn = z + beta*p, Ap = A.pn, and pAp = pn.Ap
+    Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (Ms,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        Nb_Xpfloat thd_pAp = 0.0;
+        OC_INDEX offset[6];
+        for(OC_INDEX i=istart;i<istop;++i) {
+          if(Ms[i]==0.0) {
+            cg_pn[i] = cg_Ap[i] = 0.0;
+            continue;
+          }
+          GetNeighbours(Ms,i,offset);
+          const OC_REAL8m pi = cg_z[i] + beta*cg_p[i];
+          OC_REAL8m Kp = 0.0;
+          for(int k=0;k<6;++k) {
+            if(offset[k]!=0) {
+              const OC_INDEX j = i+offset[k];
+              Kp += wgt[k]*(pi - (cg_z[j] + beta*cg_p[j]));
+            }
+          }
+          const OC_REAL8m Ap = Ms[i]*pi + c*Kp;
+          cg_pn[i] = pi;
+          cg_Ap[i] = Ap;
+          thd_pAp.Accum(pi*Ap);
+        }
+        thread_a[thread_id] += thd_pAp;
+      });
+    cg_p.Swap(cg_pn);
+    const OC_REAL8m pAp = collect(thread_a);
+    if(!(pAp>0.0)) break; // Safety
+    const OC_REAL8m step = rz/pAp;
+
+    // x += step*p, r -= step*Ap, z = r/diag
+    Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (Ms,
+       [&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+        Nb_Xpfloat thd_rz = 0.0, thd_rr = 0.0;
+        for(OC_INDEX i=istart;i<istop;++i) {
+          if(Ms[i]==0.0) continue;
+          x[i] += step*cg_p[i];
+          const OC_REAL8m r = cg_r[i] - step*cg_Ap[i];
+          const OC_REAL8m z = r/cg_diag[i];
+          cg_r[i] = r;
+          cg_z[i] = z;
+          thd_rz.Accum(r*z);
+          thd_rr.Accum(r*r);
+        }
+        thread_a[thread_id] += thd_rz;
+        thread_b[thread_id] += thd_rr;
+      });
+    const OC_REAL8m new_rz = collect(thread_a);
+    const OC_REAL8m rr = collect(thread_b);
+    if(rr<=tolsq) break;
+    beta = new_rz/rz;
+    rz = new_rz;
+  }
+  return iteration;
+}
+
+
+OC_REAL8m
+Oxs_SemiImplicitEvolve::PositiveTimestepBound
+(OC_REAL8m max_dm_dt)
+{ // Computes an estimate on the minimum time needed to change the
+  // magnetization state, subject to floating points limits.  This code
+  // lifted out of Oxs_RungeKuttaEvolve, q.v.
+  OC_REAL8m tbound = DBL_MAX/64.;
+  if(max_dm_dt>1 || OC_REAL8_EPSILON<tbound*max_dm_dt) {
+    tbound = OC_REAL8_EPSILON/max_dm_dt;
+    // A timestep of size tbound will be hopelessly lost in roundoff
+    // error.  So increase a bit, based on an empirical fudge factor.
+    tbound *= 64;
+  } else {
+    // Degenerate case: max_dm_dt_ must be exactly or very nearly
+    // zero.  Punt.
+    tbound = max_timestep;
+  }
+  return tbound;
+}
+
+
+void Oxs_SemiImplicitEvolve::Calculate_dm_dt
+(const Oxs_Mesh& mesh_,
+ const Oxs_MeshValue<OC_REAL8m>& Ms_,
+ const Oxs_MeshValue<ThreeVector>& mxH_,
+ const Oxs_MeshValue<ThreeVector>& spin_,
+ OC_REAL8m pE_pt_,
+ Oxs_MeshValue<ThreeVector>& dm_dt_,
+ OC_REAL8m& max_dm_dt_,OC_REAL8m& dE_dt_,OC_REAL8m& timestep_lower_bound_)
+{ // Imports: mesh_, Ms_, mxH_, spin_, pE_pt_
+  // Exports: dm_dt_, max_dm_dt_, dE_dt_, timestep_lower_bound_
+  dm_dt_.AdjustSize(&mesh_);
+
+  const OC_REAL8m coef1 = (do_precess ? -1*gamma : 0.0 );
+  const OC_REAL8m coef2 = alpha * gamma;
+
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  std::vector<OC_REAL8m> thread_max_dm_dt_sq(number_of_threads,0.0);
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_dE_dt_sum(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms_,
+     [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
+      Oxs_Energy::SUMTYPE thd_dE_dt_sum = 0.0;
+      OC_REAL8m thd_max_dm_dt_sq = 0.0;
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(Ms_[j]==0) {
+          dm_dt_[j].Set(0.0,0.0,0.0);
+          continue;
+        }
+        thd_dE_dt_sum += mxH_[j].MagSq() * Ms_[j] * mesh_.Volume(j);
+        ThreeVector scratch = mxH_[j];
+        scratch ^= spin_[j];
+        scratch *= coef2;
+        scratch.Accum(coef1,mxH_[j]);
+        OC_REAL8m dm_dt_sq = scratch.MagSq();
+        dm_dt_[j] = scratch;
+        if(dm_dt_sq>thd_max_dm_dt_sq) thd_max_dm_dt_sq = dm_dt_sq;
+      }
+      thread_dE_dt_sum[thread_id] += thd_dE_dt_sum;
+      if(thread_max_dm_dt_sq[thread_id]<thd_max_dm_dt_sq) {
+        thread_max_dm_dt_sq[thread_id] = thd_max_dm_dt_sq;
+      }
+    });
+
+  OC_REAL8m max_dm_dt_sq = thread_max_dm_dt_sq[0];
+  for(int i=1;i<number_of_threads;++i) {
+    if(thread_max_dm_dt_sq[i] > max_dm_dt_sq) {
+      max_dm_dt_sq = thread_max_dm_dt_sq[i];
+    }
+    thread_dE_dt_sum[0] += thread_dE_dt_sum[i];
+  }
+  max_dm_dt_ = sqrt(max_dm_dt_sq);
+  dE_dt_ = -1 * MU0 * gamma * alpha * OC_REAL8m(thread_dE_dt_sum[0]) + pE_pt_;
+  timestep_lower_bound_ = PositiveTimestepBound(max_dm_dt_);
+}
+
+
+OC_BOOL
+Oxs_SemiImplicitEvolve::CheckError
+(OC_REAL8m global_error_order,
+ OC_REAL8m error,
+ OC_REAL8m stepsize,
+ OC_REAL8m reference_stepsize,
+ OC_REAL8m max_dm_dt,
+ OC_REAL8m& new_stepsize)
+{ // Returns 1 if step is good, 0 if error is too large.
+  // Export new_stepsize is set to suggested stepsize
+  // for next step.
+  //
+  // NOTE: This routine lifted from eulerevolve.cc, which in turn
+  //     came from rungekuttaevolve.cc.  Check there for details and
+  //     updates.
+
+  OC_BOOL good_step = 1;
+  OC_BOOL error_checked=0;
+
+  if(allowed_relative_step_error>=0. || allowed_error_rate>=0.) {
+    // Determine tighter rate bound.
+    OC_REAL8m rate_error = 0.0;
+    if(allowed_relative_step_error<0.) {
+      rate_error = allowed_error_rate;
+    } else if(allowed_error_rate<0.) {
+      rate_error = allowed_relative_step_error * max_dm_dt;
+    } else {
+      rate_error = allowed_relative_step_error * max_dm_dt;
+      if(rate_error>allowed_error_rate) {
+        rate_error = allowed_error_rate;
+      }
+    }
+    rate_error *= stepsize;
+
+    // Rate check
+    if(error>rate_error) {
+      good_step = 0;
+      new_stepsize = pow(rate_error/error,1.0/global_error_order);
+    } else {
+      OC_REAL8m ratio = 0.125*DBL_MAX;
+      if(error>=1 || rate_error<ratio*error) {
+        OC_REAL8m test_ratio = rate_error/error;
+        if(test_ratio<ratio) ratio = test_ratio;
+      }
+      new_stepsize = pow(ratio,1.0/global_error_order);
+    }
+    error_checked = 1;
+  }
+
+  // Absolute error check
+  if(allowed_absolute_step_error>=0.0) {
+    OC_REAL8m test_stepsize = 0.0;
+    OC_REAL8m local_error_order = global_error_order + 1.0;
+    if(error>allowed_absolute_step_error) {
+      good_step = 0;
+      test_stepsize = pow(allowed_absolute_step_error/error,
+                          1.0/local_error_order);
+    } else {
+      OC_REAL8m ratio = 0.125*DBL_MAX;
+      if(error>=1 || allowed_absolute_step_error<ratio*error) {
+        OC_REAL8m test_ratio = allowed_absolute_step_error/error;
+        if(test_ratio<ratio) ratio = test_ratio;
+      }
+      test_stepsize = pow(ratio,1.0/local_error_order);
+    }
+    if(!error_checked || test_stepsize<new_stepsize) {
+      new_stepsize = test_stepsize;
+    }
+    error_checked = 1;
+  }
+
+  if(error_checked) {
+    new_stepsize *= step_headroom;
+    if(new_stepsize<max_step_decrease) {
+      new_stepsize = max_step_decrease*stepsize;
+    } else {
+      new_stepsize *= stepsize;
+      OC_REAL8m step_bound = stepsize * max_step_increase;
+      const OC_REAL8m refrat = 0.85;  // Ad hoc value
+      if(stepsize<reference_stepsize*refrat) {
+        step_bound = OC_MIN(step_bound,reference_stepsize);
+      } else if(stepsize<reference_stepsize) {
+        OC_REAL8m ref_bound = reference_stepsize + (max_step_increase-1)
+          *(stepsize-reference_stepsize*refrat)/(1-refrat);
+        step_bound = OC_MIN(step_bound,ref_bound);
+      }
+      if(new_stepsize>step_bound) new_stepsize = step_bound;
+    }
+  } else {
+    new_stepsize = stepsize;
+  }
+
+  return good_step;
+}
+
+OC_BOOL
+Oxs_SemiImplicitEvolve::Step(const Oxs_TimeDriver* driver,
+                             Oxs_ConstKey<Oxs_SimState> current_state,
+                             Oxs_DriverStepInfo& /* step_info */,
+                             Oxs_Key<Oxs_SimState>& next_state)
+{
+  const int number_of_threads = Oc_GetMaxThreadCount();
+
+  const Oxs_SimState& cstate = current_state.GetReadReference();
+
+  // Do first part of next_state structure initialization.
+  Oxs_SimState& workstate = next_state.GetWriteReference();
+  driver->FillStateMemberData(current_state.GetReadReference(),workstate);
+
+  if(cstate.mesh->Id() != workstate.mesh->Id()) {
+    throw Oxs_ExtError(this,
+       "Oxs_SemiImplicitEvolve::Step: Oxs_Mesh not fixed across steps.");
+  }
+
+  if(cstate.Id() != workstate.previous_state_id) {
+    throw Oxs_ExtError(this,
+       "Oxs_SemiImplicitEvolve::Step: State continuity break detected.");
+  }
+
+  // Pull cached values out from cstate.  See notes in
+  // Oxs_EulerEvolve::Step.  The total field array total_H is cached
+  // alongside energy.
+  if(energy_state_id != cstate.Id()) {
+    // cached data out-of-date
+    UpdateDerivedOutputs(cstate);
+  }
+  OC_BOOL cache_good = 1;
+  OC_REAL8m max_dm_dt,dE_dt,delta_E,pE_pt;
+  OC_REAL8m timestep_lower_bound;
+
+  cache_good &= cstate.GetDerivedData(max_dm_dt_key,max_dm_dt);
+  cache_good &= cstate.GetDerivedData(dE_dt_key,dE_dt);
+  cache_good &= cstate.GetDerivedData(delta_E_key,delta_E);
+  cache_good &= cstate.GetDerivedData(pE_pt_key,pE_pt);
+  cache_good &= cstate.GetDerivedData(timestep_lower_bound_key,
+                                      timestep_lower_bound);
+  cache_good &= (energy_state_id == cstate.Id());
+  cache_good &= (dm_dt_output.cache.state_id == cstate.Id());
+
+  if(!cache_good) {
+    throw Oxs_ExtError(this,
+       "Oxs_SemiImplicitEvolve::Step: Invalid data cache.");
+  }
+
+  const Oxs_MeshValue<ThreeVector>& dm_dt = dm_dt_output.cache.value;
+
+  // Negotiate with driver over size of next step
+  OC_REAL8m stepsize = next_timestep;
+
+  if(stepsize<=0.0) {
+    if(start_dm < sqrt(DBL_MAX/4) * max_dm_dt) {
+      stepsize = start_dm / max_dm_dt;
+    } else {
+      stepsize = sqrt(DBL_MAX/4);
+    }
+  }
+
+  // Insure step is not outside requested step bounds
+  if(stepsize<timestep_lower_bound) stepsize = timestep_lower_bound;
+  if(stepsize>max_timestep) stepsize = max_timestep;
+  if(stepsize<min_timestep) stepsize = min_timestep;
+
+  workstate.last_timestep=stepsize;
+  if(cstate.stage_number != workstate.stage_number) {
+    // New stage
+    workstate.stage_start_time = cstate.stage_start_time
+                                + cstate.stage_elapsed_time;
+    workstate.stage_elapsed_time = workstate.last_timestep;
+  } else {
+    workstate.stage_start_time = cstate.stage_start_time;
+    workstate.stage_elapsed_time = cstate.stage_elapsed_time
+                                  + workstate.last_timestep;
+  }
+  workstate.iteration_count = cstate.iteration_count + 1;
+  workstate.stage_iteration_count = cstate.stage_iteration_count + 1;
+
+  // Additional timestep control
+  driver->FillStateSupplemental(cstate,workstate);
+
+  // Check for forced step.  See notes in Oxs_EulerEvolve::Step.
+  OC_BOOL forcestep=0;
+  OC_REAL8m timestepcheck = workstate.last_timestep
+                         - 4*OC_REAL8_EPSILON*workstate.stage_elapsed_time;
+  if(timestepcheck<=min_timestep || timestepcheck<=timestep_lower_bound) {
+    forcestep=1;
+  }
+  stepsize = workstate.last_timestep;
+
+  // Gauss-Seidel projection step.  See notes in semiimplicitevolve.h.
+  const Oxs_Mesh* mesh = cstate.mesh;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(cstate.Ms);
+  const Oxs_MeshValue<ThreeVector>& spin = cstate.spin;
+  SetupLinearExchange(cstate);
+  ComputeExplicitField(cstate,total_H,explicit_field);
+  const Oxs_MeshValue<ThreeVector>& f = explicit_field;
+  for(int c=0;c<3;++c) {
+    comp[c].AdjustSize(mesh);
+    g[c].AdjustSize(mesh);
+  }
+  rhs.AdjustSize(mesh);
+  auto component = [](const ThreeVector& v,int c) -> OC_REAL8m {
+    return (c==0 ? v.x : (c==1 ? v.y : v.z));
+  };
+  auto form_rhs = [&](int c,OC_REAL8m tau) {
+    // rhs = comp[c] + tau*f_c
+    Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (Ms,
+       [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+        for(OC_INDEX i=istart;i<istop;++i) {
+          rhs[i] = comp[c][i] + tau*component(f[i],c);
+        }
+      });
+  };
+  OC_UINT4m solver_iterations = 0;
+
+  Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (spin,
+     [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+      for(OC_INDEX i=istart;i<istop;++i) {
+        comp[0][i] = spin[i].x;
+        comp[1][i] = spin[i].y;
+        comp[2][i] = spin[i].z;
+      }
+    });
+
+  if(do_precess) {
+    // 1) Gyromagnetic part, Gauss-Seidel in the components.  The
+    // updates below are done in place; each uses the already updated
+    // components of m* and the old values of the remaining ones.
+    const OC_REAL8m tau = gamma*stepsize;
+    for(int c=1;c<3;++c) {
+      form_rhs(c,tau);
+      solver_iterations += Solve(Ms,tau,rhs,g[c]);
+    }
+    Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (Ms,
+       [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+        for(OC_INDEX i=istart;i<istop;++i) {
+          if(Ms[i]==0.0) continue;
+          comp[0][i] -= comp[1][i]*g[2][i] - comp[2][i]*g[1][i];
+          rhs[i] = comp[0][i] + tau*f[i].x;
+        }
+      });
+    solver_iterations += Solve(Ms,tau,rhs,g[0]);
+    Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (Ms,
+       [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+        for(OC_INDEX i=istart;i<istop;++i) {
+          if(Ms[i]==0.0) continue;
+          comp[1][i] -= comp[2][i]*g[0][i] - comp[0][i]*g[2][i];
+          rhs[i] = comp[1][i] + tau*f[i].y;
+        }
+      });
+    solver_iterations += Solve(Ms,tau,rhs,g[1]);
+    Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (Ms,
+       [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+        for(OC_INDEX i=istart;i<istop;++i) {
+          if(Ms[i]==0.0) continue;
+          comp[2][i] -= comp[0][i]*g[1][i] - comp[1][i]*g[0][i];
+        }
+      });
+  }
+
+  // 2) Damping, as an implicit heat flow step on each component.
+  const OC_REAL8m damp_tau = alpha*gamma*stepsize;
+  for(int c=0;c<3;++c) {
+    form_rhs(c,damp_tau);
+    solver_iterations += Solve(Ms,damp_tau,rhs,g[c]);
+  }
+
+  // 3) Projection.  Put new spin configuration in next_state.
+  workstate.spin.AdjustSize(workstate.mesh); // Safety
+  Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (spin,
+     [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+      for(OC_INDEX i=istart;i<istop;++i) {
+        if(Ms[i]==0.0) {
+          workstate.spin[i] = spin[i];
+          continue;
+        }
+        ThreeVector tempspin(g[0][i],g[1][i],g[2][i]);
+        tempspin.MakeUnit();
+        workstate.spin[i] = tempspin;
+      }
+    });
+
+  const Oxs_SimState& nstate
+    = next_state.GetReadReference();  // Release write lock
+
+  //  Compute energy and torque
+  OC_REAL8m new_pE_pt;
+  GetEnergyDensity(nstate,new_energy,
+                   &mxH_output.cache.value,
+                   &new_H,new_pE_pt);
+  mxH_output.cache.state_id=nstate.Id();
+  const Oxs_MeshValue<ThreeVector>& mxH = mxH_output.cache.value;
+
+  // Calculate delta E, new dm/dt, and an error estimate.  As in
+  // Oxs_EulerEvolve, the local error is estimated by the difference
+  // between the step taken and the step that would result from
+  // averaging dm/dt across the endpoints.
+  OC_REAL8m new_max_dm_dt,new_dE_dt,new_timestep_lower_bound;
+  Calculate_dm_dt(*(nstate.mesh),*(nstate.Ms),mxH,nstate.spin,new_pE_pt,
+                  new_dm_dt,new_max_dm_dt,new_dE_dt,
+                  new_timestep_lower_bound);
+
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_var_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_total_E(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+  std::vector<OC_REAL8m> thread_max_error_sq(number_of_threads,0.0);
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
+      Oxs_Energy::SUMTYPE thd_dE = 0.0;
+      Oxs_Energy::SUMTYPE thd_var_dE = 0.0;
+      Oxs_Energy::SUMTYPE thd_total_E = 0.0;
+      OC_REAL8m thd_max_error_sq = thread_max_error_sq[thread_id];
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        OC_REAL8m vol = mesh->Volume(j);
+        OC_REAL8m e = energy[j];
+        thd_total_E += e * vol;
+        OC_REAL8m new_e = new_energy[j];
+        thd_dE += (new_e - e) * vol;
+        thd_var_dE += (new_e*new_e + e*e)*vol*vol;
+        ThreeVector temp = dm_dt[j];
+        temp -= new_dm_dt[j];
+        OC_REAL8m temp_error_sq = temp.MagSq();
+        if(temp_error_sq>thd_max_error_sq) thd_max_error_sq = temp_error_sq;
+      }
+      thread_dE[thread_id]      += thd_dE;
+      thread_var_dE[thread_id]  += thd_var_dE;
+      thread_total_E[thread_id] += thd_total_E;
+      thread_max_error_sq[thread_id] = thd_max_error_sq;
+    });
+  for(int i=1;i<number_of_threads;++i) {
+    thread_dE[0] += thread_dE[i];
+    thread_var_dE[0] += thread_var_dE[i];
+    thread_total_E[0] += thread_total_E[i];
+    if(thread_max_error_sq[0] < thread_max_error_sq[i]) {
+      thread_max_error_sq[0] = thread_max_error_sq[i];
+    }
+  }
+  OC_REAL8m total_E = static_cast<OC_REAL8m>(thread_total_E[0]);
+  OC_REAL8m dE      = static_cast<OC_REAL8m>(thread_dE[0]);
+  OC_REAL8m var_dE  = static_cast<OC_REAL8m>(thread_var_dE[0]);
+  var_dE *= 256*OC_REAL8_EPSILON*OC_REAL8_EPSILON; // See eulerevolve.cc
+
+  // Actual (local) error estimate is max_error * stepsize
+  OC_REAL8m max_error = sqrt(thread_max_error_sq[0])/2.0;
+
+  // Energy check control; see eulerevolve.cc.
+  OC_REAL8m max_allowed_dE = 0.5 * (pE_pt+new_pE_pt) * stepsize
+    + OC_MAX(OC_REAL8_EPSILON*fabs(total_E),2*sqrt(var_dE));
+
+  // Check step and adjust next_timestep.
+  OC_REAL8m suggested_step;
+  OC_BOOL goodstep = CheckError(1,max_error*stepsize,
+                                stepsize, stepsize,
+                                max_dm_dt,suggested_step);
+  if(dE>max_allowed_dE && suggested_step>0.5*stepsize) {
+    suggested_step = 0.5*stepsize;
+  }
+  next_timestep = suggested_step;
+
+  if(!forcestep && !goodstep) {
+    // Reject step
+    return 0;
+  }
+
+  // Otherwise, accept step.
+
+  // If next_timestep is much smaller than the timestep that brought
+  // us to cstate, then the reduction was probably due to a stage
+  // stopping_time requirement.  So in this case bump the
+  // next_stepsize request up to the minimum allowed reduction.
+  OC_REAL8m timestep_lower_limit = max_step_decrease * step_headroom;
+  timestep_lower_limit *= timestep_lower_limit * cstate.last_timestep;
+  if(next_timestep<timestep_lower_limit) {
+    next_timestep = timestep_lower_limit;
+  }
+
+  if(!nstate.AddDerivedData(timestep_lower_bound_key,
+                            new_timestep_lower_bound) ||
+     !nstate.AddDerivedData(max_dm_dt_key,new_max_dm_dt) ||
+     !nstate.AddDerivedData(dE_dt_key,new_dE_dt) ||
+     !nstate.AddDerivedData(delta_E_key,dE) ||
+     !nstate.AddDerivedData(pE_pt_key,new_pE_pt) ||
+     !nstate.AddDerivedData(solver_iterations_key,
+                            OC_REAL8m(solver_iterations))) {
+    throw Oxs_ExtError(this,
+       "Oxs_SemiImplicitEvolve::Step:"
+       " Programming error; data cache already set.");
+  }
+
+  // Max angle carry-over.
+  driver->FillStateDerivedData(cstate,nstate);
+
+  dm_dt_output.cache.value.Swap(new_dm_dt);
+  dm_dt_output.cache.state_id = nstate.Id();
+
+  energy.Swap(new_energy);
+  total_H.Swap(new_H);
+  energy_state_id = nstate.Id();
+
+  return 1;  // Good step
+}
+
+void Oxs_SemiImplicitEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
+{ // This routine fills all the Oxs_SemiImplicitEvolve Oxs_ScalarOutput's
+  // to the appropriate value based on the import "state", and any of
+  // Oxs_VectorOutput's that have CacheRequest enabled are filled.
+  // It also makes sure all the expected WOO objects in state are
+  // filled.
+  max_dm_dt_output.cache.state_id
+    = dE_dt_output.cache.state_id
+    = delta_E_output.cache.state_id
+    = solver_iterations_output.cache.state_id
+    = 0;  // Mark change in progress
+
+  OC_REAL8m dummy_value;
+  if(!state.GetDerivedData(max_dm_dt_key,max_dm_dt_output.cache.value) ||
+     !state.GetDerivedData(dE_dt_key,dE_dt_output.cache.value) ||
+     !state.GetDerivedData(delta_E_key,delta_E_output.cache.value) ||
+     !state.GetDerivedData(pE_pt_key,dummy_value) ||
+     !state.GetDerivedData(timestep_lower_bound_key,dummy_value) ||
+     energy_state_id != state.Id() ||
+     (dm_dt_output.GetCacheRequestCount()>0
+      && dm_dt_output.cache.state_id != state.Id()) ||
+     (mxH_output.GetCacheRequestCount()>0
+      && mxH_output.cache.state_id != state.Id())) {
+
+    // Missing at least some data, so calculate from scratch
+
+    // Calculate H and mxH outputs
+    Oxs_MeshValue<ThreeVector>& mxH = mxH_output.cache.value;
+    OC_REAL8m pE_pt;
+    GetEnergyDensity(state,energy,&mxH,&total_H,pE_pt);
+    energy_state_id=state.Id();
+    mxH_output.cache.state_id=state.Id();
+    if(!state.GetDerivedData(pE_pt_key,dummy_value)) {
+      state.AddDerivedData(pE_pt_key,pE_pt);
+    }
+
+    // Calculate dm/dt, Max dm/dt and dE/dt
+    Oxs_MeshValue<ThreeVector>& dm_dt
+      = dm_dt_output.cache.value;
+    dm_dt_output.cache.state_id=0;
+    OC_REAL8m timestep_lower_bound;
+    Calculate_dm_dt(*(state.mesh),*(state.Ms),mxH,state.spin,
+                    pE_pt,dm_dt,
+                    max_dm_dt_output.cache.value,
+                    dE_dt_output.cache.value,timestep_lower_bound);
+    dm_dt_output.cache.state_id=state.Id();
+    if(!state.GetDerivedData(max_dm_dt_key,dummy_value)) {
+      state.AddDerivedData(max_dm_dt_key,max_dm_dt_output.cache.value);
+    }
+    if(!state.GetDerivedData(dE_dt_key,dummy_value)) {
+      state.AddDerivedData(dE_dt_key,dE_dt_output.cache.value);
+    }
+    if(!state.GetDerivedData(timestep_lower_bound_key,dummy_value)) {
+      state.AddDerivedData(timestep_lower_bound_key,
+                           timestep_lower_bound);
+    }
+
+    if(!state.GetDerivedData(delta_E_key,dummy_value)) {
+      if(state.previous_state_id!=0 && state.stage_iteration_count>0) {
+        throw Oxs_ExtError(this,
+           "Oxs_SemiImplicitEvolve::UpdateDerivedOutputs:"
+           " Can't derive Delta E from single state.");
+      }
+      state.AddDerivedData(delta_E_key,0.0);
+      dummy_value = 0.;
+    }
+    delta_E_output.cache.value=dummy_value;
+  }
+
+  if(!state.GetDerivedData(solver_iterations_key,
+                           solver_iterations_output.cache.value)) {
+    solver_iterations_output.cache.value = 0.0;
+  }
+
+  max_dm_dt_output.cache.value*=(180e-9/PI);
+  /// Convert from radians/second to deg/ns
+
+  max_dm_dt_output.cache.state_id
+    = dE_dt_output.cache.state_id
+    = delta_E_output.cache.state_id
+    = solver_iterations_output.cache.state_id
+    = state.Id();
+}
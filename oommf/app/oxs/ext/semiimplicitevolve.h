@@ -0,0 +1,167 @@
+/* FILE: semiimplicitevolve.h                 -*-Mode: c++-*-
+ *
+ * Concrete evolver class, using a semi-implicit Gauss-Seidel
+ * projection step that treats the linear exchange term implicitly.
+ *
+ */
+
+#ifndef _OXS_SEMIIMPLICITEVOLVE
+#define _OXS_SEMIIMPLICITEVOLVE
+
+#include "energy.h"
+#include "key.h"
+#include "output.h"
+#include "rectangularmesh.h"
+#include "timeevolver.h"
+
+/* End includes */
+
+class Oxs_SemiImplicitEvolve:public Oxs_TimeEvolver {
+private:
+  // The total field is split as H = L.m + f, where L.m is the linear
+  // six-neighbour exchange field reported by energy terms supporting
+  // the Oxs_EnergyLinearExchangeSupport interface, and f is the
+  // remainder (computed as H-L.m).  Each step of size dt is a
+  // Gauss-Seidel projection step (X.-P. Wang, C. J. Garcia-Cervera and
+  // W. E, J. Comput. Phys. 171, 357-372 (2001)):
+  //
+  //  1) Precession, Gauss-Seidel in the components, with tau=gamma*dt
+  //        g = (I-tau*L)^-1 (m + tau*f)   (componentwise)
+  //        m*_x = m_x - (m_y g_z - m_z g_y), then update g_x from m*_x,
+  //        m*_y = m_y - (m_z g_x - m*_x g_z), then update g_y from m*_y,
+  //        m*_z = m_z - (m*_x g_y - m*_y g_x).
+  //  2) Damping, as a linearly implicit heat flow step
+  //        m** = (I-alpha*tau*L)^-1 (m* + alpha*tau*f).
+  //  3) Projection, m[n+1] = m**/|m**|.
+  //
+  // f is evaluated once per step, at m[n].  The linear systems are
+  // symmetrized by multiplying through by Ms and solved with Jacobi
+  // preconditioned conjugate gradients.  The method is first order,
+  // but the exchange term places no stability bound on dt, so steps
+  // on fine meshes are limited by the remaining fields and by the
+  // error controls below.  If no energy term reports linear exchange
+  // weights then all fields are handled explicitly.
+
+  // Base step size control parameters
+  OC_REAL8m min_timestep;           // Seconds
+  OC_REAL8m max_timestep;           // Seconds
+
+  // Error-based step size control parameters, as in Oxs_EulerEvolve.
+  // Each may be disabled by setting to -1.
+  OC_REAL8m allowed_error_rate;          // rad/s; MIF input is deg/ns
+  OC_REAL8m allowed_absolute_step_error; // rad; MIF input is degrees
+  OC_REAL8m allowed_relative_step_error; // Non-dimensional
+  OC_REAL8m step_headroom;
+
+  OC_REAL8m gamma;  // Landau-Lifschitz gyromagnetic ratio
+  OC_REAL8m alpha;  // Landau-Lifschitz damping coef
+  OC_BOOL do_precess;  // If false, then do pure damping
+
+  // Initial timestep is set so that max_dm_dt * timestep = start_dm.
+  OC_REAL8m start_dm;
+
+  // Linear solver controls
+  OC_REAL8m solver_tolerance;     // Relative residual
+  OC_UINT4m solver_max_iterations;
+
+  // Stepsize control
+  const OC_REAL8m max_step_increase;
+  const OC_REAL8m max_step_decrease;
+  OC_BOOL CheckError(OC_REAL8m global_error_order,
+                     OC_REAL8m error,
+                     OC_REAL8m stepsize,
+                     OC_REAL8m reference_stepsize,
+                     OC_REAL8m max_dm_dt,
+                     OC_REAL8m& new_stepsize);
+
+  // Linear exchange data, refreshed when the mesh changes.
+  OC_UINT4m exchange_mesh_id;
+  const Oxs_CommonRectangularMesh* exchange_mesh;  // Null if no
+  /// implicit exchange
+  OC_REAL8m wgtx, wgty, wgtz;  // Summed across supporting energies
+  int xperiodic, yperiodic, zperiodic;
+  void SetupLinearExchange(const Oxs_SimState& state);
+
+  // Neighbour offsets of cell i, or 0 for a missing or non-magnetic
+  // neighbour (or a neighbour that is the cell itself).  Order is
+  // -x, +x, -y, +y, -z, +z.
+  void GetNeighbours(const Oxs_MeshValue<OC_REAL8m>& Ms,
+                     OC_INDEX i,OC_INDEX offset[6]) const;
+
+  void ComputeExplicitField(const Oxs_SimState& state,
+                            const Oxs_MeshValue<ThreeVector>& H,
+                            Oxs_MeshValue<ThreeVector>& f) const;
+  /// Fills f = H - L.m
+
+  OC_UINT4m Solve(const Oxs_MeshValue<OC_REAL8m>& Ms,
+                  OC_REAL8m tau,
+                  const Oxs_MeshValue<OC_REAL8m>& rhs,
+                  Oxs_MeshValue<OC_REAL8m>& x);
+  /// Solves (I-tau*L) x = rhs for a single component.  The initial
+  /// guess is rhs.  Returns iteration count.
+
+  // Data cached from last state
+  OC_UINT4m energy_state_id;
+  Oxs_MeshValue<OC_REAL8m> energy;
+  Oxs_MeshValue<ThreeVector> total_H;
+  OC_REAL8m next_timestep;
+
+  // State derived data keys, set by constructor
+  Oxs_DerivedDataKey max_dm_dt_key;
+  Oxs_DerivedDataKey dE_dt_key;
+  Oxs_DerivedDataKey delta_E_key;
+  Oxs_DerivedDataKey pE_pt_key;
+  Oxs_DerivedDataKey timestep_lower_bound_key;
+  Oxs_DerivedDataKey solver_iterations_key;
+
+  // Outputs
+  void UpdateDerivedOutputs(const Oxs_SimState&);
+  Oxs_ScalarOutput<Oxs_SemiImplicitEvolve> max_dm_dt_output;
+  Oxs_ScalarOutput<Oxs_SemiImplicitEvolve> dE_dt_output;
+  Oxs_ScalarOutput<Oxs_SemiImplicitEvolve> delta_E_output;
+  Oxs_ScalarOutput<Oxs_SemiImplicitEvolve> solver_iterations_output;
+  Oxs_VectorFieldOutput<Oxs_SemiImplicitEvolve> dm_dt_output;
+  Oxs_VectorFieldOutput<Oxs_SemiImplicitEvolve> mxH_output;
+
+  // Scratch space
+  Oxs_MeshValue<OC_REAL8m> new_energy;
+  Oxs_MeshValue<ThreeVector> new_dm_dt;
+  Oxs_MeshValue<ThreeVector> new_H;
+  Oxs_MeshValue<ThreeVector> explicit_field;
+  Oxs_MeshValue<OC_REAL8m> comp[3];   // Spin components
+  Oxs_MeshValue<OC_REAL8m> g[3];      // Solutions
+  Oxs_MeshValue<OC_REAL8m> rhs;
+  Oxs_MeshValue<OC_REAL8m> cg_r, cg_z, cg_p, cg_pn, cg_Ap, cg_diag;
+
+  OC_REAL8m PositiveTimestepBound(OC_REAL8m max_dm_dt);
+
+  void Calculate_dm_dt
+  (const Oxs_Mesh& mesh_,
+   const Oxs_MeshValue<OC_REAL8m>& Ms_,
+   const Oxs_MeshValue<ThreeVector>& mxH_,
+   const Oxs_MeshValue<ThreeVector>& spin_,
+   OC_REAL8m pE_pt_,
+   Oxs_MeshValue<ThreeVector>& dm_dt_,
+   OC_REAL8m& max_dm_dt_,OC_REAL8m& dE_dt_,OC_REAL8m& timestep_lower_bound_);
+  /// Imports: mesh_, Ms_, mxH_, spin_, pE_pt
+  /// Exports: dm_dt_, max_dm_dt_, dE_dt_, timestep_lower_bound_
+
+public:
+  virtual const char* ClassName() const; // ClassName() is
+  /// automatically generated by the OXS_EXT_REGISTER macro.
+  virtual OC_BOOL Init();
+  Oxs_SemiImplicitEvolve(const char* name,     // Child instance id
+                         Oxs_Director* newdtr, // App director
+                         const char* argstr);  // MIF input block parameters
+  virtual ~Oxs_SemiImplicitEvolve();
+
+  virtual  OC_BOOL
+  Step(const Oxs_TimeDriver* driver,
+       Oxs_ConstKey<Oxs_SimState> current_state,
+       Oxs_DriverStepInfo& step_info,
+       Oxs_Key<Oxs_SimState>& next_state);
+  // Returns true if step was successful, false if
+  // unable to step as requested.
+};
+
+#endif // _OXS_SEMIIMPLICITEVOLVE
@@ -0,0 +1,577 @@
+/* FILE: thermalheunevolve.cc                 -*-Mode: c++-*-
+ *
+ * Concrete evolver class, using a fixed step stochastic Heun method
+ * to integrate the Landau-Lifshitz ODE with a thermal fluctuation
+ * field.
+ *
+ */
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include "nb.h"
+#include "director.h"
+#include "timedriver.h"
+#include "simstate.h"
+#include "thermalheunevolve.h"
+#include "key.h"
+
+// Oxs_Ext registration support
+OXS_EXT_REGISTER(Oxs_ThermalHeunEvolve);
+
+/* End includes */
+
+// Constructor
+Oxs_ThermalHeunEvolve::Oxs_ThermalHeunEvolve(
+  const char* name,     // Child instance id
+  Oxs_Director* newdtr, // App director
+  const char* argstr)   // MIF input block parameters
+  : Oxs_TimeEvolver(name,newdtr,argstr),
+    KBoltzmann(1.380649e-23),
+    energy_state_id(0)
+{
+  // Process arguments
+  timestep = GetRealInitValue("timestep",1e-13);
+  if(timestep<=0.0) {
+    char buf[4096];
+    Oc_Snprintf(buf,sizeof(buf),
+                "Invalid parameter value:"
+                " Specified time step is %g (should be >0.)",
+                static_cast<double>(timestep));
+    throw Oxs_ExtError(this,buf);
+  }
+
+  temperature = GetRealInitValue("temperature",0.0);
+  if(temperature<0.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " temperature value must be non-negative.");
+  }
+
+  // If no seed is specified, then draw one from the global generator.
+  // This makes the thermal noise reproducible under the MIF
+  // RandomSeed command.
+  if(HasInitValue("seed")) {
+    seed = GetUIntInitValue("seed");
+  } else {
+    seed = static_cast<OC_UINT4m>(Oc_UnifRand()*4294967295.0);
+  }
+
+  alpha = GetRealInitValue("alpha",0.5);
+  if(alpha<0.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " alpha value must be non-negative.");
+  }
+
+  // User may specify either gamma_G (Gilbert) or
+  // gamma_LL (Landau-Lifshitz).  Code uses "gamma"
+  // which is LL form.
+  if(HasInitValue("gamma_G") && HasInitValue("gamma_LL")) {
+    throw Oxs_ExtError(this,"Invalid Specify block; "
+                       "both gamma_G and gamma_LL specified.");
+  } else if(HasInitValue("gamma_G")) {
+    gamma = GetRealInitValue("gamma_G")/(1+alpha*alpha);
+  } else if(HasInitValue("gamma_LL")) {
+    gamma = GetRealInitValue("gamma_LL");
+  } else {
+    gamma = 2.211e5/(1+alpha*alpha);
+  }
+  gamma = fabs(gamma); // Force positive
+
+  do_precess = GetIntInitValue("do_precess",1);
+
+  // Setup outputs
+  max_dm_dt_output.Setup(this,InstanceName(),"Max dm/dt","deg/ns",
+     &Oxs_ThermalHeunEvolve::UpdateDerivedOutputs);
+  dE_dt_output.Setup(this,InstanceName(),"dE/dt","J/s",
+     &Oxs_ThermalHeunEvolve::UpdateDerivedOutputs);
+  delta_E_output.Setup(this,InstanceName(),"Delta E","J",
+     &Oxs_ThermalHeunEvolve::UpdateDerivedOutputs);
+  temperature_output.Setup(this,InstanceName(),"Temperature","K",
+     &Oxs_ThermalHeunEvolve::UpdateDerivedOutputs);
+
+  dm_dt_output.Setup(this,InstanceName(),"dm/dt","rad/s",
+     &Oxs_ThermalHeunEvolve::UpdateDerivedOutputs);
+  mxH_output.Setup(this,InstanceName(),"mxH","A/m",
+     &Oxs_ThermalHeunEvolve::UpdateDerivedOutputs);
+
+  max_dm_dt_output.Register(director,-5);
+  dE_dt_output.Register(director,-5);
+  delta_E_output.Register(director,-5);
+  temperature_output.Register(director,-5);
+  dm_dt_output.Register(director,-5);
+  mxH_output.Register(director,-5);
+
+  // dm_dt and mxH output caches are used for intermediate storage,
+  // so enable caching.
+  dm_dt_output.CacheRequestIncrement(1);
+  mxH_output.CacheRequestIncrement(1);
+
+  max_dm_dt_key = Oxs_DerivedDataKey("Max dm/dt");
+  dE_dt_key = Oxs_DerivedDataKey("dE/dt");
+  delta_E_key = Oxs_DerivedDataKey("Delta E");
+  pE_pt_key = Oxs_DerivedDataKey("pE/pt");
+  timestep_lower_bound_key = Oxs_DerivedDataKey("Timestep lower bound");
+
+  VerifyAllInitArgsUsed();
+}
+
+OC_BOOL Oxs_ThermalHeunEvolve::Init()
+{
+  Oxs_TimeEvolver::Init();
+
+  energy_state_id=0;   // Mark as invalid state
+  return 1;
+}
+
+
+Oxs_ThermalHeunEvolve::~Oxs_ThermalHeunEvolve()
+{}
+
+
+void Oxs_ThermalHeunEvolve::FillThermalField
+(const Oxs_SimState& state,
+ OC_REAL8m stepsize,
+ Oxs_MeshValue<ThreeVector>& H_th) const
+{ // Cells are taken in groups of four, and the twelve normal deviates
+  // for group g on the step out of state are generated with the
+  // Marsaglia polar method from Philox blocks with counters (g,
+  // iteration_count, block) for block = 0, 1, 2, ....  Each block
+  // provides two candidate pairs, and about four blocks are needed per
+  // group.  The polar method avoids the sin and cos evaluations of
+  // Box-Muller, which dominate its cost.  Rejections do
+  // not break reproducibility, because the counters depend only on the
+  // group and the step.  A thread whose range starts or ends inside a
+  // group generates the whole group and keeps its own cells, so the
+  // deviates do not depend on how cells are divided among threads.
+  const Oxs_Mesh* mesh = state.mesh;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  H_th.AdjustSize(mesh);
+
+  if(temperature<=0.0) {
+    H_th = ThreeVector(0.,0.,0.);
+    return;
+  }
+
+  // Variance numerator; see notes in thermalheunevolve.h
+  const OC_REAL8m varcoef = 2*alpha*KBoltzmann*temperature
+    /((1+alpha*alpha)*gamma*MU0*stepsize);
+  const uint64_t step = static_cast<uint64_t>(state.iteration_count);
+  const uint32_t key[2] = { static_cast<uint32_t>(seed),
+                            static_cast<uint32_t>(step>>32) };
+  const OC_INDEX group_size = 4;
+
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+      for(OC_INDEX g=istart/group_size;g*group_size<istop;++g) {
+        const OC_INDEX gstart = g*group_size;
+        const OC_INDEX jstart = (gstart<istart ? istart : gstart);
+        const OC_INDEX jstop
+          = (gstart+group_size<istop ? gstart+group_size : istop);
+        OC_INDEX j=jstart;
+        while(j<jstop && Ms[j]==0.0) H_th[j++].Set(0.,0.,0.);
+        if(j==jstop) continue;
+        OC_REAL8m dev[3*group_size];
+        int devcount = 0;
+        const uint64_t index = static_cast<uint64_t>(g);
+        for(uint32_t block=0;devcount<3*group_size;++block) {
+          uint32_t ctr[4] = { static_cast<uint32_t>(index),
+                              static_cast<uint32_t>(index>>32),
+                              static_cast<uint32_t>(step),
+                              block };
+          Oc_Philox4x32::Generate(ctr,key);
+          for(int w=0;w<4 && devcount<3*group_size;w+=2) {
+            // Uniform() is never 0.5, so u and v are never both zero.
+            const OC_REAL8m u = 2*Oc_Philox4x32::Uniform(ctr[w])-1;
+            const OC_REAL8m v = 2*Oc_Philox4x32::Uniform(ctr[w+1])-1;
+            const OC_REAL8m rsq = u*u + v*v;
+            if(rsq>=1.0) continue;
+            const OC_REAL8m f = sqrt(-2*log(rsq)/rsq);
+            dev[devcount++] = u*f;
+            dev[devcount++] = v*f;
+          }
+        }
+        for(;j<jstop;++j) {
+          if(Ms[j]==0.0) {
+            H_th[j].Set(0.,0.,0.);
+            continue;
+          }
+          const OC_REAL8m sigma = sqrt(varcoef/(Ms[j]*mesh->Volume(j)));
+          const OC_REAL8m* d = dev + 3*(j-gstart);
+          H_th[j].Set(sigma*d[0],sigma*d[1],sigma*d[2]);
+        }
+      }
+    });
+}
+
+
+void Oxs_ThermalHeunEvolve::HeunSlope
+(const Oxs_MeshValue<OC_REAL8m>& Ms_,
+ const Oxs_MeshValue<ThreeVector>& spin_,
+ const Oxs_MeshValue<ThreeVector>& mxH_,
+ const Oxs_MeshValue<ThreeVector>& H_th_,
+ Oxs_MeshValue<ThreeVector>& slope_) const
+{
+  slope_.AdjustSize(spin_);
+  const OC_REAL8m coef1 = (do_precess ? -1*gamma : 0.0 );
+  const OC_REAL8m coef2 = alpha * gamma;
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms_,
+     [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(Ms_[j]==0) {
+          slope_[j].Set(0.0,0.0,0.0);
+          continue;
+        }
+        ThreeVector mxHtot = spin_[j];
+        mxHtot ^= H_th_[j];
+        mxHtot += mxH_[j];
+        ThreeVector scratch = mxHtot;
+        scratch ^= spin_[j];
+        scratch *= coef2;
+        scratch.Accum(coef1,mxHtot);
+        slope_[j] = scratch;
+      }
+    });
+}
+
+
+OC_REAL8m
+Oxs_ThermalHeunEvolve::PositiveTimestepBound
+(OC_REAL8m max_dm_dt)
+{ // Computes an estimate on the minimum time needed to change the
+  // magnetization state, subject to floating points limits.  This code
+  // lifted out of Oxs_RungeKuttaEvolve, q.v.
+  OC_REAL8m tbound = DBL_MAX/64.;
+  if(max_dm_dt>1 || OC_REAL8_EPSILON<tbound*max_dm_dt) {
+    tbound = OC_REAL8_EPSILON/max_dm_dt;
+    // A timestep of size tbound will be hopelessly lost in roundoff
+    // error.  So increase a bit, based on an empirical fudge factor.
+    tbound *= 64;
+  } else {
+    // Degenerate case: max_dm_dt_ must be exactly or very nearly
+    // zero.  Punt.
+    tbound = timestep;
+  }
+  return tbound;
+}
+
+
+void Oxs_ThermalHeunEvolve::Calculate_dm_dt
+(const Oxs_Mesh& mesh_,
+ const Oxs_MeshValue<OC_REAL8m>& Ms_,
+ const Oxs_MeshValue<ThreeVector>& mxH_,
+ const Oxs_MeshValue<ThreeVector>& spin_,
+ OC_REAL8m pE_pt_,
+ Oxs_MeshValue<ThreeVector>& dm_dt_,
+ OC_REAL8m& max_dm_dt_,OC_REAL8m& dE_dt_,OC_REAL8m& timestep_lower_bound_)
+{ // Imports: mesh_, Ms_, mxH_, spin_, pE_pt_
+  // Exports: dm_dt_, max_dm_dt_, dE_dt_, timestep_lower_bound_
+  dm_dt_.AdjustSize(&mesh_);
+
+  const OC_REAL8m coef1 = (do_precess ? -1*gamma : 0.0 );
+  const OC_REAL8m coef2 = alpha * gamma;
+
+  const int number_of_threads = Oc_GetMaxThreadCount();
+  std::vector<OC_REAL8m> thread_max_dm_dt_sq(number_of_threads,0.0);
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_dE_dt_sum(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms_,
+     [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
+      Oxs_Energy::SUMTYPE thd_dE_dt_sum = 0.0;
+      OC_REAL8m thd_max_dm_dt_sq = 0.0;
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(Ms_[j]==0) {
+          dm_dt_[j].Set(0.0,0.0,0.0);
+          continue;
+        }
+        thd_dE_dt_sum += mxH_[j].MagSq() * Ms_[j] * mesh_.Volume(j);
+        ThreeVector scratch = mxH_[j];
+        scratch ^= spin_[j];
+        scratch *= coef2;
+        scratch.Accum(coef1,mxH_[j]);
+        OC_REAL8m dm_dt_sq = scratch.MagSq();
+        dm_dt_[j] = scratch;
+        if(dm_dt_sq>thd_max_dm_dt_sq) thd_max_dm_dt_sq = dm_dt_sq;
+      }
+      thread_dE_dt_sum[thread_id] += thd_dE_dt_sum;
+      if(thread_max_dm_dt_sq[thread_id]<thd_max_dm_dt_sq) {
+        thread_max_dm_dt_sq[thread_id] = thd_max_dm_dt_sq;
+      }
+    });
+
+  OC_REAL8m max_dm_dt_sq = thread_max_dm_dt_sq[0];
+  for(int i=1;i<number_of_threads;++i) {
+    if(thread_max_dm_dt_sq[i] > max_dm_dt_sq) {
+      max_dm_dt_sq = thread_max_dm_dt_sq[i];
+    }
+    thread_dE_dt_sum[0] += thread_dE_dt_sum[i];
+  }
+  max_dm_dt_ = sqrt(max_dm_dt_sq);
+  dE_dt_ = -1 * MU0 * gamma * alpha * OC_REAL8m(thread_dE_dt_sum[0]) + pE_pt_;
+  timestep_lower_bound_ = PositiveTimestepBound(max_dm_dt_);
+}
+
+
+OC_BOOL
+Oxs_ThermalHeunEvolve::Step(const Oxs_TimeDriver* driver,
+                            Oxs_ConstKey<Oxs_SimState> current_state,
+                            Oxs_DriverStepInfo& /* step_info */,
+                            Oxs_Key<Oxs_SimState>& next_state)
+{
+  const int number_of_threads = Oc_GetMaxThreadCount();
+
+  const Oxs_SimState& cstate = current_state.GetReadReference();
+
+  // Do first part of next_state structure initialization.
+  Oxs_SimState& workstate = next_state.GetWriteReference();
+  driver->FillStateMemberData(current_state.GetReadReference(),workstate);
+
+  if(cstate.mesh->Id() != workstate.mesh->Id()) {
+    throw Oxs_ExtError(this,
+       "Oxs_ThermalHeunEvolve::Step: Oxs_Mesh not fixed across steps.");
+  }
+
+  if(cstate.Id() != workstate.previous_state_id) {
+    throw Oxs_ExtError(this,
+       "Oxs_ThermalHeunEvolve::Step: State continuity break detected.");
+  }
+
+  // Pull cached values out from cstate.  See notes in
+  // Oxs_EulerEvolve::Step.
+  if(energy_state_id != cstate.Id()) {
+    // cached data out-of-date
+    UpdateDerivedOutputs(cstate);
+  }
+  OC_BOOL cache_good = 1;
+  OC_REAL8m max_dm_dt,dE_dt,delta_E,pE_pt;
+  OC_REAL8m timestep_lower_bound;
+
+  cache_good &= cstate.GetDerivedData(max_dm_dt_key,max_dm_dt);
+  cache_good &= cstate.GetDerivedData(dE_dt_key,dE_dt);
+  cache_good &= cstate.GetDerivedData(delta_E_key,delta_E);
+  cache_good &= cstate.GetDerivedData(pE_pt_key,pE_pt);
+  cache_good &= cstate.GetDerivedData(timestep_lower_bound_key,
+                                      timestep_lower_bound);
+  cache_good &= (energy_state_id == cstate.Id());
+  cache_good &= (mxH_output.cache.state_id == cstate.Id());
+
+  if(!cache_good) {
+    throw Oxs_ExtError(this,
+       "Oxs_ThermalHeunEvolve::Step: Invalid data cache.");
+  }
+
+  // Fixed step size, unless the driver needs a shorter step to meet
+  // a stage stopping criterion.  The thermal field variance is scaled
+  // to the step actually taken.
+  workstate.last_timestep=timestep;
+  if(cstate.stage_number != workstate.stage_number) {
+    // New stage
+    workstate.stage_start_time = cstate.stage_start_time
+                                + cstate.stage_elapsed_time;
+    workstate.stage_elapsed_time = workstate.last_timestep;
+  } else {
+    workstate.stage_start_time = cstate.stage_start_time;
+    workstate.stage_elapsed_time = cstate.stage_elapsed_time
+                                  + workstate.last_timestep;
+  }
+  workstate.iteration_count = cstate.iteration_count + 1;
+  workstate.stage_iteration_count = cstate.stage_iteration_count + 1;
+  driver->FillStateSupplemental(cstate,workstate);
+  const OC_REAL8m stepsize = workstate.last_timestep;
+
+  const Oxs_Mesh* mesh = cstate.mesh;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(cstate.Ms);
+  const Oxs_MeshValue<ThreeVector>& spin = cstate.spin;
+  FillThermalField(cstate,stepsize,thermal_H);
+
+  // Predictor: m1 = m + dt*f(m,H+H_th), stored in next_state.  The
+  // first slope is kept in "slope".
+  HeunSlope(Ms,spin,mxH_output.cache.value,thermal_H,slope);
+  workstate.spin.AdjustSize(mesh);
+  Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (spin,
+     [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+      for(OC_INDEX i=istart;i<istop;++i) {
+        ThreeVector tempspin = spin[i];
+        tempspin.Accum(stepsize,slope[i]);
+        tempspin.MakeUnit();
+        workstate.spin[i] = tempspin;
+      }
+    });
+  OC_REAL8m predictor_pE_pt;
+  GetEnergyDensity(next_state.GetReadReference(),new_energy,
+                   &predictor_mxH,NULL,predictor_pE_pt);
+
+  // Corrector: m2 = m + dt*(f(m,H+H_th) + f(m1,H1+H_th))/2, with the
+  // same H_th in both slopes.
+  {
+    Oxs_SimState& newstate = next_state.GetWriteReference();
+    newstate.ClearDerivedData();
+    const Oxs_MeshValue<ThreeVector>& pspin = newstate.spin;
+    const OC_REAL8m coef1 = (do_precess ? -1*gamma : 0.0 );
+    const OC_REAL8m coef2 = alpha * gamma;
+    Oxs_RunThreaded<ThreeVector,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (spin,
+       [&](OC_INT4m,OC_INDEX istart,OC_INDEX istop) {
+        for(OC_INDEX i=istart;i<istop;++i) {
+          if(Ms[i]==0.0) {
+            newstate.spin[i] = spin[i];
+            continue;
+          }
+          ThreeVector mxHtot = pspin[i];
+          mxHtot ^= thermal_H[i];
+          mxHtot += predictor_mxH[i];
+          ThreeVector slope2 = mxHtot;
+          slope2 ^= pspin[i];
+          slope2 *= coef2;
+          slope2.Accum(coef1,mxHtot);
+          slope2 += slope[i];
+          ThreeVector tempspin = spin[i];
+          tempspin.Accum(0.5*stepsize,slope2);
+          tempspin.MakeUnit();
+          newstate.spin[i] = tempspin;
+        }
+      });
+  }
+  const Oxs_SimState& nstate
+    = next_state.GetReadReference();  // Release write lock
+
+  //  Compute energy and torque at the new state.  These also seed the
+  //  first slope of the next step.
+  OC_REAL8m new_pE_pt;
+  GetEnergyDensity(nstate,new_energy,
+                   &mxH_output.cache.value,
+                   NULL,new_pE_pt);
+  mxH_output.cache.state_id=nstate.Id();
+  const Oxs_MeshValue<ThreeVector>& mxH = mxH_output.cache.value;
+
+  OC_REAL8m new_max_dm_dt,new_dE_dt,new_timestep_lower_bound;
+  Calculate_dm_dt(*(nstate.mesh),*(nstate.Ms),mxH,nstate.spin,new_pE_pt,
+                  new_dm_dt,new_max_dm_dt,new_dE_dt,
+                  new_timestep_lower_bound);
+
+  Oc_AlignedVector<Oxs_Energy::SUMTYPE>
+    thread_dE(number_of_threads,Oxs_Energy::SUMTYPE(0.0));
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m thread_id,OC_INDEX jstart,OC_INDEX jstop) {
+      Oxs_Energy::SUMTYPE thd_dE = 0.0;
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        thd_dE += (new_energy[j] - energy[j]) * mesh->Volume(j);
+      }
+      thread_dE[thread_id] += thd_dE;
+    });
+  for(int i=1;i<number_of_threads;++i) {
+    thread_dE[0] += thread_dE[i];
+  }
+  const OC_REAL8m dE = static_cast<OC_REAL8m>(thread_dE[0]);
+
+  // Thermal steps are always accepted; there is no error or energy
+  // based step control.
+  if(!nstate.AddDerivedData(timestep_lower_bound_key,
+                            new_timestep_lower_bound) ||
+     !nstate.AddDerivedData(max_dm_dt_key,new_max_dm_dt) ||
+     !nstate.AddDerivedData(dE_dt_key,new_dE_dt) ||
+     !nstate.AddDerivedData(delta_E_key,dE) ||
+     !nstate.AddDerivedData(pE_pt_key,new_pE_pt)) {
+    throw Oxs_ExtError(this,
+       "Oxs_ThermalHeunEvolve::Step:"
+       " Programming error; data cache already set.");
+  }
+
+  // Max angle carry-over.
+  driver->FillStateDerivedData(cstate,nstate);
+
+  dm_dt_output.cache.value.Swap(new_dm_dt);
+  dm_dt_output.cache.state_id = nstate.Id();
+
+  energy.Swap(new_energy);
+  energy_state_id = nstate.Id();
+
+  return 1;  // Good step
+}
+
+void Oxs_ThermalHeunEvolve::UpdateDerivedOutputs(const Oxs_SimState& state)
+{ // This routine fills all the Oxs_ThermalHeunEvolve Oxs_ScalarOutput's
+  // to the appropriate value based on the import "state", and any of
+  // Oxs_VectorOutput's that have CacheRequest enabled are filled.
+  // It also makes sure all the expected WOO objects in state are
+  // filled.  The dm/dt outputs exclude the thermal field.
+  max_dm_dt_output.cache.state_id
+    = dE_dt_output.cache.state_id
+    = delta_E_output.cache.state_id
+    = temperature_output.cache.state_id
+    = 0;  // Mark change in progress
+
+  OC_REAL8m dummy_value;
+  if(!state.GetDerivedData(max_dm_dt_key,max_dm_dt_output.cache.value) ||
+     !state.GetDerivedData(dE_dt_key,dE_dt_output.cache.value) ||
+     !state.GetDerivedData(delta_E_key,delta_E_output.cache.value) ||
+     !state.GetDerivedData(pE_pt_key,dummy_value) ||
+     !state.GetDerivedData(timestep_lower_bound_key,dummy_value) ||
+     energy_state_id != state.Id() ||
+     (dm_dt_output.GetCacheRequestCount()>0
+      && dm_dt_output.cache.state_id != state.Id()) ||
+     (mxH_output.GetCacheRequestCount()>0
+      && mxH_output.cache.state_id != state.Id())) {
+
+    // Missing at least some data, so calculate from scratch
+
+    // Calculate H and mxH outputs
+    Oxs_MeshValue<ThreeVector>& mxH = mxH_output.cache.value;
+    OC_REAL8m pE_pt;
+    GetEnergyDensity(state,energy,&mxH,NULL,pE_pt);
+    energy_state_id=state.Id();
+    mxH_output.cache.state_id=state.Id();
+    if(!state.GetDerivedData(pE_pt_key,dummy_value)) {
+      state.AddDerivedData(pE_pt_key,pE_pt);
+    }
+
+    // Calculate dm/dt, Max dm/dt and dE/dt
+    Oxs_MeshValue<ThreeVector>& dm_dt
+      = dm_dt_output.cache.value;
+    dm_dt_output.cache.state_id=0;
+    OC_REAL8m timestep_lower_bound;
+    Calculate_dm_dt(*(state.mesh),*(state.Ms),mxH,state.spin,
+                    pE_pt,dm_dt,
+                    max_dm_dt_output.cache.value,
+                    dE_dt_output.cache.value,timestep_lower_bound);
+    dm_dt_output.cache.state_id=state.Id();
+    if(!state.GetDerivedData(max_dm_dt_key,dummy_value)) {
+      state.AddDerivedData(max_dm_dt_key,max_dm_dt_output.cache.value);
+    }
+    if(!state.GetDerivedData(dE_dt_key,dummy_value)) {
+      state.AddDerivedData(dE_dt_key,dE_dt_output.cache.value);
+    }
+    if(!state.GetDerivedData(timestep_lower_bound_key,dummy_value)) {
+      state.AddDerivedData(timestep_lower_bound_key,
+                           timestep_lower_bound);
+    }
+
+    if(!state.GetDerivedData(delta_E_key,dummy_value)) {
+      if(state.previous_state_id!=0 && state.stage_iteration_count>0) {
+        throw Oxs_ExtError(this,
+           "Oxs_ThermalHeunEvolve::UpdateDerivedOutputs:"
+           " Can't derive Delta E from single state.");
+      }
+      state.AddDerivedData(delta_E_key,0.0);
+      dummy_value = 0.;
+    }
+    delta_E_output.cache.value=dummy_value;
+  }
+
+  temperature_output.cache.value = temperature;
+
+  max_dm_dt_output.cache.value*=(180e-9/PI);
+  /// Convert from radians/second to deg/ns
+
+  max_dm_dt_output.cache.state_id
+    = dE_dt_output.cache.state_id
+    = delta_E_output.cache.state_id
+    = temperature_output.cache.state_id
+    = state.Id();
+}
@@ -0,0 +1,117 @@
+/* FILE: thermalheunevolve.h                 -*-Mode: c++-*-
+ *
+ * Concrete evolver class, using a fixed step stochastic Heun method
+ * to integrate the Landau-Lifshitz ODE with a thermal fluctuation
+ * field.
+ *
+ */
+
+#ifndef _OXS_THERMALHEUNEVOLVE
+#define _OXS_THERMALHEUNEVOLVE
+
+#include "key.h"
+#include "output.h"
+#include "timeevolver.h"
+
+/* End includes */
+
+class Oxs_ThermalHeunEvolve:public Oxs_TimeEvolver {
+private:
+  // The effective field is H + H_th, where each component of the
+  // thermal field H_th in cell i is an independent normal deviate
+  // with zero mean and variance
+  //
+  //    2 alpha kB T / ((1+alpha^2) gamma MU0 Ms[i] Volume[i] dt)
+  //
+  // (Brown, Phys. Rev. 130, 1677-1686 (1963)), with gamma the LL
+  // gyromagnetic ratio.  H_th is held fixed across the step, and the
+  // Heun predictor-corrector step then converges to the Stratonovich
+  // solution.  The deviates are drawn from the counter-based
+  // Oc_Philox4x32 generator, keyed by seed and counted by iteration
+  // number and cell group index (see FillThermalField), so the noise in
+  // each cell does not depend on how cells are divided among threads.
+
+  OC_REAL8m timestep;     // Seconds; the driver may shorten steps to
+  /// meet stage stopping criteria.
+  OC_REAL8m temperature;  // Kelvin
+  OC_UINT4m seed;         // Philox key
+
+  OC_REAL8m gamma;  // Landau-Lifschitz gyromagnetic ratio
+  OC_REAL8m alpha;  // Landau-Lifschitz damping coef
+  OC_BOOL do_precess;  // If false, then do pure damping
+
+  const OC_REAL8m KBoltzmann;  // J/K
+
+  void FillThermalField(const Oxs_SimState& state,
+                        OC_REAL8m stepsize,
+                        Oxs_MeshValue<ThreeVector>& H_th) const;
+  /// Fills H_th with the thermal field for the step out of state.
+
+  void HeunSlope(const Oxs_MeshValue<OC_REAL8m>& Ms_,
+                 const Oxs_MeshValue<ThreeVector>& spin_,
+                 const Oxs_MeshValue<ThreeVector>& mxH_,
+                 const Oxs_MeshValue<ThreeVector>& H_th_,
+                 Oxs_MeshValue<ThreeVector>& slope_) const;
+  /// Fills slope_ with the right hand side of the LL ODE using the
+  /// total field H + H_th.
+
+  // Data cached from last state
+  OC_UINT4m energy_state_id;
+  Oxs_MeshValue<OC_REAL8m> energy;
+
+  // State derived data keys, set by constructor
+  Oxs_DerivedDataKey max_dm_dt_key;
+  Oxs_DerivedDataKey dE_dt_key;
+  Oxs_DerivedDataKey delta_E_key;
+  Oxs_DerivedDataKey pE_pt_key;
+  Oxs_DerivedDataKey timestep_lower_bound_key;
+
+  // Outputs
+  void UpdateDerivedOutputs(const Oxs_SimState&);
+  Oxs_ScalarOutput<Oxs_ThermalHeunEvolve> max_dm_dt_output;
+  Oxs_ScalarOutput<Oxs_ThermalHeunEvolve> dE_dt_output;
+  Oxs_ScalarOutput<Oxs_ThermalHeunEvolve> delta_E_output;
+  Oxs_ScalarOutput<Oxs_ThermalHeunEvolve> temperature_output;
+  Oxs_VectorFieldOutput<Oxs_ThermalHeunEvolve> dm_dt_output;
+  Oxs_VectorFieldOutput<Oxs_ThermalHeunEvolve> mxH_output;
+
+  // Scratch space
+  Oxs_MeshValue<OC_REAL8m> new_energy;
+  Oxs_MeshValue<ThreeVector> new_dm_dt;
+  Oxs_MeshValue<ThreeVector> thermal_H;
+  Oxs_MeshValue<ThreeVector> slope;
+  Oxs_MeshValue<ThreeVector> predictor_mxH;
+
+  OC_REAL8m PositiveTimestepBound(OC_REAL8m max_dm_dt);
+
+  void Calculate_dm_dt
+  (const Oxs_Mesh& mesh_,
+   const Oxs_MeshValue<OC_REAL8m>& Ms_,
+   const Oxs_MeshValue<ThreeVector>& mxH_,
+   const Oxs_MeshValue<ThreeVector>& spin_,
+   OC_REAL8m pE_pt_,
+   Oxs_MeshValue<ThreeVector>& dm_dt_,
+   OC_REAL8m& max_dm_dt_,OC_REAL8m& dE_dt_,OC_REAL8m& timestep_lower_bound_);
+  /// Imports: mesh_, Ms_, mxH_, spin_, pE_pt
+  /// Exports: dm_dt_, max_dm_dt_, dE_dt_, timestep_lower_bound_
+  /// The exports are deterministic, i.e., computed without H_th.
+
+public:
+  virtual const char* ClassName() const; // ClassName() is
+  /// automatically generated by the OXS_EXT_REGISTER macro.
+  virtual OC_BOOL Init();
+  Oxs_ThermalHeunEvolve(const char* name,     // Child instance id
+                        Oxs_Director* newdtr, // App director
+                        const char* argstr);  // MIF input block parameters
+  virtual ~Oxs_ThermalHeunEvolve();
+
+  virtual  OC_BOOL
+  Step(const Oxs_TimeDriver* driver,
+       Oxs_ConstKey<Oxs_SimState> current_state,
+       Oxs_DriverStepInfo& step_info,
+       Oxs_Key<Oxs_SimState>& next_state);
+  // Returns true if step was successful, false if
+  // unable to step as requested.
+};
+
+#endif // _OXS_THERMALHEUNEVOLVE
@@ -4,6 +4,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "director.h"
 #include "timeevolver.h"
 
@@ -15,14 +17,16 @@
 Oxs_TimeEvolver::Oxs_TimeEvolver
 (const char* name,     // Child instance id
  Oxs_Director* newdtr) // App director
-  : Oxs_Evolver(name,newdtr), energy_calc_count(0)
+  : Oxs_Evolver(name,newdtr), energy_calc_count(0),
+    slow_field_state_id(0)
 {}
 
 Oxs_TimeEvolver::Oxs_TimeEvolver
 (const char* name,
  Oxs_Director* newdtr,
  const char* argstr)      // MIF block argument string
-  : Oxs_Evolver(name,newdtr,argstr), energy_calc_count(0)
+  : Oxs_Evolver(name,newdtr,argstr), energy_calc_count(0),
+    slow_field_state_id(0)
 {
   total_energy_output.Setup(this,InstanceName(),
                             "Total energy","J",
@@ -69,6 +73,10 @@ OC_BOOL Oxs_TimeEvolver::Init()
   // Release scratch space.
   temp_energy.Release();
   temp_field.Release();
+  temp_slow_energy.Release();
+  temp_total_field.Release();
+  slow_field.Release();
+  slow_field_state_id = 0;
 
   // Advertise "well known quantities" available for attaching to
   // Oxs_SimStates. This attachment is handled in the GetEnergies()
@@ -151,7 +159,7 @@ void Oxs_TimeEvolver::GetEnergyDensity
 
   Oxs_MeshValue<ThreeVector>* H_fill = H_req;
   Oxs_MeshValue<ThreeVector>* field_cache = NULL;
-  if(total_field_output.GetCacheRequestCount()>0) {
+  if(total_field_output.IsDemanded(state)) {
     total_field_output.cache.state_id=0;
     field_cache = &total_field_output.cache.value;
     if(H_fill==NULL) H_fill = field_cache;
@@ -161,20 +169,24 @@ void Oxs_TimeEvolver::GetEnergyDensity
 
   // Set up energy computation data structures
   UpdateFixedSpinList(state.mesh);
-  Oxs_ComputeEnergiesImports ocei(*director,state,
-                                  director->GetEnergyObjects(),
-                                  GetFixedSpinList(),
-                                  &temp_energy,&temp_field);
   Oxs_ComputeEnergiesExports ocee;
-  ocee.energy   = &energy;
-  ocee.H        = H_fill;
-  ocee.mxH      = mxH_req;
-  ocee.mxHxm    = nullptr;
-  // Remaining ocee members are initialized to zero by default.
+  if(!slow_energy_terms.empty()) {
+    GetSplitEnergies(state,energy,mxH_req,H_fill,ocee);
+  } else {
+    Oxs_ComputeEnergiesImports ocei(*director,state,
+                                    director->GetEnergyObjects(),
+                                    GetFixedSpinList(),
+                                    &temp_energy,&temp_field);
+    ocee.energy   = &energy;
+    ocee.H        = H_fill;
+    ocee.mxH      = mxH_req;
+    ocee.mxHxm    = nullptr;
+    // Remaining ocee members are initialized to zero by default.
 
-  GetEnergies(ocei,ocee);
+    GetEnergies(ocei,ocee);
+  }
 
-  if(total_energy_density_output.GetCacheRequestCount()>0) {
+  if(total_energy_density_output.IsDemanded(state)) {
     // Energy density field output requested.  Copy results
     // to output cache.
     total_energy_density_output.cache.state_id=0;
@@ -204,6 +216,103 @@ void Oxs_TimeEvolver::GetEnergyDensity
   total_E = ocee.energy_sum; // Export total energy
 }
 
+void Oxs_TimeEvolver::SetSlowEnergyTerms
+(const std::vector<Oxs_Energy*>& slow_terms)
+{
+  slow_energy_terms = slow_terms;
+  fast_energy_terms.clear();
+  slow_field_state_id = 0;
+  if(slow_energy_terms.empty()) return;
+  const std::vector<Oxs_Energy*> all_terms = director->GetEnergyObjects();
+  for(auto term : all_terms) {
+    if(std::find(slow_energy_terms.begin(),slow_energy_terms.end(),term)
+       == slow_energy_terms.end()) {
+      fast_energy_terms.push_back(term);
+    }
+  }
+}
+
+// Multi-rate version of the energy evaluation in GetEnergyDensity.
+// The slow terms are evaluated first, with the field going to
+// slow_field, then the fast terms, and the two groups are summed.  If
+// any well-known quantities are requested for attachment to the state
+// then the slow/fast split would attach partial sums, so in that case
+// the full term list is evaluated in a single pass and the slow terms
+// are evaluated again separately for slow_field.
+void Oxs_TimeEvolver::GetSplitEnergies
+(const Oxs_SimState& state,
+ Oxs_MeshValue<OC_REAL8m>& energy,
+ Oxs_MeshValue<ThreeVector>* mxH_req,
+ Oxs_MeshValue<ThreeVector>* H_req,
+ Oxs_ComputeEnergiesExports& ocee)
+{
+  slow_field_state_id = 0;
+
+  const OC_BOOL attach = director->WellKnownQuantityRequestStatus();
+  if(attach) {
+    Oxs_ComputeEnergiesImports ocei(*director,state,
+                                    director->GetEnergyObjects(),
+                                    GetFixedSpinList(),
+                                    &temp_energy,&temp_field);
+    ocee.energy = &energy;
+    ocee.H      = H_req;
+    ocee.mxH    = mxH_req;
+    GetEnergies(ocei,ocee);
+  }
+
+  Oxs_ComputeEnergiesImports ocei_slow(*director,state,
+                                       slow_energy_terms,
+                                       GetFixedSpinList(),
+                                       &temp_energy,&temp_field);
+  Oxs_ComputeEnergiesExports ocee_slow;
+  ocee_slow.energy = &temp_slow_energy;
+  ocee_slow.H      = &slow_field;
+  GetEnergies(ocei_slow,ocee_slow);
+  slow_field_state_id = state.Id();
+  if(attach) return;
+
+  Oxs_MeshValue<ThreeVector>* H = (H_req ? H_req : &temp_total_field);
+  Oxs_ComputeEnergiesImports ocei(*director,state,fast_energy_terms,
+                                  GetFixedSpinList(),
+                                  &temp_energy,&temp_field);
+  ocee.energy = &energy;
+  ocee.H      = H;
+  ocee.mxH    = nullptr;
+  GetEnergies(ocei,ocee);
+  ocee.energy_sum += ocee_slow.energy_sum;
+  ocee.pE_pt      += ocee_slow.pE_pt;
+
+  // Sum groups, and compute mxH from total H if requested
+  if(mxH_req) mxH_req->AdjustSize(state.mesh);
+  const Oxs_MeshValue<OC_REAL8m>& slow_energy = temp_slow_energy;
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  Oxs_RunThreaded<OC_REAL8m,std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (Ms,
+     [&](OC_INT4m,OC_INDEX jstart,OC_INDEX jstop) {
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        energy[j] += slow_energy[j];
+        (*H)[j] += slow_field[j];
+        if(mxH_req) {
+          if(Ms[j]==0.0) { // Ignore zero-moment spins
+            (*mxH_req)[j].Set(0.,0.,0.);
+            continue;
+          }
+          ThreeVector mxH = spin[j];
+          mxH ^= (*H)[j];
+          (*mxH_req)[j] = mxH;
+        }
+      }
+    });
+  if(mxH_req) {
+    // Torque is zero at fixed spins
+    const vector<OC_INDEX>* fixed = GetFixedSpinList();
+    if(fixed) {
+      for(auto index : *fixed) (*mxH_req)[index].Set(0.,0.,0.);
+    }
+  }
+}
+
 void Oxs_TimeEvolver::UpdateEnergyOutputs(const Oxs_SimState& state)
 {
   if(state.Id()==0) { // Safety
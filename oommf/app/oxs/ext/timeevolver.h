@@ -7,6 +7,8 @@
 #ifndef _OXS_TIMEEVOLVER
 #define _OXS_TIMEEVOLVER
 
+#include <vector>
+
 #include "driver.h"
 #include "energy.h"
 #include "evolver.h"
@@ -25,6 +27,17 @@ private:
   Oxs_MeshValue<OC_REAL8m> temp_energy;     // Scratch space used by
   Oxs_MeshValue<ThreeVector> temp_field; // GetEnergyDensity().
 
+  // Multi-rate support; see SetSlowEnergyTerms() below.
+  std::vector<Oxs_Energy*> slow_energy_terms;
+  std::vector<Oxs_Energy*> fast_energy_terms;
+  Oxs_MeshValue<OC_REAL8m> temp_slow_energy;
+  Oxs_MeshValue<ThreeVector> temp_total_field;
+  void GetSplitEnergies(const Oxs_SimState& state,
+                        Oxs_MeshValue<OC_REAL8m>& energy,
+                        Oxs_MeshValue<ThreeVector>* mxH_req,
+                        Oxs_MeshValue<ThreeVector>* H_req,
+                        Oxs_ComputeEnergiesExports& ocee);
+
   // Outputs maintained by this interface layer.  These are conceptually
   // public, but are specified private to force clients to use the
   // output_map interface.
@@ -84,6 +97,25 @@ protected:
     GetEnergyDensity(state,energy,mxH_req,H_req,pE_pt,dummy_E);
   }
 
+  // Multi-rate support.  Children that advance some energy terms at a
+  // slower rate than the rest (for example, holding the demag field
+  // fixed across inner Runge-Kutta stages) register those terms with
+  // SetSlowEnergyTerms().  While the slow list is non-empty,
+  // GetEnergyDensity() evaluates the slow and fast terms as separate
+  // groups, and leaves the field from the slow group in slow_field
+  // with slow_field_state_id set to the id of the evaluated state.
+  // The fast group is all the director energy terms not in the slow
+  // list.  Pass an empty list to disable.
+  void SetSlowEnergyTerms(const std::vector<Oxs_Energy*>& slow_terms);
+  const std::vector<Oxs_Energy*>& GetSlowEnergyTerms() const {
+    return slow_energy_terms;
+  }
+  const std::vector<Oxs_Energy*>& GetFastEnergyTerms() const {
+    return fast_energy_terms;
+  }
+  Oxs_MeshValue<ThreeVector> slow_field;
+  OC_UINT4m slow_field_state_id;
+
 public:
   virtual ~Oxs_TimeEvolver();
 
@@ -0,0 +1,704 @@
+/* FILE: treedemag.cc            -*-Mode: c++-*-
+ *
+ * Demagnetization field by tree code.  See treedemag.h for an
+ * overview.
+ *
+ * The magnetic cells are sorted into a binary tree by recursive
+ * bisection of their bounding box, splitting each node across its
+ * longest side, until each leaf holds no more than leaf_size cells in
+ * a box of no more than 2*leaf_size cells.  For each leaf T the source
+ * tree is walked from the root, and a node S is accepted into the far
+ * list of T if
+ *
+ *      radius(S) < opening_angle * distance(center(S),box(T))
+ *
+ * Otherwise the children of S are visited, or if S is a leaf it is put
+ * on the near list of T.  Interaction lists depend only on the mesh and
+ * the Ms pattern, so they are built once when the mesh changes.
+ *
+ * Near field.  For cell pairs from near list leaves the field is
+ * computed from a table of demag tensor values indexed by cell offset,
+ * filled as in Oxs_Demag: analytic formulae out to the asymptotic
+ * radius selected by demag_tensor_error, and Oxs_DemagN??Asymptotic
+ * beyond that.
+ *
+ * Far field.  Let m_j = Ms_j*spin_j be the magnetization of source cell
+ * j, s_j its offset from the center of node S, and V the cell volume.
+ * With Q0 = sum m_j, Q1[b][a] = sum s_jb*m_ja and Q2[a][bd] = sum
+ * s_jb*s_jd*m_ja, the field at offset x from the node center is, to
+ * second order in s/|x|,
+ *
+ *   H_c = V/(4*pi) * (   D2[c][a]*Q0[a] - D3[c][a][b]*Q1[b][a]
+ *                      + 0.5*D4[c][a][b][d]*Q2[a][bd] )
+ *
+ * where Dn are the n-th order derivative tensors of 1/|x|.  The finite
+ * size of the source and target cells is accounted for to the same
+ * order by adding (h_b^2/6)*Q0[a] to each Q2[a][bb], where h_b is the
+ * cell dimension along b.  The truncation error relative to the
+ * dipole term is O(opening_angle^3).
+ *
+ * The approximate interaction operator is not exactly symmetric, so
+ * the field is not exactly the gradient of the reported energy.  The
+ * difference is of the order of the truncation error.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nb.h"
+#include "director.h"
+#include "key.h"
+#include "mesh.h"
+#include "meshvalue.h"
+#include "oxsthread.h"
+#include "simstate.h"
+#include "threevector.h"
+#include "energy.h"             // Needed to make MSVC++ 5 happy
+
+#include "rectangularmesh.h"
+#include "treedemag.h"
+#include "demagcoef.h"
+
+OC_USE_STRING;
+
+/* End includes */
+
+// Oxs_Ext registration support
+OXS_EXT_REGISTER(Oxs_TreeDemag);
+
+// Constructor
+Oxs_TreeDemag::Oxs_TreeDemag(
+  const char* name,     // Child instance id
+  Oxs_Director* newdtr, // App director
+  const char* argstr)   // MIF input block parameters
+  : Oxs_Energy(name,newdtr,argstr),
+    mesh_id(0),energy_density_error_estimate(-1),
+    opening_angle(0.5),leaf_size(32),demag_tensor_error(1e-15),
+    xdim(0),ydim(0),zdim(0),dx(0),dy(0),dz(0),
+    ntabx(0),ntaby(0),ntabz(0),ntab_center(0)
+{
+  opening_angle = GetRealInitValue("opening_angle",0.5);
+  if(opening_angle<=0.0 || opening_angle>=1.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " opening_angle must lie in the open interval"
+                       " (0,1).");
+  }
+  leaf_size = GetIntInitValue("leaf_size",32);
+  if(leaf_size<1) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " leaf_size must be positive.");
+  }
+  demag_tensor_error = GetRealInitValue("demag_tensor_error",1e-15);
+  if(demag_tensor_error<=0.0) {
+    throw Oxs_ExtError(this,"Invalid initialization detected:"
+                       " demag_tensor_error must be positive.");
+  }
+  VerifyAllInitArgsUsed();
+}
+
+OC_BOOL Oxs_TreeDemag::Init()
+{
+  mesh_id = 0;
+  energy_density_error_estimate = -1;
+  ReleaseMemory();
+  return Oxs_Energy::Init();
+}
+
+void Oxs_TreeDemag::ReleaseMemory() const
+{ // Conceptually const
+  cell_index.clear();
+  cell_pos.clear();
+  cell_tab.clear();
+  pack_index.clear();
+  node.clear();
+  leaf.clear();
+  near_start.clear();  near_list.clear();
+  far_start.clear();   far_list.clear();
+  ntab.clear();
+  Mpack.clear();
+  Hpack.clear();
+  moment.clear();
+  farcoef.clear();
+  xdim=ydim=zdim=0;
+  ntabx=ntaby=ntabz=ntab_center=0;
+}
+
+OC_INDEX Oxs_TreeDemag::BuildTree(OC_INDEX first,OC_INDEX count) const
+{ // Builds the subtree holding cell_index[first,first+count), and
+  // returns the node index of its root.
+  const OC_INDEX xydim = xdim*ydim;
+  Node nd;
+  nd.first = first;
+  nd.count = count;
+  nd.lo[0] = xdim;  nd.lo[1] = ydim;  nd.lo[2] = zdim;
+  nd.hi[0] = nd.hi[1] = nd.hi[2] = 0;
+  for(OC_INDEX n=first;n<first+count;++n) {
+    const OC_INDEX index = cell_index[n];
+    const OC_INDEX c[3]
+      = { index%xdim, (index%xydim)/xdim, index/xydim };
+    for(int a=0;a<3;++a) {
+      if(c[a]<nd.lo[a])   nd.lo[a] = c[a];
+      if(c[a]>=nd.hi[a])  nd.hi[a] = c[a]+1;
+    }
+  }
+  const OC_REAL8m h[3] = { dx, dy, dz };
+  OC_REAL8m rsq = 0.0;
+  OC_INDEX box_cells = 1;
+  int axis = -1;
+  OC_REAL8m axis_length = 0.0;
+  for(int a=0;a<3;++a) {
+    const OC_INDEX ext = nd.hi[a] - nd.lo[a];
+    const OC_REAL8m length = h[a]*ext;
+    nd.center[a] = 0.5*h[a]*(nd.lo[a]+nd.hi[a]);
+    rsq += 0.25*length*length;
+    box_cells *= ext;
+    if(ext>1 && length>axis_length) {
+      axis = a;
+      axis_length = length;
+    }
+  }
+  nd.radius = sqrt(rsq);
+  nd.child[0] = nd.child[1] = -1;
+
+  const OC_INDEX id = static_cast<OC_INDEX>(node.size());
+  node.push_back(nd);
+  if(axis<0 || (count<=leaf_size && box_cells<=2*leaf_size)) {
+    return id; // Leaf
+  }
+
+  // Bisect across axis.  Both halves are non-empty because the box is
+  // tight and has extent at least 2 along axis.
+  const OC_INDEX mid = (nd.lo[axis] + nd.hi[axis])/2;
+  const OC_INDEX stride = (axis==0 ? 1 : (axis==1 ? xdim : xydim));
+  const OC_INDEX adim = (axis==0 ? xdim : (axis==1 ? ydim : zdim));
+  OC_INDEX* split
+    = std::partition(&(cell_index[first]),&(cell_index[first])+count,
+                     [=](OC_INDEX index) {
+                       return (index/stride)%adim < mid;
+                     });
+  const OC_INDEX lower_count = split - &(cell_index[first]);
+  assert(0<lower_count && lower_count<count);
+  const OC_INDEX child0 = BuildTree(first,lower_count);
+  const OC_INDEX child1 = BuildTree(first+lower_count,count-lower_count);
+  node[id].child[0] = child0;
+  node[id].child[1] = child1;
+  return id;
+}
+
+void Oxs_TreeDemag::FillNearTable(const Oxs_RectangularMesh* mesh) const
+{ // Fills ntab across [-ntabx,ntabx] x [-ntaby,ntaby] x [-ntabz,ntabz].
+  typedef OXS_DEMAG_REAL_ANALYTIC DR;
+
+  // Demag tensor is scale invariant, so work with cell dimensions
+  // scaled so the largest is 1, as in Oxs_Demag.
+  DR ddx = mesh->EdgeLengthX();
+  DR ddy = mesh->EdgeLengthY();
+  DR ddz = mesh->EdgeLengthZ();
+  {
+    DR maxedge = ddx;
+    if(ddy>maxedge) maxedge = ddy;
+    if(ddz>maxedge) maxedge = ddz;
+    ddx/=maxedge; ddy/=maxedge; ddz/=maxedge;
+  }
+  OXS_DEMAG_REAL_ASYMP adx,ady,adz;
+  ddx.DownConvert(adx);  ddy.DownConvert(ady);  ddz.DownConvert(adz);
+
+  const int asymptotic_order = 11;
+  Oxs_DemagNxxAsymptotic ANxx(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNxyAsymptotic ANxy(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNxzAsymptotic ANxz(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNyyAsymptotic ANyy(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNyzAsymptotic ANyz(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  Oxs_DemagNzzAsymptotic ANzz(adx,ady,adz,demag_tensor_error,asymptotic_order);
+  const OXS_DEMAG_REAL_ASYMP arad = ANxx.GetAsymptoticStart();
+  const OXS_DEMAG_REAL_ASYMP aradsq = arad*arad;
+
+  // Fill the first octant in quad, then reflect into ntab.
+  const OC_INDEX qdimx = ntabx+1;
+  const OC_INDEX qdimy = ntaby+1;
+  const OC_INDEX qdimz = ntabz+1;
+  vector<OC_REAL8m> quad(6*qdimx*qdimy*qdimz);
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (qdimy*qdimz,[&](OC_INT4m,OC_INDEX rstart,OC_INDEX rstop) {
+      for(OC_INDEX r=rstart;r<rstop;++r) {
+        const OC_INDEX k = r/qdimy;
+        const OC_INDEX j = r - k*qdimy;
+        for(OC_INDEX i=0;i<qdimx;++i) {
+          OC_REAL8m* nptr = &(quad[6*(r*qdimx+i)]);
+          const OXS_DEMAG_REAL_ASYMP x = adx*i;
+          const OXS_DEMAG_REAL_ASYMP y = ady*j;
+          const OXS_DEMAG_REAL_ASYMP z = adz*k;
+          if(x*x+y*y+z*z>=aradsq) {
+            nptr[0] = ANxx.Asymptotic(x,y,z);
+            nptr[1] = ANxy.Asymptotic(x,y,z);
+            nptr[2] = ANxz.Asymptotic(x,y,z);
+            nptr[3] = ANyy.Asymptotic(x,y,z);
+            nptr[4] = ANyz.Asymptotic(x,y,z);
+            nptr[5] = ANzz.Asymptotic(x,y,z);
+          } else {
+            const DR dxi = ddx*DR(double(i));
+            const DR dyj = ddy*DR(double(j));
+            const DR dzk = ddz*DR(double(k));
+            Oxs_CalculateNxx(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[0]);
+            Oxs_CalculateNxy(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[1]);
+            Oxs_CalculateNxz(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[2]);
+            Oxs_CalculateNyy(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[3]);
+            Oxs_CalculateNyz(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[4]);
+            Oxs_CalculateNzz(dxi,dyj,dzk,ddx,ddy,ddz).DownConvert(nptr[5]);
+          }
+        }
+      }
+    });
+
+  // Self term.  Oxs_SelfDemagN? is more accurate than the general
+  // formulae at the origin.
+  Oxs_SelfDemagNx(ddx,ddy,ddz).DownConvert(quad[0]);
+  Oxs_SelfDemagNy(ddx,ddy,ddz).DownConvert(quad[3]);
+  Oxs_SelfDemagNz(ddx,ddy,ddz).DownConvert(quad[5]);
+  quad[1] = quad[2] = quad[4] = 0.0;
+
+  // Nxy is odd in x and y, Nxz in x and z, and Nyz in y and z.  The
+  // diagonal terms are even.
+  const OC_INDEX tdimx = 2*ntabx+1;
+  const OC_INDEX tdimy = 2*ntaby+1;
+  const OC_INDEX tdimz = 2*ntabz+1;
+  ntab.resize(6*tdimx*tdimy*tdimz);
+  ntab_center = (ntabz*tdimy + ntaby)*tdimx + ntabx;
+  for(OC_INDEX k=-ntabz;k<=ntabz;++k) {
+    const OC_REAL8m sz = (k<0 ? -1.0 : 1.0);
+    const OC_INDEX ak = (k<0 ? -k : k);
+    for(OC_INDEX j=-ntaby;j<=ntaby;++j) {
+      const OC_REAL8m sy = (j<0 ? -1.0 : 1.0);
+      const OC_INDEX aj = (j<0 ? -j : j);
+      for(OC_INDEX i=-ntabx;i<=ntabx;++i) {
+        const OC_REAL8m sx = (i<0 ? -1.0 : 1.0);
+        const OC_INDEX ai = (i<0 ? -i : i);
+        const OC_REAL8m* qptr = &(quad[6*((ak*qdimy + aj)*qdimx + ai)]);
+        OC_REAL8m* nptr = &(ntab[6*(ntab_center + (k*tdimy + j)*tdimx + i)]);
+        nptr[0] = qptr[0];
+        nptr[1] = sx*sy*qptr[1];
+        nptr[2] = sx*sz*qptr[2];
+        nptr[3] = qptr[3];
+        nptr[4] = sy*sz*qptr[4];
+        nptr[5] = qptr[5];
+      }
+    }
+  }
+}
+
+void Oxs_TreeDemag::SetupTree(const Oxs_SimState& state) const
+{ // This routine is conceptually const.
+  const Oxs_RectangularMesh* mesh
+    = dynamic_cast<const Oxs_RectangularMesh*>(state.mesh);
+  if(mesh==NULL) {
+    String msg = String("Object ")
+      + String(state.mesh->InstanceName())
+      + String(" is not a (non-periodic) rectangular mesh.");
+    throw Oxs_ExtError(this,msg);
+  }
+
+  // Clean-up from previous allocation, if any.
+  ReleaseMemory();
+
+  xdim = mesh->DimX();
+  ydim = mesh->DimY();
+  zdim = mesh->DimZ();
+  const OC_INDEX size = xdim*ydim*zdim;
+  if(size==0) return; // Empty mesh!
+
+  // Work in units of the largest cell dimension.
+  {
+    const OC_REAL8m hx = mesh->EdgeLengthX();
+    const OC_REAL8m hy = mesh->EdgeLengthY();
+    const OC_REAL8m hz = mesh->EdgeLengthZ();
+    OC_REAL8m hmax = (hx>hy ? hx : hy);
+    if(hz>hmax) hmax = hz;
+    dx = hx/hmax;  dy = hy/hmax;  dz = hz/hmax;
+  }
+
+  // Magnetic cells
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  for(OC_INDEX i=0;i<size;++i) {
+    if(Ms[i]!=0.0) cell_index.push_back(i);
+  }
+  const OC_INDEX cell_count = static_cast<OC_INDEX>(cell_index.size());
+  pack_index.assign(size,-1);
+  if(cell_count==0) return;
+
+  BuildTree(0,cell_count);
+  for(OC_INDEX n=0;n<OC_INDEX(node.size());++n) {
+    if(node[n].child[0]<0) leaf.push_back(n);
+  }
+  const OC_INDEX xydim = xdim*ydim;
+  cell_pos.resize(3*cell_count);
+  for(OC_INDEX n=0;n<cell_count;++n) {
+    const OC_INDEX index = cell_index[n];
+    cell_pos[3*n]   = dx*(index%xdim + 0.5);
+    cell_pos[3*n+1] = dy*((index%xydim)/xdim + 0.5);
+    cell_pos[3*n+2] = dz*(index/xydim + 0.5);
+    pack_index[index] = n;
+  }
+
+  // Interaction lists
+  const OC_REAL8m h[3] = { dx, dy, dz };
+  OC_INDEX maxoff[3] = { 0, 0, 0 };
+  near_start.push_back(0);
+  far_start.push_back(0);
+  vector<OC_INDEX> stack;
+  for(size_t t=0;t<leaf.size();++t) {
+    const Node& tnode = node[leaf[t]];
+    OC_REAL8m tlo[3],thi[3];
+    for(int a=0;a<3;++a) {
+      tlo[a] = h[a]*tnode.lo[a];
+      thi[a] = h[a]*tnode.hi[a];
+    }
+    stack.push_back(0);
+    while(!stack.empty()) {
+      const OC_INDEX s = stack.back();
+      stack.pop_back();
+      const Node& snode = node[s];
+      OC_REAL8m distsq = 0.0;
+      for(int a=0;a<3;++a) {
+        OC_REAL8m off = 0.0;
+        if(snode.center[a]<tlo[a])      off = tlo[a] - snode.center[a];
+        else if(snode.center[a]>thi[a]) off = snode.center[a] - thi[a];
+        distsq += off*off;
+      }
+      const OC_REAL8m rad = snode.radius/opening_angle;
+      if(rad*rad<distsq) {
+        far_list.push_back(s);
+      } else if(snode.child[0]>=0) {
+        stack.push_back(snode.child[1]);
+        stack.push_back(snode.child[0]);
+      } else {
+        near_list.push_back(s);
+        for(int a=0;a<3;++a) {
+          OC_INDEX off = tnode.hi[a] - 1 - snode.lo[a];
+          if(snode.hi[a] - 1 - tnode.lo[a] > off) {
+            off = snode.hi[a] - 1 - tnode.lo[a];
+          }
+          if(off>maxoff[a]) maxoff[a] = off;
+        }
+      }
+    }
+    near_start.push_back(static_cast<OC_INDEX>(near_list.size()));
+    far_start.push_back(static_cast<OC_INDEX>(far_list.size()));
+  }
+
+  ntabx = maxoff[0];  ntaby = maxoff[1];  ntabz = maxoff[2];
+  FillNearTable(mesh);
+  cell_tab.resize(cell_count);
+  for(OC_INDEX n=0;n<cell_count;++n) {
+    const OC_INDEX index = cell_index[n];
+    cell_tab[n] = ((index/xydim)*(2*ntaby+1) + (index%xydim)/xdim)
+      *(2*ntabx+1) + index%xdim;
+  }
+
+  Mpack.resize(cell_count);
+  Hpack.resize(cell_count);
+  moment.resize(MOMENT_SIZE*node.size());
+  farcoef.resize(FARCOEF_SIZE*node.size());
+}
+
+void Oxs_TreeDemag::ComputeMoments() const
+{ // Fills moment and farcoef from Mpack.  Leaves are computed directly
+  // from their cells, in parallel; internal nodes are then accumulated
+  // from their children, which follow them in the node list.
+  const OC_REAL8m shape[3] = { dx*dx/6., dy*dy/6., dz*dz/6. };
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (static_cast<OC_INDEX>(leaf.size()),
+     [&](OC_INT4m,OC_INDEX tstart,OC_INDEX tstop) {
+      for(OC_INDEX t=tstart;t<tstop;++t) {
+        const Node& nd = node[leaf[t]];
+        OC_REAL8m* Q = &(moment[MOMENT_SIZE*leaf[t]]);
+        for(int c=0;c<MOMENT_SIZE;++c) Q[c] = 0.0;
+        OC_REAL8m* Q0 = Q;
+        OC_REAL8m* Q1 = Q + 3;
+        OC_REAL8m* Q2 = Q + 12;
+        for(OC_INDEX n=nd.first;n<nd.first+nd.count;++n) {
+          const OC_REAL8m* pos = &(cell_pos[3*n]);
+          const OC_REAL8m s[3]
+            = { pos[0] - nd.center[0],
+                pos[1] - nd.center[1],
+                pos[2] - nd.center[2] };
+          const ThreeVector& mv = Mpack[n];
+          const OC_REAL8m m[3] = { mv.x, mv.y, mv.z };
+          for(int a=0;a<3;++a) {
+            Q0[a] += m[a];
+            Q1[a]   += s[0]*m[a];
+            Q1[3+a] += s[1]*m[a];
+            Q1[6+a] += s[2]*m[a];
+            OC_REAL8m* q2 = Q2 + 6*a;
+            q2[0] += s[0]*s[0]*m[a];
+            q2[1] += s[0]*s[1]*m[a];
+            q2[2] += s[0]*s[2]*m[a];
+            q2[3] += s[1]*s[1]*m[a];
+            q2[4] += s[1]*s[2]*m[a];
+            q2[5] += s[2]*s[2]*m[a];
+          }
+        }
+        for(int a=0;a<3;++a) {
+          Q2[6*a]   += shape[0]*Q0[a];
+          Q2[6*a+3] += shape[1]*Q0[a];
+          Q2[6*a+5] += shape[2]*Q0[a];
+        }
+      }
+    });
+
+  for(OC_INDEX p=static_cast<OC_INDEX>(node.size())-1;p>=0;--p) {
+    const Node& nd = node[p];
+    if(nd.child[0]<0) continue;
+    OC_REAL8m* Q = &(moment[MOMENT_SIZE*p]);
+    for(int c=0;c<MOMENT_SIZE;++c) Q[c] = 0.0;
+    for(int ic=0;ic<2;++ic) {
+      // Shift child moments from child center to parent center.
+      const OC_INDEX cid = nd.child[ic];
+      const OC_REAL8m* C = &(moment[MOMENT_SIZE*cid]);
+      const OC_REAL8m t[3]
+        = { node[cid].center[0] - nd.center[0],
+            node[cid].center[1] - nd.center[1],
+            node[cid].center[2] - nd.center[2] };
+      const OC_REAL8m* C0 = C;
+      const OC_REAL8m* C1 = C + 3;
+      const OC_REAL8m* C2 = C + 12;
+      for(int a=0;a<3;++a) {
+        Q[a] += C0[a];
+        for(int b=0;b<3;++b) {
+          Q[3+3*b+a] += C1[3*b+a] + t[b]*C0[a];
+        }
+        static const int bb[6] = { 0, 0, 0, 1, 1, 2 };
+        static const int dd[6] = { 0, 1, 2, 1, 2, 2 };
+        for(int e=0;e<6;++e) {
+          const int b = bb[e];
+          const int d = dd[e];
+          Q[12+6*a+e] += C2[6*a+e] + t[b]*C1[3*d+a] + t[d]*C1[3*b+a]
+            + t[b]*t[d]*C0[a];
+        }
+      }
+    }
+  }
+
+  // Far field coefficients.  The Q1 terms enter the field only through
+  // the symmetric part of Q1 and its trace.  The Q2 terms enter through
+  // the cubic form
+  //
+  //    u(x) = sum_a sum_b sum_d x_a*x_b*x_d*Q2[a][bd]
+  //
+  // stored as the coefficients of the monomials xxx, xxy, xxz, xyy,
+  // xyz, xzz, yyy, yyz, yzz, zzz, and through the vector
+  // k[c] = trace(Q2[c]) + 2*sum_a Q2[a][ac].
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (static_cast<OC_INDEX>(node.size()),
+     [&](OC_INT4m,OC_INDEX nstart,OC_INDEX nstop) {
+      for(OC_INDEX n=nstart;n<nstop;++n) {
+        const OC_REAL8m* Q0 = &(moment[MOMENT_SIZE*n]);
+        const OC_REAL8m* Q1 = Q0 + 3;
+        const OC_REAL8m* Q2 = Q0 + 12;
+        OC_REAL8m* fc = &(farcoef[FARCOEF_SIZE*n]);
+        fc[0] = Q0[0];  fc[1] = Q0[1];  fc[2] = Q0[2];
+        fc[3] = 2*Q1[0];
+        fc[4] = Q1[1] + Q1[3];
+        fc[5] = Q1[2] + Q1[6];
+        fc[6] = 2*Q1[4];
+        fc[7] = Q1[5] + Q1[7];
+        fc[8] = 2*Q1[8];
+        fc[9] = Q1[0] + Q1[4] + Q1[8];
+        fc[10] = Q2[0];
+        fc[11] = 2*Q2[1] + Q2[6];
+        fc[12] = 2*Q2[2] + Q2[12];
+        fc[13] = Q2[3] + 2*Q2[7];
+        fc[14] = 2*(Q2[4] + Q2[8] + Q2[13]);
+        fc[15] = Q2[5] + 2*Q2[14];
+        fc[16] = Q2[9];
+        fc[17] = 2*Q2[10] + Q2[15];
+        fc[18] = Q2[11] + 2*Q2[16];
+        fc[19] = Q2[17];
+        fc[20] = Q2[0] + Q2[3] + Q2[5] + 2*(Q2[0] + Q2[7] + Q2[14]);
+        fc[21] = Q2[6] + Q2[9] + Q2[11] + 2*(Q2[1] + Q2[9] + Q2[16]);
+        fc[22] = Q2[12] + Q2[15] + Q2[17] + 2*(Q2[2] + Q2[10] + Q2[17]);
+      }
+    });
+}
+
+void Oxs_TreeDemag::ComputeLeafField(OC_INDEX t) const
+{ // Fills Hpack for the cells of leaf number t.
+  const Node& tnode = node[leaf[t]];
+  const OC_INDEX tstart = tnode.first;
+  const OC_INDEX tstop = tnode.first + tnode.count;
+
+  // Near field, H = -N*M
+  const OC_REAL8m* const ntab_base = &(ntab[6*ntab_center]);
+  for(OC_INDEX p=tstart;p<tstop;++p) {
+    const OC_INDEX tab_p = cell_tab[p];
+    OC_REAL8m hx = 0.0, hy = 0.0, hz = 0.0;
+    for(OC_INDEX ns=near_start[t];ns<near_start[t+1];++ns) {
+      const Node& snode = node[near_list[ns]];
+      for(OC_INDEX q=snode.first;q<snode.first+snode.count;++q) {
+        const OC_REAL8m* n = ntab_base + 6*(tab_p - cell_tab[q]);
+        const ThreeVector& m = Mpack[q];
+        hx -= n[0]*m.x + n[1]*m.y + n[2]*m.z;
+        hy -= n[1]*m.x + n[3]*m.y + n[4]*m.z;
+        hz -= n[2]*m.x + n[4]*m.y + n[5]*m.z;
+      }
+    }
+    Hpack[p].Set(hx,hy,hz);
+  }
+
+  // Far field.  See file header and ComputeMoments for the expansion.
+  // With x the offset from the node center, r=|x|, u(x) the cubic form
+  // of Q2, and k the Q2 trace vector, the field is
+  //
+  //   H = V/(4*pi) * (  x*[  3*(x.Q0)/r^5 + 7.5*(x.S1.x)/r^7
+  //                        - 3*tr(Q1)/r^5 + 52.5*u/r^9 - 7.5*(k.x)/r^7 ]
+  //                   - Q0/r^3 - 3*S1.x/r^5 - 7.5*grad(u)/r^7
+  //                   + 1.5*k/r^5 )
+  //
+  // where S1 = Q1 + transpose(Q1).
+  const OC_REAL8m mult = dx*dy*dz/(4*PI);
+  const OC_REAL8m* const tpos = &(cell_pos[3*tstart]);
+  for(OC_INDEX nf=far_start[t];nf<far_start[t+1];++nf) {
+    const OC_INDEX s = far_list[nf];
+    const Node& snode = node[s];
+    const OC_REAL8m* const fc = &(farcoef[FARCOEF_SIZE*s]);
+    const OC_REAL8m* const Q0 = fc;
+    const OC_REAL8m* const S1 = fc + 3;
+    const OC_REAL8m trQ1 = fc[9];
+    const OC_REAL8m* const cu = fc + 10;
+    const OC_REAL8m* const k = fc + 20;
+    for(OC_INDEX p=0;p<tstop-tstart;++p) {
+      const OC_REAL8m x = tpos[3*p]   - snode.center[0];
+      const OC_REAL8m y = tpos[3*p+1] - snode.center[1];
+      const OC_REAL8m z = tpos[3*p+2] - snode.center[2];
+      const OC_REAL8m rsq = x*x + y*y + z*z;
+      const OC_REAL8m ir2 = 1.0/rsq;
+      const OC_REAL8m ir3 = ir2*sqrt(ir2);
+      const OC_REAL8m ir5 = ir3*ir2;
+      const OC_REAL8m ir7 = ir5*ir2;
+      const OC_REAL8m ir9 = ir7*ir2;
+
+      const OC_REAL8m S1x = S1[0]*x + S1[1]*y + S1[2]*z;
+      const OC_REAL8m S1y = S1[1]*x + S1[3]*y + S1[4]*z;
+      const OC_REAL8m S1z = S1[2]*x + S1[4]*y + S1[5]*z;
+
+      const OC_REAL8m xx = x*x, xy = x*y, xz = x*z;
+      const OC_REAL8m yy = y*y, yz = y*z, zz = z*z;
+      const OC_REAL8m gux = 3*cu[0]*xx + 2*cu[1]*xy + 2*cu[2]*xz
+                          + cu[3]*yy + cu[4]*yz + cu[5]*zz;
+      const OC_REAL8m guy = cu[1]*xx + 2*cu[3]*xy + cu[4]*xz
+                          + 3*cu[6]*yy + 2*cu[7]*yz + cu[8]*zz;
+      const OC_REAL8m guz = cu[2]*xx + cu[4]*xy + 2*cu[5]*xz
+                          + cu[7]*yy + 2*cu[8]*yz + 3*cu[9]*zz;
+
+      const OC_REAL8m xQ0 = Q0[0]*x + Q0[1]*y + Q0[2]*z;
+      const OC_REAL8m xS1x = S1x*x + S1y*y + S1z*z;
+      const OC_REAL8m xgu = gux*x + guy*y + guz*z; // 3*u
+      const OC_REAL8m kx = k[0]*x + k[1]*y + k[2]*z;
+      const OC_REAL8m ar = 3*ir5*(xQ0 - trQ1) + 7.5*ir7*(xS1x - kx)
+                         + 17.5*ir9*xgu;
+      Hpack[tstart+p].Accum(mult,ThreeVector(
+         ar*x - ir3*Q0[0] - 3*ir5*S1x - 7.5*ir7*gux + 1.5*ir5*k[0],
+         ar*y - ir3*Q0[1] - 3*ir5*S1y - 7.5*ir7*guy + 1.5*ir5*k[1],
+         ar*z - ir3*Q0[2] - 3*ir5*S1z - 7.5*ir7*guz + 1.5*ir5*k[2]));
+    }
+  }
+}
+
+void Oxs_TreeDemag::ComputeEnergy
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyData& oced
+ ) const
+{
+  // (Re)-build tree if mesh has changed.
+  if(mesh_id != state.mesh->Id()) {
+    mesh_id = 0; // Safety
+    SetupTree(state);
+    mesh_id = state.mesh->Id();
+    // The error is dominated by far field truncation.  Compared
+    // against Oxs_Demag on dot arrays, antidot films and a sphere,
+    // with uniform and random magnetizations, the largest per-cell
+    // energy density error for opening angles 0.3 to 0.9 is at most
+    // 0.02*opening_angle^3*MU0*Ms^2 (see the Oxs_TreeDemag section of
+    // the user guide), so opening_angle^3/32 is used as a bound.  The
+    // rounding term is the same as for Oxs_Demag.
+    const OC_INDEX cell_count = static_cast<OC_INDEX>(cell_index.size());
+    const OC_REAL8m Msq = MU0*state.max_absMs*state.max_absMs;
+    energy_density_error_estimate
+      = Msq*opening_angle*opening_angle*opening_angle/32.
+      + 0.5*OC_REAL8m_EPSILON*Msq
+      *(cell_count>1 ? log(double(cell_count))/log(2.) : 1.0);
+  }
+  oced.energy_density_error_estimate = energy_density_error_estimate;
+
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+
+  Oxs_MeshValue<ThreeVector>& field
+    = *(oced.H != 0 ? oced.H : oced.scratch_H);
+  field.AdjustSize(state.mesh);
+
+  const OC_INDEX size = Ms.Size();
+  assert(xdim*ydim*zdim == size);
+  if(size==0) {
+    oced.energy_sum = 0.0;
+    oced.pE_pt = 0.0;
+    return;
+  }
+
+  const OC_INDEX cell_count = static_cast<OC_INDEX>(cell_index.size());
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (cell_count,[&](OC_INT4m,OC_INDEX nstart,OC_INDEX nstop) {
+      for(OC_INDEX n=nstart;n<nstop;++n) {
+        const OC_INDEX i = cell_index[n];
+        Mpack[n] = Ms[i]*spin[i];
+      }
+    });
+  if(cell_count>0) {
+    ComputeMoments();
+    Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+      (static_cast<OC_INDEX>(leaf.size()),
+       [&](OC_INT4m,OC_INDEX tstart,OC_INDEX tstop) {
+        for(OC_INDEX t=tstart;t<tstop;++t) ComputeLeafField(t);
+      });
+  }
+
+  // Unpack field, which is zero in non-magnetic cells, followed by the
+  // pointwise energy density -0.5*MU0*<M,H> and output arrays.
+  const int thread_count = Oc_GetMaxThreadCount();
+  vector<Oxs_Energy::SUMTYPE> thread_esum(thread_count,0.0);
+  const OC_REAL8m emult =  -0.5 * MU0;
+  Oxs_ParallelFor<std::function<void(OC_INT4m,OC_INDEX,OC_INDEX)> >
+    (size,[&](OC_INT4m thread_id,OC_INDEX istart,OC_INDEX istop) {
+      Oxs_Energy::SUMTYPE esum = 0.0;
+      for(OC_INDEX i=istart;i<istop;++i) {
+        const OC_INDEX n = pack_index[i];
+        if(n<0) {
+          field[i].Set(0.0,0.0,0.0);
+          if(oced.energy)       (*oced.energy)[i] = 0.0;
+          if(oced.mxH)          (*oced.mxH)[i].Set(0.0,0.0,0.0);
+          continue;
+        }
+        field[i] = Hpack[n];
+        OC_REAL8m dot = spin[i]*field[i];
+        ThreeVector torque = spin[i]^field[i];
+        OC_REAL8m ei = emult * dot * Ms[i];
+        esum += ei;
+        if(oced.H_accum)           (*oced.H_accum)[i] += field[i];
+        if(oced.energy)             (*oced.energy)[i]  = ei;
+        if(oced.energy_accum) (*oced.energy_accum)[i] += ei;
+        if(oced.mxH)                   (*oced.mxH)[i]  = torque;
+        if(oced.mxH_accum)       (*oced.mxH_accum)[i] += torque;
+      }
+      thread_esum[thread_id] += esum;
+    });
+  Oxs_Energy::SUMTYPE esum = 0.0;
+  for(int t=0;t<thread_count;++t) esum += thread_esum[t];
+
+  oced.energy_sum = esum * state.mesh->Volume(0);
+  /// All cells have same volume in an Oxs_RectangularMesh.
+
+  oced.pE_pt = 0.0;
+}
@@ -0,0 +1,134 @@
+/* FILE: treedemag.h            -*-Mode: c++-*-
+ *
+ * Demagnetization field computed with a hierarchical tree code over
+ * the magnetic (Ms != 0) cells of a rectangular mesh.  Near-field cell
+ * pairs use the same analytic and asymptotic demag tensors as
+ * Oxs_Demag, while far-field interactions are approximated by
+ * multipole expansions of tree nodes.  The cost scales with the number
+ * of magnetic cells rather than with the volume of the bounding box,
+ * which makes this class an alternative to Oxs_Demag for sparse
+ * geometries such as particle arrays and antidot lattices.
+ *
+ */
+
+#ifndef _OXS_TREEDEMAG
+#define _OXS_TREEDEMAG
+
+#include <vector>
+
+#include "energy.h"
+#include "key.h"
+#include "mesh.h"
+#include "meshvalue.h"
+#include "simstate.h"
+#include "threevector.h"
+#include "rectangularmesh.h"
+
+/* End includes */
+
+class Oxs_TreeDemag:public Oxs_Energy {
+private:
+  // Tree node.  Each node covers the magnetic cells in the range
+  // [first,first+count) of cell_index, and lo, hi is the tight bounding
+  // box of those cells in mesh index coordinates (hi exclusive).
+  // Internal nodes have exactly two children, with child[0]=-1 marking
+  // a leaf.  Children always follow their parent in the node list.
+  struct Node {
+  public:
+    OC_INDEX first, count;
+    OC_INDEX lo[3], hi[3];
+    OC_INDEX child[2];
+    OC_REAL8m center[3]; // Center of bounding box
+    OC_REAL8m radius;    // Half-diagonal of bounding box
+  };
+
+  // Number of reals in the multipole moment record of one node:
+  // 3 for the total moment Q0, 9 for the first moment Q1[b][a], and
+  // 18 for the second moment Q2[a][bd], bd=xx,xy,xz,yy,yz,zz.
+  enum { MOMENT_SIZE = 30 };
+
+  // Number of reals in the far field coefficient record of one node,
+  // which holds the combinations of the moments used in the field
+  // evaluation: Q0 (3), Q1+transpose(Q1) (6), trace(Q1) (1), the
+  // coefficients of the cubic form x_a*x_b*x_d*Q2[a][bd] (10), and
+  // trace(Q2[c]) + 2*sum_a Q2[a][ac] (3).  See ComputeMoments().
+  enum { FARCOEF_SIZE = 23 };
+
+  mutable OC_UINT4m mesh_id;
+  mutable OC_REAL8m energy_density_error_estimate; // Cached value,
+  /// initialized when mesh changes.
+
+  OC_REAL8m opening_angle; // Far field acceptance criterion
+  OC_INDEX leaf_size;      // Maximum number of cells in a leaf
+  OC_REAL8m demag_tensor_error; // Near field analytic/asymptotic split
+
+  // Mesh dimensions.  Lengths (dx, dy, dz, node centers and radii,
+  // and cell_pos) are in units of the largest cell dimension.
+  mutable OC_INDEX xdim, ydim, zdim;
+  mutable OC_REAL8m dx, dy, dz;
+
+  // Magnetic cells in tree order, as mesh indices, as cell center
+  // coordinates, and as offsets into the near field table (see ntab).
+  // pack_index is the inverse map, from mesh index to position in
+  // cell_index, with -1 for non-magnetic cells.
+  mutable std::vector<OC_INDEX> cell_index;
+  mutable std::vector<OC_REAL8m> cell_pos;
+  mutable std::vector<OC_INDEX> cell_tab;
+  mutable std::vector<OC_INDEX> pack_index;
+
+  mutable std::vector<Node> node;
+  mutable std::vector<OC_INDEX> leaf; // Node indices of leaves
+
+  // Interaction lists, per leaf.  For leaf number t, near_list entries
+  // [near_start[t],near_start[t+1]) are the leaves (as node indices)
+  // whose cells interact with the cells of t through the near field
+  // table, and far_list entries [far_start[t],far_start[t+1]) are the
+  // nodes whose multipole expansions are evaluated at the cells of t.
+  mutable std::vector<OC_INDEX> near_start, near_list;
+  mutable std::vector<OC_INDEX> far_start, far_list;
+
+  // Demag tensor for cell offsets (i,j,k) with |i|<=ntabx, |j|<=ntaby
+  // and |k|<=ntabz, indexed [k+ntabz][j+ntaby][i+ntabx][component]
+  // with components xx, xy, xz, yy, yz, zz.  The tensor for the offset
+  // from source cell q to target cell p is at 6*(ntab_center +
+  // cell_tab[p] - cell_tab[q]).
+  mutable OC_INDEX ntabx, ntaby, ntabz;
+  mutable OC_INDEX ntab_center;
+  mutable std::vector<OC_REAL8m> ntab;
+
+  // Workspace: packed M (=Ms*m) and H for magnetic cells, and node
+  // moments and far field coefficients.
+  mutable std::vector<ThreeVector> Mpack;
+  mutable std::vector<ThreeVector> Hpack;
+  mutable std::vector<OC_REAL8m> moment;
+  mutable std::vector<OC_REAL8m> farcoef;
+
+  OC_INDEX BuildTree(OC_INDEX first,OC_INDEX count) const;
+  void FillNearTable(const Oxs_RectangularMesh* mesh) const;
+  void SetupTree(const Oxs_SimState& state) const; // Conceptually const.
+  void ComputeMoments() const;
+  void ComputeLeafField(OC_INDEX t) const;
+
+  void ReleaseMemory() const; // Conceptually const.
+
+protected:
+  virtual void GetEnergy(const Oxs_SimState& state,
+                         Oxs_EnergyData& oed) const {
+    GetEnergyAlt(state,oed);
+  }
+
+  virtual void ComputeEnergy(const Oxs_SimState& state,
+                             Oxs_ComputeEnergyData& oced) const;
+
+public:
+  virtual const char* ClassName() const; // ClassName() is
+  /// automatically generated by the OXS_EXT_REGISTER macro.
+  Oxs_TreeDemag(const char* name,     // Child instance id
+                Oxs_Director* newdtr, // App director
+                const char* argstr);  // MIF input block parameters
+  virtual ~Oxs_TreeDemag() { ReleaseMemory(); }
+  virtual OC_BOOL Init();
+};
+
+
+#endif // _OXS_TREEDEMAG
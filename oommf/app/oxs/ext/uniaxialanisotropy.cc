@@ -349,6 +349,75 @@ void Oxs_UniaxialAnisotropy::RectIntegEnergy
   ocedtaux.pE_pt_accum += pE_pt_sum;
 }
 
+void Oxs_UniaxialAnisotropy::ComputeEnergyTile
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
+ Oxs_ChunkEnergyTile& tile,
+ int /* threadnumber */
+ ) const
+{ // Fused version of RectIntegEnergy; see chunkenergy.h.  The
+  // arithmetic matches the *_accum branches of RectIntegEnergy.
+  const Oxs_Mesh* mesh = state.mesh;
+  const Oxs_MeshValue<OC_REAL8m>& Ms         = *(state.Ms);
+  const Oxs_MeshValue<OC_REAL8m>& Ms_inverse = *(state.Ms_inverse);
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const OC_INDEX offset = tile.node_start;
+  const OC_INDEX tsize = tile.node_stop - tile.node_start;
+
+  Nb_Xpfloat energy_sum = 0.0;
+  Nb_Xpfloat pE_pt_sum = 0.0;
+
+  OC_REAL8m k = uniform_K1_value;
+  OC_REAL8m field_mult = uniform_Ha_value;
+  ThreeVector unifaxis = uniform_axis_value;
+
+  OC_REAL8m scaling  = mult;  // Copy from class mutables.  These are
+  OC_REAL8m dscaling = dmult; // set from main thread once per state.
+
+  for(OC_INDEX j=0;j<tsize;++j) {
+    const OC_INDEX i = offset + j;
+    if(aniscoeftype == K1_TYPE) {
+      if(!K1_is_uniform) k = K1[i];
+      field_mult = (2.0/MU0)*k*Ms_inverse[i];
+    } else {
+      if(!Ha_is_uniform) field_mult = Ha[i];
+      k = 0.5*MU0*field_mult*Ms[i];
+    }
+    if(k==0.0 || field_mult == 0.0) continue; // Includes Ms==0.0 case
+
+    const ThreeVector& axisi = (axis_is_uniform ? unifaxis : axis[i]);
+    OC_REAL8m dot = spin[i].x*axisi.x;
+    const OC_REAL8m ty = FMA_Block(spin[i].z,axisi.x,-spin[i].x*axisi.z);
+    dot = FMA_Block(spin[i].z,axisi.z,dot);
+    const OC_REAL8m tx = FMA_Block(spin[i].y,axisi.z,-spin[i].z*axisi.y);
+    dot = FMA_Block(spin[i].y,axisi.y,dot);
+    const OC_REAL8m tz = FMA_Block(spin[i].x,axisi.y,-spin[i].y*axisi.x);
+    const OC_REAL8m Hscale = scaling*field_mult*dot;
+    const OC_REAL8m vol = mesh->Volume(i);
+    tile.mxH[j].Accum(Hscale,ThreeVector(tx,ty,tz));
+
+    if(k<=0) {
+      // Easy plane (hard axis)
+      tile.H[j] += Hscale*axisi;
+      const OC_REAL8m mkdotsq = -k*dot*dot;
+      const OC_REAL8m ei = scaling*mkdotsq;
+      Nb_XpfloatDualAccum(energy_sum,ei*vol,
+                          pE_pt_sum,dscaling*mkdotsq*vol);
+      tile.energy[j] += ei;
+    } else {
+      // Easy axis
+      const OC_REAL8m ktsq = k*(FMA_Block(tx,tx,FMA_Block(ty,ty,tz*tz)));
+      const OC_REAL8m ei = scaling*ktsq;
+      Nb_XpfloatDualAccum(energy_sum,ei*vol,
+                          pE_pt_sum,dscaling*ktsq*vol);
+      tile.energy[j] += ei;
+      tile.H[j].Accum(Hscale,axisi);
+    }
+  }
+  ocedtaux.energy_total_accum += energy_sum;
+  ocedtaux.pE_pt_accum += pE_pt_sum;
+}
+
 void Oxs_UniaxialAnisotropy::ComputeEnergyChunkInitialize
 (const Oxs_SimState& state,
  Oxs_ComputeEnergyDataThreaded& ocedt,
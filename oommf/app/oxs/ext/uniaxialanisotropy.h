@@ -124,6 +124,16 @@ protected:
                                   Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
                                   OC_INDEX node_start,OC_INDEX node_stop,
                                   int threadnumber) const;
+
+  // The fused tile interface is supported for RECT_INTEG only; the
+  // QUAD_INTEG edge corrections reach outside the tile.
+  virtual OC_BOOL FusedTileSupport(const Oxs_SimState&) const {
+    return (integration_method == RECT_INTEG);
+  }
+  virtual void ComputeEnergyTile(const Oxs_SimState& state,
+                                 Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
+                                 Oxs_ChunkEnergyTile& tile,
+                                 int threadnumber) const;
 public:
   virtual const char* ClassName() const; // ClassName() is
   /// automatically generated by the OXS_EXT_REGISTER macro.
@@ -139,6 +139,9 @@ OC_BOOL Oxs_UniformExchange::Init()
   // Stage and run max angle computations require access to the
   // immediate predecessor of the current state.
   director->GetDriver()->SimstateHoldRequest(2);
+  maxspinangle_key = Oxs_DerivedDataKey(MaxSpinAngleStateName());
+  stage_maxspinangle_key = Oxs_DerivedDataKey(StageMaxSpinAngleStateName());
+  run_maxspinangle_key = Oxs_DerivedDataKey(RunMaxSpinAngleStateName());
 
   return Oxs_ChunkEnergy::Init(); // Run parent initializer.
 }
@@ -373,11 +376,26 @@ Oxs_UniformExchange::CalcEnergy6NgbrMirror
   // Note: For maxangle calculation, it suffices to check
   // spin[j]-spin[i] for j>i, or j<i, or various mixes of the two.
 
+  // Packed maxdot accumulators for the Oc_Pack block code below
+  Oc_Pack pack_maxdot_x(0.0), pack_maxdot_y(0.0), pack_maxdot_z(0.0);
+
   OC_INDEX x,y,z;
   mesh->GetCoords(node_start,x,y,z);
 
   OC_INDEX i = node_start;
   while(i<node_stop) {
+    // Offsets to y and z neighbors for the current row, or 0 if the
+    // neighbor doesn't exist.
+    OC_INDEX ylo = 0, yhi = 0, zlo = 0, zhi = 0;
+    if(y>0) ylo = -xdim;
+    else if(yperiodic) ylo = xydim - xdim;
+    if(y<ydim-1) yhi = xdim;
+    else if(yperiodic) yhi = xdim - xydim;
+    if(z>0) zlo = -xydim;
+    else if(zperiodic) zlo = xyzdim - xydim;
+    if(z<zdim-1) zhi = xydim;
+    else if(zperiodic) zhi = xydim - xyzdim;
+
     OC_INDEX xstop = xdim;
     if(xdim-x>node_stop-i) xstop = x + (node_stop-i);
     ThreeVector xlast(0.,0.,0.);
@@ -387,6 +405,85 @@ Oxs_UniformExchange::CalcEnergy6NgbrMirror
       if(Ms_inverse[j]!=0.0) xlast = (spin[j]-spin[i]);
     }
     while(x<xstop) {
+      // Blocks of OC_PACK_WIDTH interior cells, with both x neighbors
+      // of each cell inside the row and all neighbors magnetic, are
+      // computed with Oc_Pack.  The operation order matches the
+      // single cell code below, so results are the same either way.
+      if(x>0 && x+OC_PACK_WIDTH<xdim && x+OC_PACK_WIDTH<=xstop) {
+        bool packok = true;
+        for(OC_INDEX k=-1;k<=OC_PACK_WIDTH;++k) {
+          if(Ms_inverse[i+k]==0.0) { packok = false; break; }
+        }
+        for(OC_INDEX k=0;packok && k<OC_PACK_WIDTH;++k) {
+          if((ylo!=0 && Ms_inverse[i+k+ylo]==0.0)
+             || (yhi!=0 && Ms_inverse[i+k+yhi]==0.0)
+             || (zlo!=0 && Ms_inverse[i+k+zlo]==0.0)
+             || (zhi!=0 && Ms_inverse[i+k+zhi]==0.0)) packok = false;
+        }
+        if(packok) {
+          const Oxs_ThreeVectorPack base(&spin[i]);
+          const Oxs_ThreeVectorPack xprev
+            = Oxs_ThreeVectorPack(&spin[i-1]) - base;
+          const Oxs_ThreeVectorPack xnext
+            = base - Oxs_ThreeVectorPack(&spin[i+1]);
+          Oxs_ThreeVectorPack sum = xprev - xnext;
+          pack_maxdot_x.KeepMax(xnext.MagSq());
+          sum *= wgtx;
+
+          Oxs_ThreeVectorPack tempy;
+          tempy.SetZero();
+          if(ylo!=0) {
+            tempy = Oxs_ThreeVectorPack(&spin[i+ylo]) - base;
+            pack_maxdot_y.KeepMax(tempy.MagSq());
+          }
+          if(yhi!=0) tempy += Oxs_ThreeVectorPack(&spin[i+yhi]) - base;
+          sum += wgty*tempy;
+
+          Oxs_ThreeVectorPack tempz;
+          tempz.SetZero();
+          if(zlo!=0) {
+            tempz = Oxs_ThreeVectorPack(&spin[i+zlo]) - base;
+            pack_maxdot_z.KeepMax(tempz.MagSq());
+          }
+          if(zhi!=0) tempz += Oxs_ThreeVectorPack(&spin[i+zhi]) - base;
+          sum += wgtz*tempz;
+
+          Oc_Pack ei = base.x*sum.x + base.y*sum.y + base.z*sum.z;
+          Oc_Pack hmult;
+          hmult.LoadUnaligned(Ms_inverse[i]);
+          hmult *= (-2/MU0);
+          sum *= hmult;
+
+          Oxs_ThreeVectorPack torque(base.y*sum.z - base.z*sum.y,
+                                     base.z*sum.x - base.x*sum.z,
+                                     base.x*sum.y - base.y*sum.x);
+
+          OC_REAL8m eibuf[OC_PACK_WIDTH];
+          ei.StoreUnaligned(eibuf[0]);
+          for(OC_INDEX k=0;k<OC_PACK_WIDTH;++k) energy_sum += eibuf[k];
+          if(ocedt.energy) ei.StoreUnaligned((*ocedt.energy)[i]);
+          if(ocedt.energy_accum) {
+            Oc_Pack etmp;
+            etmp.LoadUnaligned((*ocedt.energy_accum)[i]);
+            etmp += ei;
+            etmp.StoreUnaligned((*ocedt.energy_accum)[i]);
+          }
+          if(ocedt.H) sum.Store(&(*ocedt.H)[i]);
+          if(ocedt.H_accum) {
+            (Oxs_ThreeVectorPack(&(*ocedt.H_accum)[i])+sum)
+              .Store(&(*ocedt.H_accum)[i]);
+          }
+          if(ocedt.mxH) torque.Store(&(*ocedt.mxH)[i]);
+          if(ocedt.mxH_accum) {
+            (Oxs_ThreeVectorPack(&(*ocedt.mxH_accum)[i])+torque)
+              .Store(&(*ocedt.mxH_accum)[i]);
+          }
+          xlast = spin[i+OC_PACK_WIDTH-1] - spin[i+OC_PACK_WIDTH];
+          i += OC_PACK_WIDTH;
+          x += OC_PACK_WIDTH;
+          continue;
+        }
+      }
       if(0 == Ms_inverse[i]) {
         if(ocedt.energy) (*ocedt.energy)[i] = 0.0;
         if(ocedt.H)      (*ocedt.H)[i].Set(0.,0.,0.);
@@ -489,6 +586,12 @@ Oxs_UniformExchange::CalcEnergy6NgbrMirror
   ocedtaux.energy_total_accum += energy_sum * mesh->Volume(0);
   /// All cells have same volume in an Oxs_CommonRectangularMesh.
 
+  OC_REAL8m pmx = Oc_PackMaxElement(pack_maxdot_x);
+  OC_REAL8m pmy = Oc_PackMaxElement(pack_maxdot_y);
+  OC_REAL8m pmz = Oc_PackMaxElement(pack_maxdot_z);
+  if(pmx>thread_maxdot_x) thread_maxdot_x = pmx;
+  if(pmy>thread_maxdot_y) thread_maxdot_y = pmy;
+  if(pmz>thread_maxdot_z) thread_maxdot_z = pmz;
   if(thread_maxdot_x>thread_maxdot) thread_maxdot = thread_maxdot_x;
   if(thread_maxdot_y>thread_maxdot) thread_maxdot = thread_maxdot_y;
   if(thread_maxdot_z>thread_maxdot) thread_maxdot = thread_maxdot_z;
@@ -2987,8 +3090,7 @@ void Oxs_UniformExchange::ComputeEnergyChunkFinalize
   const OC_REAL8m maxang = ( arg >= 1.0 ? 180.0 : asin(arg)*(360.0/PI));
 
   OC_REAL8m dummy_value;
-  String msa_name = MaxSpinAngleStateName();
-  if(state.GetDerivedData(msa_name,dummy_value)) {
+  if(state.GetDerivedData(maxspinangle_key,dummy_value)) {
     // Ideally, energy values would never be computed more than once
     // for any one state, but in practice it seems inevitable that
     // such will occur on occasion.  For example, suppose a user
@@ -3027,7 +3129,7 @@ void Oxs_UniformExchange::ComputeEnergyChunkFinalize
       throw Oxs_ExtError(this,errbuf);
     }
   } else {
-    state.AddDerivedData(msa_name,maxang);
+    state.AddDerivedData(maxspinangle_key,maxang);
   }
 
   // Run and stage angle data depend on data from the previous state.
@@ -3040,19 +3142,17 @@ void Oxs_UniformExchange::ComputeEnergyChunkFinalize
   const Oxs_SimState* oldstate = NULL;
   OC_REAL8m stage_maxang = -1;
   OC_REAL8m run_maxang = -1;
-  String smsa_name = StageMaxSpinAngleStateName();
-  String rmsa_name = RunMaxSpinAngleStateName();
   if(state.previous_state_id &&
      0 != (oldstate
       = director->FindExistingSimulationState(state.previous_state_id)) ) {
     if(oldstate->stage_number != state.stage_number) {
       stage_maxang = 0.0;
     } else {
-      if(oldstate->GetDerivedData(smsa_name,dummy_value)) {
+      if(oldstate->GetDerivedData(stage_maxspinangle_key,dummy_value)) {
         stage_maxang = dummy_value;
       }
     }
-    if(oldstate->GetDerivedData(rmsa_name,dummy_value)) {
+    if(oldstate->GetDerivedData(run_maxspinangle_key,dummy_value)) {
       run_maxang = dummy_value;
     }
   }
@@ -3060,13 +3160,13 @@ void Oxs_UniformExchange::ComputeEnergyChunkFinalize
   if(run_maxang<maxang)   run_maxang = maxang;
 
   // Stage max angle data
-  if(!state.GetDerivedData(smsa_name,dummy_value)) {
-    state.AddDerivedData(smsa_name,stage_maxang);
+  if(!state.GetDerivedData(stage_maxspinangle_key,dummy_value)) {
+    state.AddDerivedData(stage_maxspinangle_key,stage_maxang);
   }
 
   // Run max angle data
-  if(!state.GetDerivedData(rmsa_name,dummy_value)) {
-    state.AddDerivedData(rmsa_name,run_maxang);
+  if(!state.GetDerivedData(run_maxspinangle_key,dummy_value)) {
+    state.AddDerivedData(run_maxspinangle_key,run_maxang);
   }
 }
 
@@ -3195,24 +3295,21 @@ void Oxs_UniformExchange::UpdateDerivedOutputs(const Oxs_SimState& state)
     = run_maxspinangle_output.cache.state_id
     = 0;  // Mark change in progress
 
-  String dummy_name = MaxSpinAngleStateName();
-  if(!state.GetDerivedData(dummy_name.c_str(),
+  if(!state.GetDerivedData(maxspinangle_key,
                            maxspinangle_output.cache.value)) {
     // Error; This should always be set.  For now, just set the value to
     // -1, but in the future should consider throwing an exception.
     maxspinangle_output.cache.value = -2.222;
   }
 
-  String stage_dummy_name = StageMaxSpinAngleStateName();
-  if(!state.GetDerivedData(stage_dummy_name.c_str(),
+  if(!state.GetDerivedData(stage_maxspinangle_key,
                            stage_maxspinangle_output.cache.value)) {
     // Error; This should always be set.  For now, just set the value to
     // -1, but in the future should consider throwing an exception.
     stage_maxspinangle_output.cache.value = -1.0;
   }
 
-  String run_dummy_name = RunMaxSpinAngleStateName();
-  if(!state.GetDerivedData(run_dummy_name.c_str(),
+  if(!state.GetDerivedData(run_maxspinangle_key,
                            run_maxspinangle_output.cache.value)) {
     // Error; This should always be set.  For now, just set the value to
     // -1, but in the future should consider throwing an exception.
@@ -3385,3 +3482,25 @@ Oxs_UniformExchange::IncrementPreconditioner(PreconditionerData& pcd)
 
   return success_code;
 }
+
+OC_INT4m
+Oxs_UniformExchange::GetLinearExchange(LinearExchangeData& led) const
+{
+  if(!led.state) {
+    throw Oxs_ExtError(this,
+         "Import to GetLinearExchange not properly initialized.");
+  }
+  led.wgtx = led.wgty = led.wgtz = 0.0;
+  if(kernel != NGBR_6_MIRROR || excoeftype != A_TYPE) {
+    // Other kernels are either not linear in the nearest neighbour
+    // sense, or else (LEX_TYPE) have an Ms dependent weight.
+    return 0;
+  }
+  const Oxs_CommonRectangularMesh* mesh
+    = dynamic_cast<const Oxs_CommonRectangularMesh*>(led.state->mesh);
+  if(mesh==NULL) return 0;
+  led.wgtx = 2*A/(mesh->EdgeLengthX()*mesh->EdgeLengthX());
+  led.wgty = 2*A/(mesh->EdgeLengthY()*mesh->EdgeLengthY());
+  led.wgtz = 2*A/(mesh->EdgeLengthZ()*mesh->EdgeLengthZ());
+  return 1;
+}
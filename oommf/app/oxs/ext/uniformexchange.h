@@ -20,7 +20,8 @@
 /* End includes */
 
 class Oxs_UniformExchange
-  : public Oxs_ChunkEnergy, public Oxs_EnergyPreconditionerSupport {
+  : public Oxs_ChunkEnergy, public Oxs_EnergyPreconditionerSupport,
+    public Oxs_EnergyLinearExchangeSupport {
 private:
   enum ExchangeCoefType {
     A_UNKNOWN, A_TYPE, LEX_TYPE
@@ -186,6 +187,9 @@ private:
   String RunMaxSpinAngleStateName() const {
     return DataName("Run Max Spin Angle");
   }
+  Oxs_DerivedDataKey maxspinangle_key;       // Interned forms of the
+  Oxs_DerivedDataKey stage_maxspinangle_key; // above names, set in Init().
+  Oxs_DerivedDataKey run_maxspinangle_key;
 
 protected:
   virtual void GetEnergy(const Oxs_SimState& state,
@@ -227,6 +231,11 @@ public:
 
   // Optional interface for conjugate-gradient evolver.
   virtual int IncrementPreconditioner(PreconditionerData& pcd);
+
+  // Optional interface for evolvers treating exchange implicitly.
+  // Supported for the default 6ngbr kernel with exchange specified
+  // by A.
+  virtual OC_INT4m GetLinearExchange(LinearExchangeData& led) const;
 };
 
 
@@ -247,6 +247,48 @@ void Oxs_UZeeman::ComputeEnergyChunk
   // ocedtaux.pE_pt_accum += 0.0;
 }
 
+void Oxs_UZeeman::ComputeEnergyTile
+(const Oxs_SimState& state,
+ Oxs_ComputeEnergyDataThreadedAux& ocedtaux,
+ Oxs_ChunkEnergyTile& tile,
+ int /* threadnumber */
+ ) const
+{ // Fused version of ComputeEnergyChunk; see chunkenergy.h.
+  const ThreeVector H = GetAppliedField(state.stage_number);
+
+  const Oxs_MeshValue<ThreeVector>& spin = state.spin;
+  const Oxs_MeshValue<OC_REAL8m>& Ms = *(state.Ms);
+  const OC_INDEX offset = tile.node_start;
+  const OC_INDEX tsize = tile.node_stop - tile.node_start;
+
+  OC_REAL8m cell_volume;
+  const OC_BOOL uniform_volume
+    = state.mesh->HasUniformCellVolumes(cell_volume);
+
+  Nb_Xpfloat energy_sum = 0.0;
+  for(OC_INDEX k=0;k<tsize;++k) {
+    const OC_INDEX i = offset + k;
+    tile.H[k] += H;
+    OC_REAL8m Msi = Ms[i];
+    if(0.0 == Msi) continue;
+    const ThreeVector& m = spin[i];
+    OC_REAL8m tz = m.x*H.y;  // t = m x H
+    OC_REAL8m ty = m.x*H.z;
+    OC_REAL8m tx = m.y*H.z;
+    OC_REAL8m ei =  -MU0*Msi*(m.x*H.x + m.y*H.y + m.z*H.z);
+    tz -= m.y*H.x;
+    ty  = m.z*H.x - ty;
+    tx -= m.z*H.y;
+    if(uniform_volume) energy_sum += ei;
+    else               energy_sum += ei * state.mesh->Volume(i);
+    tile.energy[k] += ei;
+    tile.mxH[k] += ThreeVector(tx,ty,tz);
+  }
+  if(uniform_volume) energy_sum *= cell_volume;
+
+  ocedtaux.energy_total_accum += energy_sum;
+}
+
 void
 Oxs_UZeeman::Fill__Bapp_output(const Oxs_SimState& state)
 {
@@ -33,6 +33,7 @@ set objects {
     evolver
     ext
     exterror
+    fieldwriter
     labelvalue
     lock
     mesh
@@ -113,7 +114,8 @@ foreach src $psrcs {
 
 MakeRule Define {
     -targets		all
-    -dependencies       [concat configure [Platform Specific appindex.tcl]]
+    -dependencies       [concat configure [Platform Specific appindex.tcl] \
+                                test]
 }
 
 MakeRule Define {
@@ -189,6 +191,41 @@ MakeRule Define {
                       } demagtensor.cc demagtensor demagtensor.cc]
 }
 
+# Test program for Oxs_SimState derived data storage.  Uses the base
+# objects, less the oxs shell (which has its own Oc_AppMain).
+set stobjs [concat simstatetest \
+                [lsearch -all -inline -not -exact $objects oxs]]
+MakeRule Define {
+    -targets		[Platform Executables simstatetest]
+    -dependencies	[concat [Platform Objects $stobjs] \
+			        [Platform StaticLibraries $oxslibs]]
+    -script		[format {
+			    Platform Link -obj {%s} \
+			            -lib {vf nb xp oc tk tcl} \
+			            -sub CONSOLE -out simstatetest
+			} $stobjs]
+}
+unset stobjs
+MakeRule Define {
+   -targets	     [Platform Objects simstatetest]
+   -dependencies     [concat [list [Platform Name]] \
+           [[CSourceFile New _ simstatetest.cc -inc base] Dependencies]]
+   -script           [format {Platform Compile C++ -opt 1 \
+                         -inc [[CSourceFile New _ %s -inc base] DepPath] \
+                         -out %s -src %s
+                      } simstatetest.cc simstatetest simstatetest.cc]
+}
+MakeRule Define {
+   -targets          test
+   -dependencies     [Platform Executables simstatetest]
+   -script           {
+      if {[catch {exec [Platform Executables simstatetest] 2>@1} msg]} {
+         error "Oxs simstatetest failed:\n$msg"
+      }
+      puts $msg
+   }
+}
+
 MakeRule Define {
     -targets		[Platform Executables opmsh]
     -dependencies	[concat [Platform Objects $pobjs] \
@@ -344,7 +381,7 @@ MakeRule Define {
     -dependencies       objclean
     -script             [format {eval DeleteFiles [concat \
 			        [Platform Specific appindex.tcl] \
-			        [Platform Executables {%s}]]
+			        [Platform Executables {%s simstatetest}]]
                          Recursive mostlyclean} $executables]
 }
 
@@ -352,7 +389,8 @@ MakeRule Define {
     -targets            objclean
     -dependencies       {}
     -script             [format {
-       eval DeleteFiles [Platform Objects {%s %s %s %s demagtensor extinit}]
+       eval DeleteFiles [Platform Objects {%s %s %s %s demagtensor \
+                                           simstatetest extinit}]
        eval DeleteFiles [Platform Intermediate {%s %s %s %s %s extinit}]
     } $objects $extobjs $lclobjs $pobjs \
       $objects $extobjs $lclobjs $pobjs $executables]
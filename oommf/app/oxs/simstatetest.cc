@@ -0,0 +1,132 @@
+/* FILE: simstatetest.cc            -*-Mode: c++-*-
+ *
+ * Test program for Oxs_SimState derived data storage.  Client code,
+ * for example the Oxs_SimState*FieldOutput classes in outputderiv.h,
+ * holds the pointers returned by Oxs_SimState::GetDerivedData while
+ * other code adds more derived data to the same state, possibly under
+ * names interned for the first time.  This program checks that such
+ * additions leave existing pointers and their data intact.
+ *
+ * This program is built and run by the Oxs makerules (target "test").
+ * It exits with status 0 on success, 1 on failure.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "oc.h"
+
+#include "meshvalue.h"
+#include "simstate.h"
+#include "threevector.h"
+
+/* End includes */
+
+namespace {
+
+int error_count = 0;
+
+void Check(bool ok,const char* what)
+{
+  if(!ok) {
+    fprintf(stderr,"simstatetest FAILED: %s\n",what);
+    ++error_count;
+  }
+}
+
+// Number of derived data items added after pointers are taken.  This
+// is large compared to the number of names interned at startup, so
+// the per-state stores have to grow several times.
+const int extra_count = 500;
+
+void TestDerivedDataPointers()
+{
+  const OC_INDEX size = 1000;
+  Oxs_SimState state;
+
+  Oxs_DerivedDataKey scalar_key("simstatetest:scalar field");
+  Oxs_DerivedDataKey vector_key("simstatetest:vector field");
+  Oxs_DerivedDataKey value_key("simstatetest:value");
+
+  Oxs_MeshValue<OC_REAL8m> sfield(size);
+  Oxs_MeshValue<ThreeVector> vfield(size);
+  for(OC_INDEX i=0;i<size;++i) {
+    sfield[i] = 0.5*i;
+    vfield[i].Set(i,-i,2*i);
+  }
+  Check(state.AddDerivedData(scalar_key,std::move(sfield)),
+        "add scalar field");
+  Check(state.AddDerivedData(vector_key,std::move(vfield)),
+        "add vector field");
+  Check(state.AddDerivedData(value_key,3.25),"add scalar value");
+
+  const Oxs_MeshValue<OC_REAL8m>* sptr = nullptr;
+  const Oxs_MeshValue<ThreeVector>* vptr = nullptr;
+  Check(state.GetDerivedData(scalar_key,sptr) && sptr!=nullptr,
+        "get scalar field");
+  Check(state.GetDerivedData(vector_key,vptr) && vptr!=nullptr,
+        "get vector field");
+  if(sptr==nullptr || vptr==nullptr) return;
+
+  // Add many more items, under names that have not been interned yet.
+  char buf[256];
+  for(int k=0;k<extra_count;++k) {
+    Oc_Snprintf(buf,sizeof(buf),"simstatetest:extra %d",k);
+    Oxs_DerivedDataKey key(buf);
+    Check(state.AddDerivedData(key,Oxs_MeshValue<OC_REAL8m>(k+1)),
+          "add extra scalar field");
+    Check(state.AddDerivedData(key,Oxs_MeshValue<ThreeVector>(k+1)),
+          "add extra vector field");
+    Check(state.AddDerivedData(key,OC_REAL8m(k)),"add extra value");
+  }
+
+  // The original pointers must still refer to the original data.
+  const Oxs_MeshValue<OC_REAL8m>* sptr2 = nullptr;
+  const Oxs_MeshValue<ThreeVector>* vptr2 = nullptr;
+  Check(state.GetDerivedData(scalar_key,sptr2) && sptr2==sptr,
+        "scalar field moved after additions");
+  Check(state.GetDerivedData(vector_key,vptr2) && vptr2==vptr,
+        "vector field moved after additions");
+  Check(sptr->Size()==size && vptr->Size()==size,
+        "field size changed after additions");
+  OC_BOOL data_ok = 1;
+  for(OC_INDEX i=0;i<sptr->Size() && i<vptr->Size();++i) {
+    if((*sptr)[i] != 0.5*i || (*vptr)[i] != ThreeVector(i,-i,2*i)) {
+      data_ok = 0;
+      break;
+    }
+  }
+  Check(data_ok,"field data changed after additions");
+  OC_REAL8m value = 0;
+  Check(state.GetDerivedData(value_key,value) && value==3.25,
+        "scalar value changed after additions");
+
+  // Derived data can't be overwritten.
+  Check(!state.AddDerivedData(value_key,1.0),"scalar value overwritten");
+
+  // The String versions look up the same storage.
+  Check(state.HaveDerivedData("simstatetest:extra 17"),
+        "string lookup of extra value");
+
+  state.ClearDerivedData();
+  Check(!state.HaveDerivedData(scalar_key,sptr)
+        && !state.HaveDerivedData(vector_key,vptr)
+        && !state.HaveDerivedData(value_key),
+        "derived data not cleared");
+}
+
+} // namespace
+
+int Oc_AppMain(int,char**)
+{
+  try {
+    TestDerivedDataPointers();
+  } catch(...) {
+    fprintf(stderr,"simstatetest FAILED: uncaught exception\n");
+    return 1;
+  }
+  if(error_count>0) return 1;
+  printf("simstatetest: all tests passed\n");
+  return 0;
+}
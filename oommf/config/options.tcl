@@ -276,6 +276,25 @@ if {[info exists env(OOMMF_OXSLOGDIR)]} {
 Oc_Option Add * MIFinterp safety custom
 #
 ########################################################################
+# Maximum number of outstanding background writes of Oxs vector and
+# scalar field output files, for thread-enabled builds.  Field data are
+# snapshotted and written to disk by a separate thread; the solver only
+# waits if this many writes are already in progress.  Set to 0 to write
+# field output files synchronously.  Default is 2.
+# Oc_Option Add * Oxs field_output_queue_depth 2
+#
+########################################################################
+# Memory budget, in MB, for the process-wide registry of transformed
+# Oxs_Demag tensors.  A problem that is reloaded, or a second Oxs_Demag
+# term on the same mesh, copies the tensor from the registry instead of
+# recomputing it.  The registry holds each tensor at full precision
+# (six components in OXS_FFT_REAL_TYPE), regardless of the
+# fft_precision setting, so it can take several times the memory of
+# the compacted coefficient arrays used in the solve.  Default is 0,
+# which disables the registry.
+# Oc_Option Add * Oxs demag_tensor_cache_memory_MB 256
+#
+########################################################################
 # Number of threads to run (per process), for thread-enabled builds.
 # Usually, this is set in the applicable oommf/config/platform/ file,
 # but that value may be overridden here.  Additionally, the value
@@ -173,6 +173,14 @@ source [file join [file dirname [Oc_DirectPathname [info script]]]  \
 ## (which may depend on the selected compiler).
 # $config SetValue fma_type 0 ;# Replace '0' with desired type
 #
+## Maximum width, in doubles, of the Oc_Pack SIMD type (see
+## pkg/oc/ocsse.h).  Allowed values are 1, 2, 4 and 8.  The width
+## actually used is further limited by the instruction set enabled
+## by the compiler flags: 4 requires AVX, 8 requires AVX-512F.  The
+## default is 4, because on some processors AVX-512 code runs at a
+## reduced clock rate.
+# $config SetValue simd_width 8
+#
 ## Use NUMA (non-uniform memory access) libraries?  This is only
 ## supported on Linux systems that have both NUMA runtime (numactl) and
 ## NUMA development (numactl-devel) packages installed.
@@ -348,6 +348,39 @@ void Oc_SeedRV(unsigned int seed);
 double Oc_NormalRV();
 double Oc_UniformRV();
 
+////////////////////////////////////////////////////////////////////////
+// Counter-based random number generator.  Oc_Philox4x32 implements the
+// Philox4x32-10 bijection of Salmon, Moraes, Dror and Shaw, "Parallel
+// random numbers: as easy as 1, 2, 3," SC11 (2011).  There is no
+// generator state; each call maps a 128-bit counter and a 64-bit key
+// to 128 random bits.  Keying by (seed) and counting by (step, index)
+// yields streams that are reproducible regardless of how the index
+// range is divided among threads.  The routines are pure functions,
+// so they are thread safe.
+class Oc_Philox4x32 {
+public:
+  // Apply the 10-round bijection to ctr in place.
+  static void Generate(uint32_t ctr[4],const uint32_t key[2]) {
+    uint32_t k0 = key[0], k1 = key[1];
+    for(int round=0;round<10;++round) {
+      const uint64_t prod0 = uint64_t(0xD2511F53u)*ctr[0];
+      const uint64_t prod1 = uint64_t(0xCD9E8D57u)*ctr[2];
+      const uint32_t hi0 = uint32_t(prod0>>32), lo0 = uint32_t(prod0);
+      const uint32_t hi1 = uint32_t(prod1>>32), lo1 = uint32_t(prod1);
+      ctr[0] = hi1^ctr[1]^k0;
+      ctr[1] = lo1;
+      ctr[2] = hi0^ctr[3]^k1;
+      ctr[3] = lo0;
+      k0 += 0x9E3779B9u;  k1 += 0xBB67AE85u;
+    }
+  }
+
+  // Map 32 random bits to a double uniform on the open interval (0,1).
+  static double Uniform(uint32_t x) {
+    return (double(x) + 0.5)*(1.0/4294967296.0);
+  }
+};
+
 ////////////////////////////////////////////////////////////////////////
 
 
@@ -14,9 +14,28 @@
 
 #include "ocport.h"
 
+// Width, in doubles, of the Oc_Pack class defined at the bottom of
+// this file.  This is the widest vector size enabled by the compiler
+// flags, capped by the OC_SIMD_WIDTH value from the platform config.
+#ifndef OC_SIMD_WIDTH
+# define OC_SIMD_WIDTH 4
+#endif
+#if OC_USE_SSE && OC_SIMD_WIDTH>=8 && defined(__AVX512F__)
+# define OC_PACK_WIDTH 8
+#elif OC_USE_SSE && OC_SIMD_WIDTH>=4 && defined(__AVX__)
+# define OC_PACK_WIDTH 4
+#elif OC_USE_SSE && OC_SIMD_WIDTH>=2
+# define OC_PACK_WIDTH 2
+#else
+# define OC_PACK_WIDTH 1
+#endif
+
 #if OC_USE_SSE
 
 #include <emmintrin.h>
+#if OC_PACK_WIDTH>2
+# include <immintrin.h>
+#endif
 #ifndef OC_SSE_NO_ALIGNED
 # error OOMMF header error: OC_SSE_NO_ALIGNED not defined
 #endif
@@ -512,4 +531,458 @@ inline const Oc_Duet Oc_FlipDuet(const Oc_Duet& w)
 }
 
 #endif // OC_USE_SSE
+
+////////////////////////////////////////////////////////////////////////
+// Oc_Pack: OC_PACK_WIDTH doubles in a single SIMD register, i.e.,
+// __m512d (AVX-512F), __m256d (AVX), __m128d (SSE2), or a plain
+// OC_REAL8m if SIMD is not available.  This is a width-generic
+// counterpart to Oc_Duet, intended for loops that step through arrays
+// OC_PACK_WIDTH elements at a time.  The interface follows Oc_Duet,
+// and the same warnings apply: pass Oc_Pack by reference, and don't
+// put Oc_Pack in STL containers.  LoadAligned and StoreAligned require
+// the address to be aligned to OC_PACK_WIDTH*sizeof(OC_REAL8) bytes.
+//
+// Helper functions:
+//
+//   Oc_FMA(w1,w2,w3)       w1*w2+w3, fused if OC_FMA_TYPE != 0
+//   Oc_PackMaxElement(w)   Largest element of w
+//   Oc_PackMinElement(w)   Smallest element of w
+//   Oc_PackMaskGreater(t,b,w)  w in lanes where t>b, 0 elsewhere
+//   Oc_PackSwapPairs(w)    Swaps elements 2k and 2k+1 (not available
+//                          if OC_PACK_WIDTH == 1)
+//   Oc_PackLoadInterleaved3(base,a,b,c)
+//   Oc_PackStoreInterleaved3(a,b,c,base)
+//                          Transfer between OC_PACK_WIDTH consecutive
+//                          triples (a0,b0,c0,a1,b1,c1,...) in memory
+//                          and three packs, e.g., for ThreeVector arrays.
+//                          No alignment restrictions.
+
+#if OC_PACK_WIDTH > 1
+
+#if OC_PACK_WIDTH == 8
+typedef __m512d OC_PACK_TYPE;
+# define OC_PACK_INTRIN(name) _mm512_##name
+#elif OC_PACK_WIDTH == 4
+typedef __m256d OC_PACK_TYPE;
+# define OC_PACK_INTRIN(name) _mm256_##name
+#else
+typedef __m128d OC_PACK_TYPE;
+# define OC_PACK_INTRIN(name) _mm_##name
+#endif
+
+class Oc_Pack {
+public:
+  Oc_Pack& Set(OC_REAL8 x) { value = OC_PACK_INTRIN(set1_pd)(x); return *this; }
+
+  Oc_Pack& SetPairs(OC_REAL8 a,OC_REAL8 b) {
+    // Fills pack with a,b,a,b,... (a in the lowest element)
+#if OC_PACK_WIDTH == 8
+    value = _mm512_set_pd(b,a,b,a,b,a,b,a);
+#elif OC_PACK_WIDTH == 4
+    value = _mm256_set_pd(b,a,b,a);
+#else
+    value = _mm_set_pd(b,a);
+#endif
+    return *this;
+  }
+
+  Oc_Pack& LoadUnaligned(const OC_REAL8& base) {
+    value = OC_PACK_INTRIN(loadu_pd)(&base);
+    return *this;
+  }
+
+  Oc_Pack& LoadAligned(const OC_REAL8& base) {
+#if !OC_SSE_NO_ALIGNED
+    value = OC_PACK_INTRIN(load_pd)(&base);
+#else
+    value = OC_PACK_INTRIN(loadu_pd)(&base);
+#endif
+    return *this;
+  }
+
+  Oc_Pack(OC_REAL8 x) { Set(x); }
+  Oc_Pack(const OC_PACK_TYPE& newval) : value(newval) {}
+  Oc_Pack(const Oc_Pack& other) : value(other.value) {}
+  Oc_Pack() {}
+
+  Oc_Pack& operator=(const Oc_Pack &other)
+  { value = other.value; return *this; }
+
+  Oc_Pack& SetZero() { value = OC_PACK_INTRIN(setzero_pd)(); return *this; }
+
+  Oc_Pack& operator+=(const Oc_Pack& other) {
+    value = OC_PACK_INTRIN(add_pd)(value,other.value); return *this;
+  }
+  Oc_Pack& operator+=(const OC_REAL8& x) {
+    value = OC_PACK_INTRIN(add_pd)(value,OC_PACK_INTRIN(set1_pd)(x));
+    return *this;
+  }
+  Oc_Pack& operator-=(const Oc_Pack& other) {
+    value = OC_PACK_INTRIN(sub_pd)(value,other.value); return *this;
+  }
+  Oc_Pack& operator-=(const OC_REAL8& x) {
+    value = OC_PACK_INTRIN(sub_pd)(value,OC_PACK_INTRIN(set1_pd)(x));
+    return *this;
+  }
+  Oc_Pack& operator*=(const Oc_Pack& other) {
+    value = OC_PACK_INTRIN(mul_pd)(value,other.value); return *this;
+  }
+  Oc_Pack& operator*=(const OC_REAL8& x) {
+    value = OC_PACK_INTRIN(mul_pd)(value,OC_PACK_INTRIN(set1_pd)(x));
+    return *this;
+  }
+  Oc_Pack& operator/=(const Oc_Pack& other) {
+    value = OC_PACK_INTRIN(div_pd)(value,other.value); return *this;
+  }
+  Oc_Pack& operator/=(const OC_REAL8& x) {
+    value = OC_PACK_INTRIN(div_pd)(value,OC_PACK_INTRIN(set1_pd)(x));
+    return *this;
+  }
+
+  // Write out all OC_PACK_WIDTH values.  See Oc_Duet for notes on the
+  // Unaligned, Aligned and Stream variants.
+  void StoreUnaligned(OC_REAL8& base) const {
+    OC_PACK_INTRIN(storeu_pd)(&base,value);
+  }
+#if !OC_SSE_NO_ALIGNED
+  void StoreAligned(OC_REAL8& base) const {
+    OC_PACK_INTRIN(store_pd)(&base,value);
+  }
+  void StoreStream(OC_REAL8& base) const {
+    OC_PACK_INTRIN(stream_pd)(&base,value);
+  }
+#else
+  void StoreAligned(OC_REAL8& base) const {
+    OC_PACK_INTRIN(storeu_pd)(&base,value);
+  }
+  void StoreStream(OC_REAL8& base) const {
+    OC_PACK_INTRIN(storeu_pd)(&base,value);
+  }
+#endif
+
+  void KeepMin(const Oc_Pack& tst) {
+    value = OC_PACK_INTRIN(min_pd)(value,tst.value);
+  }
+  void KeepMax(const Oc_Pack& tst) {
+    value = OC_PACK_INTRIN(max_pd)(value,tst.value);
+  }
+
+  OC_PACK_TYPE  GetPackValue() const { return value; }
+  OC_PACK_TYPE& GetPackRef() { return value; }
+  const OC_PACK_TYPE& GetPackRef() const { return value; }
+
+  friend const Oc_Pack operator+(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator+(OC_REAL8 x,const Oc_Pack& w);
+  friend const Oc_Pack operator+(const Oc_Pack& w,OC_REAL8 x);
+
+  friend const Oc_Pack operator-(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator-(OC_REAL8 x,const Oc_Pack& w);
+  friend const Oc_Pack operator-(const Oc_Pack& w,OC_REAL8 x);
+
+  friend const Oc_Pack operator*(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator*(OC_REAL8 x,const Oc_Pack& w);
+  friend const Oc_Pack operator*(const Oc_Pack& w,OC_REAL8 x);
+
+  friend const Oc_Pack operator/(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator/(OC_REAL8 x,const Oc_Pack& w);
+  friend const Oc_Pack operator/(const Oc_Pack& w,OC_REAL8 x);
+
+  friend const Oc_Pack Oc_FMA(const Oc_Pack& w1,const Oc_Pack& w2,
+                              const Oc_Pack& w3); // w1*w2+w3
+
+  friend const Oc_Pack sqrt(const Oc_Pack& w);
+  friend const Oc_Pack recip(const Oc_Pack& w); // 1.0/w
+
+private:
+  OC_PACK_TYPE value;
+};
+
+inline const Oc_Pack operator+(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(OC_PACK_INTRIN(add_pd)(w1.value,w2.value)); }
+inline const Oc_Pack operator+(OC_REAL8 x,const Oc_Pack& w)
+{ return Oc_Pack(OC_PACK_INTRIN(add_pd)(OC_PACK_INTRIN(set1_pd)(x),w.value)); }
+inline const Oc_Pack operator+(const Oc_Pack& w,OC_REAL8 x)
+{ return Oc_Pack(OC_PACK_INTRIN(add_pd)(w.value,OC_PACK_INTRIN(set1_pd)(x))); }
+
+inline const Oc_Pack operator-(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(OC_PACK_INTRIN(sub_pd)(w1.value,w2.value)); }
+inline const Oc_Pack operator-(OC_REAL8 x,const Oc_Pack& w)
+{ return Oc_Pack(OC_PACK_INTRIN(sub_pd)(OC_PACK_INTRIN(set1_pd)(x),w.value)); }
+inline const Oc_Pack operator-(const Oc_Pack& w,OC_REAL8 x)
+{ return Oc_Pack(OC_PACK_INTRIN(sub_pd)(w.value,OC_PACK_INTRIN(set1_pd)(x))); }
+
+inline const Oc_Pack operator*(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(OC_PACK_INTRIN(mul_pd)(w1.value,w2.value)); }
+inline const Oc_Pack operator*(OC_REAL8 x,const Oc_Pack& w)
+{ return Oc_Pack(OC_PACK_INTRIN(mul_pd)(OC_PACK_INTRIN(set1_pd)(x),w.value)); }
+inline const Oc_Pack operator*(const Oc_Pack& w,OC_REAL8 x)
+{ return Oc_Pack(OC_PACK_INTRIN(mul_pd)(w.value,OC_PACK_INTRIN(set1_pd)(x))); }
+
+inline const Oc_Pack operator/(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(OC_PACK_INTRIN(div_pd)(w1.value,w2.value)); }
+inline const Oc_Pack operator/(OC_REAL8 x,const Oc_Pack& w)
+{ return Oc_Pack(OC_PACK_INTRIN(div_pd)(OC_PACK_INTRIN(set1_pd)(x),w.value)); }
+inline const Oc_Pack operator/(const Oc_Pack& w,OC_REAL8 x)
+{ return Oc_Pack(OC_PACK_INTRIN(div_pd)(w.value,OC_PACK_INTRIN(set1_pd)(x))); }
+
+inline const Oc_Pack Oc_FMA(const Oc_Pack& w1,const Oc_Pack& w2,
+                            const Oc_Pack& w3)
+{ // Fused multiply-add
+#if OC_FMA_TYPE == 3
+  return Oc_Pack(OC_PACK_INTRIN(fmadd_pd)(w1.value,w2.value,w3.value));
+#elif OC_FMA_TYPE == 4 && OC_PACK_WIDTH < 8
+  return Oc_Pack(OC_PACK_INTRIN(macc_pd)(w1.value,w2.value,w3.value));
+#else
+  return w1*w2 + w3;
+#endif
+}
+
+inline const Oc_Pack sqrt(const Oc_Pack& w)
+{ return Oc_Pack(OC_PACK_INTRIN(sqrt_pd)(w.value)); }
+
+inline const Oc_Pack recip(const Oc_Pack& w)
+{ return Oc_Pack(OC_PACK_INTRIN(div_pd)(OC_PACK_INTRIN(set1_pd)(1.0),w.value)); }
+
+inline OC_REAL8 Oc_PackMaxElement(const Oc_Pack& w)
+{
+#if OC_PACK_WIDTH == 8
+  __m512d tmp = w.GetPackValue();
+  tmp = _mm512_max_pd(tmp,_mm512_shuffle_f64x2(tmp,tmp,0x4E));
+  tmp = _mm512_max_pd(tmp,_mm512_shuffle_f64x2(tmp,tmp,0xB1));
+  tmp = _mm512_max_pd(tmp,_mm512_permute_pd(tmp,0x55));
+  return oc_sse_cvtsd_f64(_mm512_castpd512_pd128(tmp));
+#else
+# if OC_PACK_WIDTH == 4
+  __m128d tmp = _mm_max_pd(_mm256_castpd256_pd128(w.GetPackValue()),
+                           _mm256_extractf128_pd(w.GetPackValue(),1));
+# else
+  __m128d tmp = w.GetPackValue();
+# endif
+  return oc_sse_cvtsd_f64(_mm_max_sd(tmp,_mm_unpackhi_pd(tmp,tmp)));
+#endif
+}
+
+inline OC_REAL8 Oc_PackMinElement(const Oc_Pack& w)
+{
+#if OC_PACK_WIDTH == 8
+  __m512d tmp = w.GetPackValue();
+  tmp = _mm512_min_pd(tmp,_mm512_shuffle_f64x2(tmp,tmp,0x4E));
+  tmp = _mm512_min_pd(tmp,_mm512_shuffle_f64x2(tmp,tmp,0xB1));
+  tmp = _mm512_min_pd(tmp,_mm512_permute_pd(tmp,0x55));
+  return oc_sse_cvtsd_f64(_mm512_castpd512_pd128(tmp));
+#else
+# if OC_PACK_WIDTH == 4
+  __m128d tmp = _mm_min_pd(_mm256_castpd256_pd128(w.GetPackValue()),
+                           _mm256_extractf128_pd(w.GetPackValue(),1));
+# else
+  __m128d tmp = w.GetPackValue();
+# endif
+  return oc_sse_cvtsd_f64(_mm_min_sd(tmp,_mm_unpackhi_pd(tmp,tmp)));
+#endif
+}
+
+inline const Oc_Pack
+Oc_PackMaskGreater(const Oc_Pack& tst,const Oc_Pack& bound,const Oc_Pack& w)
+{ // Returns w in lanes where tst>bound, 0.0 elsewhere
+#if OC_PACK_WIDTH == 8
+  return Oc_Pack(_mm512_maskz_mov_pd(_mm512_cmp_pd_mask(tst.GetPackValue(),
+                                                        bound.GetPackValue(),
+                                                        _CMP_GT_OQ),
+                                     w.GetPackValue()));
+#elif OC_PACK_WIDTH == 4
+  return Oc_Pack(_mm256_and_pd(_mm256_cmp_pd(tst.GetPackValue(),
+                                             bound.GetPackValue(),
+                                             _CMP_GT_OQ),
+                               w.GetPackValue()));
+#else
+  return Oc_Pack(_mm_and_pd(_mm_cmpgt_pd(tst.GetPackValue(),
+                                         bound.GetPackValue()),
+                            w.GetPackValue()));
+#endif
+}
+
+inline const Oc_Pack Oc_PackSwapPairs(const Oc_Pack& w)
+{
+#if OC_PACK_WIDTH == 8
+  return Oc_Pack(_mm512_permute_pd(w.GetPackValue(),0x55));
+#elif OC_PACK_WIDTH == 4
+  return Oc_Pack(_mm256_permute_pd(w.GetPackValue(),0x5));
+#else
+  return Oc_Pack(_mm_shuffle_pd(w.GetPackValue(),w.GetPackValue(),1));
+#endif
+}
+
+inline void Oc_PackLoadInterleaved3(const OC_REAL8& base,
+                                    Oc_Pack& a,Oc_Pack& b,Oc_Pack& c)
+{
+  const OC_REAL8* p = &base;
+#if OC_PACK_WIDTH == 8
+  // Two-stage permute; in each stage index bit 3 selects the second
+  // source.  The _mm512_set_epi64 arguments run from element 7 down
+  // to element 0.
+  const __m512d t0 = _mm512_loadu_pd(p);    // a0 b0 c0 a1 b1 c1 a2 b2
+  const __m512d t1 = _mm512_loadu_pd(p+8);  // c2 a3 b3 c3 a4 b4 c4 a5
+  const __m512d t2 = _mm512_loadu_pd(p+16); // b5 c5 a6 b6 c6 a7 b7 c7
+  a = _mm512_permutex2var_pd(
+        _mm512_permutex2var_pd(t0,_mm512_set_epi64(0,0,15,12,9,6,3,0),t1),
+        _mm512_set_epi64(13,10,5,4,3,2,1,0),t2);
+  b = _mm512_permutex2var_pd(
+        _mm512_permutex2var_pd(t0,_mm512_set_epi64(0,0,0,13,10,7,4,1),t1),
+        _mm512_set_epi64(14,11,8,4,3,2,1,0),t2);
+  c = _mm512_permutex2var_pd(
+        _mm512_permutex2var_pd(t0,_mm512_set_epi64(0,0,0,14,11,8,5,2),t1),
+        _mm512_set_epi64(15,12,9,4,3,2,1,0),t2);
+#elif OC_PACK_WIDTH == 4
+  const __m256d t0 = _mm256_insertf128_pd(                  // a0 b0 a2 b2
+        _mm256_castpd128_pd256(_mm_loadu_pd(p)),_mm_loadu_pd(p+6),1);
+  const __m256d t1 = _mm256_insertf128_pd(                  // c0 a1 c2 a3
+        _mm256_castpd128_pd256(_mm_loadu_pd(p+2)),_mm_loadu_pd(p+8),1);
+  const __m256d t2 = _mm256_insertf128_pd(                  // b1 c1 b3 c3
+        _mm256_castpd128_pd256(_mm_loadu_pd(p+4)),_mm_loadu_pd(p+10),1);
+  a = _mm256_shuffle_pd(t0,t1,0xA);
+  b = _mm256_shuffle_pd(t0,t2,0x5);
+  c = _mm256_shuffle_pd(t1,t2,0xA);
+#else
+  const __m128d t0 = _mm_loadu_pd(p);   // a0 b0
+  const __m128d t1 = _mm_loadu_pd(p+2); // c0 a1
+  const __m128d t2 = _mm_loadu_pd(p+4); // b1 c1
+  a = _mm_shuffle_pd(t0,t1,2);
+  b = _mm_shuffle_pd(t0,t2,1);
+  c = _mm_shuffle_pd(t1,t2,2);
+#endif
+}
+
+inline void Oc_PackStoreInterleaved3(const Oc_Pack& a,const Oc_Pack& b,
+                                     const Oc_Pack& c,OC_REAL8& base)
+{ // Inverse of Oc_PackLoadInterleaved3
+  OC_REAL8* p = &base;
+  const OC_PACK_TYPE& av = a.GetPackRef();
+  const OC_PACK_TYPE& bv = b.GetPackRef();
+  const OC_PACK_TYPE& cv = c.GetPackRef();
+#if OC_PACK_WIDTH == 8
+  // First merge a and b, leaving holes (index 0 placeholders) for
+  // the c elements, then fill in the holes from c.
+  _mm512_storeu_pd(p,_mm512_permutex2var_pd(
+    _mm512_permutex2var_pd(av,_mm512_set_epi64(10,2,0,9,1,0,8,0),bv),
+    _mm512_set_epi64(7,6,9,4,3,8,1,0),cv));
+  _mm512_storeu_pd(p+8,_mm512_permutex2var_pd(
+    _mm512_permutex2var_pd(av,_mm512_set_epi64(5,0,12,4,0,11,3,0),bv),
+    _mm512_set_epi64(7,12,5,4,11,2,1,10),cv));
+  _mm512_storeu_pd(p+16,_mm512_permutex2var_pd(
+    _mm512_permutex2var_pd(av,_mm512_set_epi64(0,15,7,0,14,6,0,13),bv),
+    _mm512_set_epi64(15,6,5,14,3,2,13,0),cv));
+#elif OC_PACK_WIDTH == 4
+  const __m256d t0 = _mm256_unpacklo_pd(av,bv);     // a0 b0 a2 b2
+  const __m256d t1 = _mm256_shuffle_pd(cv,av,0xA);  // c0 a1 c2 a3
+  const __m256d t2 = _mm256_unpackhi_pd(bv,cv);     // b1 c1 b3 c3
+  _mm_storeu_pd(p,   _mm256_castpd256_pd128(t0));
+  _mm_storeu_pd(p+2, _mm256_castpd256_pd128(t1));
+  _mm_storeu_pd(p+4, _mm256_castpd256_pd128(t2));
+  _mm_storeu_pd(p+6, _mm256_extractf128_pd(t0,1));
+  _mm_storeu_pd(p+8, _mm256_extractf128_pd(t1,1));
+  _mm_storeu_pd(p+10,_mm256_extractf128_pd(t2,1));
+#else
+  _mm_storeu_pd(p,   _mm_unpacklo_pd(av,bv));
+  _mm_storeu_pd(p+2, _mm_shuffle_pd(cv,av,2));
+  _mm_storeu_pd(p+4, _mm_unpackhi_pd(bv,cv));
+#endif
+}
+
+#else // OC_PACK_WIDTH == 1
+
+class Oc_Pack {
+public:
+  Oc_Pack& Set(OC_REAL8m x) { v0 = x; return *this; }
+  Oc_Pack& LoadUnaligned(const OC_REAL8m& base) { v0 = base; return *this; }
+  Oc_Pack& LoadAligned(const OC_REAL8m& base) { v0 = base; return *this; }
+  Oc_Pack(OC_REAL8m x) : v0(x) {}
+  Oc_Pack(const Oc_Pack& other) : v0(other.v0) {}
+  Oc_Pack() {}
+
+  Oc_Pack& operator=(const Oc_Pack &other) { v0 = other.v0; return *this; }
+
+  Oc_Pack& SetZero() { v0 = 0.0; return *this; }
+
+  Oc_Pack& operator+=(const Oc_Pack& other) { v0 += other.v0; return *this; }
+  Oc_Pack& operator+=(const OC_REAL8m& x) { v0 += x; return *this; }
+  Oc_Pack& operator-=(const Oc_Pack& other) { v0 -= other.v0; return *this; }
+  Oc_Pack& operator-=(const OC_REAL8m& x) { v0 -= x; return *this; }
+  Oc_Pack& operator*=(const Oc_Pack& other) { v0 *= other.v0; return *this; }
+  Oc_Pack& operator*=(const OC_REAL8m& x) { v0 *= x; return *this; }
+  Oc_Pack& operator/=(const Oc_Pack& other) { v0 /= other.v0; return *this; }
+  Oc_Pack& operator/=(const OC_REAL8m& x) { v0 /= x; return *this; }
+
+  void StoreUnaligned(OC_REAL8m& base) const { base = v0; }
+  void StoreAligned(OC_REAL8m& base) const { base = v0; }
+  void StoreStream(OC_REAL8m& base) const { base = v0; }
+
+  void KeepMin(const Oc_Pack& tst) { v0 = v0 > tst.v0 ? tst.v0 : v0 ; }
+  void KeepMax(const Oc_Pack& tst) { v0 = v0 < tst.v0 ? tst.v0 : v0 ; }
+
+  // NOTE: No GetPackValue() or GetPackRef() if OC_PACK_WIDTH == 1
+
+  friend const Oc_Pack operator+(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator-(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator*(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack operator/(const Oc_Pack& w1,const Oc_Pack& w2);
+  friend const Oc_Pack Oc_FMA(const Oc_Pack& w1,const Oc_Pack& w2,
+                              const Oc_Pack& w3); // w1*w2+w3
+  friend const Oc_Pack sqrt(const Oc_Pack& w);
+  friend const Oc_Pack recip(const Oc_Pack& w); // 1.0/w
+  friend OC_REAL8m Oc_PackMaxElement(const Oc_Pack& w);
+  friend OC_REAL8m Oc_PackMinElement(const Oc_Pack& w);
+  friend const Oc_Pack Oc_PackMaskGreater(const Oc_Pack& tst,
+                                          const Oc_Pack& bound,
+                                          const Oc_Pack& w);
+private:
+  OC_REAL8m v0;
+};
+
+// Mixed scalar/pack operations are covered by the implicit
+// Oc_Pack(OC_REAL8m) constructor.
+inline const Oc_Pack operator+(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(w1.v0+w2.v0); }
+inline const Oc_Pack operator-(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(w1.v0-w2.v0); }
+inline const Oc_Pack operator*(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(w1.v0*w2.v0); }
+inline const Oc_Pack operator/(const Oc_Pack& w1,const Oc_Pack& w2)
+{ return Oc_Pack(w1.v0/w2.v0); }
+
+inline const Oc_Pack Oc_FMA(const Oc_Pack& w1,const Oc_Pack& w2,
+                            const Oc_Pack& w3)
+{ return Oc_Pack(w1.v0*w2.v0+w3.v0); }
+
+inline const Oc_Pack sqrt(const Oc_Pack& w)
+{ return Oc_Pack(sqrt(w.v0)); }
+
+inline const Oc_Pack recip(const Oc_Pack& w)
+{ return Oc_Pack(OC_REAL8m(1.0)/w.v0); }
+
+inline OC_REAL8m Oc_PackMaxElement(const Oc_Pack& w)
+{ return w.v0; }
+
+inline OC_REAL8m Oc_PackMinElement(const Oc_Pack& w)
+{ return w.v0; }
+
+inline const Oc_Pack
+Oc_PackMaskGreater(const Oc_Pack& tst,const Oc_Pack& bound,const Oc_Pack& w)
+{ return Oc_Pack(tst.v0 > bound.v0 ? w.v0 : OC_REAL8m(0.0)); }
+
+inline void Oc_PackLoadInterleaved3(const OC_REAL8m& base,
+                                    Oc_Pack& a,Oc_Pack& b,Oc_Pack& c)
+{
+  const OC_REAL8m* p = &base;
+  a.Set(p[0]);  b.Set(p[1]);  c.Set(p[2]);
+}
+
+inline void Oc_PackStoreInterleaved3(const Oc_Pack& a,const Oc_Pack& b,
+                                     const Oc_Pack& c,OC_REAL8m& base)
+{
+  OC_REAL8m* p = &base;
+  a.StoreUnaligned(p[0]);  b.StoreUnaligned(p[1]);  c.StoreUnaligned(p[2]);
+}
+
+#endif // OC_PACK_WIDTH
+
 #endif // OCSSE
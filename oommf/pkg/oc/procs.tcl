@@ -1501,6 +1501,21 @@ typedef  unsigned char      OC_UCHAR;
 #define OC_FMA_TYPE 0
 }] }
 
+   # Upper bound on the width of the Oc_Pack SIMD type, in doubles.
+   # The width actually used also depends on the instruction set
+   # enabled by the compiler flags; see ocsse.h.
+   if {[catch {$config GetValue simd_width} simd_width]} {
+      set simd_width 4   ;# Default
+   }
+   if {[lsearch -exact {1 2 4 8} $simd_width]<0} {
+      error "Invalid simd_width value \"$simd_width\";\
+             should be one of 1, 2, 4 or 8"
+   }
+   append porth [subst {
+/* Maximum Oc_Pack width, in doubles */
+#define OC_SIMD_WIDTH $simd_width
+}]
+
 
    # Byte order.  For now just use 4-byte wide ordering
    foreach vartype { int long short float double } {
@@ -26,7 +26,7 @@ set objects {
 
 MakeRule Define {
     -targets            all
-    -dependencies       [concat configure [Platform StaticLibrary vf]]
+    -dependencies       [concat configure [Platform StaticLibrary vf] test]
 }
 
 MakeRule Define {
@@ -71,6 +71,36 @@ foreach o $objects {
     }
 }
 
+# Round-trip test for the OVF file reader.
+MakeRule Define {
+    -targets            [Platform Objects ovftest]
+    -dependencies       [concat [list [Platform Name]] \
+                                [[CSourceFile New _ ovftest.cc] Dependencies]]
+    -script             {Platform Compile C++ -opt 1 \
+                                -inc [[CSourceFile New _ ovftest.cc] DepPath] \
+                                -out ovftest -src ovftest.cc}
+}
+
+MakeRule Define {
+    -targets            [Platform Executables ovftest]
+    -dependencies       [concat [Platform Objects ovftest] \
+                                [Platform StaticLibraries {vf nb xp oc}]]
+    -script             {Platform Link -obj ovftest \
+                                -lib {vf nb xp oc tk tcl} -sub CONSOLE \
+                                -out ovftest}
+}
+
+MakeRule Define {
+    -targets            test
+    -dependencies       [Platform Executables ovftest]
+    -script             {
+        if {[catch {exec [Platform Executables ovftest] 2>@1} msg]} {
+            error "Vf ovftest failed:\n$msg"
+        }
+        puts $msg
+    }
+}
+
 MakeRule Define {
     -targets            distclean
     -dependencies       clean
@@ -86,15 +116,16 @@ MakeRule Define {
     -targets            mostlyclean
     -dependencies       objclean
     -script             {eval DeleteFiles [concat tclIndex \
-			        [Platform StaticLibrary vf]]}
+			        [Platform StaticLibrary vf] \
+			        [Platform Executables ovftest]]}
 }
  
 MakeRule Define {
     -targets            objclean
     -dependencies       {}
     -script             [format {
-	eval DeleteFiles [Platform Objects {%s}]
-	eval DeleteFiles [Platform Intermediate {%s}]
+	eval DeleteFiles [Platform Objects {%s ovftest}]
+	eval DeleteFiles [Platform Intermediate {%s ovftest}]
     } $objects $objects]
 }
 
@@ -0,0 +1,365 @@
+/* FILE: ovftest.cc                 -*-Mode: c++-*-
+ *
+ * Round-trip test for the OVF 2.0 reader.  Writes a small rectangular
+ * vector field in each OVF 2.0 data format (binary 8, binary 4, and
+ * text), reads it back through Vf_FileInput::NewReader, and checks
+ * the mesh dimensions and node values.  The file is then overwritten
+ * and truncated while the mesh is still alive; meshes returned by the
+ * reader must own their data, so the node values must not change.
+ *
+ * A second set of tests writes a large field, spanning several
+ * transfer blocks and split across several conversion threads, in
+ * binary 8 and binary 4 for OVF 2.0 (LSB) and OVF 1.0 (MSB).  Each file
+ * is written once through a plain file channel, which uses direct file
+ * I/O, and once through a channel with a pass-through transform pushed
+ * on top, which forces the Tcl channel path.  The two files must be
+ * byte for byte identical, and must read back correctly.
+ *
+ * This program is built and run by the Vf makerules (target "test").
+ * It exits with status 0 on success, 1 on failure.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "oc.h"
+#include "nb.h"
+#include "vf.h"
+
+/* End includes */
+
+namespace {
+
+int error_count = 0;
+
+void Check(bool ok,const char* format,const char* what)
+{
+  if(!ok) {
+    fprintf(stderr,"ovftest FAILED: %s (%s)\n",what,format);
+    ++error_count;
+  }
+}
+
+// Odd sizes, so that no dimension is a multiple of any buffer or
+// block size in the reader.
+const OC_INDEX xnodes = 7;
+const OC_INDEX ynodes = 5;
+const OC_INDEX znodes = 3;
+
+// Large field dimensions.  The node count exceeds the 16 MB transfer
+// block in every binary format (1398101 three-vector records for binary
+// 4), and also 2*vf_binary_minrange, so that each block is converted
+// on more than one thread.
+const OC_INDEX big_xnodes = 1447;
+const OC_INDEX big_ynodes = 521;
+const OC_INDEX big_znodes = 2;
+
+// Test value for component m of node (i,j,k).  The values are not
+// exactly representable in binary, so that a reader that converts
+// through single precision can be told apart from one that doesn't.
+OC_REAL8m TestValue(OC_INDEX i,OC_INDEX j,OC_INDEX k,int m)
+{
+  return (1+m)*0.1*(i+1) - 0.3*j + 1.7*k + (m==2 ? 1e5 : 0.0);
+}
+
+OC_BOOL SetupHeader(Vf_Ovf20FileHeader& header,OC_INDEX xnodes,
+                    OC_INDEX ynodes,OC_INDEX znodes,
+                    Vf_OvfFileVersion version)
+{
+  header.ovfversion = version;
+  header.title.Set(String("ovftest"));
+  header.desc.Set(String("OVF round-trip test data"));
+  header.meshtype.Set(vf_ovf20mesh_rectangular);
+  header.meshunit.Set(String("m"));
+  const OC_REAL8m step = 5e-9;
+  header.xmin.Set(0.0);
+  header.ymin.Set(0.0);
+  header.zmin.Set(0.0);
+  header.xmax.Set(xnodes*step);
+  header.ymax.Set(ynodes*step);
+  header.zmax.Set(znodes*step);
+  header.xbase.Set(step/2);
+  header.ybase.Set(step/2);
+  header.zbase.Set(step/2);
+  header.xnodes.Set(xnodes);
+  header.ynodes.Set(ynodes);
+  header.znodes.Set(znodes);
+  header.xstepsize.Set(step);
+  header.ystepsize.Set(step);
+  header.zstepsize.Set(step);
+  header.valuedim.Set(3);
+  vector<String> labels;
+  labels.push_back("m_x");
+  labels.push_back("m_y");
+  labels.push_back("m_z");
+  header.valuelabels.Set(labels);
+  vector<String> units(3,String("A/m"));
+  header.valueunits.Set(units);
+  return header.IsValid();
+}
+
+void FillTestData(std::vector<OC_REAL8m>& data,OC_INDEX xnodes,
+                  OC_INDEX ynodes,OC_INDEX znodes,OC_REAL8m offset)
+{
+  data.clear();
+  data.reserve(size_t(3*xnodes*ynodes*znodes));
+  for(OC_INDEX k=0;k<znodes;++k) {
+    for(OC_INDEX j=0;j<ynodes;++j) {
+      for(OC_INDEX i=0;i<xnodes;++i) {
+        for(int m=0;m<3;++m) data.push_back(TestValue(i,j,k,m)+offset);
+      }
+    }
+  }
+}
+
+void WriteTestFile(const char* filename,Vf_OvfDataStyle datastyle,
+                   const char* textfmt,OC_REAL8m offset)
+{
+  Vf_Ovf20FileHeader header;
+  if(!SetupHeader(header,xnodes,ynodes,znodes,vf_ovf_20)) {
+    Check(false,textfmt,"invalid test file header");
+    return;
+  }
+
+  std::vector<OC_REAL8m> data;
+  FillTestData(data,xnodes,ynodes,znodes,offset);
+
+  Nb_FileChannel channel(filename,"w");
+  header.WriteHeader(channel);
+  header.WriteData(channel,datastyle,textfmt,0,
+                   Vf_Ovf20VecArrayConst(3,xnodes*ynodes*znodes,
+                                         data.data()));
+  channel.Close();
+}
+
+// Reads filename through Vf_FileInput::NewReader.  Returns the mesh
+// as a Vf_GridVec3f if it has the expected dimensions, otherwise
+// reports an error and returns nullptr.  The caller owns the grid.
+Vf_GridVec3f* ReadTestFile(const char* filename,const char* format,
+                           OC_INDEX xnodes,OC_INDEX ynodes,OC_INDEX znodes)
+{
+  Vf_FileInput* reader
+    = Vf_FileInput::NewReader(filename,nullptr);
+  Check(reader!=nullptr,format,"no reader for file");
+  if(reader==nullptr) return nullptr;
+  int baddata = 0;
+  Vf_Mesh* mesh = reader->NewMesh(&baddata);
+  delete reader;
+  Check(baddata==0,format,"reader reported bad data");
+  Vf_GridVec3f* grid = dynamic_cast<Vf_GridVec3f*>(mesh);
+  Check(grid!=nullptr,format,"mesh is not a Vf_GridVec3f");
+  if(grid==nullptr) {
+    delete mesh;
+    return nullptr;
+  }
+
+  OC_INDEX isize,jsize,ksize;
+  grid->GetDimens(isize,jsize,ksize);
+  Check(isize==xnodes && jsize==ynodes && ksize==znodes,
+        format,"mesh dimensions");
+  if(isize!=xnodes || jsize!=ynodes || ksize!=znodes) {
+    delete mesh;
+    return nullptr;
+  }
+  return grid;
+}
+
+// Returns true if the node values in grid match TestValue, to within
+// the precision of datastyle.
+OC_BOOL CheckTestValues(const Vf_GridVec3f* grid,Vf_OvfDataStyle datastyle,
+                        OC_INDEX xnodes,OC_INDEX ynodes,OC_INDEX znodes)
+{
+  // Binary 4 files hold single precision values.  Binary 8 and
+  // %.17g text hold the double precision values exactly.
+  const OC_REAL8m reltol = (datastyle==vf_obin4 ? 1e-6 : 0.0);
+  const OC_REAL8m valmult = grid->GetValueMultiplier();
+  for(OC_INDEX k=0;k<znodes;++k) {
+    for(OC_INDEX j=0;j<ynodes;++j) {
+      for(OC_INDEX i=0;i<xnodes;++i) {
+        const Nb_Vec3<OC_REAL8>& v = (*grid)(i,j,k);
+        const OC_REAL8m got[3] = { valmult*v.x, valmult*v.y, valmult*v.z };
+        for(int m=0;m<3;++m) {
+          const OC_REAL8m want = TestValue(i,j,k,m);
+          if(fabs(got[m]-want) > reltol*fabs(want)) return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+void TestRoundTrip(const char* filename,Vf_OvfDataStyle datastyle,
+                   const char* textfmt,const char* format)
+{
+  WriteTestFile(filename,datastyle,textfmt,0.0);
+
+  Vf_GridVec3f* grid = ReadTestFile(filename,format,xnodes,ynodes,znodes);
+  if(grid==nullptr) return;
+
+  Check(CheckTestValues(grid,datastyle,xnodes,ynodes,znodes),
+        format,"node values");
+
+  // Overwrite the file with different values, then truncate it.  The
+  // mesh must not see either change.
+  WriteTestFile(filename,datastyle,textfmt,1.0);
+  FILE* fptr = fopen(filename,"wb");
+  if(fptr!=nullptr) fclose(fptr);
+  Check(CheckTestValues(grid,datastyle,xnodes,ynodes,znodes),
+        format,"node values changed with file");
+
+  delete grid;
+}
+
+// Tcl pass-through channel transform.  Pushing this onto a file
+// channel makes it a stacked channel, which the OVF writer sends
+// through Tcl_Write rather than direct file I/O.  The bytes that reach
+// the file are unchanged.
+const char* passthru_script =
+  "namespace eval ::ovftest_passthru {\n"
+  "  proc initialize {handle mode} {\n"
+  "    return {initialize finalize write}\n"
+  "  }\n"
+  "  proc finalize {handle} {}\n"
+  "  proc write {handle buffer} { return $buffer }\n"
+  "  namespace export *\n"
+  "  namespace ensemble create\n"
+  "}\n";
+
+// Writes header and data to filename.  If stacked is true, the data
+// go through the Tcl channel path; otherwise through a plain file
+// channel.  Returns false on error.
+OC_BOOL WriteLargeFile(Tcl_Interp* interp,const char* filename,
+                       OC_BOOL stacked,const Vf_Ovf20FileHeader& header,
+                       Vf_OvfDataStyle datastyle,
+                       const std::vector<OC_REAL8m>& data)
+{
+  const Vf_Ovf20VecArrayConst data_info(3,big_xnodes*big_ynodes*big_znodes,
+                                        data.data());
+  if(!stacked) {
+    Nb_FileChannel channel(filename,"w");
+    header.WriteHeader(channel);
+    header.WriteData(channel,datastyle,"",0,data_info);
+    channel.Close();
+    return 1;
+  }
+  if(Tcl_SetVar(interp,"ovftest_file",filename,TCL_LEAVE_ERR_MSG)==NULL
+     || Tcl_Eval(interp,"set ovftest_chan [open $ovftest_file w];"
+                 " chan push $ovftest_chan ::ovftest_passthru;"
+                 " set ovftest_chan")!=TCL_OK) {
+    return 0;
+  }
+  int mode;
+  Tcl_Channel channel
+    = Tcl_GetChannel(interp,Tcl_GetStringResult(interp),&mode);
+  if(channel==NULL) return 0;
+  header.WriteHeader(channel);
+  header.WriteData(channel,datastyle,"",0,data_info);
+  return Tcl_Eval(interp,"close $ovftest_chan")==TCL_OK;
+}
+
+// Reads the contents of filename into bytes.  Returns false on error.
+OC_BOOL ReadFileBytes(const char* filename,std::vector<char>& bytes)
+{
+  bytes.clear();
+  FILE* fptr = fopen(filename,"rb");
+  if(fptr==nullptr) return 0;
+  char buf[65536];
+  size_t count;
+  while((count=fread(buf,1,sizeof(buf),fptr))>0) {
+    bytes.insert(bytes.end(),buf,buf+count);
+  }
+  const OC_BOOL ok = !ferror(fptr);
+  fclose(fptr);
+  return ok;
+}
+
+void TestLargeFile(Tcl_Interp* interp,const char* directname,
+                   const char* stackedname,Vf_OvfFileVersion version,
+                   Vf_OvfDataStyle datastyle,
+                   const std::vector<OC_REAL8m>& data,const char* format)
+{
+  Vf_Ovf20FileHeader header;
+  if(!SetupHeader(header,big_xnodes,big_ynodes,big_znodes,version)) {
+    Check(false,format,"invalid test file header");
+    return;
+  }
+  Check(WriteLargeFile(interp,directname,0,header,datastyle,data),
+        format,"direct write");
+  if(!WriteLargeFile(interp,stackedname,1,header,datastyle,data)) {
+    Check(false,format,Tcl_GetStringResult(interp));
+    return;
+  }
+
+  std::vector<char> directbytes, stackedbytes;
+  Check(ReadFileBytes(directname,directbytes)
+        && ReadFileBytes(stackedname,stackedbytes),
+        format,"reading back file bytes");
+  const size_t datasize = size_t(3*big_xnodes*big_ynodes*big_znodes)
+    *(datastyle==vf_obin4 ? 4 : 8);
+  Check(directbytes.size()>datasize,format,"file size");
+  Check(directbytes==stackedbytes,format,
+        "direct and Tcl channel output differ");
+
+  Vf_GridVec3f* grid
+    = ReadTestFile(directname,format,big_xnodes,big_ynodes,big_znodes);
+  if(grid==nullptr) return;
+  Check(CheckTestValues(grid,datastyle,big_xnodes,big_ynodes,big_znodes),
+        format,"node values");
+  delete grid;
+}
+
+void RunTests(Tcl_Interp* interp)
+{
+  Nb_DString filename = Nb_TempName("ovftest",".ovf");
+  TestRoundTrip(filename.GetStr(),vf_obin8,"","binary 8");
+  TestRoundTrip(filename.GetStr(),vf_obin4,"","binary 4");
+  TestRoundTrip(filename.GetStr(),vf_oascii,"%.17g","text");
+  remove(filename.GetStr());
+
+  // Several threads, so that each block is converted in parallel.
+  Oc_SetMaxThreadCount(4);
+  if(Tcl_Eval(interp,passthru_script)!=TCL_OK) {
+    Check(false,"large",Tcl_GetStringResult(interp));
+    return;
+  }
+  Nb_DString directname = Nb_TempName("ovftest",".ovf");
+  Nb_DString stackedname = Nb_TempName("ovftest",".ovf");
+  std::vector<OC_REAL8m> data;
+  FillTestData(data,big_xnodes,big_ynodes,big_znodes,0.0);
+  TestLargeFile(interp,directname.GetStr(),stackedname.GetStr(),
+                vf_ovf_20,vf_obin8,data,"large OVF 2.0 binary 8");
+  TestLargeFile(interp,directname.GetStr(),stackedname.GetStr(),
+                vf_ovf_20,vf_obin4,data,"large OVF 2.0 binary 4");
+  TestLargeFile(interp,directname.GetStr(),stackedname.GetStr(),
+                vf_ovf_10,vf_obin8,data,"large OVF 1.0 binary 8");
+  TestLargeFile(interp,directname.GetStr(),stackedname.GetStr(),
+                vf_ovf_10,vf_obin4,data,"large OVF 1.0 binary 4");
+  remove(directname.GetStr());
+  remove(stackedname.GetStr());
+}
+
+} // namespace
+
+int Oc_AppMain(int,char** argv)
+{
+  Tcl_FindExecutable(argv[0]);
+  Tcl_Interp* interp = Tcl_CreateInterp();
+  Oc_SetDefaultTkFlag(0);
+  if(Oc_Init(interp) != TCL_OK || Nb_Init(interp) != TCL_OK
+     || Vf_Init(interp) != TCL_OK) {
+    fprintf(stderr,"ovftest FAILED: initialization: %s\n",
+            Tcl_GetStringResult(interp));
+    return 1;
+  }
+  try {
+    RunTests(interp);
+  } catch(...) {
+    fprintf(stderr,"ovftest FAILED: uncaught exception\n");
+    return 1;
+  }
+  if(error_count>0) return 1;
+  printf("ovftest: all tests passed\n");
+  return 0;
+}
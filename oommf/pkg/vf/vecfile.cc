@@ -10,7 +10,9 @@
 #include <cctype>
 #include <climits>
 #include <cstdio>
+#include <cstdint>
 #include <cstring>
+#include <thread>
 
 #include "oc.h"
 #include "nb.h"
@@ -18,6 +20,15 @@
 #include "fileio.h"  // Obsoleted *.vio input
 #include "vecfile.h"
 
+#if (OC_SYSTEM_TYPE == OC_UNIX) || (OC_SYSTEM_TYPE == OC_DARWIN)
+// Low level file I/O, used for binary data block transfers.
+# include <cerrno>
+# include <unistd.h>
+# define VF_DIRECT_FILE_IO 1
+#else
+# define VF_DIRECT_FILE_IO 0
+#endif
+
 /* End includes */     // This is an optional directive to build.tcl,
                        // that excludes the remainder of the file from
                        // '#include ".*"' dependency building
@@ -435,6 +446,470 @@ OC_INT4m Vf_OvfFileFormatSpecs::WriteBinary(Tcl_Channel channel,OC_REAL8 *buf,
   return 0;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Blocked binary data transfer.
+//
+// The binary data sections of OVF files are moved between memory and
+// disk in large blocks.  Each block is split into node ranges that are
+// converted and byte swapped in parallel (up to Oc_GetMaxThreadCount()
+// threads), and the block is then read or written with a single large
+// transfer.  If the channel is a plain file, the transfer bypasses the
+// Tcl channel buffers and goes directly to the file descriptor via
+// pread/pwrite.  The byte stream on disk is the same as that produced
+// by node-at-a-time transfers.
+
+// Target size, in bytes, of each block transfer.
+static const OC_INDEX vf_binary_blocksize = 16*1024*1024;
+
+// Minimum number of nodes handed to a conversion thread.  Smaller
+// ranges aren't worth the thread launch overhead.
+static const OC_INDEX vf_binary_minrange = 32*1024;
+
+// Calls func(start,stop) on a partition of [0,count).  The first range
+// runs on the calling thread.  func must not throw.
+template<typename Func>
+static void VfParallelRange(OC_INDEX count,Func func)
+{
+  OC_INDEX threadcount = Oc_GetMaxThreadCount();
+  if(count/vf_binary_minrange < threadcount) {
+    threadcount = count/vf_binary_minrange;
+  }
+  if(threadcount<2) {
+    if(count>0) func(OC_INDEX(0),count);
+    return;
+  }
+#if OOMMF_THREADS
+  const OC_INDEX rangesize = (count + threadcount - 1)/threadcount;
+  std::vector<std::thread> workers;
+  OC_INDEX start = rangesize;
+  try {
+    // Reserve up front, so that a failed emplace_back can't reallocate
+    // (and so destroy) thread objects that are already running.
+    workers.reserve(size_t(threadcount-1));
+    for(;start<count;start+=rangesize) {
+      const OC_INDEX stop = (count-start<rangesize ? count : start+rangesize);
+      workers.emplace_back(func,start,stop);
+    }
+  } catch(...) {
+    // Thread launch failure; do remaining work on this thread.
+    for(;start<count;start+=rangesize) {
+      func(start,(count-start<rangesize ? count : start+rangesize));
+    }
+  }
+  func(OC_INDEX(0),rangesize);
+  for(auto& worker : workers) worker.join();
+#endif // OOMMF_THREADS
+}
+
+// Returns true if binary data written to disk in byte order indicated
+// by file_is_lsb needs byte swapping on this machine.
+static inline OC_BOOL VfBinarySwapNeeded(OC_BOOL file_is_lsb)
+{
+#if (OC_BYTEORDER != 4321)  // Machine is MSB
+  return file_is_lsb;
+#else                       // Machine is LSB
+  return !file_is_lsb;
+#endif
+}
+
+static inline void VfSwapWords(OC_REAL4* buf,OC_INDEX count)
+{
+  Oc_SwapWords4(buf,count);
+}
+
+static inline void VfSwapWords(OC_REAL8* buf,OC_INDEX count)
+{
+  Oc_SwapWords8(buf,count);
+}
+
+#if VF_DIRECT_FILE_IO
+// If chan is an unstacked channel onto a plain file, with settings that
+// make Tcl_Read/Tcl_Write pass bytes through unchanged, then fills fd
+// with the underlying file descriptor and returns true.  Otherwise
+// returns false.
+static OC_BOOL VfChannelFileDescriptor(Tcl_Channel chan,int direction,
+                                       int& fd)
+{
+  // Channel handles from Tcl_GetChannel refer to the bottom of the
+  // stack, so check the top as well as the channel below.
+  if(Tcl_GetTopChannel(chan) != chan
+     || Tcl_GetStackedChannel(chan) != NULL) return 0;
+  const Tcl_ChannelType* type = Tcl_GetChannelType(chan);
+  if(type == NULL || strcmp(Tcl_ChannelName(type),"file")!=0) return 0;
+
+  // Check that no end-of-line translation or end-of-file character
+  // is in effect.  (Tcl_Read and Tcl_Write don't do encoding
+  // conversion, so the -encoding setting doesn't matter.)
+  OC_BOOL passthru = 1;
+  const char* checkopts[] = { "-translation", "-eofchar" };
+  const char* passvals[]  = { "lf", "" };
+  for(int iopt=0; passthru && iopt<2; ++iopt) {
+    Tcl_DString optval;
+    Tcl_DStringInit(&optval);
+    if(Tcl_GetChannelOption(NULL,chan,checkopts[iopt],&optval)!=TCL_OK) {
+      passthru = 0;
+    } else {
+      int argc;
+      const char** argv;
+      if(Tcl_SplitList(NULL,Tcl_DStringValue(&optval),&argc,&argv)
+         != TCL_OK) {
+        passthru = 0;
+      } else {
+        for(int i=0;i<argc;++i) {
+          if(strcmp(argv[i],passvals[iopt])!=0) passthru = 0;
+        }
+        Tcl_Free(reinterpret_cast<char*>(argv));
+      }
+    }
+    Tcl_DStringFree(&optval);
+  }
+  if(!passthru) return 0;
+
+  ClientData handle;
+  if(Tcl_GetChannelHandle(chan,direction,&handle)!=TCL_OK) return 0;
+  fd = static_cast<int>(reinterpret_cast<intptr_t>(handle));
+  return 1;
+}
+#endif // VF_DIRECT_FILE_IO
+
+// Writes bytecount bytes from buf to chan.  Throws an Oc_Exception
+// on error.
+static void VfWriteBinaryBlock(Tcl_Channel chan,const char* buf,
+                               OC_INDEX bytecount)
+{
+#if VF_DIRECT_FILE_IO
+  int fd;
+  if(VfChannelFileDescriptor(chan,TCL_WRITABLE,fd)) {
+    Tcl_WideInt offset = -1;
+    if(Tcl_Flush(chan) == TCL_OK) offset = Tcl_Tell(chan);
+    if(offset>=0) {
+      OC_INDEX done = 0;
+      while(done<bytecount) {
+        ssize_t result = pwrite(fd,buf+done,size_t(bytecount-done),
+                                off_t(offset+done));
+        if(result<0 && errno == EINTR) continue;
+        if(result<=0) {
+          OC_THROW(Oc_Exception(__FILE__,__LINE__,NULL,
+                                "VfWriteBinaryBlock",1024,
+                                "Write error: %.900s",
+                                (result<0 ? strerror(errno)
+                                 : "device full?")));
+        }
+        done += static_cast<OC_INDEX>(result);
+      }
+      if(Tcl_Seek(chan,offset+bytecount,SEEK_SET)<0) {
+        OC_THROW(Oc_Exception(__FILE__,__LINE__,NULL,
+                              "VfWriteBinaryBlock",
+                              "Seek error following write."));
+      }
+      return;
+    }
+  }
+#endif // VF_DIRECT_FILE_IO
+  if(Nb_WriteChannel(chan,buf,bytecount) != bytecount) {
+    OC_THROW(Oc_Exception(__FILE__,__LINE__,NULL,
+                          "VfWriteBinaryBlock",
+                          "Write error (device full?)"));
+  }
+}
+
+// Reads bytecount bytes from chan into buf.  Returns 0 on success,
+// 1 on premature end-of-file or other read error.
+static OC_INT4m VfReadBinaryBlock(Tcl_Channel chan,char* buf,
+                                  OC_INDEX bytecount)
+{
+#if VF_DIRECT_FILE_IO
+  int fd;
+  if(VfChannelFileDescriptor(chan,TCL_READABLE,fd)) {
+    // Tcl_Tell accounts for data already in the channel input buffer.
+    const Tcl_WideInt offset = Tcl_Tell(chan);
+    if(offset>=0) {
+      OC_INDEX done = 0;
+      while(done<bytecount) {
+        ssize_t result = pread(fd,buf+done,size_t(bytecount-done),
+                               off_t(offset+done));
+        if(result<0 && errno == EINTR) continue;
+        if(result<=0) return 1;
+        done += static_cast<OC_INDEX>(result);
+      }
+      // Reposition channel past block.  This also discards buffered
+      // input.
+      if(Tcl_Seek(chan,offset+bytecount,SEEK_SET)<0) return 1;
+      return 0;
+    }
+  }
+#endif // VF_DIRECT_FILE_IO
+  while(bytecount>0) {
+    int attempt_size = INT_MAX;
+    if(bytecount < OC_INDEX(attempt_size)) {
+      attempt_size = static_cast<int>(bytecount);
+    }
+    if(Tcl_Read(chan,buf,attempt_size) != attempt_size) return 1;
+    buf += attempt_size;
+    bytecount -= attempt_size;
+  }
+  return 0;
+}
+
+// Converts the node-interleaved contents of data_array to REALOUT
+// values in file byte order and writes them to chan.  If mesh is
+// non-NULL then the (x,y,z) cell center is written ahead of the data
+// for each node (irregular mesh format).
+template<typename REALOUT>
+static void VfWriteBinaryData
+(Tcl_Channel chan,
+ const vector<Vf_Ovf20VecArrayConst>& data_array,
+ OC_INDEX nodecount,
+ const Vf_Ovf20_MeshNodes* mesh,
+ OC_BOOL swap)
+{
+  const OC_INDEX data_array_count = static_cast<OC_INDEX>(data_array.size());
+  OC_INDEX veclen = 0;
+  for(OC_INDEX ida=0;ida<data_array_count;++ida) {
+    veclen += data_array[ida].vector_dimension;
+  }
+  const OC_INDEX reclen = veclen + (mesh != NULL ? 3 : 0);
+
+  if(!swap && mesh == NULL && data_array_count == 1
+     && sizeof(REALOUT) == sizeof(OC_REAL8m)) {
+    // Memory layout matches file layout; write directly from data.
+    VfWriteBinaryBlock(chan,
+                       reinterpret_cast<const char*>(data_array[0].data),
+                       nodecount*reclen*OC_INDEX(sizeof(REALOUT)));
+    return;
+  }
+
+  OC_INDEX blocknodes
+    = vf_binary_blocksize/(reclen*OC_INDEX(sizeof(REALOUT)));
+  if(blocknodes<1) blocknodes = 1;
+  if(blocknodes>nodecount) blocknodes = nodecount;
+  std::vector<REALOUT> buf(size_t(blocknodes*reclen));
+  REALOUT* const dbuf = buf.data();
+
+  for(OC_INDEX node=0;node<nodecount;node+=blocknodes) {
+    const OC_INDEX record_count
+      = (nodecount-node<blocknodes ? nodecount-node : blocknodes);
+    auto convert = [&](OC_INDEX jstart,OC_INDEX jstop) {
+      REALOUT* dout = dbuf + jstart*reclen;
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(mesh != NULL) {
+          OC_REAL8m x,y,z;
+          mesh->GetCellCenter(node+j,x,y,z);
+          *(dout++) = static_cast<REALOUT>(x);
+          *(dout++) = static_cast<REALOUT>(y);
+          *(dout++) = static_cast<REALOUT>(z);
+        }
+        for(OC_INDEX ida=0;ida<data_array_count;++ida) {
+          const OC_INDEX ddim = data_array[ida].vector_dimension;
+          const OC_REAL8m* din = data_array[ida].data + (node+j)*ddim;
+          for(OC_INDEX elt=0;elt<ddim;++elt) {
+            *(dout++) = static_cast<REALOUT>(din[elt]);
+          }
+        }
+      }
+      if(swap) {
+        VfSwapWords(dbuf + jstart*reclen,(jstop-jstart)*reclen);
+      }
+    };
+    if(mesh == NULL) {
+      VfParallelRange(record_count,convert);
+    } else {
+      // Vf_Ovf20_MeshNodes::GetCellCenter is not guaranteed to be
+      // thread safe.
+      convert(0,record_count);
+    }
+    VfWriteBinaryBlock(chan,reinterpret_cast<const char*>(dbuf),
+                      record_count*reclen*OC_INDEX(sizeof(REALOUT)));
+  }
+}
+
+// Reads REALIN values in file byte order from chan and interleaves
+// them into data_array.  If node_locations is non-NULL then each node
+// record in the file is prefixed with the (x,y,z) node location,
+// which is stored into node_locations.  Returns 0 on success, 1 on
+// premature end-of-file or other read error.
+template<typename REALIN>
+static OC_INT4m VfReadBinaryData
+(Tcl_Channel chan,
+ const vector<Vf_Ovf20VecArray>& data_array,
+ OC_INDEX nodecount,
+ const Vf_Ovf20VecArray* node_locations,
+ OC_BOOL swap)
+{
+  const OC_INDEX data_array_count = static_cast<OC_INDEX>(data_array.size());
+  OC_INDEX veclen = 0;
+  for(OC_INDEX ida=0;ida<data_array_count;++ida) {
+    veclen += data_array[ida].vector_dimension;
+  }
+  const OC_INDEX reclen = veclen + (node_locations != NULL ? 3 : 0);
+
+  if(!swap && node_locations == NULL && data_array_count == 1
+     && sizeof(REALIN) == sizeof(OC_REAL8m)) {
+    // Memory layout matches file layout; read directly into data.
+    return VfReadBinaryBlock(chan,
+                             reinterpret_cast<char*>(data_array[0].data),
+                             nodecount*reclen*OC_INDEX(sizeof(REALIN)));
+  }
+
+  OC_INDEX blocknodes
+    = vf_binary_blocksize/(reclen*OC_INDEX(sizeof(REALIN)));
+  if(blocknodes<1) blocknodes = 1;
+  if(blocknodes>nodecount) blocknodes = nodecount;
+  std::vector<REALIN> buf(size_t(blocknodes*reclen));
+  REALIN* const dbuf = buf.data();
+
+  for(OC_INDEX node=0;node<nodecount;node+=blocknodes) {
+    const OC_INDEX record_count
+      = (nodecount-node<blocknodes ? nodecount-node : blocknodes);
+    if(VfReadBinaryBlock(chan,reinterpret_cast<char*>(dbuf),
+                  record_count*reclen*OC_INDEX(sizeof(REALIN)))!=0) {
+      return 1;
+    }
+    VfParallelRange(record_count,[&](OC_INDEX jstart,OC_INDEX jstop) {
+      REALIN* din = dbuf + jstart*reclen;
+      if(swap) VfSwapWords(din,(jstop-jstart)*reclen);
+      for(OC_INDEX j=jstart;j<jstop;++j) {
+        if(node_locations != NULL) {
+          OC_REAL8m* loc = node_locations->data + 3*(node+j);
+          loc[0] = static_cast<OC_REAL8m>(*(din++));
+          loc[1] = static_cast<OC_REAL8m>(*(din++));
+          loc[2] = static_cast<OC_REAL8m>(*(din++));
+        }
+        for(OC_INDEX ida=0;ida<data_array_count;++ida) {
+          const OC_INDEX ddim = data_array[ida].vector_dimension;
+          OC_REAL8m* da = data_array[ida].data + (node+j)*ddim;
+          for(OC_INDEX elt=0;elt<ddim;++elt) {
+            da[elt] = static_cast<OC_REAL8m>(*(din++));
+          }
+        }
+      }
+    });
+  }
+  return 0;
+}
+
+// Reads a rectangular grid of binary REALIN records, each filevaldim
+// values long, from infile into grid.  The .x, .y, .z components of
+// each grid vector are filled from the first three values in the
+// record; shorter records are padded with zeros and values past the
+// third are skipped.  Vectors are scaled by norm, except for those
+// holding a non-finite value, which are stored as read.  On return
+// badindex holds the node index (i + xnodes*(j + ynodes*k)) of the
+// first non-finite vector, or -1 if none, and badvalue holds the
+// offending value.  If stop_on_bad is true then reading stops at the
+// end of the block containing the first bad vector.  Returns 0 on
+// success, 1 on premature end-of-file or other read error.
+template<typename REALIN>
+static OC_INT4m VfReadBinaryGrid
+(FILE* infile,
+ Vf_GridVec3f& grid,
+ OC_INDEX xnodes,OC_INDEX ynodes,OC_INDEX znodes,
+ OC_INDEX filevaldim,
+ OC_BOOL swap,
+ double norm,
+ OC_BOOL stop_on_bad,
+ OC_INDEX& badindex,
+ OC_REAL8m& badvalue)
+{
+  const OC_INDEX nodecount = xnodes*ynodes*znodes;
+  const OC_INDEX reclen = filevaldim;
+  const OC_INDEX usecount = (reclen<3 ? reclen : 3);
+  badindex = -1;
+  badvalue = 0.0;
+  if(nodecount<1 || reclen<1) return 0;
+
+  OC_INDEX blocknodes
+    = vf_binary_blocksize/(reclen*OC_INDEX(sizeof(REALIN)));
+  if(blocknodes<1) blocknodes = 1;
+  if(blocknodes>nodecount) blocknodes = nodecount;
+  std::vector<REALIN> buf(size_t(blocknodes*reclen));
+  REALIN* const dbuf = buf.data();
+  Oc_Mutex badmutex;
+
+  for(OC_INDEX node=0;node<nodecount;node+=blocknodes) {
+    const OC_INDEX record_count
+      = (nodecount-node<blocknodes ? nodecount-node : blocknodes);
+    const size_t wordcount = size_t(record_count*reclen);
+    if(fread(dbuf,sizeof(REALIN),wordcount,infile) != wordcount) {
+      return 1;
+    }
+    VfParallelRange(record_count,[&](OC_INDEX jstart,OC_INDEX jstop) {
+      if(swap) VfSwapWords(dbuf + jstart*reclen,(jstop-jstart)*reclen);
+      OC_INDEX i = (node+jstart) % xnodes;
+      OC_INDEX j = ((node+jstart) / xnodes) % ynodes;
+      OC_INDEX k = (node+jstart) / (xnodes*ynodes);
+      for(OC_INDEX n=jstart;n<jstop;++n) {
+        const REALIN* din = dbuf + n*reclen;
+        REALIN val[3] = { REALIN(0), REALIN(0), REALIN(0) };
+        OC_INDEX ibad = -1;
+        for(OC_INDEX m=0;m<usecount;++m) {
+          val[m] = din[m];
+          if(ibad<0 && !Nb_IsFinite(val[m])) ibad = m;
+        }
+        Nb_Vec3<OC_REAL8> data(static_cast<OC_REAL8>(val[0]),
+                               static_cast<OC_REAL8>(val[1]),
+                               static_cast<OC_REAL8>(val[2]));
+        if(ibad<0) {
+          data *= norm;
+        } else {
+          Oc_LockGuard lck(badmutex);
+          if(badindex<0 || node+n<badindex) {
+            badindex = node+n;
+            badvalue = static_cast<OC_REAL8m>(val[ibad]);
+          }
+        }
+        grid(i,j,k) = data;
+        if(++i == xnodes) {
+          i = 0;
+          if(++j == ynodes) { j = 0; ++k; }
+        }
+      }
+    });
+    if(stop_on_bad && badindex>=0) break;
+  }
+  return 0;
+}
+
+// Reads a rectangular grid of binary OC_REAL8 three-vectors, in native
+// byte order and with no scaling, from infile directly into the node
+// storage of grid.  This is the layout of Vf_GridVec3f storage, so no
+// intermediate buffer or conversion pass is needed.  The data are
+// copied, so the grid doesn't depend on the file after return.
+// Arguments and return value are as for VfReadBinaryGrid, except that
+// reading does not stop early on bad data.
+static OC_INT4m VfReadNativeGrid
+(FILE* infile,
+ Vf_GridVec3f& grid,
+ OC_INDEX xnodes,OC_INDEX ynodes,OC_INDEX znodes,
+ OC_INDEX& badindex,
+ OC_REAL8m& badvalue)
+{
+  const OC_INDEX nodecount = xnodes*ynodes*znodes;
+  badindex = -1;
+  badvalue = 0.0;
+  if(nodecount<1) return 0;
+  Nb_Vec3<OC_REAL8>* const data = &grid(0,0,0); // Contiguous, i fastest
+  if(fread(data,sizeof(Nb_Vec3<OC_REAL8>),size_t(nodecount),infile)
+     != size_t(nodecount)) {
+    return 1;
+  }
+  Oc_Mutex badmutex;
+  VfParallelRange(nodecount,[&](OC_INDEX start,OC_INDEX stop) {
+    for(OC_INDEX n=start;n<stop;++n) {
+      const Nb_Vec3<OC_REAL8>& v = data[n];
+      if(Nb_IsFinite(v.x) && Nb_IsFinite(v.y) && Nb_IsFinite(v.z)) continue;
+      Oc_LockGuard lck(badmutex);
+      if(badindex<0 || n<badindex) {
+        badindex = n;
+        badvalue = (!Nb_IsFinite(v.x) ? v.x
+                    : (!Nb_IsFinite(v.y) ? v.y : v.z));
+      }
+      break; // Later vectors in this range can't be first
+    }
+  });
+  return 0;
+}
+
 
 //////////////////////////////////////////////////////////////////////
 // Vf_OvfSegmentHeader
@@ -1548,8 +2023,67 @@ Vf_Mesh *Vf_OvfFileInput::NewMesh(int* baddata_status)
   /// Vf_Mesh value output in the same .x, .y, .z order, but set
   /// unfilled indexes to 0.0.  This too could be generalized, if
   /// desired.
-  if(ovfseghead.meshtype!=vf_oshmt_irregular) {
-    // Rectangular grid
+  if(ovfseghead.meshtype!=vf_oshmt_irregular
+     && (datastyle == vf_obin4 || datastyle == vf_obin8)) {
+    // Rectangular grid, binary data.  Read in large blocks and
+    // convert in parallel.  OVF 2.0 files are LSB, older formats MSB.
+    const OC_BOOL swap
+      = VfBinarySwapNeeded(ovfseghead.fileversion == vf_ovf_20);
+    OC_INDEX badindex;
+    OC_REAL8m baddata;
+    OC_INT4m readerr = 0;
+    if(datastyle == vf_obin8 && filevaldim == 3 && norm == 1.0 && !swap
+       && sizeof(Nb_Vec3<OC_REAL8>) == 3*sizeof(OC_REAL8)) {
+      // File layout matches node storage.
+      readerr = VfReadNativeGrid(infile,*mesh_rect,
+                       ovfseghead.xnodes,ovfseghead.ynodes,ovfseghead.znodes,
+                       badindex,baddata);
+    } else if(datastyle == vf_obin4) {
+      readerr = VfReadBinaryGrid<OC_REAL4>(infile,*mesh_rect,
+                       ovfseghead.xnodes,ovfseghead.ynodes,ovfseghead.znodes,
+                       filevaldim,swap,norm,(baddata_status==0),
+                       badindex,baddata);
+    } else {
+      readerr = VfReadBinaryGrid<OC_REAL8>(infile,*mesh_rect,
+                       ovfseghead.xnodes,ovfseghead.ynodes,ovfseghead.znodes,
+                       filevaldim,swap,norm,(baddata_status==0),
+                       badindex,baddata);
+    }
+    if(readerr) {
+      ClassMessage(STDDOC,"Premature EOF in file %s"
+                   " in data section",
+                   (const char *)filename);
+      delete mesh;
+      return new Vf_EmptyMesh();
+    }
+    if(badindex>=0) {
+      const OC_INDEX i = badindex % ovfseghead.xnodes;
+      const OC_INDEX j = (badindex / ovfseghead.xnodes) % ovfseghead.ynodes;
+      const OC_INDEX k = badindex / (ovfseghead.xnodes*ovfseghead.ynodes);
+      if(datastyle == vf_obin8) {
+        unsigned char* cptr=(unsigned char*)(&baddata);
+        fprintf(stderr,"Bad data at index (%ld,%ld,%ld)\n",
+                long(i),long(j),long(k));
+        fprintf(stderr,"   Bit pattern: "
+                "0x%02X%02X%02X%02X%02X%02X%02X%02X\n",
+                cptr[0],cptr[1],cptr[2],cptr[3],
+                cptr[4],cptr[5],cptr[6],cptr[7]);
+        fprintf(stderr,"      FP value: %g\n",
+                static_cast<double>(baddata));
+      }
+      ClassMessage(STDDOC,
+                   "Invalid floating point data detected"
+                   " in file %s, at index (%d,%d,%d)",
+                   (const char *)filename,int(i),int(j),int(k));
+      if(baddata_status==0) {
+        delete mesh;
+        return new Vf_EmptyMesh();
+      } else {
+        *baddata_status=1;
+      }
+    }
+  } else if(ovfseghead.meshtype!=vf_oshmt_irregular) {
+    // Rectangular grid, text data
     OC_INDEX i,j,k;
     Nb_Vec3<OC_REAL8> data;
     OC_REAL8m baddata; // For debugging
@@ -3612,186 +4146,57 @@ Vf_Ovf20FileHeader::ReadData
         }
       }
     }
-  } else if(datastyle == vf_obin4) {
-    // 4-byte binary output (little endian order) ////////////////////
-    OC_REAL4 check;
-    if(Tcl_Read(inchan,(char*)&check,sizeof(check))
-       < static_cast<int>(sizeof(check))) {
-      OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                            "Vf_Ovf20FileHeader","ReadData",
-                            "Premature end-of-file or other read error "
-                            "while reading 4-byte data check value."));
-    }
-    // OVF 1.0 uses MSB order, 2.0 uses LSB order
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-    if(ovfversion != vf_ovf_10) Oc_Flip4(&check);
-#else                       // Input is LSB
-    if(ovfversion == vf_ovf_10) Oc_Flip4(&check);
-#endif
-    if(!Vf_OvfFileFormatSpecs::CheckValue(check)) {
-      OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                            "Vf_Ovf20FileHeader","ReadData",
-                            "Invalid data block check value in input"
-                            " file; Wrong byte order?"));
-    }
-
-    const OC_INDEX stride = 1024; // Number of nodes blocked together for input
-    OC_INDEX record_count = stride;
-    const OC_INDEX reclen = veclen
-      + (input_meshtype == vf_ovf20mesh_irregular ? 3 : 0);
-    OC_INDEX inwords = reclen*stride;
-    OC_INDEX inbytes = inwords*OC_INDEX(sizeof(OC_REAL4));
-
-    Oc_AutoBuf workbuf; // Workspace.  Tweak to insure good alignment
-    workbuf.SetLength(inbytes+sizeof(OC_REAL4)-1 + 10000);
-    char* foo_align = workbuf.GetStr();
-    int foo_offset = static_cast<int>((foo_align-(char*)0)% sizeof(OC_REAL4));
-    if(foo_offset>0) foo_align += sizeof(OC_REAL4) - foo_offset;
-    OC_REAL4* const d4buf = reinterpret_cast<OC_REAL4*>(foo_align);
-
-    for(OC_INDEX node=0;node<nodecount;node+=stride) {
-      if(node+stride>nodecount) {
-        record_count = nodecount-node;
-        inwords = reclen * record_count;
-        inbytes = inwords * OC_INDEX(sizeof(OC_REAL4));
-      }
-      if(inbytes>INT_MAX) {
+  } else if(datastyle == vf_obin4 || datastyle == vf_obin8) {
+    // Binary input.  OVF 1.0 uses MSB order, 2.0 uses LSB order.
+    const OC_BOOL swap = VfBinarySwapNeeded(ovfversion != vf_ovf_10);
+    const Vf_Ovf20VecArray* locations
+      = (input_meshtype == vf_ovf20mesh_irregular ? node_locations : NULL);
+    OC_BOOL checkok = 0;
+    OC_INT4m readerr = 0;
+    if(datastyle == vf_obin4) {
+      // 4-byte binary input ////////////////////////////////////////
+      OC_REAL4 check;
+      if(Tcl_Read(inchan,(char*)&check,sizeof(check))
+         < static_cast<int>(sizeof(check))) {
         OC_THROW(Oc_Exception(__FILE__,__LINE__,
                               "Vf_Ovf20FileHeader","ReadData",
-                              "Data (d4buf) read length request too big"
-                              " for Tcl_Read."));
+                              "Premature end-of-file or other read error "
+                              "while reading 4-byte data check value."));
       }
-      if(Tcl_Read(inchan,(char*)d4buf,static_cast<int>(inbytes))<inbytes) {
+      if(swap) Oc_Flip4(&check);
+      checkok = Vf_OvfFileFormatSpecs::CheckValue(check);
+      if(checkok) {
+        readerr = VfReadBinaryData<OC_REAL4>(inchan,data_array,nodecount,
+                                             locations,swap);
+      }
+    } else {
+      // 8-byte binary input ////////////////////////////////////////
+      OC_REAL8 check;
+      if(Tcl_Read(inchan,(char*)&check,sizeof(check))
+         < static_cast<int>(sizeof(check))) {
         OC_THROW(Oc_Exception(__FILE__,__LINE__,
                               "Vf_Ovf20FileHeader","ReadData",
                               "Premature end-of-file or other read error "
-                              "while reading data block."));
+                              "while reading 8-byte data check value."));
       }
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_SwapWords4(d4buf,inwords);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_SwapWords4(d4buf,inwords);
-#endif
-
-      if(input_meshtype == vf_ovf20mesh_irregular) {
-        OC_REAL4* din = d4buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          node_locations->data[3*(node+j)]   = static_cast<OC_REAL8m>(*(++din));
-          node_locations->data[3*(node+j)+1] = static_cast<OC_REAL8m>(*(++din));
-          node_locations->data[3*(node+j)+2] = static_cast<OC_REAL8m>(*(++din));
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            OC_REAL8m* da = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              da[elt] = static_cast<OC_REAL8m>(*(++din));
-            }
-          }
-        }
-      } else {
-        OC_REAL4* din = d4buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            OC_REAL8m* da = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              da[elt] = static_cast<OC_REAL8m>(*(++din));
-            }
-          }
-        }
+      if(swap) Oc_Flip8(&check);
+      checkok = Vf_OvfFileFormatSpecs::CheckValue(check);
+      if(checkok) {
+        readerr = VfReadBinaryData<OC_REAL8>(inchan,data_array,nodecount,
+                                             locations,swap);
       }
     }
-  } else if(datastyle == vf_obin8) {
-    // 8-byte binary output (little endian order) ////////////////////
-    // NOTE: An optimization is possible here for the case where
-    // data_array_dimension == 1 and OC_REAL8m == OC_REAL8 --- the
-    // data could be read directly into data_array[0] without using
-    // using an intermediate buffer.  We don't mess with that now,
-    // but may add it in the future.
-    OC_REAL8 check;
-    if(Tcl_Read(inchan,(char*)&check,sizeof(check))
-       < static_cast<int>(sizeof(check))) {
-      OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                            "Vf_Ovf20FileHeader","ReadData",
-                            "Premature end-of-file or other read error "
-                            "while reading 8-byte data check value."));
-    }
-    // OVF 1.0 uses MSB order, 2.0 uses LSB order
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-    if(ovfversion != vf_ovf_10) Oc_Flip8(&check);
-#else                       // Input is LSB
-    if(ovfversion == vf_ovf_10) Oc_Flip8(&check);
-#endif
-    if(!Vf_OvfFileFormatSpecs::CheckValue(check)) {
+    if(!checkok) {
       OC_THROW(Oc_Exception(__FILE__,__LINE__,
                             "Vf_Ovf20FileHeader","ReadData",
                             "Invalid data block check value in input"
                             " file; Wrong byte order?"));
     }
-
-    const OC_INDEX stride = 1024; // Number of nodes blocked together for input
-    OC_INDEX record_count = stride;
-    const OC_INDEX reclen = veclen
-      + (input_meshtype == vf_ovf20mesh_irregular ? 3 : 0);
-    OC_INDEX inwords = reclen*stride;
-    OC_INDEX inbytes = inwords*OC_INDEX(sizeof(OC_REAL8));
-
-    Oc_AutoBuf workbuf; // Workspace.  Tweak to insure good alignment
-    workbuf.SetLength(inbytes+sizeof(OC_REAL8)-1 + 10000);
-    char* foo_align = workbuf.GetStr();
-    int foo_offset = static_cast<int>((foo_align-(char*)0)% sizeof(OC_REAL8));
-    if(foo_offset>0) foo_align += sizeof(OC_REAL8) - foo_offset;
-    OC_REAL8* const d8buf = reinterpret_cast<OC_REAL8*>(foo_align);
-
-    for(OC_INDEX node=0;node<nodecount;node+=stride) {
-      if(node+stride>nodecount) {
-        record_count = nodecount-node;
-        inwords = reclen * record_count;
-        inbytes = inwords * OC_INDEX(sizeof(OC_REAL8));
-      }
-      if(inbytes>INT_MAX) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","ReadData",
-                              "Data (d8buf) read length request too big"
-                              " for Tcl_Read."));
-      }
-      if(Tcl_Read(inchan,(char*)d8buf,static_cast<int>(inbytes))<inbytes) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","ReadData",
-                              "Premature end-of-file or other read error "
-                              "while reading data block."));
-      }
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_SwapWords8(d8buf,inwords);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_SwapWords8(d8buf,inwords);
-#endif
-
-      if(input_meshtype == vf_ovf20mesh_irregular) {
-        OC_REAL8* din = d8buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          node_locations->data[3*(node+j)]   = static_cast<OC_REAL8m>(*(++din));
-          node_locations->data[3*(node+j)+1] = static_cast<OC_REAL8m>(*(++din));
-          node_locations->data[3*(node+j)+2] = static_cast<OC_REAL8m>(*(++din));
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            OC_REAL8m* da = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              da[elt] = static_cast<OC_REAL8m>(*(++din));
-            }
-          }
-        }
-      } else {
-        OC_REAL8* din = d8buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            OC_REAL8m* da = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              da[elt] = static_cast<OC_REAL8m>(*(++din));
-            }
-          }
-        }
-      }
+    if(readerr) {
+      OC_THROW(Oc_Exception(__FILE__,__LINE__,
+                            "Vf_Ovf20FileHeader","ReadData",
+                            "Premature end-of-file or other read error "
+                            "while reading data block."));
     }
   }
 
@@ -4064,180 +4469,48 @@ Vf_Ovf20FileHeader::WriteData
     if(!bare) {
       Nb_FprintfChannel(outchan, NULL, 1024, "# End: Data Text\n");
     }
-  } else if(datastyle == vf_obin4) {
-    // 4-byte binary output (little endian order) ////////////////////
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 4\n");
-      OC_REAL4 check;
-      Vf_OvfFileFormatSpecs::GetCheckValue(check);
-
-      // OVF 1.0 uses MSB order, 2.0 uses LSB order
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_Flip4(&check);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_Flip4(&check);
-#endif
-      if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
-                         sizeof(check)) != sizeof(check)) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
-      }
-    }
-
-    const OC_INDEX stride = 1024; // Number of nodes blocked together for output
-    OC_INDEX record_count = stride;
-    const OC_INDEX reclen = veclen
-      + (output_meshtype == vf_ovf20mesh_irregular ? 3 : 0);
-    OC_INDEX outwords = reclen*stride;
-    OC_INDEX outbytes = outwords*OC_INDEX(sizeof(OC_REAL4));
-
-    Oc_AutoBuf workbuf; // Workspace.  Tweak to insure good alignment
-    workbuf.SetLength(outbytes+sizeof(OC_REAL4)-1 + 10000);
-    char* foo_align = workbuf.GetStr();
-    int foo_offset = static_cast<int>((foo_align-(char*)0)% sizeof(OC_REAL4));
-    if(foo_offset>0) foo_align += sizeof(OC_REAL4) - foo_offset;
-    OC_REAL4* const d4buf = reinterpret_cast<OC_REAL4*>(foo_align);
-
-    const OC_REAL8m* d8ptr = data;
-    for(OC_INDEX node=0;node<nodecount;node+=stride) {
-      if(node+stride>nodecount) {
-        record_count = nodecount-node;
-        outwords = reclen * record_count;
-        outbytes = outwords * OC_INDEX(sizeof(OC_REAL4));
-      }
-
-      if(output_meshtype == vf_ovf20mesh_irregular) {
-        for(OC_INDEX j=0;j<record_count;++j) {
-          OC_REAL8m x,y,z;
-          mesh->GetCellCenter(static_cast<OC_INDEX>(node+j),x,y,z);
-          d4buf[j*reclen]   = static_cast<OC_REAL4>(x);
-          d4buf[j*reclen+1] = static_cast<OC_REAL4>(y);
-          d4buf[j*reclen+2] = static_cast<OC_REAL4>(z);
-          for(OC_INDEX k=0;k<veclen;++k) {
-            d4buf[j*reclen+3+k] = static_cast<OC_REAL4>(d8ptr[j*veclen+k]);
-          }
-        }
-      } else {
-        for(OC_INDEX j=0;j<outwords;++j) {
-          d4buf[j] = static_cast<OC_REAL4>(d8ptr[j]);
-        }
-      }
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_SwapWords4(d4buf,outwords);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_SwapWords4(d4buf,outwords);
-#endif
-      if(Nb_WriteChannel(outchan,reinterpret_cast<char*>(d4buf),
-                         outbytes)!= outbytes) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
-      }
-      d8ptr += veclen*record_count;
-    }
-
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 4\n");
-    }
-
-  } else if(datastyle == vf_obin8) {
-    // 8-byte binary output (little endian order) ////////////////////
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 8\n");
-      OC_REAL8 check;
-      Vf_OvfFileFormatSpecs::GetCheckValue(check);
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_Flip8(&check);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_Flip8(&check);
-#endif
-
-      if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
-                         sizeof(check)) != sizeof(check)) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
-      }
-    }
-
-    const OC_INDEX stride = 1024; // Number of nodes blocked together for output
-    OC_INDEX record_count = stride;
-    const OC_INDEX reclen = veclen
-      + (output_meshtype == vf_ovf20mesh_irregular ? 3 : 0);
-    OC_INDEX outwords = reclen*stride;
-    OC_INDEX outbytes = outwords*OC_INDEX(sizeof(OC_REAL8));
-
-#if (OC_BYTEORDER == 4321)  // Input is LSB; flip may not be required
-    if(output_meshtype != vf_ovf20mesh_irregular
-       && sizeof(OC_REAL8m) == sizeof(OC_REAL8)
-       && ovfversion != vf_ovf_10) {
-      // We can do a direct dump from input data buffer
-      const char *cptr=reinterpret_cast<const char *>(data);
-      for(OC_INDEX node=0;node<nodecount;node+=stride) {
-        if(node+stride>nodecount) {
-          outbytes = reclen * (nodecount-node) * OC_INDEX(sizeof(OC_REAL8));
-        }
-        if(Nb_WriteChannel(outchan,cptr,outbytes) != outbytes) {
+  } else if(datastyle == vf_obin4 || datastyle == vf_obin8) {
+    // Binary output.  OVF 1.0 uses MSB order, 2.0 uses LSB order.
+    const OC_BOOL swap = VfBinarySwapNeeded(ovfversion != vf_ovf_10);
+    const Vf_Ovf20_MeshNodes* locmesh
+      = (output_meshtype == vf_ovf20mesh_irregular ? mesh : NULL);
+    const vector<Vf_Ovf20VecArrayConst> data_array(1,data_info);
+    if(datastyle == vf_obin4) {
+      // 4-byte binary output ///////////////////////////////////////
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 4\n");
+        OC_REAL4 check;
+        Vf_OvfFileFormatSpecs::GetCheckValue(check);
+        if(swap) Oc_Flip4(&check);
+        if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
+                           sizeof(check)) != sizeof(check)) {
           OC_THROW(Oc_Exception(__FILE__,__LINE__,
                                 "Vf_Ovf20FileHeader","WriteData",
                                 "Write error (device full?)"));
         }
-        cptr += outbytes;
       }
-
+      VfWriteBinaryData<OC_REAL4>(outchan,data_array,nodecount,locmesh,swap);
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 4\n");
+      }
     } else {
-#endif // OC_BYTEORDER
-      // Otherwise we must copy input data buffer into an intermediate
-      // buffer before we can write it.
-      Oc_AutoBuf workbuf; // Workspace.  Tweak to insure good alignment
-      workbuf.SetLength(outbytes+sizeof(OC_REAL8)-1);
-      char* foo_align = workbuf.GetStr();
-      int foo_offset = static_cast<int>((foo_align-(char*)0) % sizeof(OC_REAL8));
-      if(foo_offset>0) foo_align += sizeof(OC_REAL8) - foo_offset;
-      OC_REAL8* const dout = reinterpret_cast<OC_REAL8*>(foo_align);
-      const OC_REAL8m* din = data;
-      for(OC_INDEX node=0;node<nodecount;node+=stride) {
-        if(node+stride>nodecount) {
-          record_count = nodecount-node;
-          outwords = reclen * record_count;
-          outbytes = outwords * OC_INDEX(sizeof(OC_REAL8));
-        }
-
-        if(output_meshtype == vf_ovf20mesh_irregular) {
-          for(OC_INDEX j=0;j<record_count;++j) {
-            OC_REAL8m x,y,z;
-            mesh->GetCellCenter(static_cast<OC_INDEX>(node+j),x,y,z);
-            dout[j*reclen]   = static_cast<OC_REAL8>(x);
-            dout[j*reclen+1] = static_cast<OC_REAL8>(y);
-            dout[j*reclen+2] = static_cast<OC_REAL8>(z);
-            for(OC_INDEX k=0;k<veclen;++k) {
-              dout[j*reclen+3+k] = static_cast<OC_REAL8>(din[j*veclen+k]);
-            }
-          }
-        } else {
-          for(OC_INDEX j=0;j<outwords;++j) {
-            dout[j] = static_cast<OC_REAL8>(din[j]);
-          }
-        }
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-        if(ovfversion != vf_ovf_10) Oc_SwapWords8(dout,outwords);
-#else                    // Input is LSB
-        if(ovfversion == vf_ovf_10) Oc_SwapWords8(dout,outwords);
-#endif
-        if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(dout),
-                           outbytes) != outbytes) {
+      // 8-byte binary output ///////////////////////////////////////
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 8\n");
+        OC_REAL8 check;
+        Vf_OvfFileFormatSpecs::GetCheckValue(check);
+        if(swap) Oc_Flip8(&check);
+        if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
+                           sizeof(check)) != sizeof(check)) {
           OC_THROW(Oc_Exception(__FILE__,__LINE__,
                                 "Vf_Ovf20FileHeader","WriteData",
                                 "Write error (device full?)"));
         }
-        din += veclen*record_count;
       }
-#if (OC_BYTEORDER == 4321)  // Input is LSB; flip may not be required
-    }
-#endif // OC_BYTEORDER
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 8\n");
+      VfWriteBinaryData<OC_REAL8>(outchan,data_array,nodecount,locmesh,swap);
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 8\n");
+      }
     }
   }
 
@@ -4344,175 +4617,48 @@ Vf_Ovf20FileHeader::WriteData
     if(!bare) {
       Nb_FprintfChannel(outchan, NULL, 1024, "# End: Data Text\n");
     }
-  } else if(datastyle == vf_obin4) {
-    // 4-byte binary output (little endian order) ////////////////////
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 4\n");
-      OC_REAL4 check;
-      Vf_OvfFileFormatSpecs::GetCheckValue(check);
-
-      // OVF 1.0 uses MSB order, 2.0 uses LSB order
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_Flip4(&check);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_Flip4(&check);
-#endif
-      if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
-                         sizeof(check)) != sizeof(check)) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
-      }
-    }
-
-    const OC_INDEX stride = 1024; // Number of nodes blocked together for output
-    OC_INDEX record_count = stride;
-    const OC_INDEX reclen = veclen
-      + (output_meshtype == vf_ovf20mesh_irregular ? 3 : 0);
-    OC_INDEX outwords = reclen*stride;
-    OC_INDEX outbytes = outwords*OC_INDEX(sizeof(OC_REAL4));
-
-    Oc_AutoBuf workbuf; // Workspace.  Tweak to insure good alignment
-    workbuf.SetLength(outbytes+sizeof(OC_REAL4)-1 + 10000);
-    char* foo_align = workbuf.GetStr();
-    int foo_offset = static_cast<int>((foo_align-(char*)0)% sizeof(OC_REAL4));
-    if(foo_offset>0) foo_align += sizeof(OC_REAL4) - foo_offset;
-    OC_REAL4* const d4buf = reinterpret_cast<OC_REAL4*>(foo_align);
-
-    for(OC_INDEX node=0;node<nodecount;node+=stride) {
-      if(node+stride>nodecount) {
-        record_count = nodecount-node;
-        outwords = reclen * record_count;
-        outbytes = outwords * OC_INDEX(sizeof(OC_REAL4));
-      }
-      if(output_meshtype == vf_ovf20mesh_irregular) {
-        OC_REAL4* dout = d4buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          OC_REAL8m x,y,z;
-          mesh->GetCellCenter(static_cast<OC_INDEX>(node+j),x,y,z);
-          *(++dout) = static_cast<OC_REAL4>(x);
-          *(++dout) = static_cast<OC_REAL4>(y);
-          *(++dout) = static_cast<OC_REAL4>(z);
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            const OC_REAL8m* din = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              *(++dout) = static_cast<OC_REAL4>(din[elt]);
-            }
-          }
-        }
-      } else {
-        OC_REAL4* dout = d4buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            const OC_REAL8m* din = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              *(++dout) = static_cast<OC_REAL4>(din[elt]);
-            }
-          }
+  } else if(datastyle == vf_obin4 || datastyle == vf_obin8) {
+    // Binary output.  OVF 1.0 uses MSB order, 2.0 uses LSB order.
+    const OC_BOOL swap = VfBinarySwapNeeded(ovfversion != vf_ovf_10);
+    const Vf_Ovf20_MeshNodes* locmesh
+      = (output_meshtype == vf_ovf20mesh_irregular ? mesh : NULL);
+    if(datastyle == vf_obin4) {
+      // 4-byte binary output ///////////////////////////////////////
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 4\n");
+        OC_REAL4 check;
+        Vf_OvfFileFormatSpecs::GetCheckValue(check);
+        if(swap) Oc_Flip4(&check);
+        if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
+                           sizeof(check)) != sizeof(check)) {
+          OC_THROW(Oc_Exception(__FILE__,__LINE__,
+                                "Vf_Ovf20FileHeader","WriteData",
+                                "Write error (device full?)"));
         }
       }
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_SwapWords4(d4buf,outwords);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_SwapWords4(d4buf,outwords);
-#endif
-      if(Nb_WriteChannel(outchan,reinterpret_cast<char*>(d4buf),
-                         outbytes)!= outbytes) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
-      }
-    }
-
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 4\n");
-    }
-
-  } else if(datastyle == vf_obin8) {
-    // 8-byte binary output (little endian order) ////////////////////
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 8\n");
-      OC_REAL8 check;
-      Vf_OvfFileFormatSpecs::GetCheckValue(check);
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_Flip8(&check);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_Flip8(&check);
-#endif
-
-      if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
-                         sizeof(check)) != sizeof(check)) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
-      }
-    }
-
-    const OC_INDEX stride = 1024; // Number of nodes blocked together for output
-    OC_INDEX record_count = stride;
-    const OC_INDEX reclen = veclen
-      + (output_meshtype == vf_ovf20mesh_irregular ? 3 : 0);
-    OC_INDEX outwords = reclen*stride;
-    OC_INDEX outbytes = outwords*OC_INDEX(sizeof(OC_REAL8));
-
-    Oc_AutoBuf workbuf; // Workspace.  Tweak to insure good alignment
-    workbuf.SetLength(outbytes+sizeof(OC_REAL8)-1 + 10000);
-    char* foo_align = workbuf.GetStr();
-    int foo_offset = static_cast<int>((foo_align-(char*)0)% sizeof(OC_REAL8));
-    if(foo_offset>0) foo_align += sizeof(OC_REAL8) - foo_offset;
-    OC_REAL8* const d8buf = reinterpret_cast<OC_REAL8*>(foo_align);
-
-    for(OC_INDEX node=0;node<nodecount;node+=stride) {
-      if(node+stride>nodecount) {
-        record_count = nodecount-node;
-        outwords = reclen * record_count;
-        outbytes = outwords * OC_INDEX(sizeof(OC_REAL8));
+      VfWriteBinaryData<OC_REAL4>(outchan,data_array,nodecount,locmesh,swap);
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 4\n");
       }
-      if(output_meshtype == vf_ovf20mesh_irregular) {
-        OC_REAL8* dout = d8buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          OC_REAL8m x,y,z;
-          mesh->GetCellCenter(static_cast<OC_INDEX>(node+j),x,y,z);
-          *(++dout) = static_cast<OC_REAL8>(x);
-          *(++dout) = static_cast<OC_REAL8>(y);
-          *(++dout) = static_cast<OC_REAL8>(z);
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            const OC_REAL8m* din = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              *(++dout) = static_cast<OC_REAL8>(din[elt]);
-            }
-          }
-        }
-      } else {
-        OC_REAL8* dout = d8buf - 1;
-        for(OC_INDEX j=0;j<record_count;++j) {
-          for(OC_INDEX ida=0;ida<data_array_count;++ida) {
-            const OC_INDEX ddim = data_array[ida].vector_dimension;
-            const OC_REAL8m* din = data_array[ida].data + (node+j)*ddim;
-            for(OC_INDEX elt=0;elt<ddim;++elt) {
-              *(++dout) = static_cast<OC_REAL8>(din[elt]);
-            }
-          }
+    } else {
+      // 8-byte binary output ///////////////////////////////////////
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "# Begin: Data Binary 8\n");
+        OC_REAL8 check;
+        Vf_OvfFileFormatSpecs::GetCheckValue(check);
+        if(swap) Oc_Flip8(&check);
+        if(Nb_WriteChannel(outchan,reinterpret_cast<const char*>(&check),
+                           sizeof(check)) != sizeof(check)) {
+          OC_THROW(Oc_Exception(__FILE__,__LINE__,
+                                "Vf_Ovf20FileHeader","WriteData",
+                                "Write error (device full?)"));
         }
       }
-#if (OC_BYTEORDER != 4321)  // Input is MSB
-      if(ovfversion != vf_ovf_10) Oc_SwapWords8(d8buf,outwords);
-#else                    // Input is LSB
-      if(ovfversion == vf_ovf_10) Oc_SwapWords8(d8buf,outwords);
-#endif
-      if(Nb_WriteChannel(outchan,reinterpret_cast<char*>(d8buf),
-                         outbytes)!= outbytes) {
-        OC_THROW(Oc_Exception(__FILE__,__LINE__,
-                              "Vf_Ovf20FileHeader","WriteData",
-                              "Write error (device full?)"));
+      VfWriteBinaryData<OC_REAL8>(outchan,data_array,nodecount,locmesh,swap);
+      if(!bare) {
+        Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 8\n");
       }
     }
-    if(!bare) {
-      Nb_FprintfChannel(outchan, NULL, 1024, "\n# End: Data Binary 8\n");
-    }
   }
 
   if(!bare) {